@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
 
 #include "basebox_api.h"
+#include "basebox_grpc_datapath.h"
 #include "basebox_grpc_statistics.h"
 #include "sai.h"
 
@@ -16,10 +17,15 @@
 namespace basebox {
 
 ApiServer::ApiServer(std::shared_ptr<switch_interface> swi,
+                     std::shared_ptr<cnetlink> nl,
                      std::shared_ptr<port_manager> port_man)
-    : stats(new NetworkStats(swi, port_man)) {}
+    : stats(new NetworkStats(swi, port_man)),
+      datapath_stats(new DatapathStats(nl, port_man)) {}
 
-ApiServer::~ApiServer() { delete stats; }
+ApiServer::~ApiServer() {
+  delete stats;
+  delete datapath_stats;
+}
 
 void ApiServer::runGRPCServer() {
   std::string server_address("0.0.0.0:5000");
@@ -27,6 +33,7 @@ void ApiServer::runGRPCServer() {
 
   builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
   builder.RegisterService(stats);
+  builder.RegisterService(datapath_stats);
   std::unique_ptr<::grpc::Server> server = builder.BuildAndStart();
   LOG(INFO) << "gRPC server listening on " << server_address;
   server->Wait();
@@ -8,19 +8,23 @@
 namespace basebox {
 
 // forward declarations
+class DatapathStats;
 class NetworkStats;
+class cnetlink;
 class switch_interface;
 class port_manager;
 
 class ApiServer final {
 public:
   ApiServer(std::shared_ptr<switch_interface> swi,
+            std::shared_ptr<cnetlink> nl,
             std::shared_ptr<port_manager> port_man);
   void runGRPCServer();
   ~ApiServer();
 
 private:
   NetworkStats *stats;
+  DatapathStats *datapath_stats;
 };
 
 } // namespace basebox
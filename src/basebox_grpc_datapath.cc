@@ -0,0 +1,260 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include <cstdio>
+#include <glog/logging.h>
+#include <map>
+#include <sstream>
+#include <utility>
+
+#include "basebox_grpc_datapath.h"
+#include "netlink/cnetlink.h"
+#include "netlink/port_manager.h"
+#include "of-dpa/ofdpa_rpc_stats.h"
+#include "utils/convergence_stats.h"
+#include "utils/punt_stats.h"
+#include "utils/trace_ring.h"
+
+namespace basebox {
+
+using ::datapath::ConvergenceEvent;
+using ::datapath::ConvergenceStatistics;
+using ::datapath::LatencyBucket;
+using ::datapath::LatencyHistogram;
+using ::datapath::MacMove;
+using ::datapath::MacMoveStatistics;
+using ::datapath::OfdpaRpc;
+using ::datapath::OfdpaRpcStatistics;
+using ::datapath::PuntClass;
+using ::datapath::PuntHop;
+using ::datapath::PuntPathStatistics;
+using ::datapath::PuntPort;
+using ::datapath::PuntStatistics;
+using ::datapath::TapQueue;
+using ::datapath::TapQueueStatistics;
+using ::datapath::Trace;
+
+static void set_latency(LatencyHistogram *lat, const latency_stats &ls) {
+  lat->set_count(ls.count);
+  lat->set_mean_ns(ls.mean_ns);
+  lat->set_p50_ns(ls.p50_ns);
+  lat->set_p90_ns(ls.p90_ns);
+  lat->set_p99_ns(ls.p99_ns);
+  lat->set_p999_ns(ls.p999_ns);
+  lat->set_max_ns(ls.max_ns);
+  for (const auto &b : ls.buckets) {
+    LatencyBucket *bucket = lat->add_bucket();
+    bucket->set_upper_ns(b.first);
+    bucket->set_count(b.second);
+  }
+}
+
+DatapathStats::DatapathStats(std::shared_ptr<cnetlink> nl,
+                             std::shared_ptr<port_manager> port_man)
+    : nl(std::move(nl)), port_man(std::move(port_man)) {}
+
+::grpc::Status DatapathStats::GetTapQueueStatistics(
+    __attribute__((unused))::grpc::ServerContext *context,
+    __attribute__((unused)) const Empty *request,
+    TapQueueStatistics *response) {
+  VLOG(2) << __FUNCTION__ << ": received grpc call";
+
+  for (const auto &qs : port_man->get_queue_statistics()) {
+    TapQueue *queue = response->add_queue();
+
+    queue->set_name(qs.name);
+    queue->set_queue(qs.queue);
+    queue->set_worker(qs.worker);
+    queue->set_rx_packets(qs.rx_packets);
+    queue->set_rx_bytes(qs.rx_bytes);
+    queue->set_rx_dropped(qs.rx_dropped);
+    queue->set_tx_packets(qs.tx_packets);
+    queue->set_tx_bytes(qs.tx_bytes);
+    queue->set_tx_dropped(qs.tx_dropped);
+  }
+
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status DatapathStats::GetPuntStatistics(
+    __attribute__((unused))::grpc::ServerContext *context,
+    __attribute__((unused)) const Empty *request, PuntStatistics *response) {
+  VLOG(2) << __FUNCTION__ << ": received grpc call";
+
+  for (const auto &cs : nl->get_punt_statistics()) {
+    PuntClass *cls = response->add_class_();
+
+    cls->set_name(cs.name);
+    cls->set_rate(cs.rate);
+    cls->set_queued(cs.queued);
+    cls->set_packets(cs.packets);
+    cls->set_bytes(cs.bytes);
+    cls->set_policed(cs.policed);
+    cls->set_overflow(cs.overflow);
+  }
+
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status DatapathStats::GetPuntPathStatistics(
+    __attribute__((unused))::grpc::ServerContext *context,
+    __attribute__((unused)) const Empty *request,
+    PuntPathStatistics *response) {
+  VLOG(2) << __FUNCTION__ << ": received grpc call";
+
+  std::map<uint32_t, std::string> names;
+  for (const auto &p : port_man->get_port_map()->names)
+    names.emplace(p.second, p.first);
+
+  for (const auto &ps : punt_port_statistics()) {
+    PuntPort *port = response->add_port();
+
+    port->set_port_id(ps.port_id);
+    auto it = names.find(ps.port_id);
+    if (it != names.end())
+      port->set_name(it->second);
+
+    for (int h = 0; h < PUNT_HOP_MAX; h++) {
+      const punt_hop_stats &hs = ps.hops[h];
+      PuntHop *hop = port->add_hop();
+
+      hop->set_name(punt_hop_name(static_cast<enum punt_hop>(h)));
+      hop->set_packets(hs.packets);
+      hop->set_bytes(hs.bytes);
+      for (int i = 0; i < PUNT_DROP_MAX; i++) {
+        if (hs.drops[i])
+          (*hop->mutable_drops())[punt_drop_name(
+              static_cast<enum punt_drop>(i))] = hs.drops[i];
+      }
+      for (int i = 0; i < PUNT_ETH_MAX; i++) {
+        if (hs.ethertypes[i])
+          (*hop->mutable_ethertypes())[punt_ethertype_name(
+              static_cast<enum punt_ethertype>(i))] = hs.ethertypes[i];
+      }
+    }
+  }
+
+  for (const auto &ls : punt_latency_statistics()) {
+    LatencyHistogram *lat = response->add_latency();
+
+    lat->set_name(ls.name);
+    set_latency(lat, ls);
+  }
+
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status DatapathStats::GetOfdpaRpcStatistics(
+    __attribute__((unused))::grpc::ServerContext *context,
+    __attribute__((unused)) const Empty *request,
+    OfdpaRpcStatistics *response) {
+  VLOG(2) << __FUNCTION__ << ": received grpc call";
+
+  for (const auto &rs : ofdpa_rpc_statistics()) {
+    OfdpaRpc *rpc = response->add_rpc();
+
+    rpc->set_name(rs.name);
+    rpc->set_calls(rs.calls);
+    rpc->set_inflight(rs.inflight);
+    rpc->set_ofdpa_errors(rs.ofdpa_errors);
+    rpc->set_deadline_exceeded(rs.deadline_exceeded);
+    rpc->set_unavailable(rs.unavailable);
+    rpc->set_cancelled(rs.cancelled);
+    rpc->set_rpc_errors(rs.rpc_errors);
+
+    LatencyHistogram *lat = rpc->mutable_latency();
+    lat->set_name(rs.name);
+    set_latency(lat, rs.latency);
+  }
+
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status DatapathStats::GetConvergenceStatistics(
+    __attribute__((unused))::grpc::ServerContext *context,
+    __attribute__((unused)) const Empty *request,
+    ConvergenceStatistics *response) {
+  VLOG(2) << __FUNCTION__ << ": received grpc call";
+
+  ConvergenceEvent *ev = nullptr;
+
+  // the stages of an event are reported next to each other
+  for (const auto &cs : conv_latency_statistics()) {
+    if (ev == nullptr || ev->name() != cs.event) {
+      ev = response->add_event();
+      ev->set_name(cs.event);
+    }
+
+    LatencyHistogram *lat = ev->add_stage();
+    lat->set_name(cs.stage);
+    set_latency(lat, cs);
+  }
+
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status
+DatapathStats::GetTrace(__attribute__((unused))::grpc::ServerContext *context,
+                        __attribute__((unused)) const Empty *request,
+                        Trace *response) {
+  VLOG(2) << __FUNCTION__ << ": received grpc call";
+
+  if (!trace_enabled.load(std::memory_order_relaxed))
+    return ::grpc::Status::OK;
+
+  std::ostringstream os;
+  trace_dump(os);
+  response->set_data(os.str());
+
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status DatapathStats::GetMacMoveStatistics(
+    __attribute__((unused))::grpc::ServerContext *context,
+    __attribute__((unused)) const Empty *request,
+    MacMoveStatistics *response) {
+  VLOG(2) << __FUNCTION__ << ": received grpc call";
+
+  mac_move_stats stats = nl->get_mac_move_statistics();
+
+  response->set_moves(stats.moves);
+  response->set_suppressed(stats.suppressed);
+  response->set_holddowns(stats.holddowns);
+  response->set_held(stats.held);
+
+  if (stats.events.empty())
+    return ::grpc::Status::OK;
+
+  std::map<uint32_t, std::string> names;
+  for (const auto &p : port_man->get_port_map()->names)
+    names.emplace(p.second, p.first);
+
+  for (const auto &ev : stats.events) {
+    MacMove *move = response->add_event();
+    uint64_t mac = ev.key >> 16;
+    char buf[18];
+
+    snprintf(buf, sizeof(buf), "%02x:%02x:%02x:%02x:%02x:%02x",
+             unsigned(mac >> 40) & 0xff, unsigned(mac >> 32) & 0xff,
+             unsigned(mac >> 24) & 0xff, unsigned(mac >> 16) & 0xff,
+             unsigned(mac >> 8) & 0xff, unsigned(mac) & 0xff);
+    move->set_mac(buf);
+    move->set_vid(ev.key & 0xfff);
+    move->set_from_port_id(ev.from);
+    move->set_to_port_id(ev.to);
+    auto it = names.find(ev.from);
+    if (it != names.end())
+      move->set_from_port(it->second);
+    it = names.find(ev.to);
+    if (it != names.end())
+      move->set_to_port(it->second);
+    move->set_moves(ev.moves);
+    move->set_holddown(ev.holddown);
+    move->set_timestamp(ev.timestamp);
+    move->set_active(ev.active);
+  }
+
+  return ::grpc::Status::OK;
+}
+
+} // namespace basebox
@@ -0,0 +1,57 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#pragma once
+
+#include <grpcpp/grpcpp.h>
+
+#include "datapath/datapath-service.grpc.pb.h"
+
+namespace basebox {
+
+// forward declarations
+class cnetlink;
+class port_manager;
+
+class DatapathStats final : public ::datapath::DatapathStatistics::Service {
+public:
+  typedef ::empty::Empty Empty;
+
+  DatapathStats(std::shared_ptr<cnetlink> nl,
+                std::shared_ptr<port_manager> port_man);
+
+  virtual ~DatapathStats(){};
+
+  ::grpc::Status
+  GetTapQueueStatistics(::grpc::ServerContext *context, const Empty *request,
+                        ::datapath::TapQueueStatistics *response) override;
+
+  ::grpc::Status
+  GetPuntStatistics(::grpc::ServerContext *context, const Empty *request,
+                    ::datapath::PuntStatistics *response) override;
+
+  ::grpc::Status
+  GetPuntPathStatistics(::grpc::ServerContext *context, const Empty *request,
+                        ::datapath::PuntPathStatistics *response) override;
+
+  ::grpc::Status
+  GetOfdpaRpcStatistics(::grpc::ServerContext *context, const Empty *request,
+                        ::datapath::OfdpaRpcStatistics *response) override;
+
+  ::grpc::Status GetConvergenceStatistics(
+      ::grpc::ServerContext *context, const Empty *request,
+      ::datapath::ConvergenceStatistics *response) override;
+
+  ::grpc::Status GetTrace(::grpc::ServerContext *context, const Empty *request,
+                          ::datapath::Trace *response) override;
+
+  ::grpc::Status
+  GetMacMoveStatistics(::grpc::ServerContext *context, const Empty *request,
+                       ::datapath::MacMoveStatistics *response) override;
+
+private:
+  std::shared_ptr<cnetlink> nl;
+  std::shared_ptr<port_manager> port_man;
+};
+
+} // namespace basebox
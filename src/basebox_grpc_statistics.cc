@@ -38,9 +38,9 @@ NetworkStats::NetworkStats(std::shared_ptr<switch_interface> swi,
       switch_interface::SAI_PORT_STAT_RX_OVER_ERR,
       switch_interface::SAI_PORT_STAT_RX_CRC_ERR,
       switch_interface::SAI_PORT_STAT_COLLISIONS};
-  std::map<std::string, uint32_t> ports = port_man->get_registered_ports();
+  auto ports = port_man->get_port_map();
 
-  for (const auto &port : ports) {
+  for (const auto &port : ports->names) {
     std::vector<uint64_t> stats(counter_ids.size());
     int rv = swi->get_statistics(port.second, counter_ids.size(),
                                  counter_ids.data(), stats.data());
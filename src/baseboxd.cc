@@ -4,6 +4,7 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include <csignal>
 #include <unistd.h>
 
 #include "basebox_api.h"
@@ -11,24 +12,56 @@
 #include "netlink/nbi_impl.h"
 #include "netlink/knet_manager.h"
 #include "netlink/tap_manager.h"
+#include "netlink/veth_manager.h"
 #include "of-dpa/controller.h"
+#include "utils/log_limit.h"
+#include "utils/trace_ring.h"
 #include "version.h"
 
 DECLARE_string(tryfromenv); // from gflags
-DEFINE_bool(multicast, true, "Enable multicast support");
+
+// shared with the offline tools, defined in netlink/nl_flags.cc
+DECLARE_int32(port_untagged_vid);
+DECLARE_int32(punt_rate_control);
+DECLARE_int32(punt_rate_routing);
+DECLARE_int32(punt_rate_arp_nd);
+DECLARE_int32(punt_rate_other);
+DECLARE_int32(mac_move_threshold);
+DECLARE_int32(mac_move_window);
+DECLARE_int32(mac_move_holddown);
+DECLARE_int32(mac_move_holddown_max);
+
 DEFINE_int32(port, 6653, "Listening port");
 DEFINE_int32(ofdpa_grpc_port, 50051, "Listening port of ofdpa gRPC server");
 DEFINE_bool(use_knet, true, "Use KNET interfaces");
-DEFINE_bool(mark_fwd_offload, true, "Mark switched packets as offloaded");
 DEFINE_bool(clear_switch_configuration, true,
             "Clear switch configuration on connect");
-DEFINE_int32(port_untagged_vid, 1,
-             "VLAN ID used for untagged traffic on unbridged ports");
 DEFINE_int32(
     rx_rate_limit, -1,
     "PPS limit for traffic to controller (-1 = auto, 0 = force unlimited)");
 DEFINE_int32(of_timeout_echo, 6, "timeout of sent echo requests");
 DEFINE_int32(of_timeout_lifecheck, 10, "delay of life check after last rx");
+DEFINE_int32(tap_queues, 1,
+             "Number of queues per tap interface (> 1 = IFF_MULTI_QUEUE)");
+DEFINE_int32(tap_io_threads, 1, "Number of tap I/O worker threads");
+DEFINE_string(tap_io_cpus, "",
+              "Comma separated list of CPUs to pin tap I/O workers to");
+DEFINE_bool(tap_vnet_hdr, false,
+            "Enable IFF_VNET_HDR with checksum and TSO offload on taps");
+DEFINE_string(tap_io_engine, "poll", "tap I/O engine (poll, io_uring)");
+DEFINE_bool(use_veth, false,
+            "Use veth pairs with AF_PACKET rings instead of tap interfaces");
+DEFINE_int32(ofdpa_rpc_timeout, 10000,
+             "Deadline of calls to the OF-DPA agent in ms (0 = none)");
+DEFINE_int32(trace_records, 0,
+             "Records kept per thread by the event tracer (0 = disabled)");
+DEFINE_string(trace_file, "/tmp/baseboxd-trace.json",
+              "Write the event trace to this file on SIGUSR2");
+DEFINE_int32(log_rate_limit, 10,
+             "Messages per second of a rate limited log statement "
+             "(0 = unlimited)");
+DEFINE_int32(log_async_queue, 4096,
+             "Rate limited messages queued for the log thread (0 = no thread)");
 
 static bool validate_port(const char *flagname, gflags::int32 value) {
   VLOG(3) << __FUNCTION__ << ": flagname=" << flagname << ", value=" << value;
@@ -37,6 +70,46 @@ static bool validate_port(const char *flagname, gflags::int32 value) {
   return false;
 }
 
+static bool validate_tap_io(const char *flagname, gflags::int32 value) {
+  VLOG(3) << __FUNCTION__ << ": flagname=" << flagname << ", value=" << value;
+  if (value > 0 && value <= 256) // value is ok
+    return true;
+  return false;
+}
+
+static bool validate_tap_io_engine(const char *flagname,
+                                   const std::string &value) {
+  VLOG(3) << __FUNCTION__ << ": flagname=" << flagname << ", value=" << value;
+  if (value == "poll")
+    return true;
+#ifdef HAVE_LIBURING
+  if (value == "io_uring")
+    return true;
+#endif
+  return false;
+}
+
+static bool validate_non_negative(const char *flagname, gflags::int32 value) {
+  VLOG(3) << __FUNCTION__ << ": flagname=" << flagname << ", value=" << value;
+  if (value >= 0) // value is ok
+    return true;
+  return false;
+}
+
+static bool validate_trace_records(const char *flagname, gflags::int32 value) {
+  VLOG(3) << __FUNCTION__ << ": flagname=" << flagname << ", value=" << value;
+  if (value >= 0 && value <= (1 << 24)) // value is ok
+    return true;
+  return false;
+}
+
+static bool validate_mac_move(const char *flagname, gflags::int32 value) {
+  VLOG(3) << __FUNCTION__ << ": flagname=" << flagname << ", value=" << value;
+  if (value > 0 && value <= 86400) // value is ok
+    return true;
+  return false;
+}
+
 static bool validate_vid(const char *flagname, gflags::int32 value) {
   VLOG(3) << __FUNCTION__ << ": flagname=" << flagname << ", value=" << value;
   if (value > 0 && value <= 4095) // value is ok
@@ -51,6 +124,7 @@ int main(int argc, char **argv) {
   using basebox::nbi_impl;
   using basebox::port_manager;
   using basebox::tap_manager;
+  using basebox::veth_manager;
   bool have_knet = false;
 
   if (!gflags::RegisterFlagValidator(&FLAGS_port, &validate_port)) {
@@ -68,11 +142,58 @@ int main(int argc, char **argv) {
     exit(1);
   }
 
+  if (!gflags::RegisterFlagValidator(&FLAGS_tap_queues, &validate_tap_io)) {
+    std::cerr << "Failed to register tap queues validator" << std::endl;
+    exit(1);
+  }
+
+  if (!gflags::RegisterFlagValidator(&FLAGS_tap_io_threads,
+                                     &validate_tap_io)) {
+    std::cerr << "Failed to register tap io threads validator" << std::endl;
+    exit(1);
+  }
+
+  if (!gflags::RegisterFlagValidator(&FLAGS_tap_io_engine,
+                                     &validate_tap_io_engine)) {
+    std::cerr << "Failed to register tap io engine validator" << std::endl;
+    exit(1);
+  }
+
+  for (auto *flag : {&FLAGS_punt_rate_control, &FLAGS_punt_rate_routing,
+                     &FLAGS_punt_rate_arp_nd, &FLAGS_punt_rate_other,
+                     &FLAGS_ofdpa_rpc_timeout, &FLAGS_log_rate_limit,
+                     &FLAGS_log_async_queue, &FLAGS_mac_move_threshold}) {
+    if (!gflags::RegisterFlagValidator(flag, &validate_non_negative)) {
+      std::cerr << "Failed to register non-negative validator" << std::endl;
+      exit(1);
+    }
+  }
+
+  if (!gflags::RegisterFlagValidator(&FLAGS_trace_records,
+                                     &validate_trace_records)) {
+    std::cerr << "Failed to register trace records validator" << std::endl;
+    exit(1);
+  }
+
+  for (auto *flag : {&FLAGS_mac_move_window, &FLAGS_mac_move_holddown,
+                     &FLAGS_mac_move_holddown_max}) {
+    if (!gflags::RegisterFlagValidator(flag, &validate_mac_move)) {
+      std::cerr << "Failed to register mac move validator" << std::endl;
+      exit(1);
+    }
+  }
+
   // all variables can be set from env
   FLAGS_tryfromenv =
       std::string("multicast,port,ofdpa_grpc_port,use_knet,mark_"
                   "fwd_offload,port_untagged_vid,of_timeout_lifecheck,of_"
-                  "timeout_echo");
+                  "timeout_echo,tap_queues,tap_io_threads,tap_io_cpus,tap_vnet_"
+                  "hdr,tap_io_engine,use_veth,punt_rate_control,punt_rate_"
+                  "routing,punt_rate_arp_nd,punt_rate_other,ofdpa_rpc_"
+                  "timeout,nl_capture,swi_record,trace_records,trace_file,"
+                  "log_rate_limit,log_async_queue,fdb_soft_ageing,mac_move_"
+                  "threshold,mac_move_window,mac_move_holddown,mac_move_"
+                  "holddown_max");
   gflags::SetUsageMessage("");
   gflags::SetVersionString(PROJECT_VERSION);
 
@@ -80,6 +201,16 @@ int main(int argc, char **argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
   google::InitGoogleLogging(argv[0]);
 
+  // before any thread is started, they inherit the blocked signal
+  if (FLAGS_trace_records > 0) {
+    basebox::trace_enable(FLAGS_trace_records);
+    basebox::trace_dump_on_signal(SIGUSR2, FLAGS_trace_file);
+  }
+
+  basebox::log_limit_init(FLAGS_log_rate_limit);
+  if (FLAGS_log_async_queue > 0)
+    basebox::log_async_start(FLAGS_log_async_queue);
+
   rofl::openflow::cofhello_elem_versionbitmap versionbitmap;
   versionbitmap.add_ofp_version(rofl::openflow13::OFP_VERSION);
   LOG(INFO) << __FUNCTION__
@@ -100,6 +231,8 @@ int main(int argc, char **argv) {
 
   if (FLAGS_use_knet && have_knet)
     port_man.reset(new knet_manager());
+  else if (FLAGS_use_veth)
+    port_man.reset(new veth_manager());
   else
     port_man.reset(new tap_manager());
 
@@ -110,8 +243,9 @@ int main(int argc, char **argv) {
   rofl::csockaddr baddr(AF_INET, std::string("0.0.0.0"), FLAGS_port);
   box->dpt_sock_listen(baddr);
 
-  basebox::ApiServer grpcConnector(box, port_man);
+  basebox::ApiServer grpcConnector(box, nl, port_man);
   grpcConnector.runGRPCServer();
+  basebox::log_async_stop();
 
   LOG(INFO) << "bye";
   return EXIT_SUCCESS;
@@ -0,0 +1,455 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <netlink/addr.h>
+#include <netlink/route/link.h>
+#include <netlink/route/link/bridge.h>
+
+#include "netlink/netlink-utils.h"
+#include "netlink/nl_bridge.h"
+#include "netlink/nl_fdb_table.h"
+#include "netlink/nl_l3_interfaces.h"
+#include "utils/rofl-utils.h"
+
+DEFINE_int32(min_time_ms, 200, "Minimum run time of every repetition");
+DEFINE_int32(repetitions, 5,
+             "Repetitions of every benchmark, the median is reported");
+DEFINE_string(filter, "", "Run only the benchmarks containing this string");
+DEFINE_uint64(seed, 1, "Seed of the generated keys");
+
+namespace {
+
+using basebox::nh_stub;
+using clock = std::chrono::steady_clock;
+
+static bool validate_positive(const char *flagname, gflags::int32 value) {
+  VLOG(3) << __FUNCTION__ << ": flagname=" << flagname << ", value=" << value;
+  if (value > 0) // value is ok
+    return true;
+  return false;
+}
+
+// keeps the compiler from optimizing away the benchmarked code
+template <class T> static inline void keep(T const &v) {
+  asm volatile("" : : "r,m"(v) : "memory");
+}
+
+/**
+ * run fn, which handles batch operations per call, until min_time_ms passed
+ * and print the median time per operation of all repetitions
+ */
+static void bench(const std::string &name, size_t batch,
+                  const std::function<void()> &fn) {
+  if (!FLAGS_filter.empty() && name.find(FLAGS_filter) == std::string::npos)
+    return;
+
+  std::vector<double> ns_per_op;
+  auto min_time = std::chrono::milliseconds(FLAGS_min_time_ms);
+
+  fn(); // warm up
+  for (int r = 0; r < FLAGS_repetitions; r++) {
+    uint64_t calls = 0;
+    auto start = clock::now();
+    auto now = start;
+
+    do {
+      fn();
+      calls++;
+      now = clock::now();
+    } while (now - start < min_time);
+
+    ns_per_op.push_back(std::chrono::duration<double, std::nano>(now - start)
+                            .count() /
+                        (calls * batch));
+  }
+
+  std::sort(ns_per_op.begin(), ns_per_op.end());
+  double median = ns_per_op[ns_per_op.size() / 2];
+  std::cout << std::left << std::setw(36) << name << std::right << std::fixed
+            << std::setprecision(1) << std::setw(10) << median
+            << std::setprecision(2) << std::setw(10)
+            << (median > 0 ? 1000 / median : 0) << std::endl;
+}
+
+static rofl::caddress_ll make_mac(uint8_t kind, uint32_t n) {
+  uint8_t mac[6] = {0x02,
+                    kind,
+                    static_cast<uint8_t>(n >> 24),
+                    static_cast<uint8_t>(n >> 16),
+                    static_cast<uint8_t>(n >> 8),
+                    static_cast<uint8_t>(n)};
+  return rofl::caddress_ll(mac, sizeof(mac));
+}
+
+/**
+ * nexthops as seen on a router: mostly IPv4 gateways on the connected
+ * networks of 48 ports, one in four is IPv6
+ */
+static std::vector<nh_stub> make_nexthops(std::mt19937_64 &rng, size_t n) {
+  std::vector<nh_stub> nhs;
+  std::uniform_int_distribution<int> port(0, 47);
+  std::uniform_int_distribution<uint32_t> host(2, 254);
+
+  nhs.reserve(n);
+  for (size_t i = 0; i < n; i++) {
+    int p = port(rng);
+    nl_addr *addr;
+
+    if (i % 4 == 3) {
+      uint8_t a[16] = {0x20, 0x01, 0x0d, 0xb8, 0, static_cast<uint8_t>(p)};
+      a[15] = host(rng);
+      addr = nl_addr_build(AF_INET6, a, sizeof(a));
+    } else {
+      uint8_t a[4] = {10, static_cast<uint8_t>(p), 0,
+                      static_cast<uint8_t>(host(rng))};
+      addr = nl_addr_build(AF_INET, a, sizeof(a));
+    }
+
+    // the ifindex of the ports follows lo and the bridge
+    nhs.emplace_back(addr, p + 3);
+    nl_addr_put(addr);
+  }
+
+  return nhs;
+}
+
+// ECMP groups are mostly narrow: 2, 4, 8 and 16 nexthops in 8:4:2:1
+static std::vector<std::set<nh_stub>>
+make_groups(std::mt19937_64 &rng, const std::vector<nh_stub> &nhs,
+            size_t n) {
+  std::vector<std::set<nh_stub>> groups;
+  std::discrete_distribution<int> width({8, 4, 2, 1});
+  std::uniform_int_distribution<size_t> nh(0, nhs.size() - 1);
+
+  groups.reserve(n);
+  for (size_t i = 0; i < n; i++) {
+    std::set<nh_stub> g;
+    size_t w = 2 << width(rng);
+
+    while (g.size() < w)
+      g.insert(nhs[nh(rng)]);
+    groups.push_back(std::move(g));
+  }
+
+  return groups;
+}
+
+static void bench_nh_hashing(std::mt19937_64 &rng) {
+  auto nhs = make_nexthops(rng, 4096);
+  auto groups = make_groups(rng, nhs, 1024);
+
+  bench("hash<nh_stub>", nhs.size(), [&]() {
+    size_t h = 0;
+    for (const auto &nh : nhs)
+      h ^= std::hash<nh_stub>{}(nh);
+    keep(h);
+  });
+
+  bench("hash<std::set<nh_stub>>", groups.size(), [&]() {
+    size_t h = 0;
+    for (const auto &g : groups)
+      h ^= std::hash<std::set<nh_stub>>{}(g);
+    keep(h);
+  });
+
+  // as nh_grp_to_l3_ecmp_mapping in nl_l3
+  std::unordered_map<std::set<nh_stub>, basebox::l3_interface> ecmp;
+  for (size_t i = 0; i < groups.size(); i++)
+    ecmp.emplace(groups[i], basebox::l3_interface(i + 1));
+
+  std::vector<size_t> order(groups.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), rng);
+
+  bench("ecmp group lookup", order.size(), [&]() {
+    uint32_t id = 0;
+    for (auto i : order)
+      id ^= ecmp.find(groups[i])->second.l3_interface_id;
+    keep(id);
+  });
+}
+
+/**
+ * next hop mappings of 48 ports: most neighbours are in the default VLAN,
+ * the others spread over 100 VLANs. Lookups hit in 95% of the cases.
+ */
+static void bench_l3_interface_mapping(std::mt19937_64 &rng) {
+  typedef basebox::l3_interface_map::key_type key;
+  basebox::l3_interface_map mapping;
+  std::vector<key> keys;
+  std::uniform_int_distribution<int> port(1, 48);
+  std::uniform_int_distribution<int> vlan(2, 101);
+  std::bernoulli_distribution untagged(0.7);
+
+  for (uint32_t i = 0; keys.size() < 16384; i++) {
+    int p = port(rng);
+    uint16_t vid = untagged(rng) ? 1 : vlan(rng);
+    key k{p, vid, make_mac(0, p), make_mac(1, i)};
+
+    if (mapping.emplace(k, basebox::l3_interface(i + 1)).second)
+      keys.push_back(k);
+  }
+
+  std::vector<key> lookups;
+  std::bernoulli_distribution miss(0.05);
+  std::uniform_int_distribution<size_t> idx(0, keys.size() - 1);
+  for (uint32_t i = 0; i < 16384; i++) {
+    if (miss(rng))
+      lookups.emplace_back(port(rng), 1, make_mac(0, 0), make_mac(2, i));
+    else
+      lookups.push_back(keys[idx(rng)]);
+  }
+
+  bench("l3_interface_mapping find", lookups.size(), [&]() {
+    uint32_t id = 0;
+    for (const auto &k : lookups) {
+      auto it = mapping.find(k);
+      if (it != mapping.end())
+        id ^= it->second.l3_interface_id;
+    }
+    keep(id);
+  });
+}
+
+/**
+ * links of a switch with 48 ports: ports in the bridge, VLAN interfaces on
+ * top of the bridge, bonds and their members, and a few VXLAN interfaces
+ */
+static void bench_get_link_type(std::mt19937_64 &rng) {
+  std::vector<rtnl_link *> links;
+  std::discrete_distribution<int> kind({60, 20, 10, 5, 5});
+
+  for (int i = 0; i < 1024; i++) {
+    rtnl_link *link = rtnl_link_alloc();
+
+    rtnl_link_set_ifindex(link, i + 1);
+    switch (kind(rng)) {
+    case 0:
+      rtnl_link_set_type(link, "tun");
+      rtnl_link_set_master(link, 2);
+      rtnl_link_set_slave_type(link, "bridge");
+      break;
+    case 1:
+      rtnl_link_set_type(link, "vlan");
+      break;
+    case 2:
+      rtnl_link_set_type(link, "tun");
+      rtnl_link_set_master(link, 3);
+      rtnl_link_set_slave_type(link, "bond");
+      break;
+    case 3:
+      rtnl_link_set_type(link, "bond");
+      break;
+    default:
+      rtnl_link_set_type(link, "vxlan");
+      break;
+    }
+    links.push_back(link);
+  }
+
+  bench("get_link_type", links.size(), [&]() {
+    int lt = 0;
+    for (auto link : links)
+      lt += basebox::get_link_type(link);
+    keep(lt);
+  });
+
+  for (auto link : links)
+    rtnl_link_put(link);
+}
+
+// 48 ports with their per VLAN states of 256 VLANs
+static void bench_stp_states(std::mt19937_64 &rng) {
+  basebox::bridge_stp_states states;
+  std::uniform_int_distribution<int> state(BR_STATE_DISABLED,
+                                           BR_STATE_BLOCKING);
+
+  for (int p = 1; p <= 48; p++) {
+    states.add_global_state(p, BR_STATE_FORWARDING);
+    for (uint16_t vid = 1; vid <= 256; vid++)
+      states.add_pvlan_state(p, vid, state(rng));
+  }
+
+  bench("bridge_stp_states::get_min_states", 48, [&]() {
+    size_t n = 0;
+    for (int p = 1; p <= 48; p++)
+      n += states.get_min_states(p).size();
+    keep(n);
+  });
+}
+
+// prefix lengths of an IPv6 table, dominated by /48
+static void bench_build_mask_in6(std::mt19937_64 &rng) {
+  std::vector<unsigned> lens;
+  std::discrete_distribution<int> kind({40, 20, 20, 10, 10});
+  std::uniform_int_distribution<unsigned> shorter(19, 47);
+  std::uniform_int_distribution<unsigned> longer(65, 127);
+
+  for (int i = 0; i < 4096; i++) {
+    switch (kind(rng)) {
+    case 0:
+      lens.push_back(48);
+      break;
+    case 1:
+      lens.push_back(shorter(rng));
+      break;
+    case 2:
+      lens.push_back(64);
+      break;
+    case 3:
+      lens.push_back(56);
+      break;
+    default:
+      lens.push_back(longer(rng));
+      break;
+    }
+  }
+
+  bench("rofl::build_mask_in6", lens.size(), [&]() {
+    uint8_t b = 0;
+    for (auto len : lens) {
+      uint8_t mask[16];
+      rofl::build_mask_in6(len).pack(mask, sizeof(mask));
+      b ^= mask[len / 8 - 1];
+    }
+    keep(b);
+  });
+}
+
+// the walk of nl_bridge::update_vlans over a changed VLAN bitmap
+static void walk_bitmap(const std::vector<uint32_t> &diff, int *sum) {
+  for (unsigned i = 0; i < RTNL_LINK_BRIDGE_VLAN_BITMAP_LEN; i++) {
+    int base_bit = i * 32;
+    for (int j = basebox::find_next_bit(-1, diff[i]); j > 0;
+         j = basebox::find_next_bit(j, diff[i]))
+      *sum += j - 1 + base_bit;
+  }
+}
+
+static void bench_vlan_bitmap(std::mt19937_64 &rng) {
+  std::uniform_int_distribution<unsigned> vid(1, 4094);
+  std::vector<uint32_t> sparse(RTNL_LINK_BRIDGE_VLAN_BITMAP_LEN);
+  std::vector<uint32_t> range(RTNL_LINK_BRIDGE_VLAN_BITMAP_LEN);
+  std::vector<uint32_t> full(RTNL_LINK_BRIDGE_VLAN_BITMAP_LEN);
+
+  for (int i = 0; i < 8; i++) {
+    unsigned v = vid(rng);
+    sparse[v / 32] |= 1U << (v % 32);
+  }
+  for (unsigned v = 100; v < 200; v++)
+    range[v / 32] |= 1U << (v % 32);
+  for (unsigned v = 1; v <= 4094; v++)
+    full[v / 32] |= 1U << (v % 32);
+
+  bench("vlan bitmap walk, 8 vids", 1, [&]() {
+    int sum = 0;
+    walk_bitmap(sparse, &sum);
+    keep(sum);
+  });
+
+  bench("vlan bitmap walk, 100 vids", 1, [&]() {
+    int sum = 0;
+    walk_bitmap(range, &sum);
+    keep(sum);
+  });
+
+  bench("vlan bitmap walk, 4094 vids", 1, [&]() {
+    int sum = 0;
+    walk_bitmap(full, &sum);
+    keep(sum);
+  });
+}
+
+// learned MACs of a large bridge, 128k MACs in 64 VLANs
+static void bench_fdb_table(std::mt19937_64 &rng) {
+  const uint32_t n = 128 * 1024;
+  basebox::nl_fdb_table fdb;
+  std::vector<rofl::caddress_ll> macs;
+  std::uniform_int_distribution<uint32_t> idx(0, n - 1);
+  std::vector<uint32_t> lookups(4096);
+
+  macs.reserve(n);
+  for (uint32_t i = 0; i < n; i++) {
+    macs.push_back(make_mac(0x10, rng()));
+    fdb.insert(macs[i].somem(), i % 64 + 1, i % 48 + 3);
+  }
+  for (auto &i : lookups)
+    i = idx(rng);
+
+  bench("nl_fdb_table::find, 128k macs", lookups.size(), [&]() {
+    uint32_t sum = 0;
+    for (auto i : lookups) {
+      auto e = fdb.find(macs[i].somem(), i % 64 + 1);
+      sum += e ? fdb.ifindex(*e) : 0;
+    }
+    keep(sum);
+  });
+
+  bench("nl_fdb_table::erase+insert", lookups.size(), [&]() {
+    for (auto i : lookups) {
+      fdb.erase(macs[i].somem(), i % 64 + 1);
+      fdb.insert(macs[i].somem(), i % 64 + 1, i % 48 + 3);
+    }
+  });
+
+  bench("nl_fdb_table::for_each, 128k macs", n, [&]() {
+    uint32_t sum = 0;
+    fdb.for_each([&fdb, &sum](const basebox::nl_fdb_entry &e) {
+      sum += fdb.ifindex(e);
+    });
+    keep(sum);
+  });
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (!gflags::RegisterFlagValidator(&FLAGS_min_time_ms, &validate_positive)) {
+    std::cerr << "Failed to register min_time_ms validator" << std::endl;
+    exit(1);
+  }
+
+  if (!gflags::RegisterFlagValidator(&FLAGS_repetitions, &validate_positive)) {
+    std::cerr << "Failed to register repetitions validator" << std::endl;
+    exit(1);
+  }
+
+  gflags::SetUsageMessage("microbenchmarks of the netlink data structures\n"
+                          "  nl-micro-bench [--filter=NAME]");
+
+  // init
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  std::mt19937_64 rng(FLAGS_seed);
+
+  std::cout << std::left << std::setw(36) << "benchmark" << std::right
+            << std::setw(10) << "ns/op" << std::setw(10) << "Mops/s"
+            << std::endl;
+
+  bench_nh_hashing(rng);
+  bench_l3_interface_mapping(rng);
+  bench_get_link_type(rng);
+  bench_stp_states(rng);
+  bench_build_mask_in6(rng);
+  bench_vlan_bitmap(rng);
+  bench_fdb_table(rng);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,767 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <linux/if_bridge.h>
+#include <net/if.h>
+#include <netlink/msg.h>
+#include <netlink/route/addr.h>
+#include <netlink/route/link.h>
+#include <netlink/route/link/bridge.h>
+#include <netlink/route/link/bridge_info.h>
+#include <netlink/route/neighbour.h>
+#include <netlink/route/nexthop.h>
+#include <netlink/route/route.h>
+#include <sched.h>
+#include <sys/mount.h>
+
+#include "netlink/cnetlink.h"
+#include "netlink/nbi_impl.h"
+#include "replay/replay_port_manager.h"
+#include "utils/swi_recorder.h"
+
+DECLARE_string(tryfromenv); // from gflags
+DEFINE_int32(routes, 1000, "Number of IPv4 and of IPv6 routes");
+DEFINE_int32(ecmp, 4, "Number of nexthops of each route");
+DEFINE_int32(neighbours, 1000, "Number of IPv4 and of IPv6 neighbours");
+DEFINE_int32(flaps, 1, "Number of times every neighbour is flapped");
+DEFINE_int32(macs, 10000, "Number of MAC addresses learned and aged");
+DEFINE_int32(vlans, 16, "Number of VLANs on every bridge port");
+DEFINE_int32(bridge_ports, 4, "Number of ports in the bridge");
+DEFINE_int32(timeout, 60, "Seconds to wait for a scenario to converge");
+
+// used by the netlink side, defined in netlink/nl_flags.cc
+DECLARE_int32(port_untagged_vid);
+
+namespace {
+
+using basebox::swi_method;
+using clock = std::chrono::steady_clock;
+
+static bool validate_count(const char *flagname, gflags::int32 value) {
+  VLOG(3) << __FUNCTION__ << ": flagname=" << flagname << ", value=" << value;
+  if (value >= 0 && value <= 1000000) // value is ok
+    return true;
+  return false;
+}
+
+static bool validate_neighbours(const char *flagname, gflags::int32 value) {
+  VLOG(3) << __FUNCTION__ << ": flagname=" << flagname << ", value=" << value;
+  if (value >= 0 && value <= 60000) // value is ok, fits into the subnets
+    return true;
+  return false;
+}
+
+static bool validate_ecmp(const char *flagname, gflags::int32 value) {
+  VLOG(3) << __FUNCTION__ << ": flagname=" << flagname << ", value=" << value;
+  if (value > 0 && value <= 64) // value is ok
+    return true;
+  return false;
+}
+
+static bool validate_vlans(const char *flagname, gflags::int32 value) {
+  VLOG(3) << __FUNCTION__ << ": flagname=" << flagname << ", value=" << value;
+  if (value >= 0 && value <= 4000) // value is ok
+    return true;
+  return false;
+}
+
+static bool validate_vid(const char *flagname, gflags::int32 value) {
+  VLOG(3) << __FUNCTION__ << ": flagname=" << flagname << ", value=" << value;
+  if (value > 0 && value <= 4095) // value is ok
+    return true;
+  return false;
+}
+
+/**
+ * convergence of a scenario
+ *
+ * Every operation sent to the kernel is expected to result in a number of
+ * calls of the given methods to the switch. cnetlink handles the events in
+ * the order they were sent, so the n-th call seen belongs to the n-th call
+ * issued and the difference is the time until the change reached the switch.
+ */
+class scenario {
+public:
+  scenario(const std::string &name, std::set<swi_method> methods,
+           const basebox::swi_recorder &sw)
+      : name(name), methods(std::move(methods)), sw(sw), ops(0),
+        start_calls(sw.calls()), start(clock::now()) {}
+
+  // an operation resulting in n calls is about to be sent
+  void issue(unsigned n) {
+    auto now = clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+
+    issued.insert(issued.end(), n, now);
+    ops++;
+  }
+
+  // switch observer, called by cnetlink
+  void observe(swi_method method) {
+    if (methods.find(method) == methods.end())
+      return;
+
+    auto now = clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (latencies.size() < issued.size())
+      latencies.push_back(std::chrono::duration<double, std::micro>(
+                              now - issued[latencies.size()])
+                              .count());
+    end = now;
+  }
+
+  // wait until all issued calls were seen
+  bool wait(std::chrono::seconds timeout) {
+    auto deadline = clock::now() + timeout;
+
+    while (clock::now() < deadline) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (latencies.size() == issued.size())
+          return true;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    LOG(ERROR) << name << ": " << latencies.size() << " of " << issued.size()
+               << " switch calls seen within " << timeout.count() << " s";
+    return false;
+  }
+
+  void report(std::ostream &os) {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t events = sw.calls() - start_calls;
+    double elapsed = 0;
+
+    if (!latencies.empty())
+      elapsed = std::chrono::duration<double>(end - start).count();
+
+    std::sort(latencies.begin(), latencies.end());
+    os << std::left << std::setw(16) << name << std::right << std::fixed
+       << std::setprecision(0) << std::setw(9) << ops << std::setw(10)
+       << events << std::setw(12) << (elapsed > 0 ? ops / elapsed : 0)
+       << std::setw(12) << (elapsed > 0 ? events / elapsed : 0)
+       << std::setw(10) << percentile(50) << std::setw(10) << percentile(99)
+       << std::endl;
+  }
+
+  static void report_header(std::ostream &os) {
+    os << std::left << std::setw(16) << "scenario" << std::right
+       << std::setw(9) << "ops" << std::setw(10) << "events" << std::setw(12)
+       << "ops/s" << std::setw(12) << "events/s" << std::setw(10) << "p50 us"
+       << std::setw(10) << "p99 us" << std::endl;
+  }
+
+private:
+  // latencies must be sorted
+  double percentile(unsigned p) const {
+    if (latencies.empty())
+      return 0;
+    return latencies[(latencies.size() - 1) * p / 100];
+  }
+
+  const std::string name;
+  const std::set<swi_method> methods;
+  const basebox::swi_recorder &sw;
+
+  std::mutex mutex;
+  uint64_t ops;
+  uint64_t start_calls;
+  clock::time_point start;
+  clock::time_point end;
+  std::vector<clock::time_point> issued;
+  std::vector<double> latencies;
+};
+
+/**
+ * configuration of the network namespace
+ *
+ * Thin wrappers around libnl, every request waits for the ack of the kernel.
+ */
+class kernel {
+public:
+  kernel() : sk(nl_socket_alloc()) {}
+  ~kernel() { nl_socket_free(sk); }
+
+  int connect() {
+    if (sk == nullptr)
+      return -ENOMEM;
+
+    int err = nl_connect(sk, NETLINK_ROUTE);
+    if (err < 0) {
+      LOG(ERROR) << __FUNCTION__ << ": failed to connect: " << nl_geterror(err);
+      return -EIO;
+    }
+    return 0;
+  }
+
+  int add_dummy(const std::string &name, const rofl::caddress_ll &hwaddr) {
+    std::unique_ptr<rtnl_link, decltype(&rtnl_link_put)> link(
+        rtnl_link_alloc(), rtnl_link_put);
+    std::unique_ptr<nl_addr, decltype(&nl_addr_put)> addr(
+        nl_addr_build(AF_LLC, hwaddr.somem(), hwaddr.memlen()), nl_addr_put);
+
+    if (!link || !addr)
+      return -ENOMEM;
+
+    rtnl_link_set_type(link.get(), "dummy");
+    rtnl_link_set_name(link.get(), name.c_str());
+    rtnl_link_set_addr(link.get(), addr.get());
+
+    return check(rtnl_link_add(sk, link.get(), NLM_F_CREATE | NLM_F_EXCL),
+                 "add link " + name);
+  }
+
+  int add_bridge(const std::string &name) {
+    std::unique_ptr<rtnl_link, decltype(&rtnl_link_put)> link(
+        rtnl_link_bridge_alloc(), rtnl_link_put);
+
+    if (!link)
+      return -ENOMEM;
+
+    // baseboxd supports VLAN-aware bridges only
+    rtnl_link_set_name(link.get(), name.c_str());
+    rtnl_link_bridge_set_vlan_filtering(link.get(), 1);
+
+    return check(rtnl_link_add(sk, link.get(), NLM_F_CREATE | NLM_F_EXCL),
+                 "add bridge " + name);
+  }
+
+  // bring the link up, dummy links are created with IFF_NOARP
+  int set_up(const std::string &name, int master = 0) {
+    std::unique_ptr<rtnl_link, decltype(&rtnl_link_put)> change(
+        rtnl_link_alloc(), rtnl_link_put);
+    rtnl_link *link = nullptr;
+
+    int err = rtnl_link_get_kernel(sk, 0, name.c_str(), &link);
+    if (err < 0)
+      return check(err, "get link " + name);
+
+    rtnl_link_set_flags(change.get(), IFF_UP);
+    rtnl_link_unset_flags(change.get(), IFF_NOARP);
+    if (master)
+      rtnl_link_set_master(change.get(), master);
+
+    err = rtnl_link_change(sk, link, change.get(), 0);
+    rtnl_link_put(link);
+    return check(err, "change link " + name);
+  }
+
+  int ifindex(const std::string &name) {
+    rtnl_link *link = nullptr;
+
+    int err = rtnl_link_get_kernel(sk, 0, name.c_str(), &link);
+    if (err < 0)
+      return check(err, "get link " + name);
+
+    int rv = rtnl_link_get_ifindex(link);
+    rtnl_link_put(link);
+    return rv;
+  }
+
+  int add_addr(int ifindex, const std::string &prefix) {
+    std::unique_ptr<rtnl_addr, decltype(&rtnl_addr_put)> addr(
+        rtnl_addr_alloc(), rtnl_addr_put);
+    std::unique_ptr<nl_addr, decltype(&nl_addr_put)> local(
+        parse(prefix, AF_UNSPEC), nl_addr_put);
+
+    if (!addr || !local)
+      return -EINVAL;
+
+    rtnl_addr_set_ifindex(addr.get(), ifindex);
+    rtnl_addr_set_local(addr.get(), local.get());
+    // no duplicate address detection, the address has to be usable at once
+    rtnl_addr_set_flags(addr.get(), IFA_F_NODAD);
+
+    return check(rtnl_addr_add(sk, addr.get(), 0), "add address " + prefix);
+  }
+
+  int neigh(bool add, int ifindex, const std::string &dst,
+            const rofl::caddress_ll &mac) {
+    std::unique_ptr<rtnl_neigh, decltype(&rtnl_neigh_put)> n(
+        rtnl_neigh_alloc(), rtnl_neigh_put);
+    std::unique_ptr<nl_addr, decltype(&nl_addr_put)> addr(
+        parse(dst, AF_UNSPEC), nl_addr_put);
+    std::unique_ptr<nl_addr, decltype(&nl_addr_put)> lladdr(
+        nl_addr_build(AF_LLC, mac.somem(), mac.memlen()), nl_addr_put);
+
+    if (!n || !addr || !lladdr)
+      return -EINVAL;
+
+    rtnl_neigh_set_ifindex(n.get(), ifindex);
+    rtnl_neigh_set_dst(n.get(), addr.get());
+    rtnl_neigh_set_lladdr(n.get(), lladdr.get());
+    rtnl_neigh_set_state(n.get(), NUD_PERMANENT);
+
+    if (add)
+      return check(rtnl_neigh_add(sk, n.get(), NLM_F_CREATE | NLM_F_REPLACE),
+                   "add neighbour " + dst);
+    return check(rtnl_neigh_delete(sk, n.get(), 0), "delete neighbour " + dst);
+  }
+
+  // a dynamic fdb entry, as if the bridge had learned it
+  int fdb_add(int ifindex, uint16_t vid, const rofl::caddress_ll &mac) {
+    std::unique_ptr<rtnl_neigh, decltype(&rtnl_neigh_put)> n(
+        rtnl_neigh_alloc(), rtnl_neigh_put);
+    std::unique_ptr<nl_addr, decltype(&nl_addr_put)> lladdr(
+        nl_addr_build(AF_LLC, mac.somem(), mac.memlen()), nl_addr_put);
+
+    if (!n || !lladdr)
+      return -ENOMEM;
+
+    rtnl_neigh_set_family(n.get(), AF_BRIDGE);
+    rtnl_neigh_set_ifindex(n.get(), ifindex);
+    rtnl_neigh_set_lladdr(n.get(), lladdr.get());
+    rtnl_neigh_set_vlan(n.get(), vid);
+    rtnl_neigh_set_flags(n.get(), NTF_MASTER);
+    rtnl_neigh_set_state(n.get(), NUD_REACHABLE);
+
+    return check(rtnl_neigh_add(sk, n.get(), NLM_F_CREATE), "add fdb entry");
+  }
+
+  int route(bool add, const std::string &dst,
+            const std::vector<std::pair<int, std::string>> &nhs) {
+    std::unique_ptr<rtnl_route, decltype(&rtnl_route_put)> r(
+        rtnl_route_alloc(), rtnl_route_put);
+    std::unique_ptr<nl_addr, decltype(&nl_addr_put)> addr(
+        parse(dst, AF_UNSPEC), nl_addr_put);
+
+    if (!r || !addr)
+      return -EINVAL;
+
+    rtnl_route_set_family(r.get(), nl_addr_get_family(addr.get()));
+    rtnl_route_set_dst(r.get(), addr.get());
+    rtnl_route_set_table(r.get(), RT_TABLE_MAIN);
+    rtnl_route_set_protocol(r.get(), RTPROT_STATIC);
+    rtnl_route_set_scope(r.get(), RT_SCOPE_UNIVERSE);
+    rtnl_route_set_type(r.get(), RTN_UNICAST);
+
+    for (auto &nh : nhs) {
+      std::unique_ptr<nl_addr, decltype(&nl_addr_put)> gw(
+          parse(nh.second, nl_addr_get_family(addr.get())), nl_addr_put);
+      if (!gw)
+        return -EINVAL;
+
+      // owned by the route
+      rtnl_nexthop *n = rtnl_route_nh_alloc();
+      rtnl_route_nh_set_ifindex(n, nh.first);
+      rtnl_route_nh_set_gateway(n, gw.get());
+      rtnl_route_add_nexthop(r.get(), n);
+    }
+
+    if (add)
+      return check(rtnl_route_add(sk, r.get(), NLM_F_CREATE | NLM_F_EXCL),
+                   "add route " + dst);
+    return check(rtnl_route_delete(sk, r.get(), 0), "delete route " + dst);
+  }
+
+  // add or remove a range of VLANs of a bridge port, like "bridge vlan add"
+  int bridge_vlans(bool add, int ifindex, uint16_t first, uint16_t last) {
+    struct ifinfomsg ifi = {};
+    struct bridge_vlan_info vinfo = {};
+    nl_msg *msg = nlmsg_alloc_simple(add ? RTM_SETLINK : RTM_DELLINK,
+                                     NLM_F_REQUEST | NLM_F_ACK);
+
+    if (msg == nullptr)
+      return -ENOMEM;
+
+    ifi.ifi_family = AF_BRIDGE;
+    ifi.ifi_index = ifindex;
+    nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO);
+
+    nlattr *af_spec = nla_nest_start(msg, IFLA_AF_SPEC);
+    if (first != last) {
+      vinfo.flags = BRIDGE_VLAN_INFO_RANGE_BEGIN;
+      vinfo.vid = first;
+      nla_put(msg, IFLA_BRIDGE_VLAN_INFO, sizeof(vinfo), &vinfo);
+      vinfo.flags = BRIDGE_VLAN_INFO_RANGE_END;
+    }
+    vinfo.vid = last;
+    nla_put(msg, IFLA_BRIDGE_VLAN_INFO, sizeof(vinfo), &vinfo);
+    nla_nest_end(msg, af_spec);
+
+    // frees the message
+    return check(nl_send_sync(sk, msg), "change bridge vlans");
+  }
+
+private:
+  kernel(const kernel &) = delete;
+  kernel &operator=(const kernel &) = delete;
+
+  static nl_addr *parse(const std::string &s, int family) {
+    nl_addr *addr = nullptr;
+
+    if (nl_addr_parse(s.c_str(), family, &addr) < 0)
+      return nullptr;
+    return addr;
+  }
+
+  static int check(int err, const std::string &what) {
+    if (err < 0) {
+      LOG(ERROR) << "failed to " << what << ": " << nl_geterror(err);
+      return -EIO;
+    }
+    return err;
+  }
+
+  nl_sock *sk;
+};
+
+static rofl::caddress_ll make_mac(uint8_t kind, uint32_t n) {
+  uint8_t mac[6] = {0x02,
+                    kind,
+                    static_cast<uint8_t>(n >> 24),
+                    static_cast<uint8_t>(n >> 16),
+                    static_cast<uint8_t>(n >> 8),
+                    static_cast<uint8_t>(n)};
+  return rofl::caddress_ll(mac, sizeof(mac));
+}
+
+static std::string fmt(const char *f, unsigned a, unsigned b,
+                       unsigned c = 0) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), f, a, b, c);
+  return buf;
+}
+
+// the mounted sysfs shows the links of the namespace it was mounted in, but
+// nl_bridge reads the bridge settings from it
+static int enter_namespace() {
+  if (unshare(CLONE_NEWNET | CLONE_NEWNS) < 0) {
+    LOG(ERROR) << "failed to create namespaces: " << strerror(errno);
+    return -errno;
+  }
+
+  if (mount(nullptr, "/", nullptr, MS_REC | MS_PRIVATE, nullptr) < 0 ||
+      umount2("/sys", MNT_DETACH) < 0 ||
+      mount("sysfs", "/sys", "sysfs", 0, nullptr) < 0) {
+    LOG(ERROR) << "failed to mount sysfs: " << strerror(errno);
+    return -errno;
+  }
+
+  return 0;
+}
+
+// wait until cnetlink stopped calling the switch
+static void settle(const basebox::swi_recorder &sw) {
+  uint64_t calls;
+
+  do {
+    calls = sw.calls();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  } while (calls != sw.calls());
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  using basebox::cnetlink;
+  using basebox::nbi;
+  using basebox::nbi_impl;
+  using basebox::replay_port_manager;
+  using basebox::swi_recorder;
+
+  for (auto flag : {&FLAGS_routes, &FLAGS_flaps, &FLAGS_macs,
+                    &FLAGS_bridge_ports, &FLAGS_timeout}) {
+    if (!gflags::RegisterFlagValidator(flag, &validate_count)) {
+      std::cerr << "Failed to register count validator" << std::endl;
+      exit(1);
+    }
+  }
+
+  if (!gflags::RegisterFlagValidator(&FLAGS_neighbours, &validate_neighbours)) {
+    std::cerr << "Failed to register neighbours validator" << std::endl;
+    exit(1);
+  }
+
+  if (!gflags::RegisterFlagValidator(&FLAGS_ecmp, &validate_ecmp)) {
+    std::cerr << "Failed to register ecmp validator" << std::endl;
+    exit(1);
+  }
+
+  if (!gflags::RegisterFlagValidator(&FLAGS_vlans, &validate_vlans)) {
+    std::cerr << "Failed to register vlans validator" << std::endl;
+    exit(1);
+  }
+
+  if (!gflags::RegisterFlagValidator(&FLAGS_port_untagged_vid, &validate_vid)) {
+    std::cerr << "Failed to register vid validator" << std::endl;
+    exit(1);
+  }
+
+  FLAGS_tryfromenv =
+      std::string("multicast,mark_fwd_offload,port_untagged_vid");
+  gflags::SetUsageMessage(
+      "scale benchmark of the netlink side of baseboxd without a switch\n"
+      "  nl-scale-bench [--routes=N] [--ecmp=M] [--neighbours=N] "
+      "[--macs=K] [--vlans=V]");
+
+  // init
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  if (enter_namespace() < 0)
+    return EXIT_FAILURE;
+
+  kernel k;
+  if (k.connect() < 0)
+    return EXIT_FAILURE;
+
+  // the switch, every call succeeds
+  swi_recorder sw(nullptr);
+  std::mutex scenario_mutex;
+  std::unique_ptr<scenario> current;
+
+  sw.set_observer([&](swi_method method, int rv) {
+    std::lock_guard<std::mutex> lock(scenario_mutex);
+    if (current)
+      current->observe(method);
+  });
+
+  auto run = [&](const std::string &name, std::set<swi_method> methods,
+                 const std::function<int(scenario &)> &body) {
+    {
+      std::lock_guard<std::mutex> lock(scenario_mutex);
+      current.reset(new scenario(name, std::move(methods), sw));
+    }
+
+    bool ok = body(*current) == 0 &&
+              current->wait(std::chrono::seconds(FLAGS_timeout));
+    current->report(std::cout);
+    settle(sw);
+
+    std::lock_guard<std::mutex> lock(scenario_mutex);
+    current.reset();
+    return ok;
+  };
+
+  std::shared_ptr<cnetlink> nl(new cnetlink());
+  std::shared_ptr<replay_port_manager> port_man(new replay_port_manager());
+  nbi_impl nb(nl, port_man);
+
+  nb.register_switch(&sw);
+  nb.switch_state_notification(nbi::SWITCH_STATE_UP);
+
+  // routed ports carry one nexthop each, the bridge ports follow
+  const unsigned l3_ports = FLAGS_ecmp;
+  const unsigned n_ports = l3_ports + FLAGS_bridge_ports;
+  std::deque<nbi::port_notification_data> ntfys;
+  for (unsigned p = 0; p < n_ports; p++)
+    ntfys.push_back({nbi::PORT_EVENT_TABLE, p + 1, make_mac(0, p + 1),
+                     "port" + std::to_string(p + 1), true, 10000000, 0});
+  nb.port_notification(ntfys);
+
+  std::vector<int> ifindex;
+  for (auto &p : ntfys) {
+    if (k.add_dummy(p.name, p.hwaddr) < 0)
+      return EXIT_FAILURE;
+
+    int ifi = k.ifindex(p.name);
+    if (ifi < 0)
+      return EXIT_FAILURE;
+    ifindex.push_back(ifi);
+  }
+
+  // routed ports: 10.p.0.0/16 and 2001:db8:p::/64, gateway .2 and ::2
+  std::vector<std::pair<int, std::string>> gw4, gw6;
+  for (unsigned p = 0; p < l3_ports; p++) {
+    if (k.set_up(ntfys[p].name) < 0 ||
+        k.add_addr(ifindex[p], fmt("10.%u.0.1/16", p, 0)) < 0 ||
+        k.add_addr(ifindex[p], fmt("2001:db8:%x::1/64", p, 0)) < 0)
+      return EXIT_FAILURE;
+
+    gw4.emplace_back(ifindex[p], fmt("10.%u.0.2", p, 0));
+    gw6.emplace_back(ifindex[p], fmt("2001:db8:%x::2", p, 0));
+    if (k.neigh(true, ifindex[p], gw4.back().second, make_mac(1, p)) < 0 ||
+        k.neigh(true, ifindex[p], gw6.back().second, make_mac(1, p)) < 0)
+      return EXIT_FAILURE;
+  }
+
+  std::vector<int> br_ports;
+  if (FLAGS_bridge_ports) {
+    int br;
+    if (k.add_bridge("br0") < 0 || k.set_up("br0") < 0 ||
+        (br = k.ifindex("br0")) < 0)
+      return EXIT_FAILURE;
+
+    for (unsigned p = l3_ports; p < n_ports; p++) {
+      if (k.set_up(ntfys[p].name, br) < 0)
+        return EXIT_FAILURE;
+      br_ports.push_back(p);
+    }
+  }
+
+  settle(sw);
+  std::cout << "ports: " << n_ports << ", setup switch calls: " << sw.calls()
+            << std::endl;
+  scenario::report_header(std::cout);
+
+  bool ok = true;
+  const unsigned n_routes = FLAGS_routes;
+  const unsigned n_neighs = FLAGS_neighbours;
+  const unsigned n_macs = FLAGS_macs;
+  const unsigned n_vlans = FLAGS_vlans;
+
+  auto route4 = [](unsigned i) {
+    return fmt("%u.%u.%u.0/24", 16 + (i >> 16), (i >> 8) & 0xff, i & 0xff);
+  };
+  auto route6 = [](unsigned i) {
+    return fmt("fd00:%x:%x::/48", i >> 16, i & 0xffff);
+  };
+  auto neigh4 = [&](unsigned i) {
+    unsigned n = i / l3_ports;
+    return fmt("10.%u.%u.%u", i % l3_ports, 1 + n / 250, 1 + n % 250);
+  };
+  auto neigh6 = [&](unsigned i) {
+    return fmt("2001:db8:%x::1:%x", i % l3_ports, i / l3_ports);
+  };
+  auto vid_of = [&](unsigned i) { return n_vlans ? 2 + i % n_vlans : 1; };
+
+  if (n_routes) {
+    ok &= run("route add",
+              {basebox::SWI_L3_UNICAST_ROUTE_ADD,
+               basebox::SWI_L3_UNICAST_ROUTE_ADD_V6},
+              [&](scenario &s) {
+                for (unsigned i = 0; i < n_routes; i++) {
+                  s.issue(1);
+                  if (k.route(true, route4(i), gw4) < 0)
+                    return -EIO;
+                  s.issue(1);
+                  if (k.route(true, route6(i), gw6) < 0)
+                    return -EIO;
+                }
+                return 0;
+              });
+  }
+
+  if (n_neighs) {
+    // the routes stay installed, neighbours flap in a full table
+    ok &= run("neigh add",
+              {basebox::SWI_L3_UNICAST_HOST_ADD,
+               basebox::SWI_L3_UNICAST_HOST_ADD_V6},
+              [&](scenario &s) {
+                for (unsigned i = 0; i < n_neighs; i++) {
+                  unsigned p = i % l3_ports;
+                  s.issue(1);
+                  if (k.neigh(true, ifindex[p], neigh4(i), make_mac(2, i)) < 0)
+                    return -EIO;
+                  s.issue(1);
+                  if (k.neigh(true, ifindex[p], neigh6(i), make_mac(2, i)) < 0)
+                    return -EIO;
+                }
+                return 0;
+              });
+
+    ok &= run("neigh flap",
+              {basebox::SWI_L3_UNICAST_HOST_ADD,
+               basebox::SWI_L3_UNICAST_HOST_ADD_V6,
+               basebox::SWI_L3_UNICAST_HOST_REMOVE,
+               basebox::SWI_L3_UNICAST_HOST_REMOVE_V6},
+              [&](scenario &s) {
+                for (int round = 0; round < FLAGS_flaps; round++) {
+                  for (unsigned i = 0; i < n_neighs; i++) {
+                    int ifi = ifindex[i % l3_ports];
+                    auto mac = make_mac(2, i);
+                    s.issue(1);
+                    if (k.neigh(false, ifi, neigh4(i), mac) < 0)
+                      return -EIO;
+                    s.issue(1);
+                    if (k.neigh(true, ifi, neigh4(i), mac) < 0)
+                      return -EIO;
+                    s.issue(1);
+                    if (k.neigh(false, ifi, neigh6(i), mac) < 0)
+                      return -EIO;
+                    s.issue(1);
+                    if (k.neigh(true, ifi, neigh6(i), mac) < 0)
+                      return -EIO;
+                  }
+                }
+                return 0;
+              });
+  }
+
+  if (n_routes) {
+    ok &= run("route del",
+              {basebox::SWI_L3_UNICAST_ROUTE_REMOVE,
+               basebox::SWI_L3_UNICAST_ROUTE_REMOVE_V6},
+              [&](scenario &s) {
+                for (unsigned i = 0; i < n_routes; i++) {
+                  s.issue(1);
+                  if (k.route(false, route4(i), gw4) < 0)
+                    return -EIO;
+                  s.issue(1);
+                  if (k.route(false, route6(i), gw6) < 0)
+                    return -EIO;
+                }
+                return 0;
+              });
+  }
+
+  if (!br_ports.empty() && n_vlans) {
+    ok &= run("vlan add", {basebox::SWI_EGRESS_BRIDGE_PORT_VLAN_ADD},
+              [&](scenario &s) {
+                for (auto p : br_ports) {
+                  s.issue(n_vlans);
+                  if (k.bridge_vlans(true, ifindex[p], 2, 1 + n_vlans) < 0)
+                    return -EIO;
+                }
+                return 0;
+              });
+  }
+
+  if (!br_ports.empty() && n_macs) {
+    // learning on the switch ends up as dynamic entries in the kernel
+    ok &= run("fdb learn", {basebox::SWI_L2_ADDR_ADD}, [&](scenario &s) {
+      for (unsigned i = 0; i < n_macs; i++) {
+        s.issue(1);
+        if (k.fdb_add(ifindex[br_ports[i % br_ports.size()]], vid_of(i),
+                      make_mac(3, i)) < 0)
+          return -EIO;
+      }
+      return 0;
+    });
+
+    // the switch reports aged entries, cnetlink removes them from the kernel
+    ok &= run("fdb age", {basebox::SWI_L2_ADDR_REMOVE}, [&](scenario &s) {
+      for (unsigned i = 0; i < n_macs; i++) {
+        s.issue(1);
+        nb.fdb_timeout(br_ports[i % br_ports.size()] + 1, vid_of(i),
+                       make_mac(3, i));
+      }
+      return 0;
+    });
+  }
+
+  if (!br_ports.empty() && n_vlans) {
+    ok &= run("vlan del", {basebox::SWI_EGRESS_BRIDGE_PORT_VLAN_REMOVE},
+              [&](scenario &s) {
+                for (auto p : br_ports) {
+                  s.issue(n_vlans);
+                  if (k.bridge_vlans(false, ifindex[p], 2, 1 + n_vlans) < 0)
+                    return -EIO;
+                }
+                return 0;
+              });
+  }
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
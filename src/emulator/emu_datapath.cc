@@ -0,0 +1,276 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "emu_datapath.h"
+#include "emu_state.h"
+
+namespace basebox {
+
+// packs a rofl object into its OpenFlow wire format
+template <typename T> static std::string packed(const T &obj) {
+  std::vector<uint8_t> buf(obj.length());
+
+  if (!buf.empty())
+    obj.pack(buf.data(), buf.size());
+  return std::string(buf.begin(), buf.end());
+}
+
+emu_datapath::emu_datapath(std::shared_ptr<emu_state> state, uint64_t dpid,
+                           unsigned n_ports, unsigned hit_percent)
+    : state(std::move(state)), dpid(dpid), n_ports(n_ports),
+      hit_percent(hit_percent), num_packet_outs(0) {
+  rofl::openflow::cofhello_elem_versionbitmap versionbitmap;
+  versionbitmap.add_ofp_version(rofl::openflow13::OFP_VERSION);
+  rofl::crofbase::set_versionbitmap(versionbitmap);
+}
+
+emu_datapath::~emu_datapath() {}
+
+void emu_datapath::connect(const rofl::csockaddr &raddr) {
+  LOG(INFO) << __FUNCTION__ << ": connecting to " << raddr;
+
+  add_ctl(rofl::cctlid(0))
+      .add_conn(rofl::cauxid(0))
+      .set_raddr(raddr)
+      .tcp_connect(get_versionbitmap(), rofl::crofconn::MODE_DATAPATH, true);
+}
+
+void emu_datapath::handle_ctl_open(rofl::crofctl &ctl) {
+  LOG(INFO) << __FUNCTION__ << ": controller connected, ctlid="
+            << ctl.get_ctlid();
+}
+
+void emu_datapath::handle_ctl_close(const rofl::cctlid &ctlid) {
+  LOG(INFO) << __FUNCTION__ << ": controller disconnected, ctlid=" << ctlid;
+}
+
+void emu_datapath::handle_features_request(
+    rofl::crofctl &ctl, const rofl::cauxid &auxid,
+    rofl::openflow::cofmsg_features_request &msg) {
+  VLOG(1) << __FUNCTION__ << ": xid=" << msg.get_xid();
+
+  ctl.send_features_reply(auxid, msg.get_xid(), dpid, 0, 255,
+                          rofl::openflow13::OFPC_FLOW_STATS |
+                              rofl::openflow13::OFPC_PORT_STATS |
+                              rofl::openflow13::OFPC_GROUP_STATS);
+}
+
+void emu_datapath::handle_desc_stats_request(
+    rofl::crofctl &ctl, const rofl::cauxid &auxid,
+    rofl::openflow::cofmsg_desc_stats_request &msg) {
+  VLOG(1) << __FUNCTION__ << ": xid=" << msg.get_xid();
+
+  rofl::openflow::cofdesc_stats_reply desc(
+      rofl::openflow13::OFP_VERSION, "BISDN GmbH", "OF-DPA emulator",
+      "ofdpa-emulator", "0", "emulated OF-DPA switch");
+  ctl.send_desc_stats_reply(auxid, msg.get_xid(), desc);
+}
+
+void emu_datapath::handle_port_desc_stats_request(
+    rofl::crofctl &ctl, const rofl::cauxid &auxid,
+    rofl::openflow::cofmsg_port_desc_stats_request &msg) {
+  VLOG(1) << __FUNCTION__ << ": xid=" << msg.get_xid();
+
+  rofl::openflow::cofports ports(rofl::openflow13::OFP_VERSION);
+
+  for (uint32_t port_no = 1; port_no <= n_ports; port_no++) {
+    rofl::openflow::cofport &port = ports.add_port(port_no);
+
+    // locally administered, port number in the lower bytes
+    uint8_t hwaddr[6] = {0x02, 0xbb, 0, 0, (uint8_t)(port_no >> 8),
+                         (uint8_t)port_no};
+    port.set_hwaddr(rofl::caddress_ll(hwaddr, sizeof(hwaddr)));
+    port.set_name("port" + std::to_string(port_no));
+    port.set_config(0);
+    port.set_state(rofl::openflow13::OFPPS_LIVE);
+    port.set_ethernet().set_curr(rofl::openflow13::OFPPF_10GB_FD |
+                                 rofl::openflow13::OFPPF_FIBER);
+    port.set_ethernet().set_curr_speed(10000000);
+    port.set_ethernet().set_max_speed(10000000);
+  }
+
+  ctl.send_port_desc_stats_reply(auxid, msg.get_xid(), ports);
+}
+
+void emu_datapath::handle_port_stats_request(
+    rofl::crofctl &ctl, const rofl::cauxid &auxid,
+    rofl::openflow::cofmsg_port_stats_request &msg) {
+  VLOG(3) << __FUNCTION__ << ": xid=" << msg.get_xid();
+
+  // no traffic is forwarded, all counters stay at zero
+  rofl::openflow::cofportstatsarray stats(rofl::openflow13::OFP_VERSION);
+  uint32_t req = msg.get_port_stats().get_port_no();
+
+  for (uint32_t port_no = 1; port_no <= n_ports; port_no++) {
+    if (req == rofl::openflow13::OFPP_ANY || req == port_no)
+      stats.add_port_stats(port_no);
+  }
+
+  ctl.send_port_stats_reply(auxid, msg.get_xid(), stats);
+}
+
+void emu_datapath::handle_flow_stats_request(
+    rofl::crofctl &ctl, const rofl::cauxid &auxid,
+    rofl::openflow::cofmsg_flow_stats_request &msg) {
+  VLOG(3) << __FUNCTION__ << ": xid=" << msg.get_xid();
+
+  const rofl::openflow::cofflow_stats_request &req = msg.get_flow_stats();
+  std::deque<emu_flow_stats> flows;
+  state->flow_stats(req.get_table_id(), packed(req.get_match()), hit_percent,
+                    &flows);
+
+  rofl::openflow::cofflowstatsarray stats(rofl::openflow13::OFP_VERSION);
+  uint32_t id = 0;
+
+  for (auto &f : flows) {
+    rofl::openflow::cofflow_stats_reply &fs = stats.add_flow_stats(id++);
+
+    fs.set_table_id(f.table_id);
+    fs.set_priority(f.priority);
+    fs.set_cookie(f.cookie);
+    fs.set_packet_count(f.packets);
+    fs.set_match().unpack(reinterpret_cast<uint8_t *>(&f.match[0]),
+                          f.match.size());
+  }
+
+  ctl.send_flow_stats_reply(auxid, msg.get_xid(), stats);
+}
+
+void emu_datapath::handle_flow_mod(rofl::crofctl &ctl,
+                                   const rofl::cauxid &auxid,
+                                   rofl::openflow::cofmsg_flow_mod &msg) {
+  using namespace rofl::openflow13;
+
+  const rofl::openflow::cofflowmod &fm = msg.get_flowmod();
+  std::string match = packed(fm.get_match());
+  enum emu_status rv = EMU_PARAM;
+
+  switch (fm.get_command()) {
+  case OFPFC_ADD:
+    rv = state->flow_add(fm.get_table_id(), fm.get_priority(),
+                         fm.get_cookie(), match,
+                         packed(fm.get_instructions()));
+    break;
+  case OFPFC_MODIFY:
+  case OFPFC_MODIFY_STRICT:
+    rv = state->flow_modify(fm.get_table_id(), fm.get_priority(), match,
+                            packed(fm.get_instructions()),
+                            fm.get_command() == OFPFC_MODIFY_STRICT);
+    break;
+  case OFPFC_DELETE:
+  case OFPFC_DELETE_STRICT:
+    rv = state->flow_delete(fm.get_table_id(), fm.get_priority(), match,
+                            fm.get_command() == OFPFC_DELETE_STRICT);
+    break;
+  default:
+    ctl.send_error_message(auxid, msg.get_xid(), OFPET_FLOW_MOD_FAILED,
+                           OFPFMFC_BAD_COMMAND);
+    return;
+  }
+
+  if (rv == EMU_OK)
+    return;
+
+  VLOG(1) << __FUNCTION__ << ": rejected flow mod xid=" << msg.get_xid()
+          << " table_id=" << (unsigned)fm.get_table_id() << ": "
+          << emu_status_str(rv);
+
+  switch (rv) {
+  case EMU_FULL:
+    ctl.send_error_message(auxid, msg.get_xid(), OFPET_FLOW_MOD_FAILED,
+                           OFPFMFC_TABLE_FULL);
+    break;
+  case EMU_BAD_REF:
+    ctl.send_error_message(auxid, msg.get_xid(), OFPET_BAD_ACTION,
+                           OFPBAC_BAD_OUT_GROUP);
+    break;
+  case EMU_PARAM:
+    ctl.send_error_message(auxid, msg.get_xid(), OFPET_FLOW_MOD_FAILED,
+                           OFPFMFC_BAD_TABLE_ID);
+    break;
+  default:
+    ctl.send_error_message(auxid, msg.get_xid(), OFPET_FLOW_MOD_FAILED,
+                           OFPFMFC_UNKNOWN);
+    break;
+  }
+}
+
+void emu_datapath::handle_group_mod(rofl::crofctl &ctl,
+                                    const rofl::cauxid &auxid,
+                                    rofl::openflow::cofmsg_group_mod &msg) {
+  using namespace rofl::openflow13;
+
+  const rofl::openflow::cofgroupmod &gm = msg.get_groupmod();
+  enum emu_status rv = EMU_PARAM;
+
+  switch (gm.get_command()) {
+  case OFPGC_ADD:
+    rv = state->group_add(gm.get_group_id(), gm.get_type(),
+                          packed(gm.get_buckets()));
+    break;
+  case OFPGC_MODIFY:
+    rv = state->group_modify(gm.get_group_id(), gm.get_type(),
+                             packed(gm.get_buckets()));
+    break;
+  case OFPGC_DELETE:
+    rv = state->group_delete(gm.get_group_id());
+    break;
+  default:
+    ctl.send_error_message(auxid, msg.get_xid(), OFPET_GROUP_MOD_FAILED,
+                           OFPGMFC_BAD_COMMAND);
+    return;
+  }
+
+  if (rv == EMU_OK)
+    return;
+
+  VLOG(1) << __FUNCTION__ << ": rejected group mod xid=" << msg.get_xid()
+          << " group_id=" << std::showbase << std::hex << gm.get_group_id()
+          << std::dec << ": " << emu_status_str(rv);
+
+  uint16_t code;
+  switch (rv) {
+  case EMU_EXISTS:
+    code = OFPGMFC_GROUP_EXISTS;
+    break;
+  case EMU_NOT_FOUND:
+    code = OFPGMFC_UNKNOWN_GROUP;
+    break;
+  case EMU_BAD_REF:
+    code = OFPGMFC_INVALID_GROUP;
+    break;
+  case EMU_IN_USE:
+    code = OFPGMFC_CHAINED_GROUP;
+    break;
+  case EMU_FULL:
+    code = OFPGMFC_OUT_OF_GROUPS;
+    break;
+  case EMU_PARAM:
+  default:
+    code = OFPGMFC_BAD_TYPE;
+    break;
+  }
+
+  ctl.send_error_message(auxid, msg.get_xid(), OFPET_GROUP_MOD_FAILED, code);
+}
+
+void emu_datapath::handle_barrier_request(
+    rofl::crofctl &ctl, const rofl::cauxid &auxid,
+    rofl::openflow::cofmsg_barrier_request &msg) {
+  // mods are applied synchronously, everything before is done
+  ctl.send_barrier_reply(auxid, msg.get_xid());
+}
+
+void emu_datapath::handle_packet_out(rofl::crofctl &ctl,
+                                     const rofl::cauxid &auxid,
+                                     rofl::openflow::cofmsg_packet_out &msg) {
+  num_packet_outs++;
+}
+
+} // namespace basebox
@@ -0,0 +1,75 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include <rofl/common/crofbase.h>
+#include <rofl/common/crofctl.h>
+
+namespace basebox {
+
+// forward declarations
+class emu_state;
+
+/**
+ * OpenFlow 1.3 side of the emulated OF-DPA switch
+ *
+ * Connects to baseboxd as datapath, announces n_ports physical ports and
+ * applies flow and group mods to the emulated tables. Rejected mods are
+ * answered with the OpenFlow error the OF-DPA agent would send.
+ */
+class emu_datapath final : public rofl::crofbase {
+public:
+  // hit_percent of the flows count a packet between two flow stats requests
+  emu_datapath(std::shared_ptr<emu_state> state, uint64_t dpid,
+               unsigned n_ports, unsigned hit_percent);
+  ~emu_datapath() override;
+
+  void connect(const rofl::csockaddr &raddr);
+
+  uint64_t packet_outs() const { return num_packet_outs; }
+
+protected:
+  void handle_ctl_open(rofl::crofctl &ctl) override;
+  void handle_ctl_close(const rofl::cctlid &ctlid) override;
+
+  void handle_features_request(
+      rofl::crofctl &ctl, const rofl::cauxid &auxid,
+      rofl::openflow::cofmsg_features_request &msg) override;
+  void handle_desc_stats_request(
+      rofl::crofctl &ctl, const rofl::cauxid &auxid,
+      rofl::openflow::cofmsg_desc_stats_request &msg) override;
+  void handle_port_desc_stats_request(
+      rofl::crofctl &ctl, const rofl::cauxid &auxid,
+      rofl::openflow::cofmsg_port_desc_stats_request &msg) override;
+  void handle_port_stats_request(
+      rofl::crofctl &ctl, const rofl::cauxid &auxid,
+      rofl::openflow::cofmsg_port_stats_request &msg) override;
+  void handle_flow_stats_request(
+      rofl::crofctl &ctl, const rofl::cauxid &auxid,
+      rofl::openflow::cofmsg_flow_stats_request &msg) override;
+  void handle_flow_mod(rofl::crofctl &ctl, const rofl::cauxid &auxid,
+                       rofl::openflow::cofmsg_flow_mod &msg) override;
+  void handle_group_mod(rofl::crofctl &ctl, const rofl::cauxid &auxid,
+                        rofl::openflow::cofmsg_group_mod &msg) override;
+  void handle_barrier_request(
+      rofl::crofctl &ctl, const rofl::cauxid &auxid,
+      rofl::openflow::cofmsg_barrier_request &msg) override;
+  void handle_packet_out(rofl::crofctl &ctl, const rofl::cauxid &auxid,
+                         rofl::openflow::cofmsg_packet_out &msg) override;
+
+private:
+  emu_datapath(const emu_datapath &) = delete;
+  emu_datapath &operator=(const emu_datapath &) = delete;
+
+  std::shared_ptr<emu_state> state;
+  const uint64_t dpid;
+  const unsigned n_ports;
+  const unsigned hit_percent;
+  std::atomic<uint64_t> num_packet_outs;
+};
+
+} // namespace basebox
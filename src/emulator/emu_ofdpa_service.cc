@@ -0,0 +1,245 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include <glog/logging.h>
+
+#include "emu_ofdpa_service.h"
+#include "emu_state.h"
+
+using ::grpc::Status;
+using ::ofdpa::OfdpaStatus;
+
+namespace basebox {
+
+// errors are carried in the response, the RPC itself always succeeds
+static Status reply(const char *name, enum emu_status s,
+                    OfdpaStatus *response) {
+  OfdpaStatus::OfdpaStatusCode code;
+
+  switch (s) {
+  case EMU_OK:
+    code = OfdpaStatus::OFDPA_E_NONE;
+    break;
+  case EMU_PARAM:
+    code = OfdpaStatus::OFDPA_E_PARAM;
+    break;
+  case EMU_EXISTS:
+    code = OfdpaStatus::OFDPA_E_EXISTS;
+    break;
+  case EMU_NOT_FOUND:
+  case EMU_BAD_REF:
+    code = OfdpaStatus::OFDPA_E_NOT_FOUND;
+    break;
+  case EMU_FULL:
+    code = OfdpaStatus::OFDPA_E_FULL;
+    break;
+  case EMU_IN_USE:
+  default:
+    code = OfdpaStatus::OFDPA_E_FAIL;
+    break;
+  }
+
+  VLOG(2) << name << ": " << emu_status_str(s);
+  response->set_status(code);
+  return Status::OK;
+}
+
+EmuOfdpaService::EmuOfdpaService(std::shared_ptr<emu_state> state)
+    : state(std::move(state)) {}
+
+Status EmuOfdpaService::ofdpaTunnelReset(ServerContext *context,
+                                         const ::ofdpa::Empty *request,
+                                         OfdpaStatus *response) {
+  return reply(__FUNCTION__, state->tunnel_reset(), response);
+}
+
+Status EmuOfdpaService::ofdpaTunnelTenantCreate(
+    ServerContext *context, const ::ofdpa::TunnelTenantCreate *request,
+    OfdpaStatus *response) {
+  return reply(__FUNCTION__,
+               state->tenant_create(request->tunnel_id(),
+                                    request->config().virtual_network_id()),
+               response);
+}
+
+Status EmuOfdpaService::ofdpaTunnelTenantDelete(
+    ServerContext *context, const ::ofdpa::TunnelId *request,
+    OfdpaStatus *response) {
+  return reply(__FUNCTION__, state->tenant_delete(request->tunnel_id()),
+               response);
+}
+
+Status EmuOfdpaService::ofdpaPortSourceMacLearningSet(
+    ServerContext *context, const ::ofdpa::PortSrcMacLearning *request,
+    OfdpaStatus *response) {
+  return reply(__FUNCTION__, state->config_set(), response);
+}
+
+Status EmuOfdpaService::ofdpaPortSourceMacMoveLearningSet(
+    ServerContext *context, const ::ofdpa::PortSrcMacLearning *request,
+    OfdpaStatus *response) {
+  return reply(__FUNCTION__, state->config_set(), response);
+}
+
+Status EmuOfdpaService::ofdpaTunnelNextHopCreate(
+    ServerContext *context, const ::ofdpa::TunnelNextHopCreate *request,
+    OfdpaStatus *response) {
+  return reply(__FUNCTION__,
+               state->next_hop_create(request->next_hop_id(),
+                                      request->config().physical_port_num()),
+               response);
+}
+
+Status EmuOfdpaService::ofdpaTunnelNextHopDelete(
+    ServerContext *context, const ::ofdpa::NextHopId *request,
+    OfdpaStatus *response) {
+  return reply(__FUNCTION__, state->next_hop_delete(request->next_hop_id()),
+               response);
+}
+
+Status EmuOfdpaService::ofdpaTunnelNextHopModify(
+    ServerContext *context, const ::ofdpa::TunnelNextHopCreate *request,
+    OfdpaStatus *response) {
+  return reply(__FUNCTION__,
+               state->next_hop_modify(request->next_hop_id(),
+                                      request->config().physical_port_num()),
+               response);
+}
+
+Status EmuOfdpaService::ofdpaTunnelPortCreate(
+    ServerContext *context, const ::ofdpa::TunnelPortCreate *request,
+    OfdpaStatus *response) {
+  uint32_t next_hop_id = 0;
+
+  // endpoints reference their next hop, access ports a physical port
+  if (request->config().type() == ::ofdpa::OFDPA_TUNNEL_PORT_TYPE_ENDPOINT)
+    next_hop_id = request->config().config().endpoint_config().next_hop_id();
+
+  return reply(__FUNCTION__,
+               state->tunnel_port_create(request->port_num(), next_hop_id),
+               response);
+}
+
+Status EmuOfdpaService::ofdpaTunnelPortDelete(ServerContext *context,
+                                              const ::ofdpa::PortNum *request,
+                                              OfdpaStatus *response) {
+  return reply(__FUNCTION__, state->tunnel_port_delete(request->port_num()),
+               response);
+}
+
+Status EmuOfdpaService::ofdpaTunnelPortTenantAdd(
+    ServerContext *context, const ::ofdpa::TunnelPortTenantAdd *request,
+    OfdpaStatus *response) {
+  return reply(__FUNCTION__,
+               state->tunnel_port_tenant_add(request->port_num(),
+                                             request->tunnel_id()),
+               response);
+}
+
+Status EmuOfdpaService::ofdpaTunnelPortTenantDelete(
+    ServerContext *context, const ::ofdpa::TunnelPortTenantAdd *request,
+    OfdpaStatus *response) {
+  return reply(__FUNCTION__,
+               state->tunnel_port_tenant_delete(request->port_num(),
+                                                request->tunnel_id()),
+               response);
+}
+
+Status EmuOfdpaService::ofdpaStgReset(ServerContext *context,
+                                      const ::ofdpa::Empty *request,
+                                      OfdpaStatus *response) {
+  return reply(__FUNCTION__, state->stg_reset(), response);
+}
+
+Status EmuOfdpaService::ofdpaStgStatePortSet(
+    ServerContext *context, const ::ofdpa::StpInterfaceState *request,
+    OfdpaStatus *response) {
+  return reply(__FUNCTION__,
+               state->stg_port_state_set(request->stg_id().id(),
+                                         request->port_num(),
+                                         request->port_state()),
+               response);
+}
+
+Status EmuOfdpaService::ofdpaStgCreate(ServerContext *context,
+                                       const ::ofdpa::StgId *request,
+                                       OfdpaStatus *response) {
+  return reply(__FUNCTION__, state->stg_create(request->id()), response);
+}
+
+Status EmuOfdpaService::ofdpaStgDestroy(ServerContext *context,
+                                        const ::ofdpa::StgId *request,
+                                        OfdpaStatus *response) {
+  return reply(__FUNCTION__, state->stg_destroy(request->id()), response);
+}
+
+Status EmuOfdpaService::ofdpaStgVlanAdd(ServerContext *context,
+                                        const ::ofdpa::StgVlan *request,
+                                        OfdpaStatus *response) {
+  return reply(__FUNCTION__,
+               state->stg_vlan_add(request->stg_id().id(),
+                                   request->vlan_id().id()),
+               response);
+}
+
+Status EmuOfdpaService::ofdpaTrunkCreate(ServerContext *context,
+                                         const ::ofdpa::TrunkCreate *request,
+                                         OfdpaStatus *response) {
+  return reply(__FUNCTION__, state->trunk_create(request->lag_id()),
+               response);
+}
+
+Status EmuOfdpaService::ofdpaTrunkDelete(ServerContext *context,
+                                         const ::ofdpa::PortNum *request,
+                                         OfdpaStatus *response) {
+  return reply(__FUNCTION__, state->trunk_delete(request->port_num()),
+               response);
+}
+
+Status EmuOfdpaService::ofdpaPortTrunkGroupSet(
+    ServerContext *context, const ::ofdpa::TrunkGroupSet *request,
+    OfdpaStatus *response) {
+  return reply(__FUNCTION__,
+               state->trunk_member_set(request->member(), request->lag_id()),
+               response);
+}
+
+Status EmuOfdpaService::ofdpaTrunkPortMemberActiveSet(
+    ServerContext *context, const ::ofdpa::PortMemberActiveSet *request,
+    OfdpaStatus *response) {
+  return reply(__FUNCTION__,
+               state->trunk_member_active_set(
+                   request->member(), request->lag_id(), request->active()),
+               response);
+}
+
+Status EmuOfdpaService::ofdpaTrunkPortPSCSet(ServerContext *context,
+                                             const ::ofdpa::PSC *request,
+                                             OfdpaStatus *response) {
+  return reply(__FUNCTION__, state->trunk_psc_set(request->lag_id()),
+               response);
+}
+
+Status EmuOfdpaService::ofdpaRxRateSet(ServerContext *context,
+                                       const ::ofdpa::Pps *request,
+                                       OfdpaStatus *response) {
+  if (request->pps() < 0)
+    return reply(__FUNCTION__, EMU_PARAM, response);
+  return reply(__FUNCTION__, state->config_set(), response);
+}
+
+Status EmuOfdpaService::ofdpaPortKnetCreate(ServerContext *context,
+                                            const ::ofdpa::PortNum *request,
+                                            OfdpaStatus *response) {
+  return reply(__FUNCTION__, state->knet_create(request->port_num()),
+               response);
+}
+
+Status EmuOfdpaService::ofdpaPortKnetDelete(ServerContext *context,
+                                            const ::ofdpa::PortNum *request,
+                                            OfdpaStatus *response) {
+  return reply(__FUNCTION__, state->knet_delete(request->port_num()),
+               response);
+}
+
+} // namespace basebox
@@ -0,0 +1,114 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#pragma once
+
+#include <memory>
+
+#include <grpcpp/grpcpp.h>
+
+#include "api/ofdpa.grpc.pb.h"
+
+namespace basebox {
+
+// forward declarations
+class emu_state;
+
+// the OF-DPA agent RPC service on top of the emulated switch state
+class EmuOfdpaService final : public ::ofdpa::OfdpaRpc::Service {
+public:
+  typedef ::grpc::ServerContext ServerContext;
+  typedef ::ofdpa::OfdpaStatus OfdpaStatus;
+
+  explicit EmuOfdpaService(std::shared_ptr<emu_state> state);
+
+  ::grpc::Status ofdpaTunnelReset(ServerContext *context,
+                                  const ::ofdpa::Empty *request,
+                                  OfdpaStatus *response) override;
+  ::grpc::Status
+  ofdpaTunnelTenantCreate(ServerContext *context,
+                          const ::ofdpa::TunnelTenantCreate *request,
+                          OfdpaStatus *response) override;
+  ::grpc::Status ofdpaTunnelTenantDelete(ServerContext *context,
+                                         const ::ofdpa::TunnelId *request,
+                                         OfdpaStatus *response) override;
+  ::grpc::Status
+  ofdpaPortSourceMacLearningSet(ServerContext *context,
+                                const ::ofdpa::PortSrcMacLearning *request,
+                                OfdpaStatus *response) override;
+  ::grpc::Status
+  ofdpaPortSourceMacMoveLearningSet(ServerContext *context,
+                                    const ::ofdpa::PortSrcMacLearning *request,
+                                    OfdpaStatus *response) override;
+  ::grpc::Status
+  ofdpaTunnelNextHopCreate(ServerContext *context,
+                           const ::ofdpa::TunnelNextHopCreate *request,
+                           OfdpaStatus *response) override;
+  ::grpc::Status ofdpaTunnelNextHopDelete(ServerContext *context,
+                                          const ::ofdpa::NextHopId *request,
+                                          OfdpaStatus *response) override;
+  ::grpc::Status
+  ofdpaTunnelNextHopModify(ServerContext *context,
+                           const ::ofdpa::TunnelNextHopCreate *request,
+                           OfdpaStatus *response) override;
+  ::grpc::Status ofdpaTunnelPortCreate(ServerContext *context,
+                                       const ::ofdpa::TunnelPortCreate *request,
+                                       OfdpaStatus *response) override;
+  ::grpc::Status ofdpaTunnelPortDelete(ServerContext *context,
+                                       const ::ofdpa::PortNum *request,
+                                       OfdpaStatus *response) override;
+  ::grpc::Status
+  ofdpaTunnelPortTenantAdd(ServerContext *context,
+                           const ::ofdpa::TunnelPortTenantAdd *request,
+                           OfdpaStatus *response) override;
+  ::grpc::Status
+  ofdpaTunnelPortTenantDelete(ServerContext *context,
+                              const ::ofdpa::TunnelPortTenantAdd *request,
+                              OfdpaStatus *response) override;
+  ::grpc::Status ofdpaStgReset(ServerContext *context,
+                               const ::ofdpa::Empty *request,
+                               OfdpaStatus *response) override;
+  ::grpc::Status
+  ofdpaStgStatePortSet(ServerContext *context,
+                       const ::ofdpa::StpInterfaceState *request,
+                       OfdpaStatus *response) override;
+  ::grpc::Status ofdpaStgCreate(ServerContext *context,
+                                const ::ofdpa::StgId *request,
+                                OfdpaStatus *response) override;
+  ::grpc::Status ofdpaStgDestroy(ServerContext *context,
+                                 const ::ofdpa::StgId *request,
+                                 OfdpaStatus *response) override;
+  ::grpc::Status ofdpaStgVlanAdd(ServerContext *context,
+                                 const ::ofdpa::StgVlan *request,
+                                 OfdpaStatus *response) override;
+  ::grpc::Status ofdpaTrunkCreate(ServerContext *context,
+                                  const ::ofdpa::TrunkCreate *request,
+                                  OfdpaStatus *response) override;
+  ::grpc::Status ofdpaTrunkDelete(ServerContext *context,
+                                  const ::ofdpa::PortNum *request,
+                                  OfdpaStatus *response) override;
+  ::grpc::Status ofdpaPortTrunkGroupSet(ServerContext *context,
+                                        const ::ofdpa::TrunkGroupSet *request,
+                                        OfdpaStatus *response) override;
+  ::grpc::Status
+  ofdpaTrunkPortMemberActiveSet(ServerContext *context,
+                                const ::ofdpa::PortMemberActiveSet *request,
+                                OfdpaStatus *response) override;
+  ::grpc::Status ofdpaTrunkPortPSCSet(ServerContext *context,
+                                      const ::ofdpa::PSC *request,
+                                      OfdpaStatus *response) override;
+  ::grpc::Status ofdpaRxRateSet(ServerContext *context,
+                                const ::ofdpa::Pps *request,
+                                OfdpaStatus *response) override;
+  ::grpc::Status ofdpaPortKnetCreate(ServerContext *context,
+                                     const ::ofdpa::PortNum *request,
+                                     OfdpaStatus *response) override;
+  ::grpc::Status ofdpaPortKnetDelete(ServerContext *context,
+                                     const ::ofdpa::PortNum *request,
+                                     OfdpaStatus *response) override;
+
+private:
+  std::shared_ptr<emu_state> state;
+};
+
+} // namespace basebox
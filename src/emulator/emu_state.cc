@@ -0,0 +1,764 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include <algorithm>
+#include <thread>
+
+#include <glog/logging.h>
+
+#include "emu_state.h"
+#include "of-dpa/ofdpa_datatypes.h"
+
+namespace basebox {
+
+// OpenFlow 1.3 wire format constants
+enum {
+  OFPIT_WRITE_ACTIONS = 3,
+  OFPIT_APPLY_ACTIONS = 4,
+  OFPAT_GROUP = 22,
+  OFPGT_ALL = 0,
+  OFPGT_SELECT = 1,
+  OFPGT_INDIRECT = 2,
+  OFPG_ALL = 0xfffffffc,
+  OFPTT_ALL = 0xff,
+};
+
+// OF-DPA group types encoded in bits 28-31 of the group id
+enum emu_group_type {
+  EMU_GROUP_L2_INTERFACE = 0,
+  EMU_GROUP_L2_REWRITE = 1,
+  EMU_GROUP_L3_UNICAST = 2,
+  EMU_GROUP_L2_MULTICAST = 3,
+  EMU_GROUP_L2_FLOOD = 4,
+  EMU_GROUP_L3_INTERFACE = 5,
+  EMU_GROUP_L3_MULTICAST = 6,
+  EMU_GROUP_L3_ECMP = 7,
+  EMU_GROUP_L2_OVERLAY = 8,
+  EMU_GROUP_MPLS_LABEL = 9,
+  EMU_GROUP_MPLS_FORWARDING = 10,
+  EMU_GROUP_L2_UNFILTERED_INTERFACE = 11,
+  EMU_GROUP_L2_LOOPBACK = 12,
+};
+
+static uint16_t get16(const std::string &s, size_t off) {
+  return (uint8_t)s[off] << 8 | (uint8_t)s[off + 1];
+}
+
+static uint32_t get32(const std::string &s, size_t off) {
+  return (uint32_t)get16(s, off) << 16 | get16(s, off + 2);
+}
+
+static void action_groups(const std::string &s, size_t off, size_t end,
+                          std::set<uint32_t> &ids) {
+  while (off + 4 <= end) {
+    uint16_t type = get16(s, off);
+    uint16_t len = get16(s, off + 2);
+
+    if (len < 4 || off + len > end)
+      break;
+    if (type == OFPAT_GROUP && len >= 8)
+      ids.insert(get32(s, off + 4));
+    off += len;
+  }
+}
+
+std::set<uint32_t> emu_instruction_groups(const std::string &instructions) {
+  std::set<uint32_t> ids;
+  size_t off = 0;
+
+  while (off + 4 <= instructions.size()) {
+    uint16_t type = get16(instructions, off);
+    uint16_t len = get16(instructions, off + 2);
+
+    if (len < 4 || off + len > instructions.size())
+      break;
+    if (type == OFPIT_WRITE_ACTIONS || type == OFPIT_APPLY_ACTIONS)
+      action_groups(instructions, off + 8, off + len, ids);
+    off += len;
+  }
+
+  return ids;
+}
+
+// walks the packed buckets, returns the number of buckets
+static unsigned walk_buckets(const std::string &buckets,
+                             std::set<uint32_t> &ids) {
+  unsigned n = 0;
+  size_t off = 0;
+
+  while (off + 16 <= buckets.size()) {
+    uint16_t len = get16(buckets, off);
+
+    if (len < 16 || off + len > buckets.size())
+      break;
+    action_groups(buckets, off + 16, off + len, ids);
+    off += len;
+    n++;
+  }
+
+  return n;
+}
+
+std::set<uint32_t> emu_bucket_groups(const std::string &buckets) {
+  std::set<uint32_t> ids;
+
+  walk_buckets(buckets, ids);
+  return ids;
+}
+
+// the OXM TLVs of a packed ofp_match
+static std::set<std::string> oxm_fields(const std::string &match) {
+  std::set<std::string> fields;
+
+  if (match.size() < 4)
+    return fields;
+
+  size_t end = std::min<size_t>(get16(match, 2), match.size());
+  size_t off = 4;
+
+  while (off + 4 <= end) {
+    size_t len = 4 + (uint8_t)match[off + 3];
+
+    if (off + len > end)
+      break;
+    fields.emplace(match, off, len);
+    off += len;
+  }
+
+  return fields;
+}
+
+bool emu_match_covers(const std::string &filter, const std::string &match) {
+  auto f = oxm_fields(filter);
+
+  if (f.empty())
+    return true;
+
+  auto m = oxm_fields(match);
+  for (const auto &field : f) {
+    if (m.find(field) == m.end())
+      return false;
+  }
+
+  return true;
+}
+
+static bool valid_table(uint8_t table_id) {
+  switch (table_id) {
+  case OFDPA_FLOW_TABLE_ID_INGRESS_PORT:
+  case OFDPA_FLOW_TABLE_ID_PORT_DSCP_TRUST:
+  case OFDPA_FLOW_TABLE_ID_PORT_PCP_TRUST:
+  case OFDPA_FLOW_TABLE_ID_TUNNEL_DSCP_TRUST:
+  case OFDPA_FLOW_TABLE_ID_TUNNEL_PCP_TRUST:
+  case OFDPA_FLOW_TABLE_ID_INJECTED_OAM:
+  case OFDPA_FLOW_TABLE_ID_VLAN:
+  case OFDPA_FLOW_TABLE_ID_VLAN_1:
+  case OFDPA_FLOW_TABLE_ID_MAINTENANCE_POINT:
+  case OFDPA_FLOW_TABLE_ID_MPLS_L2_PORT:
+  case OFDPA_FLOW_TABLE_ID_MPLS_DSCP_TRUST:
+  case OFDPA_FLOW_TABLE_ID_MPLS_PCP_TRUST:
+  case OFDPA_FLOW_TABLE_ID_MPLS_QOS_CLASS:
+  case OFDPA_FLOW_TABLE_ID_L2_POLICER:
+  case OFDPA_FLOW_TABLE_ID_L2_POLICER_ACTIONS:
+  case OFDPA_FLOW_TABLE_ID_TERMINATION_MAC:
+  case OFDPA_FLOW_TABLE_ID_L3_TYPE:
+  case OFDPA_FLOW_TABLE_ID_MPLS_0:
+  case OFDPA_FLOW_TABLE_ID_MPLS_1:
+  case OFDPA_FLOW_TABLE_ID_MPLS_2:
+  case OFDPA_FLOW_TABLE_ID_MPLS_MAINTENANCE_POINT:
+  case OFDPA_FLOW_TABLE_ID_MPLS_L3_TYPE:
+  case OFDPA_FLOW_TABLE_ID_MPLS_LABEL_TRUST:
+  case OFDPA_FLOW_TABLE_ID_MPLS_TYPE:
+  case OFDPA_FLOW_TABLE_ID_UNICAST_ROUTING:
+  case OFDPA_FLOW_TABLE_ID_MULTICAST_ROUTING:
+  case OFDPA_FLOW_TABLE_ID_BRIDGING:
+  case OFDPA_FLOW_TABLE_ID_ACL_POLICY:
+  case OFDPA_FLOW_TABLE_ID_COLOR_BASED_ACTIONS:
+  case OFDPA_FLOW_TABLE_ID_EGRESS_VLAN:
+  case OFDPA_FLOW_TABLE_ID_EGRESS_VLAN_1:
+  case OFDPA_FLOW_TABLE_ID_EGRESS_MAINTENANCE_POINT:
+  case OFDPA_FLOW_TABLE_ID_EGRESS_DSCP_PCP_REMARK:
+  case OFDPA_FLOW_TABLE_ID_EGRESS_TPID:
+  case OFDPA_FLOW_TABLE_ID_SA_LOOKUP:
+    return true;
+  default:
+    return false;
+  }
+}
+
+static bool valid_group(uint32_t group_id, uint8_t type, unsigned buckets) {
+  switch (group_id >> 28) {
+  case EMU_GROUP_L2_INTERFACE:
+  case EMU_GROUP_L2_REWRITE:
+  case EMU_GROUP_L3_UNICAST:
+  case EMU_GROUP_L3_INTERFACE:
+  case EMU_GROUP_MPLS_LABEL:
+  case EMU_GROUP_L2_UNFILTERED_INTERFACE:
+  case EMU_GROUP_L2_LOOPBACK:
+    return type == OFPGT_INDIRECT && buckets == 1;
+  case EMU_GROUP_L2_MULTICAST:
+  case EMU_GROUP_L2_FLOOD:
+  case EMU_GROUP_L3_MULTICAST:
+  case EMU_GROUP_L2_OVERLAY:
+    return type == OFPGT_ALL;
+  case EMU_GROUP_L3_ECMP:
+    return type == OFPGT_SELECT;
+  case EMU_GROUP_MPLS_FORWARDING:
+    return true; // depends on the subtype
+  default:
+    return false;
+  }
+}
+
+const char *emu_status_str(enum emu_status s) {
+  switch (s) {
+  case EMU_OK:
+    return "ok";
+  case EMU_PARAM:
+    return "invalid parameter";
+  case EMU_EXISTS:
+    return "exists";
+  case EMU_NOT_FOUND:
+    return "not found";
+  case EMU_BAD_REF:
+    return "invalid reference";
+  case EMU_IN_USE:
+    return "in use";
+  case EMU_FULL:
+    return "table full";
+  }
+  return "unknown";
+}
+
+emu_state::emu_state(const emu_limits &limits)
+    : limits(limits), flow_mods(0), group_mods(0), rpcs(0), errors(0) {}
+
+enum emu_status emu_state::done(enum emu_status s,
+                                std::atomic<uint64_t> &counter) {
+  if (limits.latency.count())
+    std::this_thread::sleep_for(limits.latency);
+
+  counter++;
+  if (s != EMU_OK) {
+    errors++;
+    VLOG(2) << __FUNCTION__ << ": failed: " << emu_status_str(s);
+  }
+  return s;
+}
+
+enum emu_status emu_state::ref_groups(const std::set<uint32_t> &ids) {
+  for (auto id : ids) {
+    if (groups.find(id) == groups.end())
+      return EMU_BAD_REF;
+  }
+
+  for (auto id : ids)
+    groups[id].refcnt++;
+  return EMU_OK;
+}
+
+void emu_state::unref_groups(const std::set<uint32_t> &ids) {
+  for (auto id : ids) {
+    auto it = groups.find(id);
+    if (it != groups.end() && it->second.refcnt)
+      it->second.refcnt--;
+  }
+}
+
+void emu_state::erase_flow(std::map<flow_key, flow>::iterator it) {
+  unref_groups(it->second.groups);
+  table_size[std::get<0>(it->first)]--;
+  flows.erase(it);
+}
+
+enum emu_status emu_state::flow_add(uint8_t table_id, uint16_t priority,
+                                    uint64_t cookie, const std::string &match,
+                                    const std::string &instructions) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  if (!valid_table(table_id))
+    return done(EMU_PARAM, flow_mods);
+
+  flow f = {instructions, emu_instruction_groups(instructions), cookie, 0};
+  auto it = flows.find(flow_key(table_id, priority, match));
+
+  if (it == flows.end() && table_size[table_id] >= limits.flows)
+    return done(EMU_FULL, flow_mods);
+
+  enum emu_status rv = ref_groups(f.groups);
+  if (rv != EMU_OK)
+    return done(rv, flow_mods);
+
+  // an identical flow is replaced
+  if (it != flows.end()) {
+    unref_groups(it->second.groups);
+    it->second = std::move(f);
+  } else {
+    flows.emplace(flow_key(table_id, priority, match), std::move(f));
+    table_size[table_id]++;
+  }
+
+  return done(EMU_OK, flow_mods);
+}
+
+enum emu_status emu_state::flow_modify(uint8_t table_id, uint16_t priority,
+                                       const std::string &match,
+                                       const std::string &instructions,
+                                       bool strict) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  if (!valid_table(table_id))
+    return done(EMU_PARAM, flow_mods);
+
+  auto ids = emu_instruction_groups(instructions);
+
+  // modifying a flow that does not exist is not an error
+  for (auto &f : flows) {
+    if (std::get<0>(f.first) != table_id)
+      continue;
+    if (strict && (std::get<1>(f.first) != priority ||
+                   std::get<2>(f.first) != match))
+      continue;
+    if (!strict && !emu_match_covers(match, std::get<2>(f.first)))
+      continue;
+
+    enum emu_status rv = ref_groups(ids);
+    if (rv != EMU_OK)
+      return done(rv, flow_mods);
+
+    unref_groups(f.second.groups);
+    f.second.instructions = instructions;
+    f.second.groups = ids;
+  }
+
+  return done(EMU_OK, flow_mods);
+}
+
+enum emu_status emu_state::flow_delete(uint8_t table_id, uint16_t priority,
+                                       const std::string &match,
+                                       bool strict) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  if (table_id != OFPTT_ALL && !valid_table(table_id))
+    return done(EMU_PARAM, flow_mods);
+
+  if (strict) {
+    auto it = flows.find(flow_key(table_id, priority, match));
+    if (it != flows.end())
+      erase_flow(it);
+    return done(EMU_OK, flow_mods);
+  }
+
+  for (auto it = flows.begin(); it != flows.end();) {
+    auto cur = it++;
+    if (table_id != OFPTT_ALL && std::get<0>(cur->first) != table_id)
+      continue;
+    if (emu_match_covers(match, std::get<2>(cur->first)))
+      erase_flow(cur);
+  }
+
+  return done(EMU_OK, flow_mods);
+}
+
+void emu_state::flow_stats(uint8_t table_id, const std::string &match,
+                           unsigned hit_percent,
+                           std::deque<emu_flow_stats> *stats) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+  std::uniform_int_distribution<unsigned> percent(0, 99);
+
+  for (auto &f : flows) {
+    if (table_id != OFPTT_ALL && std::get<0>(f.first) != table_id)
+      continue;
+    if (!emu_match_covers(match, std::get<2>(f.first)))
+      continue;
+
+    if (hit_percent && percent(hits) < hit_percent)
+      f.second.packets++;
+
+    stats->push_back(emu_flow_stats{std::get<0>(f.first), std::get<1>(f.first),
+                                    f.second.cookie, f.second.packets,
+                                    std::get<2>(f.first)});
+  }
+}
+
+enum emu_status emu_state::group_add(uint32_t group_id, uint8_t type,
+                                     const std::string &buckets) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+  std::set<uint32_t> ids;
+
+  if (!valid_group(group_id, type, walk_buckets(buckets, ids)))
+    return done(EMU_PARAM, group_mods);
+  if (groups.find(group_id) != groups.end())
+    return done(EMU_EXISTS, group_mods);
+  if (groups.size() >= limits.groups)
+    return done(EMU_FULL, group_mods);
+
+  enum emu_status rv = ref_groups(ids);
+  if (rv != EMU_OK)
+    return done(rv, group_mods);
+
+  groups.emplace(group_id, group{buckets, std::move(ids), 0});
+  return done(EMU_OK, group_mods);
+}
+
+enum emu_status emu_state::group_modify(uint32_t group_id, uint8_t type,
+                                        const std::string &buckets) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+  std::set<uint32_t> ids;
+
+  if (!valid_group(group_id, type, walk_buckets(buckets, ids)))
+    return done(EMU_PARAM, group_mods);
+
+  auto it = groups.find(group_id);
+  if (it == groups.end())
+    return done(EMU_NOT_FOUND, group_mods);
+  if (ids.count(group_id))
+    return done(EMU_BAD_REF, group_mods);
+
+  enum emu_status rv = ref_groups(ids);
+  if (rv != EMU_OK)
+    return done(rv, group_mods);
+
+  unref_groups(it->second.groups);
+  it->second.buckets = buckets;
+  it->second.groups = std::move(ids);
+  return done(EMU_OK, group_mods);
+}
+
+enum emu_status emu_state::group_delete(uint32_t group_id) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  if (group_id == OFPG_ALL) {
+    // flows forwarding to any group go with them
+    for (auto it = flows.begin(); it != flows.end();) {
+      auto cur = it++;
+      if (!cur->second.groups.empty())
+        erase_flow(cur);
+    }
+    groups.clear();
+    return done(EMU_OK, group_mods);
+  }
+
+  auto it = groups.find(group_id);
+  if (it == groups.end())
+    return done(EMU_OK, group_mods);
+
+  // OF-DPA refuses to remove referenced groups
+  if (it->second.refcnt)
+    return done(EMU_IN_USE, group_mods);
+
+  unref_groups(it->second.groups);
+  groups.erase(it);
+  return done(EMU_OK, group_mods);
+}
+
+enum emu_status emu_state::tunnel_reset() {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  tenants.clear();
+  tenant_refcnt.clear();
+  next_hops.clear();
+  next_hop_refcnt.clear();
+  tunnel_ports.clear();
+  return done(EMU_OK, rpcs);
+}
+
+enum emu_status emu_state::tenant_create(uint32_t tunnel_id, uint32_t vni) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  if (tenants.find(tunnel_id) != tenants.end())
+    return done(EMU_EXISTS, rpcs);
+  if (tenants.size() >= limits.tunnel)
+    return done(EMU_FULL, rpcs);
+
+  for (const auto &t : tenants) {
+    if (t.second == vni)
+      return done(EMU_EXISTS, rpcs);
+  }
+
+  tenants.emplace(tunnel_id, vni);
+  return done(EMU_OK, rpcs);
+}
+
+enum emu_status emu_state::tenant_delete(uint32_t tunnel_id) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  if (tenants.find(tunnel_id) == tenants.end())
+    return done(EMU_NOT_FOUND, rpcs);
+  if (tenant_refcnt[tunnel_id])
+    return done(EMU_IN_USE, rpcs);
+
+  tenants.erase(tunnel_id);
+  tenant_refcnt.erase(tunnel_id);
+  return done(EMU_OK, rpcs);
+}
+
+enum emu_status emu_state::next_hop_create(uint32_t next_hop_id,
+                                           uint32_t port_id) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  if (next_hops.find(next_hop_id) != next_hops.end())
+    return done(EMU_EXISTS, rpcs);
+  if (next_hops.size() >= limits.tunnel)
+    return done(EMU_FULL, rpcs);
+
+  next_hops.emplace(next_hop_id, port_id);
+  return done(EMU_OK, rpcs);
+}
+
+enum emu_status emu_state::next_hop_modify(uint32_t next_hop_id,
+                                           uint32_t port_id) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  auto it = next_hops.find(next_hop_id);
+  if (it == next_hops.end())
+    return done(EMU_NOT_FOUND, rpcs);
+
+  it->second = port_id;
+  return done(EMU_OK, rpcs);
+}
+
+enum emu_status emu_state::next_hop_delete(uint32_t next_hop_id) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  if (next_hops.find(next_hop_id) == next_hops.end())
+    return done(EMU_NOT_FOUND, rpcs);
+  if (next_hop_refcnt[next_hop_id])
+    return done(EMU_IN_USE, rpcs);
+
+  next_hops.erase(next_hop_id);
+  next_hop_refcnt.erase(next_hop_id);
+  return done(EMU_OK, rpcs);
+}
+
+enum emu_status emu_state::tunnel_port_create(uint32_t port_id,
+                                              uint32_t next_hop_id) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  if (tunnel_ports.find(port_id) != tunnel_ports.end())
+    return done(EMU_EXISTS, rpcs);
+  if (tunnel_ports.size() >= limits.tunnel)
+    return done(EMU_FULL, rpcs);
+  if (next_hop_id && next_hops.find(next_hop_id) == next_hops.end())
+    return done(EMU_BAD_REF, rpcs);
+
+  if (next_hop_id)
+    next_hop_refcnt[next_hop_id]++;
+  tunnel_ports.emplace(port_id, tunnel_port{next_hop_id, {}});
+  return done(EMU_OK, rpcs);
+}
+
+enum emu_status emu_state::tunnel_port_delete(uint32_t port_id) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  auto it = tunnel_ports.find(port_id);
+  if (it == tunnel_ports.end())
+    return done(EMU_NOT_FOUND, rpcs);
+  if (!it->second.tenants.empty())
+    return done(EMU_IN_USE, rpcs);
+
+  if (it->second.next_hop_id)
+    next_hop_refcnt[it->second.next_hop_id]--;
+  tunnel_ports.erase(it);
+  return done(EMU_OK, rpcs);
+}
+
+enum emu_status emu_state::tunnel_port_tenant_add(uint32_t port_id,
+                                                  uint32_t tunnel_id) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  auto it = tunnel_ports.find(port_id);
+  if (it == tunnel_ports.end() || tenants.find(tunnel_id) == tenants.end())
+    return done(EMU_NOT_FOUND, rpcs);
+  if (!it->second.tenants.insert(tunnel_id).second)
+    return done(EMU_EXISTS, rpcs);
+
+  tenant_refcnt[tunnel_id]++;
+  return done(EMU_OK, rpcs);
+}
+
+enum emu_status emu_state::tunnel_port_tenant_delete(uint32_t port_id,
+                                                     uint32_t tunnel_id) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  auto it = tunnel_ports.find(port_id);
+  if (it == tunnel_ports.end() || !it->second.tenants.erase(tunnel_id))
+    return done(EMU_NOT_FOUND, rpcs);
+
+  tenant_refcnt[tunnel_id]--;
+  return done(EMU_OK, rpcs);
+}
+
+enum emu_status emu_state::stg_reset() {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  stgs.clear();
+  stg_port_states.clear();
+  return done(EMU_OK, rpcs);
+}
+
+enum emu_status emu_state::stg_create(uint32_t stg_id) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  if (stgs.find(stg_id) != stgs.end())
+    return done(EMU_EXISTS, rpcs);
+
+  stgs.emplace(stg_id, std::set<uint16_t>());
+  return done(EMU_OK, rpcs);
+}
+
+enum emu_status emu_state::stg_destroy(uint32_t stg_id) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  if (!stgs.erase(stg_id))
+    return done(EMU_NOT_FOUND, rpcs);
+
+  for (auto it = stg_port_states.begin(); it != stg_port_states.end();) {
+    if (it->first.first == stg_id)
+      it = stg_port_states.erase(it);
+    else
+      ++it;
+  }
+
+  return done(EMU_OK, rpcs);
+}
+
+enum emu_status emu_state::stg_vlan_add(uint32_t stg_id, uint16_t vid) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  auto it = stgs.find(stg_id);
+  if (it == stgs.end())
+    return done(EMU_NOT_FOUND, rpcs);
+  if (vid == 0 || vid > 4095)
+    return done(EMU_PARAM, rpcs);
+
+  // a vlan is part of a single stg
+  for (auto &stg : stgs)
+    stg.second.erase(vid);
+  it->second.insert(vid);
+  return done(EMU_OK, rpcs);
+}
+
+enum emu_status emu_state::stg_port_state_set(uint32_t stg_id,
+                                              uint32_t port_id,
+                                              const std::string &state) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  if (stgs.find(stg_id) == stgs.end())
+    return done(EMU_NOT_FOUND, rpcs);
+  if (state != "forward" && state != "block" && state != "disable" &&
+      state != "listen" && state != "learn")
+    return done(EMU_PARAM, rpcs);
+
+  stg_port_states[std::make_pair(stg_id, port_id)] = state;
+  return done(EMU_OK, rpcs);
+}
+
+enum emu_status emu_state::trunk_create(uint32_t lag_id) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  if (trunks.find(lag_id) != trunks.end())
+    return done(EMU_EXISTS, rpcs);
+  if (trunks.size() >= limits.tunnel)
+    return done(EMU_FULL, rpcs);
+
+  trunks.emplace(lag_id, trunk());
+  return done(EMU_OK, rpcs);
+}
+
+enum emu_status emu_state::trunk_delete(uint32_t lag_id) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  auto it = trunks.find(lag_id);
+  if (it == trunks.end())
+    return done(EMU_NOT_FOUND, rpcs);
+
+  for (const auto &m : it->second.members)
+    trunk_of_port.erase(m.first);
+  trunks.erase(it);
+  return done(EMU_OK, rpcs);
+}
+
+enum emu_status emu_state::trunk_member_set(uint32_t port_id,
+                                            uint32_t lag_id) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  if (lag_id && trunks.find(lag_id) == trunks.end())
+    return done(EMU_NOT_FOUND, rpcs);
+
+  auto cur = trunk_of_port.find(port_id);
+  if (cur != trunk_of_port.end()) {
+    trunks[cur->second].members.erase(port_id);
+    trunk_of_port.erase(cur);
+  }
+
+  if (lag_id) {
+    trunks[lag_id].members[port_id] = false;
+    trunk_of_port[port_id] = lag_id;
+  }
+
+  return done(EMU_OK, rpcs);
+}
+
+enum emu_status emu_state::trunk_member_active_set(uint32_t port_id,
+                                                   uint32_t lag_id,
+                                                   bool active) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  auto it = trunks.find(lag_id);
+  if (it == trunks.end())
+    return done(EMU_NOT_FOUND, rpcs);
+
+  auto m = it->second.members.find(port_id);
+  if (m == it->second.members.end())
+    return done(EMU_NOT_FOUND, rpcs);
+
+  m->second = active;
+  return done(EMU_OK, rpcs);
+}
+
+enum emu_status emu_state::trunk_psc_set(uint32_t lag_id) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  if (trunks.find(lag_id) == trunks.end())
+    return done(EMU_NOT_FOUND, rpcs);
+  return done(EMU_OK, rpcs);
+}
+
+enum emu_status emu_state::knet_create(uint32_t port_id) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  if (!knet_ports.insert(port_id).second)
+    return done(EMU_EXISTS, rpcs);
+  return done(EMU_OK, rpcs);
+}
+
+enum emu_status emu_state::knet_delete(uint32_t port_id) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  if (!knet_ports.erase(port_id))
+    return done(EMU_NOT_FOUND, rpcs);
+  return done(EMU_OK, rpcs);
+}
+
+enum emu_status emu_state::config_set() {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  return done(EMU_OK, rpcs);
+}
+
+void emu_state::stats(emu_stats &s) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  s.flow_mods = flow_mods;
+  s.group_mods = group_mods;
+  s.rpcs = rpcs;
+  s.errors = errors;
+  s.flows = flows.size();
+  s.groups = groups.size();
+  s.tenants = tenants.size();
+  s.next_hops = next_hops.size();
+  s.tunnel_ports = tunnel_ports.size();
+}
+
+} // namespace basebox
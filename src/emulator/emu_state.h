@@ -0,0 +1,198 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <tuple>
+
+namespace basebox {
+
+enum emu_status {
+  EMU_OK = 0,
+  EMU_PARAM,     // invalid table id, group type or argument
+  EMU_EXISTS,    // object already exists
+  EMU_NOT_FOUND, // object does not exist
+  EMU_BAD_REF,   // referenced group or object does not exist
+  EMU_IN_USE,    // object is still referenced
+  EMU_FULL,      // capacity limit reached
+};
+
+const char *emu_status_str(enum emu_status s);
+
+struct emu_flow_stats {
+  uint8_t table_id;
+  uint16_t priority;
+  uint64_t cookie;
+  uint64_t packets;
+  std::string match; // packed ofp_match
+};
+
+struct emu_limits {
+  std::size_t flows;  // per flow table
+  std::size_t groups; // all group types
+  std::size_t tunnel; // per tunnel object type (tenants, next hops, ports)
+  std::chrono::microseconds latency; // per programming operation
+};
+
+struct emu_stats {
+  uint64_t flow_mods;
+  uint64_t group_mods;
+  uint64_t rpcs;
+  uint64_t errors;
+  std::size_t flows;
+  std::size_t groups;
+  std::size_t tenants;
+  std::size_t next_hops;
+  std::size_t tunnel_ports;
+};
+
+/**
+ * in memory state of the emulated OF-DPA switch
+ *
+ * Flow and group entries are kept as their packed OpenFlow wire format and
+ * checked the way OF-DPA does: flows only go into the pipeline tables, group
+ * ids have to encode a group type matching the OpenFlow group type, and
+ * groups referenced by flows or other groups must exist and cannot be
+ * deleted. The tunnel, STG and trunk objects of the OF-DPA API keep their
+ * references the same way.
+ *
+ * All operations are serialized by a single lock, like the API of the agent,
+ * and take at least the configured latency.
+ */
+class emu_state final {
+public:
+  explicit emu_state(const emu_limits &limits);
+
+  // OpenFlow, match is a packed ofp_match, instructions/buckets packed lists
+  enum emu_status flow_add(uint8_t table_id, uint16_t priority,
+                           uint64_t cookie, const std::string &match,
+                           const std::string &instructions);
+  enum emu_status flow_modify(uint8_t table_id, uint16_t priority,
+                              const std::string &match,
+                              const std::string &instructions, bool strict);
+  enum emu_status flow_delete(uint8_t table_id, uint16_t priority,
+                              const std::string &match, bool strict);
+  enum emu_status group_add(uint32_t group_id, uint8_t type,
+                            const std::string &buckets);
+  enum emu_status group_modify(uint32_t group_id, uint8_t type,
+                               const std::string &buckets);
+  enum emu_status group_delete(uint32_t group_id);
+
+  // the flows of table_id matching the filter, no traffic is forwarded: each
+  // flow counts a packet since the previous request with a chance of
+  // hit_percent, e.g. for the soft ageing of baseboxd
+  void flow_stats(uint8_t table_id, const std::string &match,
+                  unsigned hit_percent, std::deque<emu_flow_stats> *stats);
+
+  // OF-DPA API
+  enum emu_status tunnel_reset();
+  enum emu_status tenant_create(uint32_t tunnel_id, uint32_t vni);
+  enum emu_status tenant_delete(uint32_t tunnel_id);
+  enum emu_status next_hop_create(uint32_t next_hop_id, uint32_t port_id);
+  enum emu_status next_hop_modify(uint32_t next_hop_id, uint32_t port_id);
+  enum emu_status next_hop_delete(uint32_t next_hop_id);
+  // next_hop_id is 0 for access ports
+  enum emu_status tunnel_port_create(uint32_t port_id, uint32_t next_hop_id);
+  enum emu_status tunnel_port_delete(uint32_t port_id);
+  enum emu_status tunnel_port_tenant_add(uint32_t port_id, uint32_t tunnel_id);
+  enum emu_status tunnel_port_tenant_delete(uint32_t port_id,
+                                            uint32_t tunnel_id);
+  enum emu_status stg_reset();
+  enum emu_status stg_create(uint32_t stg_id);
+  enum emu_status stg_destroy(uint32_t stg_id);
+  enum emu_status stg_vlan_add(uint32_t stg_id, uint16_t vid);
+  enum emu_status stg_port_state_set(uint32_t stg_id, uint32_t port_id,
+                                     const std::string &state);
+  enum emu_status trunk_create(uint32_t lag_id);
+  enum emu_status trunk_delete(uint32_t lag_id);
+  // lag_id 0 removes the port from its trunk
+  enum emu_status trunk_member_set(uint32_t port_id, uint32_t lag_id);
+  enum emu_status trunk_member_active_set(uint32_t port_id, uint32_t lag_id,
+                                          bool active);
+  enum emu_status trunk_psc_set(uint32_t lag_id);
+  enum emu_status knet_create(uint32_t port_id);
+  enum emu_status knet_delete(uint32_t port_id);
+  // settings without state, i.e. learning mode and rx rate
+  enum emu_status config_set();
+
+  void stats(emu_stats &s);
+
+private:
+  emu_state(const emu_state &) = delete;
+  emu_state &operator=(const emu_state &) = delete;
+
+  // (table_id, priority, match)
+  typedef std::tuple<uint8_t, uint16_t, std::string> flow_key;
+
+  struct flow {
+    std::string instructions;
+    std::set<uint32_t> groups;
+    uint64_t cookie;
+    uint64_t packets;
+  };
+
+  struct group {
+    std::string buckets;
+    std::set<uint32_t> groups;
+    unsigned refcnt;
+  };
+
+  struct tunnel_port {
+    uint32_t next_hop_id;
+    std::set<uint32_t> tenants;
+  };
+
+  struct trunk {
+    std::map<uint32_t, bool> members; // port_id:active
+  };
+
+  const emu_limits limits;
+  std::mutex state_mutex;
+
+  std::map<flow_key, flow> flows;
+  std::map<uint8_t, std::size_t> table_size;
+  std::map<uint32_t, group> groups;
+
+  std::map<uint32_t, uint32_t> tenants;   // tunnel_id:vni
+  std::map<uint32_t, unsigned> tenant_refcnt;
+  std::map<uint32_t, uint32_t> next_hops; // next_hop_id:port_id
+  std::map<uint32_t, unsigned> next_hop_refcnt;
+  std::map<uint32_t, tunnel_port> tunnel_ports;
+
+  std::map<uint32_t, std::set<uint16_t>> stgs; // stg_id:vlans
+  std::map<std::pair<uint32_t, uint32_t>, std::string> stg_port_states;
+  std::map<uint32_t, trunk> trunks;
+  std::map<uint32_t, uint32_t> trunk_of_port;
+  std::set<uint32_t> knet_ports;
+  std::minstd_rand hits;
+
+  std::atomic<uint64_t> flow_mods;
+  std::atomic<uint64_t> group_mods;
+  std::atomic<uint64_t> rpcs;
+  std::atomic<uint64_t> errors;
+
+  // called with state_mutex held
+  enum emu_status done(enum emu_status s, std::atomic<uint64_t> &counter);
+
+  enum emu_status ref_groups(const std::set<uint32_t> &ids);
+  void unref_groups(const std::set<uint32_t> &ids);
+  void erase_flow(std::map<flow_key, flow>::iterator it);
+};
+
+// group ids referenced by OFPAT_GROUP actions of packed instructions/buckets
+std::set<uint32_t> emu_instruction_groups(const std::string &instructions);
+std::set<uint32_t> emu_bucket_groups(const std::string &buckets);
+
+// true if all OXM fields of the packed ofp_match filter are set in match
+bool emu_match_covers(const std::string &filter, const std::string &match);
+
+} // namespace basebox
@@ -0,0 +1,153 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <grpcpp/security/server_credentials.h>
+#include <grpcpp/server_builder.h>
+
+#include "emu_datapath.h"
+#include "emu_ofdpa_service.h"
+#include "emu_state.h"
+
+DECLARE_string(tryfromenv); // from gflags
+DEFINE_string(controller, "127.0.0.1", "Address of baseboxd");
+DEFINE_int32(port, 6653, "OpenFlow port of baseboxd");
+DEFINE_int32(ofdpa_grpc_port, 50051, "Listening port of the ofdpa gRPC server");
+DEFINE_uint64(dpid, 1, "Datapath id");
+DEFINE_int32(ports, 32, "Number of emulated physical ports");
+DEFINE_int32(latency_us, 0, "Latency of each programming operation in us");
+DEFINE_int32(flow_table_size, 16384, "Capacity of each flow table");
+DEFINE_int32(group_table_size, 16384, "Capacity of the group table");
+DEFINE_int32(tunnel_table_size, 4096,
+             "Capacity of the tenant, next hop and tunnel port tables");
+DEFINE_int32(hit_percent, 0,
+             "Flows counting a packet between two flow stats requests in %");
+DEFINE_int32(stats_interval, 10,
+             "Interval of the statistics log in s (0 = off)");
+
+static bool validate_port(const char *flagname, gflags::int32 value) {
+  VLOG(3) << __FUNCTION__ << ": flagname=" << flagname << ", value=" << value;
+  if (value > 0 && value < 32768) // value is ok
+    return true;
+  return false;
+}
+
+static bool validate_ports(const char *flagname, gflags::int32 value) {
+  VLOG(3) << __FUNCTION__ << ": flagname=" << flagname << ", value=" << value;
+  if (value > 0 && value <= 0xffff) // value is ok
+    return true;
+  return false;
+}
+
+static bool validate_positive(const char *flagname, gflags::int32 value) {
+  VLOG(3) << __FUNCTION__ << ": flagname=" << flagname << ", value=" << value;
+  if (value >= 0) // value is ok
+    return true;
+  return false;
+}
+
+static bool validate_percent(const char *flagname, gflags::int32 value) {
+  VLOG(3) << __FUNCTION__ << ": flagname=" << flagname << ", value=" << value;
+  if (value >= 0 && value <= 100) // value is ok
+    return true;
+  return false;
+}
+
+int main(int argc, char **argv) {
+  using basebox::emu_datapath;
+  using basebox::emu_limits;
+  using basebox::emu_state;
+  using basebox::emu_stats;
+  using basebox::EmuOfdpaService;
+
+  for (auto *flag : {&FLAGS_port, &FLAGS_ofdpa_grpc_port}) {
+    if (!gflags::RegisterFlagValidator(flag, &validate_port)) {
+      std::cerr << "Failed to register port validator" << std::endl;
+      exit(1);
+    }
+  }
+
+  if (!gflags::RegisterFlagValidator(&FLAGS_ports, &validate_ports)) {
+    std::cerr << "Failed to register ports validator" << std::endl;
+    exit(1);
+  }
+
+  if (!gflags::RegisterFlagValidator(&FLAGS_hit_percent, &validate_percent)) {
+    std::cerr << "Failed to register hit percent validator" << std::endl;
+    exit(1);
+  }
+
+  for (auto *flag : {&FLAGS_latency_us, &FLAGS_flow_table_size,
+                     &FLAGS_group_table_size, &FLAGS_tunnel_table_size,
+                     &FLAGS_stats_interval}) {
+    if (!gflags::RegisterFlagValidator(flag, &validate_positive)) {
+      std::cerr << "Failed to register validator" << std::endl;
+      exit(1);
+    }
+  }
+
+  // all variables can be set from env
+  FLAGS_tryfromenv = std::string(
+      "controller,port,ofdpa_grpc_port,dpid,ports,latency_us,flow_table_"
+      "size,group_table_size,tunnel_table_size,hit_percent,stats_interval");
+  gflags::SetUsageMessage("software OF-DPA switch for testing baseboxd");
+
+  // init
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  emu_limits limits = {(std::size_t)FLAGS_flow_table_size,
+                       (std::size_t)FLAGS_group_table_size,
+                       (std::size_t)FLAGS_tunnel_table_size,
+                       std::chrono::microseconds(FLAGS_latency_us)};
+  std::shared_ptr<emu_state> state(new emu_state(limits));
+
+  // baseboxd connects to the agent on the address of the OpenFlow peer
+  std::string server_address("0.0.0.0:" +
+                             std::to_string(FLAGS_ofdpa_grpc_port));
+  EmuOfdpaService service(state);
+  ::grpc::ServerBuilder builder;
+
+  builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
+  builder.RegisterService(&service);
+  std::unique_ptr<::grpc::Server> server = builder.BuildAndStart();
+  if (!server)
+    LOG(FATAL) << __FUNCTION__ << ": failed to start gRPC server on "
+               << server_address;
+  LOG(INFO) << "gRPC server listening on " << server_address;
+
+  emu_datapath dp(state, FLAGS_dpid, FLAGS_ports, FLAGS_hit_percent);
+  dp.connect(rofl::csockaddr(AF_INET, FLAGS_controller, FLAGS_port));
+
+  if (FLAGS_stats_interval == 0) {
+    server->Wait();
+    return EXIT_SUCCESS;
+  }
+
+  emu_stats last = {};
+  auto interval = std::chrono::seconds(FLAGS_stats_interval);
+  while (true) {
+    std::this_thread::sleep_for(interval);
+
+    emu_stats s;
+    state->stats(s);
+    LOG(INFO) << "flow_mods/s="
+              << (s.flow_mods - last.flow_mods) / FLAGS_stats_interval
+              << " group_mods/s="
+              << (s.group_mods - last.group_mods) / FLAGS_stats_interval
+              << " rpcs/s=" << (s.rpcs - last.rpcs) / FLAGS_stats_interval
+              << " errors=" << s.errors << " flows=" << s.flows
+              << " groups=" << s.groups << " tenants=" << s.tenants
+              << " next_hops=" << s.next_hops
+              << " tunnel_ports=" << s.tunnel_ports
+              << " packet_outs=" << dp.packet_outs();
+    last = s;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -8,10 +8,12 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <iterator>
+#include <map>
 #include <string_view>
 
 #include <sys/socket.h>
 #include <linux/if.h>
+#include <netlink/msg.h>
 #include <netlink/object.h>
 #include <netlink/route/addr.h>
 #ifdef HAVE_NETLINK_ROUTE_BRIDGE_VLAN_H
@@ -36,13 +38,24 @@
 #include "port_manager.h"
 
 #include "nl_bond.h"
+#include "nl_capture.h"
 #include "nl_interface.h"
 #include "nl_l3.h"
 #include "nl_vlan.h"
 #include "nl_vxlan.h"
+#include "utils/convergence_stats.h"
+#include "utils/log_limit.h"
+#include "utils/punt_stats.h"
+#include "utils/trace_ring.h"
 
 DECLARE_bool(multicast);
 DECLARE_bool(mark_fwd_offload);
+DECLARE_string(nl_capture);
+DECLARE_bool(fdb_soft_ageing);
+DECLARE_int32(mac_move_threshold);
+DECLARE_int32(mac_move_window);
+DECLARE_int32(mac_move_holddown);
+DECLARE_int32(mac_move_holddown_max);
 
 namespace basebox {
 
@@ -50,7 +63,10 @@ cnetlink::cnetlink()
     : swi(nullptr), thread(1), caches(NL_MAX_CACHE, nullptr), nl_proc_max(10),
       state(NL_STATE_STOPPED), bridge(nullptr), iface(new nl_interface(this)),
       bond(new nl_bond(this)), vlan(new nl_vlan(this)),
-      l3(new nl_l3(vlan, this)), vxlan(new nl_vxlan(l3, this)) {
+      l3(new nl_l3(vlan, this)), vxlan(new nl_vxlan(l3, this)),
+      mac_moves(FLAGS_mac_move_threshold, FLAGS_mac_move_window,
+                FLAGS_mac_move_holddown, FLAGS_mac_move_holddown_max),
+      inject_busy(false) {
 
   sock_tx = nl_socket_alloc();
   if (sock_tx == nullptr) {
@@ -60,9 +76,23 @@ cnetlink::cnetlink()
   nl_connect(sock_tx, NETLINK_ROUTE);
   set_nl_socket_buffer_sizes(sock_tx);
 
+  // the acks of a batch are counted, not matched to their requests
+  sock_bulk = nl_socket_alloc();
+  if (sock_bulk == nullptr) {
+    LOG(FATAL) << __FUNCTION__ << ": failed to create netlink socket";
+  }
+
+  nl_connect(sock_bulk, NETLINK_ROUTE);
+  set_nl_socket_buffer_sizes(sock_bulk);
+  nl_socket_disable_seq_check(sock_bulk);
+
   try {
     thread.start("netlink");
     init_caches();
+
+    if (FLAGS_fdb_soft_ageing)
+      thread.add_timer(this, NL_TIMER_FDB_AGEING,
+                       rofl::ctimespec().expire_in(1));
   } catch (...) {
     LOG(FATAL) << __FUNCTION__ << ": caught unknown exception";
   }
@@ -74,6 +104,7 @@ cnetlink::~cnetlink() {
   destroy_caches();
   nl_socket_free(sock_mon);
   nl_socket_free(sock_tx);
+  nl_socket_free(sock_bulk);
 }
 
 int cnetlink::load_from_file(const std::string &path, int base) {
@@ -111,6 +142,19 @@ void cnetlink::init_caches() {
   nl_socket_modify_cb(sock_mon, NL_CB_INVALID, NL_CB_CUSTOM,
                       nl_invalid_handler_verbose, nullptr);
 
+  if (!FLAGS_nl_capture.empty()) {
+    capture.reset(new nl_capture());
+    if (capture->open(FLAGS_nl_capture) < 0) {
+      LOG(ERROR) << __FUNCTION__ << ": netlink capture disabled";
+      capture.reset();
+    } else {
+      LOG(INFO) << __FUNCTION__ << ": capturing netlink events to "
+                << FLAGS_nl_capture;
+      nl_socket_modify_cb(sock_mon, NL_CB_MSG_IN, NL_CB_CUSTOM,
+                          nl_capture::event_msg_in, capture.get());
+    }
+  }
+
   int rc = nl_cache_mngr_alloc(sock_mon, NETLINK_ROUTE, NL_AUTO_PROVIDE, &mngr);
 
   if (rc < 0) {
@@ -214,6 +258,17 @@ void cnetlink::init_caches() {
   }
 #endif
 
+  if (capture) {
+    // the caches allocated with NL_CACHE_AF_ITER are dumped the same way
+    capture->snapshot(caches[NL_LINK_CACHE], true);
+    capture->snapshot(caches[NL_ROUTE_CACHE], false);
+    capture->snapshot(caches[NL_ADDR_CACHE], false);
+    capture->snapshot(caches[NL_NEIGH_CACHE], true);
+    capture->snapshot(caches[NL_NH_CACHE], false);
+    capture->snapshot(caches[NL_MDB_CACHE], true);
+    capture->snapshot(caches[NL_BVLAN_CACHE], true);
+  }
+
   try {
     thread.add_read_fd(this, nl_cache_mngr_get_fd(mngr), true, false);
   } catch (std::exception &e) {
@@ -517,7 +572,7 @@ int cnetlink::add_l3_addresses(rtnl_link *link) {
   l3->get_l3_addrs(link, &addresses);
 
   for (auto i : addresses) {
-    LOG(INFO) << __FUNCTION__ << ": adding address=" << i;
+    LOG_LIMITED(INFO) << __FUNCTION__ << ": adding address=" << i;
 
     switch (rtnl_addr_get_family(i)) {
     case AF_INET:
@@ -568,7 +623,7 @@ int cnetlink::add_l3_routes(rtnl_link *link) {
   l3->get_l3_routes(link, &routes);
 
   for (auto i : routes) {
-    LOG(INFO) << __FUNCTION__ << ": adding route=" << i;
+    LOG_LIMITED(INFO) << __FUNCTION__ << ": adding route=" << i;
 
     switch (rtnl_route_get_family(i)) {
     case AF_INET:
@@ -759,7 +814,7 @@ bool cnetlink::is_bridge_interface(rtnl_link *l) const {
   }
   // is a vlan on top of the bridge?
   if (rtnl_link_is_vlan(l)) {
-    LOG(INFO) << __FUNCTION__ << ": vlan ok";
+    LOG_LIMITED(INFO) << __FUNCTION__ << ": vlan ok";
 
     // get the master and check if it's a bridge
     auto _l = get_link_by_ifindex(rtnl_link_get_link(l));
@@ -769,9 +824,9 @@ bool cnetlink::is_bridge_interface(rtnl_link *l) const {
 
     auto lt = get_link_type(_l.get());
 
-    LOG(INFO) << __FUNCTION__ << ": lt=" << lt << " " << _l.get();
+    LOG_LIMITED(INFO) << __FUNCTION__ << ": lt=" << lt << " " << _l.get();
     if (lt == LT_BRIDGE) {
-      LOG(INFO) << __FUNCTION__ << ": vlan ok";
+      LOG_LIMITED(INFO) << __FUNCTION__ << ": vlan ok";
 
       std::deque<rtnl_link *> bridge_interfaces;
       get_bridge_ports(rtnl_link_get_ifindex(_l.get()), &bridge_interfaces);
@@ -881,6 +936,38 @@ uint16_t cnetlink::get_vrf_table_id(rtnl_link *link) {
   return vrf_id;
 }
 
+static enum conv_event conv_event_type(int msg_type) {
+  switch (msg_type) {
+  case RTM_NEWLINK:
+  case RTM_DELLINK:
+    return CONV_EV_LINK;
+  case RTM_NEWNEIGH:
+  case RTM_DELNEIGH:
+    return CONV_EV_NEIGH;
+  case RTM_NEWROUTE:
+  case RTM_DELROUTE:
+    return CONV_EV_ROUTE;
+  case RTM_NEWNEXTHOP:
+  case RTM_DELNEXTHOP:
+    return CONV_EV_NEXTHOP;
+  case RTM_NEWADDR:
+  case RTM_DELADDR:
+    return CONV_EV_ADDR;
+#ifdef HAVE_NETLINK_ROUTE_MDB_H
+  case RTM_NEWMDB:
+  case RTM_DELMDB:
+    return CONV_EV_MDB;
+#endif
+#ifdef HAVE_NETLINK_ROUTE_BRIDGE_VLAN_H
+  case RTM_NEWVLAN:
+  case RTM_DELVLAN:
+    return CONV_EV_BRIDGE_VLAN;
+#endif
+  default:
+    return CONV_EV_OTHER;
+  }
+}
+
 void cnetlink::handle_wakeup(rofl::cthread &thread) {
   bool do_wakeup = false;
 
@@ -903,6 +990,10 @@ void cnetlink::handle_wakeup(rofl::cthread &thread) {
     return;
   }
 
+  if (inject_busy && handle_injected_msgs()) {
+    do_wakeup = true;
+  }
+
   // loop through nl_objs
   for (int cnt = 0;
        cnt < nl_proc_max && nl_objs.size() && state == NL_STATE_RUNNING;
@@ -910,6 +1001,10 @@ void cnetlink::handle_wakeup(rofl::cthread &thread) {
     auto obj = nl_objs.front();
     nl_objs.pop_front();
 
+    // switch calls made until the end of this iteration belong to obj
+    conv_trace trace(conv_event_type(obj.get_msg_type()), obj.get_arrival());
+    trace_scope span("cnetlink::handle_wakeup", obj.get_msg_type());
+
     switch (obj.get_msg_type()) {
     case RTM_NEWLINK:
     case RTM_DELLINK:
@@ -951,6 +1046,8 @@ void cnetlink::handle_wakeup(rofl::cthread &thread) {
     }
   }
 
+  handle_posted();
+
   if (handle_source_mac_learn()) {
     do_wakeup = true;
   }
@@ -959,6 +1056,12 @@ void cnetlink::handle_wakeup(rofl::cthread &thread) {
     do_wakeup = true;
   }
 
+  if (inject_busy && !do_wakeup && nl_objs.empty()) {
+    std::lock_guard<std::mutex> lock(inject_mutex);
+    if (injected_msgs.empty())
+      inject_busy = false;
+  }
+
   if (do_wakeup || nl_objs.size()) {
     VLOG(3) << __FUNCTION__
             << ": calling wakeup nl_objs.size()=" << nl_objs.size();
@@ -1006,6 +1109,11 @@ void cnetlink::handle_timeout(rofl::cthread &thread, uint32_t timer_id) {
     // was stopped before
     start();
     break;
+  case NL_TIMER_FDB_AGEING:
+    thread.add_timer(this, NL_TIMER_FDB_AGEING,
+                     rofl::ctimespec().expire_in(1));
+    handle_fdb_ageing();
+    break;
   default:
     break;
   }
@@ -1036,6 +1144,122 @@ void cnetlink::nl_cb_v2(struct nl_cache *cache, struct nl_object *old_obj,
   }
 }
 
+void cnetlink::capture_port(const nbi::port_notification_data &p) {
+  if (capture)
+    capture->port(p);
+}
+
+void cnetlink::inject(std::string msg, bool notify) {
+  {
+    std::lock_guard<std::mutex> lock(inject_mutex);
+    injected_msgs.push_back({std::move(msg), notify});
+    inject_busy = true;
+  }
+  thread.wakeup(this);
+}
+
+bool cnetlink::injection_done() { return !inject_busy; }
+
+struct inject_ctx {
+  cnetlink *nl;
+  struct nl_cache *cache;
+  bool notify;
+};
+
+static void inject_parsed_obj(struct nl_object *obj, void *arg) {
+  auto ctx = static_cast<inject_ctx *>(arg);
+
+  if (ctx->notify)
+    nl_cache_include_v2(ctx->cache, obj, (change_func_v2_t)&cnetlink::nl_cb_v2,
+                        ctx->nl);
+  else
+    nl_cache_include_v2(ctx->cache, obj, nullptr, nullptr);
+}
+
+int cnetlink::handle_injected_msgs() {
+  std::deque<injected_msg> msgs;
+  size_t remaining;
+
+  {
+    std::lock_guard<std::mutex> lock(inject_mutex);
+    for (int cnt = 0; cnt < nl_proc_max && injected_msgs.size(); cnt++) {
+      msgs.emplace_back(std::move(injected_msgs.front()));
+      injected_msgs.pop_front();
+    }
+    remaining = injected_msgs.size();
+  }
+
+  for (auto &m : msgs) {
+    auto hdr = reinterpret_cast<struct nlmsghdr *>(&m.data[0]);
+
+    if (m.data.size() < sizeof(*hdr) || hdr->nlmsg_len != m.data.size()) {
+      LOG(ERROR) << __FUNCTION__ << ": invalid message of length "
+                 << m.data.size();
+      continue;
+    }
+
+    enum nl_cache_t id;
+    switch (hdr->nlmsg_type) {
+    case RTM_NEWLINK:
+    case RTM_DELLINK:
+      id = NL_LINK_CACHE;
+      break;
+    case RTM_NEWNEIGH:
+    case RTM_DELNEIGH:
+      id = NL_NEIGH_CACHE;
+      break;
+    case RTM_NEWROUTE:
+    case RTM_DELROUTE:
+      id = NL_ROUTE_CACHE;
+      break;
+    case RTM_NEWNEXTHOP:
+    case RTM_DELNEXTHOP:
+      id = NL_NH_CACHE;
+      break;
+    case RTM_NEWADDR:
+    case RTM_DELADDR:
+      id = NL_ADDR_CACHE;
+      break;
+#ifdef HAVE_NETLINK_ROUTE_MDB_H
+    case RTM_NEWMDB:
+    case RTM_DELMDB:
+      id = NL_MDB_CACHE;
+      break;
+#endif
+#ifdef HAVE_NETLINK_ROUTE_BRIDGE_VLAN_H
+    case RTM_NEWVLAN:
+    case RTM_DELVLAN:
+      id = NL_BVLAN_CACHE;
+      break;
+#endif
+    default:
+      VLOG(2) << __FUNCTION__ << ": ignoring netlink type "
+              << hdr->nlmsg_type;
+      continue;
+    }
+
+    // e.g. no mdb cache if multicast is disabled
+    if (caches[id] == nullptr)
+      continue;
+
+    struct nl_msg *msg = nlmsg_convert(hdr);
+    if (msg == nullptr) {
+      LOG(ERROR) << __FUNCTION__ << ": failed to allocate message";
+      continue;
+    }
+
+    inject_ctx ctx = {this, caches[id], m.notify};
+    nlmsg_set_proto(msg, NETLINK_ROUTE);
+    int rv = nl_msg_parse(msg, &inject_parsed_obj, &ctx);
+    if (rv < 0)
+      LOG(ERROR) << __FUNCTION__ << ": failed to parse netlink type "
+                 << hdr->nlmsg_type << ": " << nl_geterror(rv);
+    nlmsg_free(msg);
+  }
+
+  return remaining;
+}
+
 void cnetlink::set_tapmanager(std::shared_ptr<port_manager> pm) {
   port_man = pm;
   iface->set_tapmanager(pm);
@@ -1043,10 +1267,91 @@ void cnetlink::set_tapmanager(std::shared_ptr<port_manager> pm) {
 
 int cnetlink::send_nl_msg(nl_msg *msg) { return nl_send_sync(sock_tx, msg); }
 
+struct nl_batch_acks {
+  int pending;
+  int err;
+};
+
+static int nl_batch_ack(struct nl_msg *msg, void *arg) {
+  static_cast<nl_batch_acks *>(arg)->pending--;
+  return NL_OK;
+}
+
+static int nl_batch_err(struct sockaddr_nl *nla, struct nlmsgerr *e,
+                        void *arg) {
+  auto *acks = static_cast<nl_batch_acks *>(arg);
+
+  acks->pending--;
+  if (acks->err == 0)
+    acks->err = -nl_syserr2nlerr(e->error);
+  return NL_SKIP;
+}
+
+int cnetlink::send_nl_msgs(std::deque<nl_msg *> &msgs) {
+  trace_scope trace("cnetlink::send_nl_msgs", msgs.size());
+
+  // stay well below the receive buffer for the acks of a datagram
+  const std::size_t max_datagram = 64 * 1024;
+  int rv = 0;
+
+  nl_batch_acks acks = {0, 0};
+  nl_socket_modify_cb(sock_bulk, NL_CB_ACK, NL_CB_CUSTOM, nl_batch_ack, &acks);
+  nl_socket_modify_err_cb(sock_bulk, NL_CB_CUSTOM, nl_batch_err, &acks);
+
+  while (!msgs.empty()) {
+    std::string buf;
+    int n = 0;
+
+    while (!msgs.empty()) {
+      nl_msg *msg = msgs.front();
+      nlmsghdr *hdr = nlmsg_hdr(msg);
+
+      if (!buf.empty() &&
+          buf.size() + NLMSG_ALIGN(hdr->nlmsg_len) > max_datagram)
+        break;
+
+      nl_complete_msg(sock_bulk, msg);
+      buf.append(reinterpret_cast<const char *>(hdr),
+                 NLMSG_ALIGN(hdr->nlmsg_len));
+      nlmsg_free(msg);
+      msgs.pop_front();
+      n++;
+    }
+
+    int err = nl_sendto(sock_bulk, &buf[0], buf.size());
+    if (err < 0) {
+      LOG(ERROR) << __FUNCTION__ << ": failed to send " << n
+                 << " messages: " << nl_geterror(err);
+      if (rv == 0)
+        rv = err;
+      continue;
+    }
+
+    acks.pending = n;
+    while (acks.pending > 0) {
+      err = nl_recvmsgs_default(sock_bulk);
+      if (err < 0) {
+        LOG(ERROR) << __FUNCTION__ << ": failed to receive acks: "
+                   << nl_geterror(err);
+        acks.err = acks.err ? acks.err : err;
+        break;
+      }
+    }
+
+    if (rv == 0)
+      rv = acks.err;
+    acks.err = 0;
+  }
+
+  return rv;
+}
+
 void cnetlink::learn_l2(uint32_t port_id, basebox::packet *pkt) {
-  {
-    std::lock_guard<std::mutex> scoped_lock(pi_mutex);
-    packet_in.emplace_back(port_id, pkt);
+  // classify and police the frame before it is queued
+  int rv = packet_in.push(port_id, pkt);
+  if (rv < 0) {
+    punt_drop(port_id, PUNT_HOP_PACKET_IN, rv);
+    return;
   }
 
   VLOG(2) << __FUNCTION__ << ": got pkt " << pkt << " for port_id=" << port_id;
@@ -1054,31 +1359,23 @@ void cnetlink::learn_l2(uint32_t port_id, basebox::packet *pkt) {
 }
 
 int cnetlink::handle_source_mac_learn() {
-  // handle source mac learning
-  std::deque<nl_pkt_in> _packet_in;
+  // handle source mac learning, highest priority class first
+  std::deque<punt_queue::entry> _packet_in;
 
-  {
-    std::lock_guard<std::mutex> scoped_lock(pi_mutex);
-    _packet_in.swap(packet_in);
-  }
+  if (state != NL_STATE_RUNNING)
+    return packet_in.size();
 
-  for (int cnt = 0;
-       cnt < nl_proc_max && _packet_in.size() && state == NL_STATE_RUNNING;
-       cnt++) {
-    auto p = _packet_in.front();
+  packet_in.pop(_packet_in, nl_proc_max);
 
+  for (auto &p : _packet_in) {
     // pass process packets to port_man
+    punt_latency(PUNT_LAT_PACKET_IN_DISPATCH, p.pkt);
     port_man->enqueue(p.port_id, p.pkt);
-    _packet_in.pop_front();
   }
 
-  int size = _packet_in.size();
+  int size = packet_in.size();
   if (size) {
     VLOG(3) << __FUNCTION__ << ": " << size << " packets not processed";
-    std::lock_guard<std::mutex> scoped_lock(pi_mutex);
-    std::copy(make_move_iterator(_packet_in.rbegin()),
-              make_move_iterator(_packet_in.rend()),
-              std::front_inserter(packet_in));
   }
 
   return size;
@@ -1097,7 +1394,53 @@ void cnetlink::fdb_timeout(uint32_t port_id, uint16_t vid,
   thread.wakeup(this);
 }
 
+void cnetlink::fdb_hits(const std::deque<switch_interface::l2_addr> &hits) {
+  std::lock_guard<std::mutex> scoped_lock(fdb_ev_mutex);
+
+  // handled with the next ageing tick
+  fdb_hit_evts.insert(fdb_hit_evts.end(), hits.begin(), hits.end());
+}
+
+void cnetlink::post(std::function<void()> fn) {
+  {
+    std::lock_guard<std::mutex> scoped_lock(posted_mutex);
+    posted.push_back(std::move(fn));
+  }
+
+  thread.wakeup(this);
+}
+
+void cnetlink::handle_posted() {
+  std::deque<std::function<void()>> fns;
+
+  {
+    std::lock_guard<std::mutex> scoped_lock(posted_mutex);
+    fns.swap(posted);
+  }
+
+  for (auto &fn : fns)
+    fn();
+}
+
+void cnetlink::handle_fdb_ageing() {
+  std::deque<switch_interface::l2_addr> hits;
+
+  {
+    std::lock_guard<std::mutex> scoped_lock(fdb_ev_mutex);
+    hits.swap(fdb_hit_evts);
+  }
+
+  if (bridge == nullptr || state != NL_STATE_RUNNING)
+    return;
+
+  bridge->fdb_hits(hits);
+  bridge->fdb_ageing_tick();
+}
+
 int cnetlink::handle_fdb_timeout() {
+  // expirations come in bursts when a busy port goes quiet, handle them in
+  // large batches rather than nl_proc_max per wakeup
+  const std::size_t batch_max = 4096;
   std::deque<fdb_ev> _fdb_evts;
 
   {
@@ -1105,19 +1448,31 @@ int cnetlink::handle_fdb_timeout() {
     _fdb_evts.swap(fdb_evts);
   }
 
-  for (int cnt = 0; cnt < nl_proc_max && _fdb_evts.size() && bridge &&
-                    state == NL_STATE_RUNNING;
+  if (_fdb_evts.empty())
+    return 0;
+
+  trace_scope trace("cnetlink::handle_fdb_timeout", _fdb_evts.size());
+
+  // group by bridge port and vid to look up each port once
+  std::map<std::pair<uint32_t, uint16_t>, std::vector<rofl::caddress_ll>>
+      groups;
+
+  for (std::size_t cnt = 0; cnt < batch_max && _fdb_evts.size() && bridge &&
+                            state == NL_STATE_RUNNING;
        cnt++) {
+    auto &fdbev = _fdb_evts.front();
 
-    auto fdbev = _fdb_evts.front();
-    int ifindex = port_man->get_ifindex(fdbev.port_id);
+    groups[std::make_pair(fdbev.port_id, fdbev.vid)].push_back(fdbev.mac);
+    _fdb_evts.pop_front();
+  }
+
+  for (const auto &group : groups) {
+    int ifindex = port_man->get_ifindex(group.first.first);
     rtnl_link *br_link = get_link(ifindex, AF_BRIDGE);
 
     if (br_link && bridge) {
-      bridge->fdb_timeout(br_link, fdbev.vid, fdbev.mac);
+      bridge->fdb_timeout(br_link, group.first.second, group.second);
     }
-
-    _fdb_evts.pop_front();
   }
 
   int size = _fdb_evts.size();
@@ -3,7 +3,9 @@
 
 #pragma once
 
+#include <atomic>
 #include <deque>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <tuple>
@@ -14,13 +16,16 @@
 #include <rofl/common/cthread.hpp>
 
 #include "nl_bridge.h"
+#include "nl_mac_moves.h"
 #include "nl_obj.h"
+#include "punt_queue.h"
 #include "sai.h"
 
 namespace basebox {
 
 // forward declaration
 class nl_bond;
+class nl_capture;
 class nl_interface;
 class nl_l3;
 class nl_vlan;
@@ -104,15 +109,45 @@ public:
   void set_tapmanager(std::shared_ptr<port_manager> pm);
 
   int send_nl_msg(nl_msg *msg);
+
+  // send the requests in as few datagrams as possible and wait for all acks,
+  // frees the messages. Returns the first error.
+  int send_nl_msgs(std::deque<nl_msg *> &msgs);
   void learn_l2(uint32_t port_id, packet *pkt);
+  std::deque<punt_class_stats> get_punt_statistics() const {
+    return packet_in.get_statistics();
+  }
+
+  nl_mac_moves &get_mac_moves() { return mac_moves; }
+  mac_move_stats get_mac_move_statistics() const {
+    return mac_moves.get_statistics();
+  }
 
   void fdb_timeout(uint32_t port_id, uint16_t vid,
                    const rofl::caddress_ll &mac);
+  void fdb_hits(const std::deque<switch_interface::l2_addr> &hits);
+
+  // run fn on the netlink thread
+  void post(std::function<void()> fn);
 
   std::deque<rtnl_neigh *> search_fdb(uint16_t vid = 0,
                                       nl_addr *lladdr = nullptr);
   int load_from_file(const std::string &path, int base = 10);
 
+  // record a port of the switch if netlink events are captured
+  void capture_port(const nbi::port_notification_data &p);
+
+  /**
+   * @brief feed a captured netlink message into the caches
+   *
+   * Used to replay a capture. Snapshot messages are only added to the caches,
+   * events are handled as if they were received from the kernel.
+   */
+  void inject(std::string msg, bool notify);
+
+  // true once all injected messages and the resulting events are handled
+  bool injection_done();
+
 private:
   // non copyable
   cnetlink(const cnetlink &other) = delete;
@@ -121,6 +156,7 @@ private:
   enum timer {
     NL_TIMER_RESEND_STATE,
     NL_TIMER_RESYNC,
+    NL_TIMER_FDB_AGEING,
   };
 
   enum nl_state {
@@ -135,6 +171,7 @@ private:
   rofl::cthread thread;
   struct nl_sock *sock_mon;
   struct nl_sock *sock_tx;
+  struct nl_sock *sock_bulk; // send_nl_msgs
   struct nl_cache_mngr *mngr;
   std::vector<struct nl_cache *> caches;
   std::deque<std::tuple<uint32_t, enum nbi::port_status, int>>
@@ -153,14 +190,11 @@ private:
   std::shared_ptr<nl_l3> l3;
   std::shared_ptr<nl_vxlan> vxlan;
 
-  struct nl_pkt_in {
-    nl_pkt_in(uint32_t port_id, packet *pkt) : port_id(port_id), pkt(pkt) {}
-    uint32_t port_id;
-    packet *pkt;
-  };
+  // frames punted to the CPU, classified and policed
+  punt_queue packet_in;
 
-  std::mutex pi_mutex;
-  std::deque<nl_pkt_in> packet_in;
+  // moves of learned MAC addresses between bridge ports
+  nl_mac_moves mac_moves;
 
   struct fdb_ev {
     fdb_ev(uint32_t port_id, uint16_t vid, const rofl::caddress_ll &mac)
@@ -172,10 +206,30 @@ private:
 
   std::mutex fdb_ev_mutex;
   std::deque<fdb_ev> fdb_evts;
+  std::deque<switch_interface::l2_addr> fdb_hit_evts;
+
+  std::mutex posted_mutex;
+  std::deque<std::function<void()>> posted;
+
+  // captured netlink messages to be replayed
+  struct injected_msg {
+    std::string data;
+    bool notify;
+  };
+
+  std::mutex inject_mutex;
+  std::deque<injected_msg> injected_msgs;
+  std::atomic<bool> inject_busy;
+
+  // capture of the netlink events, nullptr if disabled
+  std::unique_ptr<nl_capture> capture;
 
   int handle_port_status_events();
+  int handle_injected_msgs();
   int handle_source_mac_learn();
   int handle_fdb_timeout();
+  void handle_fdb_ageing();
+  void handle_posted();
 
   void route_addr_apply(const nl_obj &obj);
   void route_link_apply(const nl_obj &obj);
@@ -16,14 +16,20 @@
 
 #include "ctapdev.h"
 #include "tap_manager.h"
+#include "vnet_hdr.h"
 
 namespace basebox {
 
-ctapdev::ctapdev(std::string const &devname, const rofl::caddress_ll &hwaddr)
-    : fd(-1), devname(devname), hwaddr(hwaddr) {
+ctapdev::ctapdev(std::string const &devname, const rofl::caddress_ll &hwaddr,
+                 unsigned queues, bool vnet_hdr)
+    : devname(devname), hwaddr(hwaddr), queues(queues), vnet_hdr(vnet_hdr) {
   if (devname.size() >= IFNAMSIZ || devname.size() == 0) {
     throw std::length_error("invalid devname size");
   }
+
+  if (queues == 0) {
+    throw std::invalid_argument("invalid number of queues");
+  }
 }
 
 ctapdev::~ctapdev() { tap_close(); }
@@ -32,47 +38,85 @@ void ctapdev::tap_open() {
   struct ifreq ifr;
   int rc, carrier = 0;
 
-  if (fd != -1) {
-    VLOG(1) << __FUNCTION__ << ": tapdev is already open using fd=" << fd;
+  if (!fds.empty()) {
+    VLOG(1) << __FUNCTION__ << ": tapdev is already open using fd=" << fds[0];
     return;
   }
 
-  if ((fd = open("/dev/net/tun", O_RDWR)) < 0) {
-    LOG(FATAL) << __FUNCTION__
-               << ": could not open /dev/net/tun (module loaded?)";
-  }
-
   memset(&ifr, 0, sizeof(ifr));
   ifr.ifr_flags = IFF_TAP | IFF_NO_PI | IFF_NO_CARRIER;
+  if (queues > 1)
+    ifr.ifr_flags |= IFF_MULTI_QUEUE;
+  if (vnet_hdr)
+    ifr.ifr_flags |= IFF_VNET_HDR;
   strncpy(ifr.ifr_name, devname.c_str(), IFNAMSIZ - 1);
   hwaddr.pack(reinterpret_cast<uint8_t *>(ifr.ifr_hwaddr.sa_data), ETH_ALEN);
 
-  if ((rc = ioctl(fd, TUNSETIFF, (void *)&ifr)) < 0) {
-    LOG(FATAL) << __FUNCTION__ << ": ioctl TUNSETIFF failed on fd=" << fd
-               << " errno=" << errno << " reason: " << strerror(errno);
-    close(fd);
-    fd = -1;
+  // every open of /dev/net/tun attached to the same device adds a queue
+  for (unsigned i = 0; i < queues; i++) {
+    int fd;
+
+    if ((fd = open("/dev/net/tun", O_RDWR)) < 0) {
+      LOG(FATAL) << __FUNCTION__
+                 << ": could not open /dev/net/tun (module loaded?)";
+    }
+
+    if ((rc = ioctl(fd, TUNSETIFF, (void *)&ifr)) < 0) {
+      LOG(FATAL) << __FUNCTION__ << ": ioctl TUNSETIFF failed on fd=" << fd
+                 << " queue=" << i << " errno=" << errno
+                 << " reason: " << strerror(errno);
+      close(fd);
+      tap_close();
+      return;
+    }
+
+    fds.push_back(fd);
   }
 
-  if ((rc = ioctl(fd, TUNSETCARRIER, &carrier)) < 0) {
-    LOG(ERROR) << __FUNCTION__ << ": ioctl TUNSETCARRIER failed on fd=" << fd
-               << " errno=" << errno << " reason: " << strerror(errno);
+  // offloads are a property of the device, any queue will do
+  if (vnet_hdr) {
+    int hdr_len = vnet_hdr_len;
+    unsigned offload = TUN_F_CSUM | TUN_F_TSO4 | TUN_F_TSO6 | TUN_F_TSO_ECN;
+
+    for (int fd : fds) {
+      if ((rc = ioctl(fd, TUNSETVNETHDRSZ, &hdr_len)) < 0) {
+        LOG(ERROR) << __FUNCTION__ << ": ioctl TUNSETVNETHDRSZ failed on fd="
+                   << fd << " errno=" << errno
+                   << " reason: " << strerror(errno);
+      }
+    }
+
+    if ((rc = ioctl(fds[0], TUNSETOFFLOAD, offload)) < 0) {
+      LOG(ERROR) << __FUNCTION__ << ": ioctl TUNSETOFFLOAD failed on fd="
+                 << fds[0] << " errno=" << errno
+                 << " reason: " << strerror(errno);
+    }
   }
 
-  LOG(INFO) << __FUNCTION__ << ": created tapdev " << devname << " fd=" << fd
-            << " tid=" << pthread_self();
+  // the carrier is a property of the device, any queue will do
+  if ((rc = ioctl(fds[0], TUNSETCARRIER, &carrier)) < 0) {
+    LOG(ERROR) << __FUNCTION__ << ": ioctl TUNSETCARRIER failed on fd="
+               << fds[0] << " errno=" << errno
+               << " reason: " << strerror(errno);
+  }
+
+  LOG(INFO) << __FUNCTION__ << ": created tapdev " << devname
+            << " fd=" << fds[0] << " queues=" << queues
+            << " vnet_hdr=" << vnet_hdr << " tid=" << pthread_self();
 }
 
 void ctapdev::tap_close() {
-  if (fd == -1) {
+  if (fds.empty()) {
     return;
   }
 
-  int rv = close(fd);
-  if (rv < 0)
-    LOG(ERROR) << __FUNCTION__ << ": failed to close fd=" << fd;
+  for (int fd : fds) {
+    int rv = close(fd);
+    if (rv < 0)
+      LOG(ERROR) << __FUNCTION__ << ": failed to close fd=" << fd;
+  }
 
-  fd = -1;
+  fds.clear();
 
   LOG(INFO) << __FUNCTION__ << ": closed tapdev " << devname
             << " tid=" << pthread_self();
@@ -4,22 +4,28 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include <rofl/common/caddress.h>
 
 namespace basebox {
 
 class ctapdev {
-  int fd; // tap device file descriptor
+  std::vector<int> fds; // tap device file descriptors, one per queue
   std::string devname;
   rofl::caddress_ll hwaddr;
+  unsigned queues;
+  bool vnet_hdr;
 
 public:
   /**
    *
    * @param devname
+   * @param queues number of queues, > 1 creates an IFF_MULTI_QUEUE device
+   * @param vnet_hdr use IFF_VNET_HDR and enable checksum and TSO offloads
    */
-  ctapdev(std::string const &devname, const rofl::caddress_ll &hwaddr);
+  ctapdev(std::string const &devname, const rofl::caddress_ll &hwaddr,
+          unsigned queues = 1, bool vnet_hdr = false);
 
   /**
    *
@@ -41,7 +47,13 @@ public:
    */
   void tap_close();
 
-  int get_fd() const { return fd; }
+  int get_fd() const { return fds.empty() ? -1 : fds.front(); }
+
+  const std::vector<int> &get_fds() const { return fds; }
+
+  unsigned get_queues() const { return queues; }
+
+  bool has_vnet_hdr() const { return vnet_hdr; }
 };
 
 } // end of namespace basebox
@@ -0,0 +1,176 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include <cerrno>
+#include <fcntl.h>
+#include <set>
+#include <unistd.h>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "knet_ctl.h"
+
+namespace basebox {
+
+static const char *knet_link_path = "/proc/bcm/knet/link";
+
+knet_ctl::knet_ctl() : thread(1), link_fd(-1) { thread.start("knet_ctl"); }
+
+knet_ctl::~knet_ctl() {
+  thread.stop();
+
+  // the netif deletes of the shutdown must not leave stale netifs behind
+  if (!ops.empty()) {
+    VLOG(1) << __FUNCTION__ << ": carrying out " << ops.size()
+            << " pending knet operations";
+    handle_ops();
+  }
+
+  if (link_fd >= 0)
+    close(link_fd);
+}
+
+void knet_ctl::netif_create(switch_interface *swi, uint32_t port_id,
+                            const std::string &name) {
+  queue({KNET_NETIF_CREATE, swi, port_id, name, "", false});
+}
+
+void knet_ctl::netif_delete(switch_interface *swi, uint32_t port_id,
+                            const std::string &name) {
+  queue({KNET_NETIF_DELETE, swi, port_id, name, "", false});
+}
+
+void knet_ctl::link_status(const std::string &name, bool status) {
+  queue({KNET_LINK_STATUS, nullptr, 0, name, status ? "up" : "down", false});
+}
+
+void knet_ctl::link_speed(const std::string &name, uint32_t speed_mbit,
+                          uint8_t duplex) {
+  queue({KNET_LINK_SPEED, nullptr, 0, name,
+         std::to_string(speed_mbit) + "," + (duplex ? "fd" : "hd"), false});
+}
+
+void knet_ctl::link_offload(const std::string &name, bool offloaded) {
+  queue({KNET_LINK_OFFLOAD, nullptr, 0, name,
+         offloaded ? "offload" : "no-offload", false});
+}
+
+int knet_ctl::link_error(const std::string &name) {
+  std::lock_guard<std::mutex> guard(ops_mutex);
+  auto it = link_errs.find(name);
+
+  if (it == link_errs.end())
+    return 0;
+
+  int rv = it->second;
+  link_errs.erase(it);
+  return rv;
+}
+
+void knet_ctl::queue(knet_op op) {
+  {
+    std::lock_guard<std::mutex> guard(ops_mutex);
+    ops.emplace_back(std::move(op));
+  }
+
+  thread.wakeup(this);
+}
+
+int knet_ctl::write_link(const std::string &line) {
+  if (link_fd < 0) {
+    link_fd = open(knet_link_path, O_WRONLY | O_CLOEXEC);
+    if (link_fd < 0) {
+      LOG(ERROR) << __FUNCTION__ << ": failed to open " << knet_link_path
+                 << " errno=" << errno;
+      return -errno;
+    }
+  }
+
+  // the proc handler parses a single entry per write
+  ssize_t rv = pwrite(link_fd, line.c_str(), line.size(), 0);
+  if (rv < 0) {
+    int err = errno;
+    LOG(ERROR) << __FUNCTION__ << ": failed to write '" << line
+               << "' errno=" << err;
+
+    // reopen on the next write
+    close(link_fd);
+    link_fd = -1;
+    return -err;
+  }
+
+  return 0;
+}
+
+void knet_ctl::handle_ops() {
+  std::deque<knet_op> batch;
+
+  {
+    std::lock_guard<std::mutex> guard(ops_mutex);
+    batch.swap(ops);
+  }
+
+  if (batch.empty())
+    return;
+
+  // skip link updates superseded later in the batch, netif operations on the
+  // same port act as barrier
+  std::set<std::pair<std::string, int>> seen;
+  for (auto it = batch.rbegin(); it != batch.rend(); ++it) {
+    switch (it->type) {
+    case KNET_NETIF_CREATE:
+    case KNET_NETIF_DELETE:
+      for (int t : {KNET_LINK_STATUS, KNET_LINK_SPEED, KNET_LINK_OFFLOAD})
+        seen.erase(std::make_pair(it->name, t));
+      break;
+    default:
+      it->skip = !seen.emplace(it->name, it->type).second;
+      break;
+    }
+  }
+
+  unsigned skipped = 0;
+  for (auto &op : batch) {
+    int rv = 0;
+
+    if (op.skip) {
+      skipped++;
+      continue;
+    }
+
+    switch (op.type) {
+    case KNET_NETIF_CREATE:
+      rv = op.swi->port_knet_create(op.port_id);
+      if (rv != 0)
+        LOG(FATAL) << __FUNCTION__
+                   << ": failed to create knet netif for port_id "
+                   << op.port_id;
+      break;
+    case KNET_NETIF_DELETE:
+      rv = op.swi->port_knet_delete(op.port_id);
+      if (rv != 0)
+        LOG(WARNING) << __FUNCTION__
+                     << ": failed to remove knet netif for port_id "
+                     << op.port_id;
+
+      {
+        std::lock_guard<std::mutex> guard(ops_mutex);
+        link_errs.erase(op.name);
+      }
+      break;
+    default:
+      rv = write_link(op.name + "=" + op.value);
+      if (rv < 0) {
+        std::lock_guard<std::mutex> guard(ops_mutex);
+        link_errs[op.name] = rv;
+      }
+      break;
+    }
+  }
+
+  VLOG(2) << __FUNCTION__ << ": processed " << batch.size()
+          << " operations, skipped " << skipped;
+}
+
+} // namespace basebox
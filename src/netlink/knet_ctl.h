@@ -0,0 +1,92 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#pragma once
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <rofl/common/cthread.hpp>
+
+#include "sai.h"
+
+namespace basebox {
+
+/**
+ * control channel of the KNET netifs
+ *
+ * Creating and deleting netifs as well as link state, speed and offload
+ * updates are queued and carried out by a worker thread in the order they
+ * were requested. Link updates superseded by a later update of the same kind
+ * within a batch are skipped. /proc/bcm/knet/link is kept open across
+ * writes, a failed write is kept per port until taken by link_error().
+ * Operations still pending on destruction are carried out.
+ */
+class knet_ctl final : public rofl::cthread_env {
+public:
+  knet_ctl();
+  ~knet_ctl();
+
+  void netif_create(switch_interface *swi, uint32_t port_id,
+                    const std::string &name);
+  void netif_delete(switch_interface *swi, uint32_t port_id,
+                    const std::string &name);
+
+  void link_status(const std::string &name, bool status);
+  void link_speed(const std::string &name, uint32_t speed_mbit,
+                  uint8_t duplex);
+  void link_offload(const std::string &name, bool offloaded);
+
+  // error of the last failed link update of the port since the previous
+  // call, 0 if none
+  int link_error(const std::string &name);
+
+private:
+  knet_ctl(const knet_ctl &other) = delete; // non construction-copyable
+  knet_ctl &operator=(const knet_ctl &) = delete; // non copyable
+
+  enum knet_op_type {
+    KNET_NETIF_CREATE,
+    KNET_NETIF_DELETE,
+    KNET_LINK_STATUS,
+    KNET_LINK_SPEED,
+    KNET_LINK_OFFLOAD,
+  };
+
+  struct knet_op {
+    enum knet_op_type type;
+    switch_interface *swi;
+    uint32_t port_id;
+    std::string name;
+    std::string value; // link ops only
+    bool skip;
+  };
+
+  rofl::cthread thread;
+
+  std::deque<knet_op> ops;
+  std::map<std::string, int> link_errs; // port name:error
+  std::mutex ops_mutex;                 // guards ops and link_errs
+
+  // only accessible from the worker thread
+  int link_fd;
+
+  void queue(knet_op op);
+  void handle_ops();
+  int write_link(const std::string &line);
+
+protected:
+  void handle_read_event(__attribute__((unused)) rofl::cthread &thread,
+                         __attribute__((unused)) int fd) {}
+  void handle_write_event(__attribute__((unused)) rofl::cthread &thread,
+                          __attribute__((unused)) int fd) {}
+  void handle_wakeup(__attribute__((unused)) rofl::cthread &thread) {
+    handle_ops();
+  }
+  void handle_timeout(__attribute__((unused)) rofl::cthread &thread,
+                      __attribute__((unused)) uint32_t timer_id) {}
+};
+
+} // namespace basebox
@@ -6,37 +6,19 @@
 #include <netlink/route/link.h>
 
 #include <cassert>
-#include <fstream>
 
 #include "cnetlink.h"
+#include "knet_ctl.h"
 #include "knet_manager.h"
+#include "utils/packet_pool.h"
 
 #define ETHTOOL_SPEED(speed) speed / 1000 // conversion to Mbit
 
 namespace basebox {
 
-knet_manager::knet_manager() {}
-
-knet_manager::~knet_manager() {
-  std::map<uint32_t, uint32_t> ddevs;
-  ddevs.swap(knet_devs);
-  for (auto dev : ddevs) {
-    uint32_t netif_id = dev.second;
-
-    int ret = system(("/usr/sbin/client_drivshell knet filter destroy " +
-                      std::to_string(netif_id + 1))
-                         .c_str());
-    if (!WIFEXITED(ret) || WEXITSTATUS(ret) != 0)
-      LOG(WARNING) << __FUNCTION__ << ": failed to remove filter with id "
-                   << netif_id + 1;
-    ret = system(("/usr/sbin/client_drivshell knet netif destroy " +
-                  std::to_string(netif_id))
-                     .c_str());
-    if (!WIFEXITED(ret) || WEXITSTATUS(ret) != 0)
-      LOG(WARNING) << __FUNCTION__ << ": failed to remove knet netif with id "
-                   << netif_id;
-  }
-}
+knet_manager::knet_manager() : ctl(new knet_ctl()) {}
+
+knet_manager::~knet_manager() {}
 
 int knet_manager::get_next_netif_id(void) {
   for (int i = 1; i < 128; i++)
@@ -81,12 +63,10 @@ int knet_manager::create_portdev(uint32_t port_id, const std::string &port_name,
         if (!rv2.second) {
           LOG(FATAL) << __FUNCTION__ << ": failed to insert hwaddr";
         }
+        publish_port_map();
 
-        r = swi->port_knet_create(port_id);
-        if (r != 0)
-          LOG(FATAL) << __FUNCTION__
-                     << ": failed to create knet netif for port_id " << port_id;
-        change_port_status_unlocked(port_name, false);
+        ctl->netif_create(swi, port_id, port_name);
+        ctl->link_status(port_name, false);
       }
 
     } catch (std::exception &e) {
@@ -103,8 +83,6 @@ int knet_manager::create_portdev(uint32_t port_id, const std::string &port_name,
 
 int knet_manager::destroy_portdev(uint32_t port_id,
                                   const std::string &port_name) {
-  int ret = 0;
-
   std::lock_guard<std::mutex> lock{tn_mutex};
   port_deleted.push_back(port_id);
 
@@ -120,16 +98,14 @@ int knet_manager::destroy_portdev(uint32_t port_id,
   if (port_names_it != port_names2id.end()) {
     port_names2id.erase(port_names_it);
   }
+  publish_port_map();
 
-  ret = swi->port_knet_delete(port_id);
-  if (ret != 0)
-    LOG(WARNING) << __FUNCTION__ << ": failed to remove knet netif for port_id "
-                 << port_id;
+  ctl->netif_delete(swi, port_id, port_name);
   return 0;
 }
 
 int knet_manager::enqueue(uint32_t port_id, basebox::packet *pkt) {
-  std::free(pkt);
+  packet_put(pkt);
 
   return 0;
 }
@@ -185,6 +161,8 @@ bool knet_manager::portdev_ready(rtnl_link *link) {
                    << " id(new)=" << tn_it->second;
       rv1.first->second = tn_it->second;
     }
+
+    publish_port_map();
   }
 
   update_mtu(link);
@@ -227,30 +205,19 @@ bool knet_manager::portdev_removed(rtnl_link *link) {
   ifindex_to_id.erase(ifi2id_it);
   id_to_ifindex.erase(id2ifi_it);
   port_deleted.erase(pd_it);
+  publish_port_map();
 
   return true;
 }
 
-int knet_manager::change_port_status_unlocked(const std::string name,
-                                              bool status) {
-  std::ofstream file("/proc/bcm/knet/link");
-
-  if (file.is_open()) {
-    file << (name + "=" + (status ? "up" : "down"));
-    file.close();
-    return 0;
-  }
-
-  return 1;
-}
-
 /*
  * set netif link state according to open flow link state
  * Status is determined via the portstatus/port_desc_reply message
  *
  * @param name port name to be changed
  * @param status interface status: true=up / false=down
- * @return 0 on success
+ * @return 0 on success, or the error of a link update of the port that failed
+ * since the previous call, as the update is carried out asynchronously
  */
 int knet_manager::change_port_status(const std::string name, bool status) {
   {
@@ -262,7 +229,9 @@ int knet_manager::change_port_status(const std::string name, bool status) {
     }
   }
 
-  return change_port_status_unlocked(name, status);
+  int rv = ctl->link_error(name);
+  ctl->link_status(name, status);
+  return rv;
 }
 
 /*
@@ -272,7 +241,8 @@ int knet_manager::change_port_status(const std::string name, bool status) {
  * @param name port name to be changed
  * @param speed speed in kbit/s
  * @param duplex true=full duplex / false=half duplex
- * @return 0 on success
+ * @return 0 on success, or the error of a link update of the port that failed
+ * since the previous call, as the update is carried out asynchronously
  */
 int knet_manager::set_port_speed(const std::string name, uint32_t speed,
                                  uint8_t duplex) {
@@ -285,25 +255,13 @@ int knet_manager::set_port_speed(const std::string name, uint32_t speed,
     }
   }
 
-  std::ofstream file("/proc/bcm/knet/link");
-
-  if (file.is_open()) {
-    file << (name + "=" + std::to_string(ETHTOOL_SPEED(speed)) + "," +
-             (duplex ? "fd" : "hd"));
-    file.close();
-    return 0;
-  }
-  return 1;
+  int rv = ctl->link_error(name);
+  ctl->link_speed(name, ETHTOOL_SPEED(speed), duplex);
+  return rv;
 }
 
 int knet_manager::set_offloaded(rtnl_link *link, bool offloaded) {
-  std::string name(rtnl_link_get_name(link));
-  std::ofstream file("/proc/bcm/knet/link");
-
-  if (file.is_open()) {
-    file << (name + (offloaded ? "=offload" : "=no-offload"));
-    file.close();
-  }
+  ctl->link_offload(rtnl_link_get_name(link), offloaded);
   return 0;
 }
 
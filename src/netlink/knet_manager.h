@@ -20,6 +20,8 @@ struct rtnl_link;
 
 namespace basebox {
 
+class knet_ctl;
+
 class knet_manager final : public port_manager {
 
 public:
@@ -47,7 +49,8 @@ private:
   knet_manager(const knet_manager &other) = delete; // non construction-copyable
   knet_manager &operator=(const knet_manager &) = delete; // non copyable
 
-  int change_port_status_unlocked(const std::string name, bool status);
+  // netif and link changes are carried out asynchronously
+  std::unique_ptr<knet_ctl> ctl;
 
   std::bitset<128> netif_ids_in_use;
   int get_next_netif_id();
@@ -1,6 +1,7 @@
 // SPDX-FileCopyrightText: © 2016 BISDN GmbH
 // SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "cnetlink.h"
@@ -8,8 +9,13 @@
 #include "port_manager.h"
 
 #include "netlink/ctapdev.h"
+#include "utils/convergence_stats.h"
+#include "utils/packet_pool.h"
+#include "utils/swi_recorder.h"
 #include "utils/utils.h"
 
+DECLARE_string(swi_record);
+
 namespace basebox {
 
 nbi_impl::nbi_impl(std::shared_ptr<cnetlink> nl,
@@ -24,6 +30,21 @@ nbi_impl::~nbi_impl() { nl->stop(); }
 void nbi_impl::resend_state() noexcept { nl->resend_state(); }
 
 void nbi_impl::register_switch(switch_interface *swi) noexcept {
+  if (!recorder) {
+    // every call of the switch is accounted to the netlink event being
+    // handled, the calls are only written to a log if requested
+    recorder.reset(new swi_recorder(swi));
+    recorder->set_observer([](enum swi_method, int) { conv_switch_write(); });
+    if (!FLAGS_swi_record.empty()) {
+      if (recorder->open(FLAGS_swi_record) < 0)
+        LOG(ERROR) << __FUNCTION__ << ": recording of switch calls disabled";
+      else
+        LOG(INFO) << __FUNCTION__ << ": recording switch calls to "
+                  << FLAGS_swi_record;
+    }
+  }
+  swi = recorder.get();
+
   this->swi = swi;
   port_man->register_switch(swi);
   nl->register_switch(swi);
@@ -48,6 +69,8 @@ void nbi_impl::port_notification(
     std::deque<port_notification_data> &notifications) noexcept {
 
   for (auto &&ntfy : notifications) {
+    nl->capture_port(ntfy);
+
     switch (ntfy.ev) {
     case PORT_EVENT_TABLE:
       switch (get_port_type(ntfy.port_id)) {
@@ -122,7 +145,7 @@ int nbi_impl::enqueue(uint32_t port_id, basebox::packet *pkt) noexcept {
     LOG(ERROR) << __FUNCTION__
                << ": failed to enqueue packet for port_id=" << port_id << ": "
                << e.what();
-    std::free(pkt);
+    packet_put(pkt);
     rv = -1;
   }
   return rv;
@@ -134,4 +157,14 @@ int nbi_impl::fdb_timeout(uint32_t port_id, uint16_t vid,
   return 0;
 }
 
+int nbi_impl::fdb_hits(
+    const std::deque<switch_interface::l2_addr> &hits) noexcept {
+  nl->fdb_hits(hits);
+  return 0;
+}
+
+void nbi_impl::post(std::function<void()> fn) noexcept {
+  nl->post(std::move(fn));
+}
+
 } // namespace basebox
@@ -12,12 +12,16 @@ namespace basebox {
 
 class cnetlink;
 class port_manager;
+class swi_recorder;
 
 class nbi_impl : public nbi, public switch_callback {
   switch_interface *swi;
   std::shared_ptr<cnetlink> nl;
   std::shared_ptr<port_manager> port_man;
 
+  // records the calls to the switch, nullptr if disabled
+  std::unique_ptr<swi_recorder> recorder;
+
 public:
   nbi_impl(std::shared_ptr<cnetlink> nl,
            std::shared_ptr<port_manager> port_man);
@@ -32,6 +36,9 @@ public:
   int enqueue(uint32_t port_id, basebox::packet *pkt) noexcept override;
   int fdb_timeout(uint32_t port_id, uint16_t vid,
                   const rofl::caddress_ll &mac) noexcept override;
+  int fdb_hits(
+      const std::deque<switch_interface::l2_addr> &hits) noexcept override;
+  void post(std::function<void()> fn) noexcept override;
 
   // tap_callback
   int enqueue_to_switch(uint32_t port_id, struct basebox::packet *) override;
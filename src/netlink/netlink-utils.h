@@ -49,4 +49,21 @@ void multicast_ipv4_to_ll(const uint32_t addr, unsigned char *dst) noexcept;
 void multicast_ipv6_to_ll(const struct in6_addr *addr,
                           unsigned char *dst) noexcept;
 
+// 1-based position of the next set bit after bit i (1-based, -1 to start),
+// 0 if there is none
+inline int find_next_bit(int i, uint32_t x) {
+  int j;
+
+  if (i >= 32)
+    return -1;
+
+  /* find first bit */
+  if (i < 0)
+    return __builtin_ffs(x);
+
+  /* mask off prior finds to get next */
+  j = __builtin_ffs(x >> i);
+  return j ? j + i : 0;
+}
+
 } // namespace basebox
@@ -217,18 +217,12 @@ int nl_bond::add_lag_member(rtnl_link *bond, rtnl_link *link) {
     VLOG(1) << __FUNCTION__ << ": failed to get slave state for " << link;
   }
 
-  rv = swi->lag_add_member(lag_id, port_id);
+  rv = swi->lag_add_member(lag_id, port_id, state == 0);
   if (rv < 0) {
     LOG(ERROR) << __FUNCTION__ << ": failed add member " << port_id;
     return -EINVAL;
   }
 
-  rv = swi->lag_set_member_active(lag_id, port_id, state == 0);
-  if (rv < 0) {
-    LOG(ERROR) << __FUNCTION__ << ": failed set active member " << port_id;
-    return -EINVAL;
-  }
-
   if (new_lag)
     nl->add_l3_configuration(bond);
 #endif
@@ -1,6 +1,7 @@
 // SPDX-FileCopyrightText: © 2015 BISDN GmbH
 // SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <map>
@@ -8,6 +9,7 @@
 #include <linux/if_packet.h>
 #include <linux/if_bridge.h>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <netlink/route/link.h>
 #ifdef HAVE_NETLINK_ROUTE_BRIDGE_VLAN_H
@@ -31,6 +33,10 @@
 #include "nl_vxlan.h"
 #include "sai.h"
 #include "port_manager.h"
+#include "utils/log_limit.h"
+#include "utils/trace_ring.h"
+
+DECLARE_bool(fdb_soft_ageing);
 
 namespace basebox {
 
@@ -39,9 +45,8 @@ nl_bridge::nl_bridge(switch_interface *sw,
                      std::shared_ptr<nl_vlan> vlan,
                      std::shared_ptr<nl_vxlan> vxlan)
     : bridge(nullptr), sw(sw), port_man(std::move(port_man)), nl(nl),
-      vlan(std::move(vlan)), vxlan(std::move(vxlan)),
-      l2_cache(nl_cache_alloc(nl_cache_ops_lookup("route/neigh")),
-               nl_cache_free) {
+      vlan(std::move(vlan)), vxlan(std::move(vxlan)), idle_timeout(300),
+      ageing_wheel(nl_fdb_table::now()) {
   memset(&empty_br_vlan, 0, sizeof(rtnl_link_bridge_vlan));
   memset(&vxlan_dom_bitmap, 0, sizeof(vxlan_dom_bitmap));
 
@@ -66,6 +71,23 @@ static rofl::caddress_in4 libnl_in4addr_2_rofl(struct nl_addr *addr, int *rv) {
   return rofl::caddress_in4(&sin, salen);
 }
 
+// kernel fdb entry of a mac learned by us
+static std::unique_ptr<rtnl_neigh, decltype(&rtnl_neigh_put)>
+learned_neigh(int ifindex, int master, uint16_t vid, nl_addr *mac) {
+  std::unique_ptr<rtnl_neigh, decltype(&rtnl_neigh_put)> n(rtnl_neigh_alloc(),
+                                                           rtnl_neigh_put);
+
+  rtnl_neigh_set_ifindex(n.get(), ifindex);
+  rtnl_neigh_set_master(n.get(), master);
+  rtnl_neigh_set_family(n.get(), AF_BRIDGE);
+  rtnl_neigh_set_vlan(n.get(), vid);
+  rtnl_neigh_set_lladdr(n.get(), mac);
+  rtnl_neigh_set_flags(n.get(), NTF_MASTER | NTF_EXT_LEARNED);
+  rtnl_neigh_set_state(n.get(), NUD_REACHABLE);
+
+  return n;
+}
+
 void nl_bridge::set_bridge_interface(rtnl_link *bridge) {
   uint32_t ageing_time;
 
@@ -231,22 +253,8 @@ static void unset_vid(unsigned vid, uint32_t *addr) {
     addr[vid / 32] &= ~(((uint32_t)1) << (vid % 32));
 }
 
-static int find_next_bit(int i, uint32_t x) {
-  int j;
-
-  if (i >= 32)
-    return -1;
-
-  /* find first bit */
-  if (i < 0)
-    return __builtin_ffs(x);
-
-  /* mask off prior finds to get next */
-  j = __builtin_ffs(x >> i);
-  return j ? j + i : 0;
-}
-
 void nl_bridge::add_interface(rtnl_link *link) {
+  trace_scope trace("nl_bridge::add_interface");
 
   assert(rtnl_link_get_family(link) == AF_BRIDGE);
 
@@ -277,6 +285,8 @@ void nl_bridge::add_interface(rtnl_link *link) {
 }
 
 void nl_bridge::update_interface(rtnl_link *old_link, rtnl_link *new_link) {
+  trace_scope trace("nl_bridge::update_interface");
+
   assert(rtnl_link_get_family(old_link) == AF_BRIDGE);
   assert(rtnl_link_get_family(new_link) == AF_BRIDGE);
 
@@ -318,6 +328,8 @@ void nl_bridge::update_interface(rtnl_link *old_link, rtnl_link *new_link) {
 }
 
 void nl_bridge::delete_interface(rtnl_link *link) {
+  trace_scope trace("nl_bridge::delete_interface");
+
   assert(rtnl_link_get_family(link) == AF_BRIDGE);
 
   // sanity checks
@@ -345,6 +357,8 @@ void nl_bridge::delete_interface(rtnl_link *link) {
 }
 
 void nl_bridge::update_vlans(rtnl_link *old_link, rtnl_link *new_link) {
+  trace_scope trace("nl_bridge::update_vlans");
+
   assert(sw);
   assert(bridge); // already checked
 
@@ -542,24 +556,14 @@ void nl_bridge::update_vlans(rtnl_link *old_link, rtnl_link *new_link) {
           VLOG(3) << __FUNCTION__ << ": remove vid=" << vid
                   << " on pport_no=" << pport_no << " link: " << _link;
 
-          // delete all cache entries first
-          std::unique_ptr<rtnl_neigh, decltype(&rtnl_neigh_put)> filter(
-              rtnl_neigh_alloc(), rtnl_neigh_put);
-
-          rtnl_neigh_set_ifindex(filter.get(), rtnl_link_get_ifindex(_link));
-          rtnl_neigh_set_master(filter.get(), rtnl_link_get_master(_link));
-          rtnl_neigh_set_family(filter.get(), AF_BRIDGE);
-          rtnl_neigh_set_vlan(filter.get(), vid);
-          rtnl_neigh_set_flags(filter.get(), NTF_MASTER | NTF_EXT_LEARNED);
-          rtnl_neigh_set_state(filter.get(), NUD_REACHABLE);
-
-          nl_cache_foreach_filter(
-              l2_cache.get(), OBJ_CAST(filter.get()),
-              [](struct nl_object *o, void *arg) {
-                VLOG(3) << "l2_cache remove object " << o;
-                nl_cache_remove(o);
-              },
-              nullptr);
+          // delete all learned entries first
+          uint32_t ifindex = rtnl_link_get_ifindex(_link);
+          auto removed =
+              fdb.erase_if([this, ifindex, vid](const nl_fdb_entry &e) {
+                return fdb.ifindex(e) == ifindex && e.vid() == vid;
+              });
+          VLOG(3) << __FUNCTION__ << ": removed " << removed
+                  << " learned fdb entries";
 
           // then delete all FM pointing to this group
           sw->l2_addr_remove_all_in_vlan(pport_no, vid);
@@ -825,8 +829,9 @@ void nl_bridge::update_access_ports(rtnl_link *vxlan_link, rtnl_link *br_link,
   }
 }
 void nl_bridge::set_ageing_time(uint32_t ageing_time) {
+  trace_scope trace("nl_bridge::set_ageing_time");
+
   assert(sw);
-  std::deque<rtnl_neigh *> neighs;
 
   // ageing time is in centiseconds, so convert it to seconds, rounded
   uint32_t new_ageing_time = (ageing_time + 50) / 100;
@@ -846,43 +851,39 @@ void nl_bridge::set_ageing_time(uint32_t ageing_time) {
 
   VLOG(1) << __FUNCTION__ << ": updating ageing time to " << new_ageing_time;
 
-  sw->l2_set_idle_timeout(new_ageing_time);
-
-  // get all tracked neighs
-  nl_cache_foreach(
-      l2_cache.get(),
-      [](struct nl_object *obj, void *arg) {
-        assert(arg);
-        auto *list = static_cast<std::deque<rtnl_neigh *> *>(arg);
-        auto neigh = NEIGH_CAST(obj);
-
-        // skip permanent neighs
-        if (!!(rtnl_neigh_get_flags(neigh) & (NUD_NOARP | NUD_PERMANENT)))
-          return;
-
-        nl_object_get(obj);
-        list->push_back(neigh);
-      },
-      &neighs);
-
-  for (auto neigh : neighs) {
-    int ifindex = rtnl_neigh_get_ifindex(neigh);
-    uint32_t port = nl->get_port_id(ifindex);
-    nl_addr *mac = rtnl_neigh_get_lladdr(neigh);
-    int vid = rtnl_neigh_get_vlan(neigh);
-    rofl::caddress_ll _mac((uint8_t *)nl_addr_get_binary_addr(mac),
-                           nl_addr_get_len(mac));
-
-    VLOG(2) << __FUNCTION__ << ": updating l2 neigh " << neigh;
+  if (FLAGS_fdb_soft_ageing) {
+    // the switch keeps the entries and reports their hits, polled often
+    // enough to not delay the expiry much
+    uint32_t interval = std::min(std::max(new_ageing_time / 4, 1U), 60U);
+
+    sw->l2_set_idle_timeout(0);
+    sw->l2_hit_poll_interval(new_ageing_time ? interval : 0);
+    idle_timeout = new_ageing_time;
+
+    // the timers of the previous ageing time are stale
+    uint32_t now = nl_fdb_table::now();
+    ageing_wheel.reset(now);
+    if (idle_timeout)
+      fdb.for_each(
+          [this, now](const nl_fdb_entry &e) { fdb_schedule(e, now); });
+    return;
+  }
 
-    // update entry to update its ageing time
-    sw->l2_addr_add(port, vid, _mac, true, false, true);
+  // The timeout applies to entries added from now on. Rewriting the
+  // installed entries would replace every flow and blackhole each MAC in
+  // between, so they keep theirs: an entry expiring with a shorter timeout
+  // than the current one is refreshed by fdb_timeout, one with a longer
+  // timeout just lives longer.
+  sw->l2_set_idle_timeout(new_ageing_time);
+  idle_timeout = new_ageing_time;
 
-    rtnl_neigh_put(neigh);
-  }
+  VLOG(1) << __FUNCTION__ << ": " << fdb.size()
+          << " learned entries keep their idle timeout until refreshed";
 }
 
 void nl_bridge::add_neigh_to_fdb(rtnl_neigh *neigh, bool update) {
+  trace_scope trace("nl_bridge::add_neigh_to_fdb");
+
   assert(sw);
   assert(neigh);
 
@@ -911,44 +912,61 @@ void nl_bridge::add_neigh_to_fdb(rtnl_neigh *neigh, bool update) {
     rtnl_neigh_set_flags(neigh, NTF_MASTER);
   }
 
-  // check if entry already exists in cache
-  std::unique_ptr<rtnl_neigh, decltype(&rtnl_neigh_put)> n(rtnl_neigh_alloc(),
-                                                           rtnl_neigh_put);
+  if (nl_addr_get_len(mac) != ETH_ALEN) {
+    VLOG(2) << __FUNCTION__ << ": invalid lladdr, skipping add neigh=" << neigh;
+    return;
+  }
 
-  rtnl_neigh_set_master(n.get(), rtnl_neigh_get_master(neigh));
-  rtnl_neigh_set_family(n.get(), AF_BRIDGE);
-  rtnl_neigh_set_vlan(n.get(), vid);
-  rtnl_neigh_set_lladdr(n.get(), mac);
-  rtnl_neigh_set_flags(n.get(), NTF_MASTER | NTF_EXT_LEARNED);
-  rtnl_neigh_set_state(n.get(), NUD_REACHABLE);
+  auto *_addr = static_cast<uint8_t *>(nl_addr_get_binary_addr(mac));
+
+  bool permanent =
+      !!(rtnl_neigh_get_state(neigh) & (NUD_NOARP | NUD_PERMANENT));
 
-  std::unique_ptr<rtnl_neigh, decltype(&rtnl_neigh_put)> n_lookup(
-      NEIGH_CAST(nl_cache_search(l2_cache.get(), OBJ_CAST(n.get()))),
-      rtnl_neigh_put);
+  // check if entry was learned already
+  nl_fdb_entry *entry = fdb.find(_addr, vid);
 
-  if (n_lookup) {
-    if (rtnl_neigh_get_ifindex(n_lookup.get()) == ifindex)
+  if (entry) {
+    if (fdb.ifindex(*entry) == static_cast<uint32_t>(ifindex))
       return;
 
-    nl_cache_remove(OBJ_CAST(n_lookup.get()));
-  }
-  rtnl_neigh_set_ifindex(n.get(), ifindex);
+    // a flapping MAC stays on its port instead of rewriting its flow on
+    // every move, static entries are configured and never held down
+    uint32_t old_port = nl->get_port_id(fdb.ifindex(*entry));
+    if (!permanent && !nl->get_mac_moves().moved(entry->key, old_port, port,
+                                                 nl_mac_moves::now())) {
+      LOG_LIMITED(WARNING) << __FUNCTION__ << ": mac="
+                           << rofl::caddress_ll(_addr, ETH_ALEN)
+                           << " vid=" << vid << " is flapping, keeping it on"
+                           << " port=" << old_port;
+
+      // the kernel moved the entry already, move it back to match the switch
+      auto n = learned_neigh(fdb.ifindex(*entry), rtnl_neigh_get_master(neigh),
+                             vid, mac);
+
+      nl_msg *msg = nullptr;
+      rtnl_neigh_build_add_request(n.get(), NLM_F_REPLACE, &msg);
+      assert(msg);
+
+      if (nl->send_nl_msg(msg) < 0)
+        LOG(ERROR) << __FUNCTION__ << ": failed to send netlink message";
+      return;
+    }
 
-  bool permanent =
-      !!(rtnl_neigh_get_state(neigh) & (NUD_NOARP | NUD_PERMANENT));
+    fdb.erase(entry->key);
+  }
 
   rofl::caddress_ll _mac((uint8_t *)nl_addr_get_binary_addr(mac),
                          nl_addr_get_len(mac));
 
-  LOG(INFO) << __FUNCTION__ << ": add mac=" << _mac << " to bridge "
-            << rtnl_link_get_name(bridge) << " on port=" << port
-            << " vlan=" << (unsigned)vid << ", permanent=" << permanent;
-  LOG(INFO) << __FUNCTION__ << ": object: " << neigh;
+  LOG_LIMITED(INFO) << __FUNCTION__ << ": add mac=" << _mac << " to bridge "
+                    << rtnl_link_get_name(bridge) << " on port=" << port
+                    << " vlan=" << (unsigned)vid << ", permanent=" << permanent;
+  LOG_LIMITED(INFO) << __FUNCTION__ << ": object: " << neigh;
   sw->l2_addr_add(port, vid, _mac, true, permanent, update);
 
   if (!permanent) {
     // take over dynamic entries from kernel
-    rtnl_neigh_set_flags(n.get(), NTF_EXT_LEARNED);
+    auto n = learned_neigh(ifindex, rtnl_neigh_get_master(neigh), vid, mac);
 
     nl_msg *msg = nullptr;
     rtnl_neigh_build_add_request(n.get(), NLM_F_REPLACE, &msg);
@@ -960,15 +978,16 @@ void nl_bridge::add_neigh_to_fdb(rtnl_neigh *neigh, bool update) {
       return;
     }
 
-    // cache the entry
-    if (nl_cache_add(l2_cache.get(), OBJ_CAST(n.get())) < 0) {
-      LOG(ERROR) << __FUNCTION__ << ": failed to add entry to l2_cache "
-                 << n.get();
-    }
+    entry = fdb.insert(_addr, vid, ifindex,
+                       FLAGS_fdb_soft_ageing ? 0 : idle_timeout);
+    if (FLAGS_fdb_soft_ageing && idle_timeout)
+      fdb_schedule(*entry, nl_fdb_table::now());
   }
 }
 
 void nl_bridge::remove_neigh_from_fdb(rtnl_neigh *neigh) {
+  trace_scope trace("nl_bridge::remove_neigh_from_fdb");
+
   assert(sw);
 
   int vid = rtnl_neigh_get_vlan(neigh);
@@ -991,14 +1010,10 @@ void nl_bridge::remove_neigh_from_fdb(rtnl_neigh *neigh) {
   }
 
   if ((rtnl_neigh_get_flags(neigh) & NTF_EXT_LEARNED) == NTF_EXT_LEARNED) {
-    // lookup l2_cache as well
-    std::unique_ptr<rtnl_neigh, decltype(&rtnl_neigh_put)> n_lookup(
-        NEIGH_CAST(nl_cache_search(l2_cache.get(), OBJ_CAST(neigh))),
-        rtnl_neigh_put);
-
-    if (n_lookup) {
-      nl_cache_remove(OBJ_CAST(n_lookup.get()));
-    } else {
+    // lookup the learned entries as well
+    if (nl_addr_get_len(addr) != ETH_ALEN ||
+        !fdb.erase(static_cast<uint8_t *>(nl_addr_get_binary_addr(addr)),
+                   vid)) {
       // if we flushed the entry, we already removed it from cache and flows, so
       // no need to do anything here
       VLOG(2) << __FUNCTION__ << ": neigh not found in cache" << neigh;
@@ -1017,12 +1032,14 @@ void nl_bridge::remove_neigh_from_fdb(rtnl_neigh *neigh) {
 bool nl_bridge::is_mac_in_l2_cache(rtnl_neigh *n) {
   assert(n);
 
-  std::unique_ptr<rtnl_neigh, decltype(&rtnl_neigh_put)> n_lookup(
-      NEIGH_CAST(nl_cache_search(l2_cache.get(), OBJ_CAST(n))), rtnl_neigh_put);
+  nl_addr *mac = rtnl_neigh_get_lladdr(n);
+  int vid = rtnl_neigh_get_vlan(n);
 
-  if (n_lookup) {
-    VLOG(2) << __FUNCTION__ << ": found existing l2_cache entry "
-            << n_lookup.get();
+  if (mac == nullptr || nl_addr_get_len(mac) != ETH_ALEN || vid < 0)
+    return false;
+
+  if (fdb.find(static_cast<uint8_t *>(nl_addr_get_binary_addr(mac)), vid)) {
+    VLOG(2) << __FUNCTION__ << ": found existing learned entry for " << n;
     return true;
   }
 
@@ -1030,44 +1047,154 @@ bool nl_bridge::is_mac_in_l2_cache(rtnl_neigh *n) {
 }
 
 int nl_bridge::fdb_timeout(rtnl_link *br_link, uint16_t vid,
-                           const rofl::caddress_ll &mac) {
-  int rv = 0;
+                           const std::vector<rofl::caddress_ll> &macs) {
+  trace_scope trace("nl_bridge::fdb_timeout", macs.size());
 
-  std::unique_ptr<rtnl_neigh, decltype(&rtnl_neigh_put)> n(rtnl_neigh_alloc(),
-                                                           rtnl_neigh_put);
+  uint32_t ifindex = rtnl_link_get_ifindex(br_link);
+  int master = rtnl_link_get_master(br_link);
+  uint32_t port = nl->get_port_id(br_link);
+  std::deque<nl_msg *> msgs;
 
-  std::unique_ptr<nl_addr, decltype(&nl_addr_put)> h_src(
-      nl_addr_build(AF_LLC, mac.somem(), mac.memlen()), nl_addr_put);
+  for (const auto &mac : macs) {
+    // find entry in the learned entries
+    nl_fdb_entry *entry = fdb.find(mac.somem(), vid);
 
-  rtnl_neigh_set_master(n.get(), rtnl_link_get_master(br_link));
-  rtnl_neigh_set_family(n.get(), AF_BRIDGE);
-  rtnl_neigh_set_vlan(n.get(), vid);
-  rtnl_neigh_set_lladdr(n.get(), h_src.get());
-  rtnl_neigh_set_flags(n.get(), NTF_MASTER | NTF_EXT_LEARNED);
+    if (entry == nullptr || fdb.ifindex(*entry) != ifindex)
+      continue;
+
+    if (idle_timeout == 0 || entry->timeout < idle_timeout) {
+      // ageing was disabled or raised after the entry was installed, the MAC
+      // was not idle for the current ageing time yet: refresh it with the
+      // current timeout instead of removing it
+      VLOG(2) << __FUNCTION__ << ": refreshing mac=" << mac << " vid=" << vid
+              << " on port=" << port << " with timeout=" << idle_timeout;
+      sw->l2_addr_add(port, vid, mac, true, false, false);
+      entry->updated = nl_fdb_table::now();
+      entry->timeout = idle_timeout;
+      continue;
+    }
 
-  // find entry in local l2_cache
-  std::unique_ptr<rtnl_neigh, decltype(&rtnl_neigh_put)> n_lookup(
-      NEIGH_CAST(nl_cache_search(l2_cache.get(), OBJ_CAST(n.get()))),
-      rtnl_neigh_put);
+    std::unique_ptr<nl_addr, decltype(&nl_addr_put)> h_src(
+        nl_addr_build(AF_LLC, mac.somem(), mac.memlen()), nl_addr_put);
+    auto n = learned_neigh(ifindex, master, vid, h_src.get());
 
-  if (n_lookup && rtnl_neigh_get_ifindex(n_lookup.get()) ==
-                      rtnl_link_get_ifindex(br_link)) {
     // * remove l2 entry from kernel
     nl_msg *msg = nullptr;
-    rtnl_neigh_build_delete_request(n_lookup.get(), NLM_F_REQUEST, &msg);
+    rtnl_neigh_build_delete_request(n.get(), NLM_F_REQUEST, &msg);
     assert(msg);
+    msgs.push_back(msg);
 
-    // send the message and create new fdb entry
-    if (nl->send_nl_msg(msg) < 0) {
-      LOG(ERROR) << __FUNCTION__ << ": failed to send netlink message";
-      return -EINVAL;
+    // XXX TODO maybe delete after NL event and not yet here
+    fdb.erase(entry->key);
+  }
+
+  if (msgs.empty())
+    return 0;
+
+  std::size_t n = msgs.size();
+
+  VLOG(2) << __FUNCTION__ << ": removing " << n << " entries of port=" << port
+          << " vid=" << vid;
+
+  // the deletes of the group are sent pipelined, not one round trip each
+  int rv = nl->send_nl_msgs(msgs);
+  if (rv < 0) {
+    LOG(ERROR) << __FUNCTION__ << ": failed to delete " << n
+               << " entries: " << nl_geterror(rv);
+    return -EINVAL;
+  }
+
+  return 0;
+}
+
+void nl_bridge::fdb_schedule(const nl_fdb_entry &e, uint32_t now) {
+  uint32_t age = std::min<uint32_t>(nl_fdb_table::now() - e.updated,
+                                    idle_timeout);
+
+  ageing_wheel.schedule(e.key, now + idle_timeout - age);
+}
+
+void nl_bridge::fdb_hits(const std::deque<switch_interface::l2_addr> &hits) {
+  uint32_t now = nl_fdb_table::now();
+
+  // the timers are moved once they expire
+  for (const auto &h : hits) {
+    nl_fdb_entry *entry = fdb.find(h.mac.somem(), h.vid);
+
+    if (entry)
+      entry->updated = now;
+  }
+}
+
+void nl_bridge::fdb_ageing_tick() {
+  trace_scope trace("nl_bridge::fdb_ageing_tick");
+
+  std::vector<timing_wheel::timer> expired;
+  uint32_t now = nl_fdb_table::now();
+
+  ageing_wheel.advance(now, &expired);
+  if (expired.empty() || bridge == nullptr)
+    return;
+
+  std::deque<switch_interface::l2_addr> addrs;
+  std::deque<nl_msg *> msgs;
+  int master = rtnl_link_get_ifindex(bridge);
+
+  // An entry learned again keeps the timer of its previous life next to the
+  // new one. Both are rescheduled to updated + idle_timeout when they fire
+  // early, so they meet at the same deadline and only one is handled.
+  std::sort(expired.begin(), expired.end(),
+            [](const timing_wheel::timer &a, const timing_wheel::timer &b) {
+              return a.key < b.key;
+            });
+
+  for (std::size_t i = 0; i < expired.size(); i++) {
+    const auto &t = expired[i];
+    if (i > 0 && expired[i - 1].key == t.key)
+      continue;
+
+    nl_fdb_entry *entry = fdb.find(t.key);
+    if (entry == nullptr)
+      continue;
+
+    uint32_t age = now - entry->updated;
+    if (age < idle_timeout) {
+      ageing_wheel.schedule(t.key, now + idle_timeout - age);
+      continue;
     }
 
-    // XXX TODO maybe delete after NL event and not yet here
-    nl_cache_remove(OBJ_CAST(n_lookup.get()));
+    uint8_t mac[ETH_ALEN];
+    entry->mac(mac);
+
+    uint32_t ifindex = fdb.ifindex(*entry);
+    uint32_t port = nl->get_port_id(ifindex);
+    if (port)
+      addrs.push_back(switch_interface::l2_addr{
+          port, entry->vid(), rofl::caddress_ll(mac, sizeof(mac))});
+
+    std::unique_ptr<nl_addr, decltype(&nl_addr_put)> lladdr(
+        nl_addr_build(AF_LLC, mac, sizeof(mac)), nl_addr_put);
+    auto n = learned_neigh(ifindex, master, entry->vid(), lladdr.get());
+
+    nl_msg *msg = nullptr;
+    if (rtnl_neigh_build_delete_request(n.get(), 0, &msg) == 0)
+      msgs.push_back(msg);
+
+    fdb.erase(t.key);
   }
 
-  return rv;
+  if (msgs.empty())
+    return;
+
+  VLOG(1) << __FUNCTION__ << ": " << msgs.size() << " entries aged out";
+
+  // one batch of flow mods and one of netlink requests per tick
+  sw->l2_addr_remove_bulk(addrs);
+
+  int rv = nl->send_nl_msgs(msgs);
+  if (rv < 0)
+    LOG(WARNING) << __FUNCTION__
+                 << ": failed to delete aged entries: " << nl_geterror(rv);
 }
 
 bool nl_bridge::is_port_flooding(rtnl_link *br_link) const {
@@ -1175,6 +1302,8 @@ int nl_bridge::mdb_to_set(
 }
 
 int nl_bridge::mdb_update(rtnl_mdb *old_mdb, rtnl_mdb *new_mdb) {
+  trace_scope trace("nl_bridge::mdb_update");
+
   std::set<std::tuple<uint32_t, uint16_t, rofl::caddress_ll>> old_entries;
   std::set<std::tuple<uint32_t, uint16_t, rofl::caddress_ll>> new_entries;
 
@@ -1257,12 +1386,7 @@ int nl_bridge::set_port_vlan_stp_state(uint32_t port_id, uint16_t vid,
 
   if (nbi::get_port_type(port_id) == nbi::port_type_lag) {
     auto members = nl->get_bond_members_by_port_id(port_id);
-    auto err2 = 0;
-    for (auto mem : members) {
-      err2 = sw->ofdpa_stg_state_port_set(mem, vid, state);
-      if (err2 < 0)
-        err = err2;
-    }
+    err = sw->ofdpa_stg_state_ports_set(members, vid, state);
   } else {
     err = sw->ofdpa_stg_state_port_set(port_id, vid, state);
   }
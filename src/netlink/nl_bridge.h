@@ -9,10 +9,14 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <netlink/route/link/bridge.h>
 
 #include "netlink-utils.h"
+#include "nl_fdb_table.h"
+#include "sai.h"
+#include "utils/timing_wheel.h"
 
 #define BR_STATE_DISABLED 0
 #define BR_STATE_LISTENING 1
@@ -168,8 +172,14 @@ public:
   int mdb_update(rtnl_mdb *old_mdb, rtnl_mdb *new_mdb);
 
   bool is_mac_in_l2_cache(rtnl_neigh *n);
+  // remove the expired entries of a bridge port and vid
   int fdb_timeout(rtnl_link *br_link, uint16_t vid,
-                  const rofl::caddress_ll &mac);
+                  const std::vector<rofl::caddress_ll> &macs);
+
+  // ageing by baseboxd, see --fdb_soft_ageing
+  void fdb_hits(const std::deque<switch_interface::l2_addr> &hits);
+  void fdb_ageing_tick();
+
   int get_ifindex() { return bridge ? rtnl_link_get_ifindex(bridge) : 0; }
 
   uint32_t get_vlan_proto();
@@ -202,6 +212,8 @@ private:
 
   void update_vlans(rtnl_link *, rtnl_link *);
 
+  void fdb_schedule(const nl_fdb_entry &e, uint32_t now);
+
   void update_access_ports(rtnl_link *vxlan_link, rtnl_link *br_link,
                            const uint16_t vid, const uint32_t tunnel_id,
                            const std::deque<rtnl_link *> &bridge_ports,
@@ -225,7 +237,9 @@ private:
   cnetlink *nl;
   std::shared_ptr<nl_vlan> vlan;
   std::shared_ptr<nl_vxlan> vxlan;
-  std::unique_ptr<nl_cache, decltype(&nl_cache_free)> l2_cache;
+  nl_fdb_table fdb; // entries learned by us
+  uint16_t idle_timeout; // of new entries in seconds, 0 = no ageing
+  timing_wheel ageing_wheel; // a timer per learned entry with soft ageing
 
   rtnl_link_bridge_vlan empty_br_vlan;
   uint32_t vxlan_dom_bitmap[RTNL_LINK_BRIDGE_VLAN_BITMAP_LEN];
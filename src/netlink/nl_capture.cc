@@ -0,0 +1,127 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include <cerrno>
+#include <cstring>
+
+#include <glog/logging.h>
+#include <linux/if_ether.h>
+#include <linux/rtnetlink.h>
+#include <netlink/cache.h>
+#include <netlink/msg.h>
+#include <netlink/netlink.h>
+
+#include "nl_capture.h"
+
+namespace basebox {
+
+struct nl_capture_port {
+  uint8_t ev;
+  uint8_t status;
+  uint8_t duplex;
+  uint8_t hwaddr[ETH_ALEN];
+  uint32_t port_id;
+  uint32_t speed;
+  uint16_t name_len;
+} __attribute__((packed));
+
+std::string nl_capture_pack_port(const nbi::port_notification_data &p) {
+  nl_capture_port hdr;
+
+  hdr.ev = p.ev;
+  hdr.status = p.status;
+  hdr.duplex = p.duplex;
+  p.hwaddr.pack(hdr.hwaddr, sizeof(hdr.hwaddr));
+  hdr.port_id = p.port_id;
+  hdr.speed = p.speed;
+  hdr.name_len = p.name.size();
+
+  std::string payload(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+  payload.append(p.name);
+  return payload;
+}
+
+int nl_capture_unpack_port(const std::string &payload,
+                           nbi::port_notification_data *p) {
+  nl_capture_port hdr;
+
+  if (payload.size() < sizeof(hdr))
+    return -EBADMSG;
+
+  memcpy(&hdr, payload.data(), sizeof(hdr));
+  if (payload.size() != sizeof(hdr) + hdr.name_len)
+    return -EBADMSG;
+
+  p->ev = static_cast<enum nbi::port_event>(hdr.ev);
+  p->port_id = hdr.port_id;
+  p->hwaddr = rofl::caddress_ll(hdr.hwaddr, sizeof(hdr.hwaddr));
+  p->name = payload.substr(sizeof(hdr));
+  p->status = hdr.status;
+  p->speed = hdr.speed;
+  p->duplex = hdr.duplex;
+  return 0;
+}
+
+void nl_capture::message(enum nl_capture_record type, struct nl_msg *msg) {
+  struct nlmsghdr *hdr = nlmsg_hdr(msg);
+
+  // acks, errors and end of dumps are not needed for a replay
+  if (hdr->nlmsg_type < RTM_BASE)
+    return;
+
+  log.write(type, hdr, hdr->nlmsg_len);
+}
+
+int nl_capture::event_msg_in(struct nl_msg *msg, void *arg) {
+  static_cast<nl_capture *>(arg)->event(msg);
+  return NL_OK;
+}
+
+int nl_capture::snapshot_msg_in(struct nl_msg *msg, void *arg) {
+  static_cast<nl_capture *>(arg)->message(NL_CAPTURE_SNAPSHOT, msg);
+  return NL_OK;
+}
+
+int nl_capture::snapshot(struct nl_cache *cache, bool af_iter) {
+  struct nl_sock *sk;
+  struct nl_cache *scratch;
+  int rv;
+
+  if (cache == nullptr || !log.is_open())
+    return 0;
+
+  // dump into a scratch cache of the same kind, the messages are recorded on
+  // their way in
+  sk = nl_socket_alloc();
+  if (sk == nullptr)
+    return -ENOMEM;
+
+  rv = nl_connect(sk, NETLINK_ROUTE);
+  if (rv < 0) {
+    LOG(ERROR) << __FUNCTION__ << ": failed to connect: " << nl_geterror(rv);
+    nl_socket_free(sk);
+    return -EIO;
+  }
+
+  nl_socket_modify_cb(sk, NL_CB_MSG_IN, NL_CB_CUSTOM, snapshot_msg_in, this);
+
+  scratch = nl_cache_alloc(nl_cache_get_ops(cache));
+  if (scratch == nullptr) {
+    nl_socket_free(sk);
+    return -ENOMEM;
+  }
+
+  if (af_iter)
+    nl_cache_set_flags(scratch, NL_CACHE_AF_ITER);
+
+  rv = nl_cache_refill(sk, scratch);
+  if (rv < 0)
+    LOG(ERROR) << __FUNCTION__ << ": failed to dump cache: "
+               << nl_geterror(rv);
+
+  nl_cache_free(scratch);
+  nl_socket_free(sk);
+  return rv < 0 ? -EIO : 0;
+}
+
+} // namespace basebox
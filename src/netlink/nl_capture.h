@@ -0,0 +1,71 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#pragma once
+
+#include <string>
+
+#include "sai.h"
+#include "utils/record_log.h"
+
+extern "C" {
+struct nl_cache;
+struct nl_msg;
+struct nlmsghdr;
+}
+
+namespace basebox {
+
+/**
+ * Capture of the netlink events seen by cnetlink
+ *
+ * The raw netlink messages are recorded instead of the parsed objects, they
+ * are parsed by libnl again when replayed and thus carry all attributes.
+ * A capture starts with the content of the caches at the time the capture
+ * was started, followed by the events and the ports announced by the switch
+ * in the order they were received.
+ */
+
+// kind of the record log
+static constexpr uint32_t nl_capture_kind = 0x6e6c6361; // "nlca"
+
+enum nl_capture_record {
+  NL_CAPTURE_SNAPSHOT = 1, // netlink message of the initial cache content
+  NL_CAPTURE_EVENT,        // netlink message received by the cache manager
+  NL_CAPTURE_PORT,         // port notification of the switch
+};
+
+std::string nl_capture_pack_port(const nbi::port_notification_data &p);
+int nl_capture_unpack_port(const std::string &payload,
+                           nbi::port_notification_data *p);
+
+class nl_capture {
+public:
+  nl_capture() = default;
+
+  int open(const std::string &path) { return log.open(path, nl_capture_kind); }
+
+  // record the current content of the kind of cache
+  int snapshot(struct nl_cache *cache, bool af_iter);
+
+  // record a message received on the monitoring socket
+  void event(struct nl_msg *msg) { message(NL_CAPTURE_EVENT, msg); }
+
+  void port(const nbi::port_notification_data &p) {
+    log.write(NL_CAPTURE_PORT, nl_capture_pack_port(p));
+  }
+
+  // libnl NL_CB_MSG_IN callbacks, arg is the nl_capture
+  static int event_msg_in(struct nl_msg *msg, void *arg);
+  static int snapshot_msg_in(struct nl_msg *msg, void *arg);
+
+private:
+  nl_capture(const nl_capture &) = delete;
+  nl_capture &operator=(const nl_capture &) = delete;
+
+  void message(enum nl_capture_record type, struct nl_msg *msg);
+
+  record_writer log;
+};
+
+} // namespace basebox
@@ -0,0 +1,165 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include <cassert>
+#include <limits>
+#include <stdexcept>
+
+#include "nl_fdb_table.h"
+
+namespace basebox {
+
+void nl_fdb_entry::mac(uint8_t *mac) const {
+  for (int i = 0; i < 6; i++)
+    mac[i] = key >> (56 - 8 * i);
+}
+
+nl_fdb_table::nl_fdb_table(std::size_t capacity) : used(0) {
+  std::size_t size = 16;
+
+  // a power of two to wrap around by masking
+  while (size < capacity)
+    size <<= 1;
+
+  slots.resize(size);
+  mask = size - 1;
+  shift = 64 - __builtin_ctzll(size);
+}
+
+uint64_t nl_fdb_table::make_key(const uint8_t *mac, uint16_t vid) {
+  uint64_t key = 0;
+
+  for (int i = 0; i < 6; i++)
+    key = key << 8 | mac[i];
+
+  return key << 16 | vid;
+}
+
+nl_fdb_entry *nl_fdb_table::find(uint64_t key) {
+  for (std::size_t i = home(key);; i = (i + 1) & mask) {
+    if (slots[i].key == key)
+      return &slots[i];
+    if (slots[i].key == 0)
+      return nullptr;
+  }
+}
+
+nl_fdb_entry *nl_fdb_table::insert(const uint8_t *mac, uint16_t vid,
+                                   uint32_t ifindex, uint16_t timeout) {
+  uint64_t key = make_key(mac, vid);
+
+  assert(key);
+
+  if ((used + 1) * 4 > slots.size() * 3)
+    grow();
+
+  std::size_t i = home(key);
+  while (slots[i].key && slots[i].key != key)
+    i = (i + 1) & mask;
+
+  uint16_t port = port_ref(ifindex);
+  if (slots[i].key)
+    port_unref(slots[i].port);
+  else
+    used++;
+
+  slots[i] = nl_fdb_entry{key, now(), port, timeout};
+  return &slots[i];
+}
+
+bool nl_fdb_table::erase(uint64_t key) {
+  nl_fdb_entry *e = find(key);
+
+  if (e == nullptr)
+    return false;
+
+  erase_slot(e - slots.data());
+  return true;
+}
+
+void nl_fdb_table::erase_slot(std::size_t i) {
+  std::size_t j = i;
+
+  port_unref(slots[i].port);
+
+  // move back every following entry of the cluster, which would not be found
+  // anymore from its home slot with i empty
+  for (;;) {
+    j = (j + 1) & mask;
+    if (slots[j].key == 0)
+      break;
+
+    std::size_t h = home(slots[j].key);
+    if (((j - h) & mask) >= ((j - i) & mask)) {
+      slots[i] = slots[j];
+      i = j;
+    }
+  }
+
+  slots[i] = nl_fdb_entry{};
+  used--;
+}
+
+void nl_fdb_table::grow() {
+  std::vector<nl_fdb_entry> old(slots.size() * 2);
+
+  old.swap(slots);
+  mask = slots.size() - 1;
+  shift--;
+
+  for (const auto &e : old) {
+    if (e.key == 0)
+      continue;
+
+    std::size_t i = home(e.key);
+    while (slots[i].key)
+      i = (i + 1) & mask;
+    slots[i] = e;
+  }
+}
+
+void nl_fdb_table::clear() {
+  for (auto &e : slots)
+    e = nl_fdb_entry{};
+  used = 0;
+
+  ports.clear();
+  free_ports.clear();
+  port_ids.clear();
+}
+
+uint16_t nl_fdb_table::port_ref(uint32_t ifindex) {
+  auto it = port_ids.find(ifindex);
+
+  if (it != port_ids.end()) {
+    ports[it->second].refs++;
+    return it->second;
+  }
+
+  uint16_t port;
+  if (!free_ports.empty()) {
+    port = free_ports.back();
+    free_ports.pop_back();
+    ports[port] = {ifindex, 1};
+  } else {
+    // an index per bridge port with entries, far below the limit
+    if (ports.size() > std::numeric_limits<uint16_t>::max())
+      throw std::length_error("nl_fdb_table: too many bridge ports");
+
+    port = ports.size();
+    ports.push_back({ifindex, 1});
+  }
+
+  port_ids.emplace(ifindex, port);
+  return port;
+}
+
+void nl_fdb_table::port_unref(uint16_t port) {
+  if (--ports[port].refs)
+    return;
+
+  port_ids.erase(ports[port].ifindex);
+  free_ports.push_back(port);
+}
+
+} // namespace basebox
@@ -0,0 +1,141 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace basebox {
+
+/**
+ * entry of the fdb table, packed into 16 bytes, four to a cache line
+ */
+struct nl_fdb_entry {
+  uint64_t key;     // mac << 16 | vid, 0 for an empty slot
+  uint32_t updated; // nl_fdb_table::now() of the last add or hit
+  uint16_t port;    // bridge port, see nl_fdb_table::ifindex()
+  uint16_t timeout; // idle timeout of the switch flow, 0 = none
+
+  uint16_t vid() const { return key & 0xffff; }
+  void mac(uint8_t *mac) const;
+};
+
+static_assert(sizeof(nl_fdb_entry) == 16, "nl_fdb_entry has to be packed");
+
+/**
+ * @brief the fdb entries learned by baseboxd, keyed by (mac, vid)
+ *
+ * Open addressing with linear probing in a power of two sized array, growing
+ * at a load of 3/4. Erasing shifts the following entries of the probe
+ * sequence back instead of leaving tombstones, so lookups stay short under
+ * churn. Lookups do not allocate.
+ *
+ * Entries refer to their bridge port by a 16 bit index into a table of the
+ * ifindexes in use, which is refcounted so indexes of removed ports are
+ * reused.
+ *
+ * Pointers to entries are invalidated by inserting and erasing.
+ */
+class nl_fdb_table {
+public:
+  explicit nl_fdb_table(std::size_t capacity = 1024);
+
+  nl_fdb_table(const nl_fdb_table &) = delete;
+  nl_fdb_table &operator=(const nl_fdb_table &) = delete;
+
+  static uint64_t make_key(const uint8_t *mac, uint16_t vid);
+
+  // coarse timestamp in seconds
+  static uint32_t now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  nl_fdb_entry *find(const uint8_t *mac, uint16_t vid) {
+    return find(make_key(mac, vid));
+  }
+  nl_fdb_entry *find(uint64_t key);
+
+  // add or update the entry of (mac, vid)
+  nl_fdb_entry *insert(const uint8_t *mac, uint16_t vid, uint32_t ifindex,
+                       uint16_t timeout = 0);
+
+  // bridge port of an entry
+  uint32_t ifindex(const nl_fdb_entry &e) const {
+    return ports[e.port].ifindex;
+  }
+
+  // returns false if there was no entry
+  bool erase(const uint8_t *mac, uint16_t vid) {
+    return erase(make_key(mac, vid));
+  }
+  bool erase(uint64_t key);
+
+  // erase all entries pred returns true for, returns the number erased
+  template <typename Pred> std::size_t erase_if(Pred pred);
+
+  template <typename Fn> void for_each(Fn fn) const {
+    for (const auto &e : slots)
+      if (e.key)
+        fn(e);
+  }
+
+  void clear();
+
+  std::size_t size() const { return used; }
+  std::size_t capacity() const { return slots.size(); }
+
+private:
+  std::size_t home(uint64_t key) const {
+    // fibonacci hashing, the top bits are the best mixed
+    return (key * 0x9e3779b97f4a7c15ULL) >> shift;
+  }
+
+  void erase_slot(std::size_t i);
+  void grow();
+
+  uint16_t port_ref(uint32_t ifindex);
+  void port_unref(uint16_t port);
+
+  struct port {
+    uint32_t ifindex;
+    uint32_t refs; // entries on the port, 0 for a free index
+  };
+
+  std::vector<nl_fdb_entry> slots;
+  std::size_t mask;
+  unsigned shift;
+  std::size_t used;
+
+  std::vector<port> ports;
+  std::vector<uint16_t> free_ports;
+  std::unordered_map<uint32_t, uint16_t> port_ids; // ifindex:port
+};
+
+template <typename Pred> std::size_t nl_fdb_table::erase_if(Pred pred) {
+  std::size_t start = 0;
+  std::size_t n = 0;
+
+  // start behind an empty slot, so no probe sequence wraps around the start
+  // and erasing only shifts entries to the slot visited again
+  while (slots[start].key)
+    start++;
+
+  for (std::size_t k = 1; k <= mask + 1; k++) {
+    std::size_t i = (start + k) & mask;
+
+    while (slots[i].key && pred(static_cast<const nl_fdb_entry &>(slots[i]))) {
+      erase_slot(i);
+      n++;
+    }
+  }
+
+  return n;
+}
+
+} // namespace basebox
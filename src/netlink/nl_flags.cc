@@ -0,0 +1,31 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+// flags of the netlink side, shared by baseboxd, nl-replay and nl-scale-bench
+
+#include <gflags/gflags.h>
+
+DEFINE_bool(multicast, true, "Enable multicast support");
+DEFINE_bool(mark_fwd_offload, true, "Mark switched packets as offloaded");
+DEFINE_int32(port_untagged_vid, 1,
+             "VLAN ID used for untagged traffic on unbridged ports");
+DEFINE_int32(punt_rate_control, 0,
+             "PPS limit for punted LACP, LLDP and STP frames (0 = unlimited)");
+DEFINE_int32(punt_rate_routing, 0,
+             "PPS limit for punted routing protocol frames (0 = unlimited)");
+DEFINE_int32(punt_rate_arp_nd, 0,
+             "PPS limit for punted ARP and ND frames (0 = unlimited)");
+DEFINE_int32(punt_rate_other, 0,
+             "PPS limit for other punted frames (0 = unlimited)");
+DEFINE_string(nl_capture, "",
+              "Capture the netlink events to this file for a later replay");
+DEFINE_string(swi_record, "", "Record the calls to the switch to this file");
+DEFINE_bool(fdb_soft_ageing, false,
+            "Age learned FDB entries in baseboxd from polled switch hits");
+DEFINE_int32(mac_move_threshold, 10,
+             "Moves of a MAC within the window to hold it down (0 = never)");
+DEFINE_int32(mac_move_window, 10, "Window of the MAC move detection in s");
+DEFINE_int32(mac_move_holddown, 30,
+             "First hold-down of a flapping MAC in s, doubled on repeats");
+DEFINE_int32(mac_move_holddown_max, 960,
+             "Maximum hold-down of a flapping MAC in s");
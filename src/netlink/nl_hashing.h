@@ -5,6 +5,8 @@
 
 #include <cstdint>
 #include <functional>
+#include <set>
+#include <tuple>
 
 namespace std {
 
@@ -46,4 +48,16 @@ template <typename... TT> struct hash<std::tuple<TT...>> {
   }
 };
 
+template <class T, class A> struct hash<std::set<T, A>> {
+  using argument_type = std::set<T, A>;
+  using result_type = std::size_t;
+  result_type operator()(argument_type const &arg) const noexcept {
+    result_type seed = 0;
+    for (const auto &v : arg) {
+      hash_combine(seed, v);
+    }
+    return seed;
+  }
+};
+
 } // namespace std
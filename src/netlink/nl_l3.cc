@@ -26,74 +26,16 @@
 #include "nl_vlan.h"
 #include "nl_route_query.h"
 #include "sai.h"
+#include "utils/log_limit.h"
 #include "utils/rofl-utils.h"
+#include "utils/trace_ring.h"
 
 DECLARE_int32(port_untagged_vid);
 
-namespace std {
-
-template <> struct hash<rofl::caddress_ll> {
-  using argument_type = rofl::caddress_ll;
-  using result_type = std::size_t;
-  result_type operator()(argument_type const &lla) const noexcept {
-    return std::hash<uint64_t>{}(lla.get_mac());
-  }
-};
-
-template <class T, class A> struct hash<std::set<T, A>> {
-  using argument_type = std::set<T, A>;
-  using result_type = std::size_t;
-  result_type operator()(argument_type const &arg) const noexcept {
-    result_type seed = 0;
-    for (const auto &v : arg) {
-      hash_combine(seed, v);
-    }
-    return seed;
-  }
-};
-
-template <> struct hash<basebox::nh_stub> {
-  using argument_type = basebox::nh_stub;
-  using result_type = std::size_t;
-  result_type operator()(argument_type const &nh) const noexcept {
-    size_t seed = 0;
-    if (nh.nh == nullptr) {
-      hash_combine(seed, nullptr);
-    } else {
-      auto len = nl_addr_get_len(nh.nh);
-
-      hash_combine(seed, nl_addr_get_family(nh.nh));
-      hash_combine(seed, nl_addr_get_prefixlen(nh.nh));
-
-      if (len > 0) {
-        hash_combine(seed, std::string_view{reinterpret_cast<const char *>(
-                                                nl_addr_get_binary_addr(nh.nh)),
-                                            len});
-      }
-    }
-    hash_combine(seed, nh.ifindex);
-    return seed;
-  }
-};
-
-} // namespace std
-
 namespace basebox {
 
-class l3_interface final {
-public:
-  l3_interface(uint32_t l3_interface_id)
-      : l3_interface_id(l3_interface_id), refcnt(1) {}
-
-  uint32_t l3_interface_id;
-  int refcnt;
-};
-
 // next hop mapping key: <port_id, vid, src_mac, dst_mac>
-std::unordered_map<
-    std::tuple<int, uint16_t, rofl::caddress_ll, rofl::caddress_ll>,
-    l3_interface>
-    l3_interface_mapping;
+l3_interface_map l3_interface_mapping;
 
 // key: source port_id, vid, src_mac, af ; value: refcount
 std::unordered_set<std::tuple<int, uint16_t, rofl::caddress_ll, uint16_t>>
@@ -191,6 +133,8 @@ int nl_l3::search_neigh_cache(int ifindex, struct nl_addr *addr, int family,
 
 // XXX separate function to make it possible to add lo addresses more directly
 int nl_l3::add_l3_addr(struct rtnl_addr *a) {
+  trace_scope trace("nl_l3::add_l3_addr");
+
   assert(sw);
   assert(a);
 
@@ -304,6 +248,8 @@ int nl_l3::add_l3_addr(struct rtnl_addr *a) {
 }
 
 int nl_l3::add_l3_addr_v6(struct rtnl_addr *a) {
+  trace_scope trace("nl_l3::add_l3_addr_v6");
+
   assert(sw);
   assert(a);
 
@@ -426,6 +372,8 @@ int nl_l3::add_lo_addr_v6(struct rtnl_addr *a) {
 }
 
 int nl_l3::del_l3_addr(struct rtnl_addr *a) {
+  trace_scope trace("nl_l3::del_l3_addr");
+
   assert(sw);
   assert(a);
 
@@ -601,13 +549,14 @@ int nl_l3::add_l3_neigh_egress(struct rtnl_neigh *n, uint32_t *l3_interface_id,
 
   switch (state) {
   case NUD_FAILED:
-    LOG(INFO) << __FUNCTION__ << ": neighbour not reachable state=failed";
+    LOG_LIMITED(INFO) << __FUNCTION__
+                      << ": neighbour not reachable state=failed";
     return -EINVAL;
   case NUD_INCOMPLETE:
-    LOG(INFO) << __FUNCTION__ << ": neighbour state=incomplete";
+    LOG_LIMITED(INFO) << __FUNCTION__ << ": neighbour state=incomplete";
     return 0;
   case NUD_STALE:
-    LOG(INFO) << __FUNCTION__ << ": neighbour state=stale";
+    LOG_LIMITED(INFO) << __FUNCTION__ << ": neighbour state=stale";
     break;
   }
 
@@ -734,6 +683,8 @@ int nl_l3::del_l3_neigh_egress(struct rtnl_neigh *n) {
 }
 
 int nl_l3::add_l3_neigh(struct rtnl_neigh *n) {
+  trace_scope trace("nl_l3::add_l3_neigh");
+
   assert(n);
 
   int rv;
@@ -770,7 +721,8 @@ int nl_l3::add_l3_neigh(struct rtnl_neigh *n) {
     }
 
     rv = add_l3_neigh_egress(n, &l3_interface_id, &vrf_id);
-    LOG(INFO) << __FUNCTION__ << ": adding l3 neigh egress for neigh " << n;
+    LOG_LIMITED(INFO) << __FUNCTION__ << ": adding l3 neigh egress for neigh "
+                      << n;
 
     if (rv < 0) {
       LOG(ERROR) << __FUNCTION__ << ": add l3 neigh egress failed for neigh "
@@ -821,6 +773,8 @@ int nl_l3::add_l3_neigh(struct rtnl_neigh *n) {
 }
 
 int nl_l3::update_l3_neigh(struct rtnl_neigh *n_old, struct rtnl_neigh *n_new) {
+  trace_scope trace("nl_l3::update_l3_neigh");
+
   assert(n_old);
   assert(n_new);
 
@@ -938,6 +892,8 @@ int nl_l3::update_l3_neigh(struct rtnl_neigh *n_old, struct rtnl_neigh *n_new) {
 }
 
 int nl_l3::del_l3_neigh(struct rtnl_neigh *n) {
+  trace_scope trace("nl_l3::del_l3_neigh");
+
   assert(n);
 
   int rv = 0;
@@ -950,13 +906,14 @@ int nl_l3::del_l3_neigh(struct rtnl_neigh *n) {
 
   switch (state) {
   case NUD_FAILED:
-    LOG(INFO) << __FUNCTION__ << ": neighbour not reachable state=failed";
+    LOG_LIMITED(INFO) << __FUNCTION__
+                      << ": neighbour not reachable state=failed";
     return -EINVAL;
   case NUD_INCOMPLETE:
-    LOG(INFO) << __FUNCTION__ << ": neighbour state=incomplete";
+    LOG_LIMITED(INFO) << __FUNCTION__ << ": neighbour state=incomplete";
     return 0;
   case NUD_STALE:
-    LOG(INFO) << __FUNCTION__ << ": neighbour state=stale";
+    LOG_LIMITED(INFO) << __FUNCTION__ << ": neighbour state=stale";
     break;
   }
 
@@ -1138,6 +1095,8 @@ int nl_l3::del_l3_egress(int ifindex, uint16_t vid, const struct nl_addr *s_mac,
 }
 
 int nl_l3::add_l3_route(struct rtnl_route *r) {
+  trace_scope trace("nl_l3::add_l3_route");
+
   assert(r);
 
   int rv = 0;
@@ -1170,6 +1129,8 @@ int nl_l3::add_l3_route(struct rtnl_route *r) {
 }
 
 int nl_l3::update_l3_route(struct rtnl_route *r_old, struct rtnl_route *r_new) {
+  trace_scope trace("nl_l3::update_l3_route");
+
   int rv = 0;
 
   assert(r_old);
@@ -1210,6 +1171,8 @@ int nl_l3::update_l3_route(struct rtnl_route *r_old, struct rtnl_route *r_new) {
 }
 
 int nl_l3::del_l3_route(struct rtnl_route *r) {
+  trace_scope trace("nl_l3::del_l3_route");
+
   assert(r);
 
   switch (rtnl_route_get_type(r)) {
@@ -2149,6 +2112,8 @@ int nl_l3::del_l3_unicast_route(rtnl_route *r, bool keep_route) {
 
 int nl_l3::add_l3_ecmp_group(const std::set<nh_stub> &nhs,
                              uint32_t *l3_ecmp_id) {
+  trace_scope trace("nl_l3::add_l3_ecmp_group");
+
   std::set<uint32_t> empty;
 
   auto it = nh_grp_to_l3_ecmp_mapping.find(nhs);
@@ -2185,6 +2150,8 @@ int nl_l3::get_l3_ecmp_group(const std::set<nh_stub> &nhs,
 }
 
 int nl_l3::del_l3_ecmp_group(const std::set<nh_stub> &nhs) {
+  trace_scope trace("nl_l3::del_l3_ecmp_group");
+
   auto it = nh_grp_to_l3_ecmp_mapping.find(nhs);
   if (it == nh_grp_to_l3_ecmp_mapping.end()) {
     VLOG(2) << __FUNCTION__ << ": failed to find ecmp id";
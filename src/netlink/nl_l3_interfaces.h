@@ -3,9 +3,16 @@
 
 #pragma once
 
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+
 #include <netlink/addr.h>
 #include <glog/logging.h>
 
+#include "nl_hashing.h"
+#include "utils/rofl-utils.h"
+
 namespace basebox {
 
 struct net_params {
@@ -109,4 +116,47 @@ public:
                                            struct nh_params) noexcept = 0;
 };
 
+class l3_interface final {
+public:
+  l3_interface(uint32_t l3_interface_id)
+      : l3_interface_id(l3_interface_id), refcnt(1) {}
+
+  uint32_t l3_interface_id;
+  int refcnt;
+};
+
+// next hop mapping key: <port_id, vid, src_mac, dst_mac>
+typedef std::unordered_map<
+    std::tuple<int, uint16_t, rofl::caddress_ll, rofl::caddress_ll>,
+    l3_interface>
+    l3_interface_map;
+
 } // namespace basebox
+
+namespace std {
+
+template <> struct hash<basebox::nh_stub> {
+  using argument_type = basebox::nh_stub;
+  using result_type = std::size_t;
+  result_type operator()(argument_type const &nh) const noexcept {
+    size_t seed = 0;
+    if (nh.nh == nullptr) {
+      hash_combine(seed, nullptr);
+    } else {
+      auto len = nl_addr_get_len(nh.nh);
+
+      hash_combine(seed, nl_addr_get_family(nh.nh));
+      hash_combine(seed, nl_addr_get_prefixlen(nh.nh));
+
+      if (len > 0) {
+        hash_combine(seed, std::string_view{reinterpret_cast<const char *>(
+                                                nl_addr_get_binary_addr(nh.nh)),
+                                            len});
+      }
+    }
+    hash_combine(seed, nh.ifindex);
+    return seed;
+  }
+};
+
+} // namespace std
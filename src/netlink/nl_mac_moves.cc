@@ -0,0 +1,120 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include <algorithm>
+#include <ctime>
+
+#include "nl_mac_moves.h"
+
+namespace basebox {
+
+// hold-downs kept for the statistics
+static const std::size_t max_events = 128;
+
+nl_mac_moves::nl_mac_moves(uint32_t threshold, uint32_t window,
+                           uint32_t holddown, uint32_t holddown_max)
+    : threshold(threshold), window(std::max(window, 1U)),
+      holddown(std::max(holddown, 1U)),
+      holddown_max(std::max(holddown_max, holddown)), moves(0), suppressed(0),
+      holddowns(0), prune_at(1024) {}
+
+bool nl_mac_moves::moved(uint64_t key, uint32_t from, uint32_t to,
+                         uint32_t now) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto it = macs.find(key);
+  if (it == macs.end()) {
+    if (macs.size() >= prune_at)
+      prune(now);
+    it = macs.emplace(key, mac_state{now, 0, now, 0, 0}).first;
+  }
+
+  mac_state &s = it->second;
+
+  if (s.hold_until) {
+    if (static_cast<int32_t>(now - s.hold_until) < 0) {
+      suppressed++;
+      return false;
+    }
+
+    s.hold_until = 0;
+  }
+
+  // the penalty of a MAC that stayed put long enough is forgotten
+  if (now - s.last_move >= holddown_max)
+    s.level = 0;
+
+  if (now - s.window_start >= window) {
+    s.window_start = now;
+    s.window_moves = 0;
+  }
+
+  s.window_moves++;
+  s.last_move = now;
+
+  if (threshold == 0 || s.window_moves < threshold) {
+    moves++;
+    return true;
+  }
+
+  // pin the MAC to the port it is on, the move found to be a flap included
+  uint32_t hold = holddown;
+  for (unsigned i = 0; i < s.level && hold < holddown_max; i++)
+    hold <<= 1;
+  hold = std::min(hold, holddown_max);
+
+  if (hold < holddown_max)
+    s.level++;
+  s.hold_until = now + hold;
+  s.window_moves = 0;
+  holddowns++;
+  suppressed++;
+
+  if (events.size() >= max_events)
+    events.pop_front();
+  events.push_back(mac_move_event{key, from, to, threshold, hold, s.hold_until,
+                                  std::time(nullptr), true});
+
+  return false;
+}
+
+void nl_mac_moves::prune(uint32_t now) {
+  uint32_t keep = std::max(window, holddown_max);
+
+  for (auto it = macs.begin(); it != macs.end();) {
+    const mac_state &s = it->second;
+    bool held = s.hold_until && static_cast<int32_t>(now - s.hold_until) < 0;
+
+    if (!held && now - s.last_move >= keep)
+      it = macs.erase(it);
+    else
+      ++it;
+  }
+
+  // prune again once the remaining state doubled
+  prune_at = std::max<std::size_t>(1024, macs.size() * 2);
+}
+
+mac_move_stats nl_mac_moves::get_statistics() const {
+  uint32_t t = now();
+  std::lock_guard<std::mutex> lock(mutex);
+  mac_move_stats stats{moves, suppressed, holddowns, 0, events};
+
+  for (const auto &m : macs) {
+    if (m.second.hold_until &&
+        static_cast<int32_t>(t - m.second.hold_until) < 0)
+      stats.held++;
+  }
+
+  for (auto &ev : stats.events) {
+    auto it = macs.find(ev.key);
+
+    // a later hold-down of the MAC has its own event
+    ev.active = static_cast<int32_t>(t - ev.hold_until) < 0 &&
+                it != macs.end() && it->second.hold_until == ev.hold_until;
+  }
+
+  return stats;
+}
+
+} // namespace basebox
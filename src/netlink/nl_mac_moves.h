@@ -0,0 +1,98 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace basebox {
+
+// a learned MAC address was held down for moving between ports too often
+struct mac_move_event {
+  uint64_t key;        // nl_fdb_table key, mac << 16 | vid
+  uint32_t from;       // port the MAC is pinned to
+  uint32_t to;         // port of the move that started the hold-down
+  uint32_t moves;      // moves within the detection window
+  uint32_t holddown;   // seconds
+  uint32_t hold_until; // nl_mac_moves::now() the hold-down ends
+  int64_t timestamp;   // unix time the hold-down started
+  bool active;         // still held down
+};
+
+struct mac_move_stats {
+  uint64_t moves;      // moves applied
+  uint64_t suppressed; // moves ignored while held down
+  uint64_t holddowns;  // hold-downs started
+  uint32_t held;       // MAC addresses held down now
+  std::deque<mac_move_event> events; // most recent hold-downs, oldest first
+};
+
+/**
+ * @brief detection and dampening of learned MAC addresses flapping between
+ * bridge ports
+ *
+ * Every move of a (mac, vid) to another port is counted. A MAC moving
+ * threshold times within a window is held down: it stays pinned to the port
+ * it was on and further moves are ignored until the hold-down ends. The
+ * hold-down doubles every time the MAC is held down again, up to a maximum,
+ * and is forgotten once the MAC did not move for that maximum.
+ *
+ * Moves are rare compared to lookups, the state is guarded by a mutex to be
+ * read by the gRPC server.
+ */
+class nl_mac_moves final {
+public:
+  // threshold 0 disables the dampening, the moves are counted regardless
+  nl_mac_moves(uint32_t threshold, uint32_t window, uint32_t holddown,
+               uint32_t holddown_max);
+
+  nl_mac_moves(const nl_mac_moves &) = delete;
+  nl_mac_moves &operator=(const nl_mac_moves &) = delete;
+
+  // coarse timestamp in seconds
+  static uint32_t now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  /**
+   * @brief a learned MAC moved from port from to port to
+   *
+   * @return false if the move has to be ignored, the MAC is held down
+   */
+  bool moved(uint64_t key, uint32_t from, uint32_t to, uint32_t now);
+
+  mac_move_stats get_statistics() const;
+
+private:
+  struct mac_state {
+    uint32_t window_start;
+    uint32_t window_moves;
+    uint32_t last_move;
+    uint32_t hold_until; // 0 = not held down
+    unsigned level;      // hold-downs in a row, doubling the next one
+  };
+
+  // drop the state of MACs that are neither held down nor penalized
+  void prune(uint32_t now);
+
+  const uint32_t threshold;
+  const uint32_t window;
+  const uint32_t holddown;
+  const uint32_t holddown_max;
+
+  mutable std::mutex mutex;
+  std::unordered_map<uint64_t, mac_state> macs;
+  std::deque<mac_move_event> events;
+  uint64_t moves;
+  uint64_t suppressed;
+  uint64_t holddowns;
+  uint32_t prune_at;
+};
+
+} // namespace basebox
@@ -7,14 +7,16 @@
 namespace basebox {
 
 nl_obj::nl_obj(int action, struct nl_object *old_obj, struct nl_object *new_obj)
-    : action(action), old_obj(old_obj), new_obj(new_obj) {
+    : action(action), old_obj(old_obj), new_obj(new_obj),
+      arrival(std::chrono::steady_clock::now()) {
   increment_refcount();
   VLOG(2) << "created nl_obj=" << this << " (old_obj=" << old_obj
           << " new_obj=" << new_obj << ")";
 }
 
 nl_obj::nl_obj(const nl_obj &other)
-    : action(other.action), old_obj(other.old_obj), new_obj(other.new_obj) {
+    : action(other.action), old_obj(other.old_obj), new_obj(other.new_obj),
+      arrival(other.arrival) {
   increment_refcount();
   VLOG(2) << "copied nl_obj=" << this << " other=" << &other
           << " (old_obj=" << old_obj << " new_obj=" << new_obj << ")";
@@ -24,6 +26,7 @@ nl_obj &nl_obj::operator=(nl_obj &other) noexcept {
   action = other.action;
   old_obj = other.old_obj;
   new_obj = other.new_obj;
+  arrival = other.arrival;
   increment_refcount();
   return *this;
 }
@@ -32,6 +35,7 @@ nl_obj &nl_obj::operator=(nl_obj &&other) noexcept {
   action = other.action;
   old_obj = other.old_obj;
   new_obj = other.new_obj;
+  arrival = other.arrival;
   other.action = NL_ACT_UNSPEC;
   other.old_obj = other.new_obj = nullptr;
   return *this;
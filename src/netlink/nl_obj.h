@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <chrono>
+
 #include <netlink/cache.h>
 #include <netlink/object.h>
 
@@ -25,6 +27,8 @@ public:
   struct nl_object *get_new_obj() const {
     return new_obj;
   }
+  // time the object was received from the kernel
+  std::chrono::steady_clock::time_point get_arrival() const { return arrival; }
 
 private:
   struct nl_object *get_obj() const {
@@ -49,6 +53,7 @@ private:
   int action;
   struct nl_object *old_obj;
   struct nl_object *new_obj;
+  std::chrono::steady_clock::time_point arrival;
 };
 
 } // namespace basebox
@@ -26,6 +26,7 @@
 #include "nl_output.h"
 #include "nl_route_query.h"
 #include "nl_vxlan.h"
+#include "utils/trace_ring.h"
 
 DECLARE_int32(port_untagged_vid);
 
@@ -189,6 +190,41 @@ static struct access_tunnel_port get_access_tunnel_port(uint32_t pport,
   return invalid;
 }
 
+// drop a reference to a next hop without touching the switch, for next hops
+// that were not created or are still used
+static void release_next_hop(uint32_t nh_id) {
+  auto nh2tnh_it = tunnel_next_hop2tnh.find(nh_id);
+
+  if (nh2tnh_it == tunnel_next_hop2tnh.end())
+    return;
+
+  auto tnh_it = tunnel_next_hop_id.equal_range(nh2tnh_it->second);
+  for (auto it = tnh_it.first; it != tnh_it.second; ++it) {
+    if (it->second.nh_id != nh_id)
+      continue;
+
+    if (--it->second.refcnt == 0) {
+      tunnel_next_hop_id.erase(it);
+      tunnel_next_hop2tnh.erase(nh2tnh_it);
+    }
+    return;
+  }
+}
+
+// same for a reference of vni to an endpoint
+static void release_endpoint(uint32_t lport_id, uint32_t vni) {
+  for (auto it = endpoint_id.begin(); it != endpoint_id.end(); ++it) {
+    if (it->second.lport_id != lport_id)
+      continue;
+
+    if (--it->second.refcnt_vni[vni] == 0)
+      it->second.refcnt_vni.erase(vni);
+    if (--it->second.refcnt == 0)
+      endpoint_id.erase(it);
+    return;
+  }
+}
+
 nl_vxlan::nl_vxlan(std::shared_ptr<nl_l3> l3, cnetlink *nl)
     : sw(nullptr), bridge(nullptr), l3(std::move(l3)), nl(nl) {}
 
@@ -302,6 +338,8 @@ int nl_vxlan::create_access_port(rtnl_link *br_link, uint32_t tunnel_id,
                                  const std::string &access_port_name,
                                  uint32_t pport_no, uint16_t vid, bool untagged,
                                  uint32_t *lport) {
+  trace_scope trace("nl_vxlan::create_access_port");
+
   using namespace std::chrono_literals;
   assert(sw);
 
@@ -387,6 +425,8 @@ int nl_vxlan::create_access_port(rtnl_link *br_link, uint32_t tunnel_id,
 
 int nl_vxlan::delete_access_port(rtnl_link *br_link, uint32_t pport_no,
                                  uint16_t vid, bool wipe_l2_addresses) {
+  trace_scope trace("nl_vxlan::delete_access_port");
+
   assert(br_link);
   pport_vlan search(pport_no, vid);
   auto port_range = access_port_ids.equal_range(search);
@@ -476,14 +516,21 @@ int nl_vxlan::create_vni(rtnl_link *link) {
     return -EINVAL;
   }
 
-  // enable tunnel_id
-  rv = sw->overlay_tunnel_add(this->tunnel_id_cnt);
+  rv = enable_tenant(vni);
+  if (rv < 0)
+    sw->tunnel_tenant_delete(this->tunnel_id_cnt);
+
+  return rv;
+}
+
+// enables the tenant just created on the switch as tunnel_id_cnt
+int nl_vxlan::enable_tenant(uint32_t vni) {
+  int rv = sw->overlay_tunnel_add(this->tunnel_id_cnt);
 
   if (rv < 0) {
     LOG(ERROR) << __FUNCTION__
-               << ": failed to add overlay tunnel tunnel_id=" << tunnel_id
-               << ", rv=" << rv;
-    sw->tunnel_tenant_delete(this->tunnel_id_cnt);
+               << ": failed to add overlay tunnel tunnel_id="
+               << this->tunnel_id_cnt << ", rv=" << rv;
     return -EINVAL;
   }
 
@@ -531,6 +578,8 @@ int nl_vxlan::remove_vni(rtnl_link *link) {
 }
 
 int nl_vxlan::create_endpoint(rtnl_link *vxlan_link, rtnl_link *br_link) {
+  trace_scope trace("nl_vxlan::create_endpoint");
+
   assert(vxlan_link);
 
   if (!rtnl_link_is_vxlan(vxlan_link)) {
@@ -593,8 +642,23 @@ int nl_vxlan::create_endpoint(rtnl_link *vxlan_link, rtnl_link *br_link,
     return -EINVAL;
   }
 
+  uint32_t tunnel_id, vni;
+  if (rtnl_link_vxlan_get_id(vxlan_link, &vni) != 0)
+    return -EINVAL;
+
+  // tenant, next hop, endpoint and the endpoint in the tenant depend on each
+  // other and are set up together by one staged call
+  switch_interface::tunnel_endpoint_ops setup = {};
+
+  // the tenant is created along with the endpoint if the vni has none yet
+  if (get_tunnel_id(vni, &tunnel_id) < 0) {
+    tunnel_id = this->tunnel_id_cnt;
+    setup.tenant.tunnel_id = tunnel_id;
+    setup.tenant.vni = vni;
+  }
+
   uint32_t next_hop_id = 0;
-  rv = create_next_hop(vxlan_link, remote_addr, &next_hop_id);
+  rv = create_next_hop(vxlan_link, remote_addr, &next_hop_id, &setup);
   if (rv == -ENETUNREACH) {
     // NH network not reachable (route missing)
     l3->notify_on_net_reachable(
@@ -605,27 +669,39 @@ int nl_vxlan::create_endpoint(rtnl_link *vxlan_link, rtnl_link *br_link,
     return rv;
   }
 
-  uint32_t tunnel_id, vni;
-  rv = get_tunnel_id(vxlan_link, &vni, &tunnel_id);
-  if (rv < 0) {
-    return -EINVAL;
-  }
-
   rv = create_endpoint(vxlan_link, local_.get(), remote_addr, next_hop_id,
-                       &lport_id);
+                       &lport_id, &setup);
 
   if (rv < 0) {
-    delete_next_hop(next_hop_id);
+    release_next_hop(next_hop_id);
     LOG(ERROR) << __FUNCTION__ << ": failed to create endpoint";
     return -EINVAL;
   }
 
-  rv = sw->tunnel_port_tenant_add(lport_id, tunnel_id);
+  setup.port_tenant.port_id = lport_id;
+  setup.port_tenant.tunnel_id = tunnel_id;
+  rv = sw->tunnel_endpoint_setup(&setup);
+  if (rv == 0 && setup.tenant.tunnel_id)
+    rv = enable_tenant(vni);
+
   if (rv < 0) {
-    delete_endpoint(vxlan_link, local_.get(), remote_addr);
-    delete_next_hop(next_hop_id);
-    LOG(ERROR) << __FUNCTION__ << ": tunnel_port_tenant_add returned rv=" << rv
-               << " for lport_id=" << lport_id << " tunnel_id=" << tunnel_id;
+    LOG(ERROR) << __FUNCTION__ << ": failed to set up lport_id=" << lport_id
+               << " in tunnel_id=" << tunnel_id << ", rv=" << rv;
+
+    // undo the steps done in reverse, forget the others
+    if (setup.port_tenant.rv == 0)
+      sw->tunnel_port_tenant_remove(lport_id, tunnel_id);
+    if (setup.endpoint.port_id && setup.endpoint.rv == 0)
+      sw->tunnel_port_delete(lport_id);
+    release_endpoint(lport_id, vni);
+
+    if (setup.next_hop.next_hop_id && setup.next_hop.rv < 0)
+      release_next_hop(next_hop_id);
+    else
+      delete_next_hop(next_hop_id);
+
+    if (setup.tenant.tunnel_id && setup.tenant.rv == 0)
+      sw->tunnel_tenant_delete(tunnel_id);
     return -EINVAL;
   }
 
@@ -684,7 +760,8 @@ int nl_vxlan::create_endpoint(rtnl_link *vxlan_link, rtnl_link *br_link,
 
 int nl_vxlan::create_endpoint(rtnl_link *vxlan_link, nl_addr *local_,
                               nl_addr *group_, uint32_t _next_hop_id,
-                              uint32_t *lport_id) {
+                              uint32_t *lport_id,
+                              switch_interface::tunnel_endpoint_ops *setup) {
   assert(group_);
   assert(local_);
   assert(vxlan_link);
@@ -739,30 +816,23 @@ int nl_vxlan::create_endpoint(rtnl_link *vxlan_link, nl_addr *local_,
 
   // create endpoint port
   VLOG(3) << __FUNCTION__ << std::hex << std::showbase
-          << ": calling tunnel_enpoint_create lport_id=" << lport_id
+          << ": adding tunnel endpoint lport_id=" << this->port_id_cnt
           << ", name=" << rtnl_link_get_name(vxlan_link)
           << ", remote=" << remote_ipv4 << ", local=" << local_ipv4
           << ", ttl=" << ttl << ", next_hop_id=" << _next_hop_id
           << ", terminator_udp_dst_port=" << terminator_udp_dst_port
           << ", initiator_udp_dst_port=" << initiator_udp_dst_port
           << ", use_entropy=" << use_entropy;
-  rv = sw->tunnel_enpoint_create(
-      this->port_id_cnt, std::string(rtnl_link_get_name(vxlan_link)),
-      remote_ipv4, local_ipv4, ttl, _next_hop_id, terminator_udp_dst_port,
-      initiator_udp_dst_port, udp_src_port_if_no_entropy, use_entropy);
-
-  if (rv != 0) {
-    LOG(ERROR) << __FUNCTION__
-               << ": failed to create tunnel enpoint lport_id=" << std::hex
-               << std::showbase << lport_id
-               << ", name=" << rtnl_link_get_name(vxlan_link)
-               << ", remote=" << remote_ipv4 << ", local=" << local_ipv4
-               << ", ttl=" << ttl << ", next_hop_id=" << _next_hop_id
-               << ", terminator_udp_dst_port=" << terminator_udp_dst_port
-               << ", initiator_udp_dst_port=" << initiator_udp_dst_port
-               << ", use_entropy=" << use_entropy << ", rv=" << rv;
-    return -EINVAL;
-  }
+  setup->endpoint.port_id = this->port_id_cnt;
+  setup->endpoint.port_name = rtnl_link_get_name(vxlan_link);
+  setup->endpoint.remote_ipv4 = remote_ipv4;
+  setup->endpoint.local_ipv4 = local_ipv4;
+  setup->endpoint.ttl = ttl;
+  setup->endpoint.next_hop_id = _next_hop_id;
+  setup->endpoint.terminator_udp_dst_port = terminator_udp_dst_port;
+  setup->endpoint.initiator_udp_dst_port = initiator_udp_dst_port;
+  setup->endpoint.udp_src_port_if_no_entropy = udp_src_port_if_no_entropy;
+  setup->endpoint.use_entropy = use_entropy;
 
   endpoint_id.emplace(
       ep, endpoint_tunnel_port(this->port_id_cnt, _next_hop_id, vni));
@@ -801,6 +871,8 @@ int nl_vxlan::disable_flooding(uint32_t tunnel_id, uint32_t lport_id) {
 }
 
 int nl_vxlan::delete_endpoint(rtnl_link *vxlan_link) {
+  trace_scope trace("nl_vxlan::delete_endpoint");
+
   nl_addr *tmp_addr = nullptr;
   int rv = rtnl_link_vxlan_get_local(vxlan_link, &tmp_addr);
 
@@ -938,7 +1010,8 @@ int nl_vxlan::delete_endpoint(rtnl_link *vxlan_link, nl_addr *local_,
 }
 
 int nl_vxlan::create_next_hop(rtnl_link *vxlan_link, nl_addr *remote,
-                              uint32_t *next_hop_id) {
+                              uint32_t *next_hop_id,
+                              switch_interface::tunnel_endpoint_ops *setup) {
   int rv;
   std::packaged_task<struct rtnl_route *(struct nl_addr *)> task(
       [](struct nl_addr *addr) {
@@ -1006,7 +1079,7 @@ int nl_vxlan::create_next_hop(rtnl_link *vxlan_link, nl_addr *remote,
     return -EDESTADDRREQ;
   }
 
-  rv = create_next_hop(neigh, next_hop_id);
+  rv = create_next_hop(neigh, next_hop_id, setup);
   if (rv < 0) {
     LOG(ERROR) << __FUNCTION__ << ": failed to create next hop " << neigh;
     return -EINVAL;
@@ -1015,9 +1088,8 @@ int nl_vxlan::create_next_hop(rtnl_link *vxlan_link, nl_addr *remote,
   return rv;
 }
 
-int nl_vxlan::create_next_hop(rtnl_neigh *neigh, uint32_t *next_hop_id) {
-  int rv;
-
+int nl_vxlan::create_next_hop(rtnl_neigh *neigh, uint32_t *next_hop_id,
+                              switch_interface::tunnel_endpoint_ops *setup) {
   assert(neigh);
   assert(next_hop_id_cnt);
 
@@ -1073,26 +1145,20 @@ int nl_vxlan::create_next_hop(rtnl_neigh *neigh, uint32_t *next_hop_id) {
 
   // create next hop
   VLOG(3) << __FUNCTION__ << std::hex << std::showbase
-          << ": calling tunnel_next_hop_create next_hop_id=" << next_hop_id_cnt
+          << ": adding tunnel next hop next_hop_id=" << next_hop_id_cnt
           << ", src_mac=" << src_mac << ", dst_mac=" << dst_mac
           << ", physical_port=" << physical_port << ", vlan_id=" << vlan_id;
-  rv = sw->tunnel_next_hop_create(next_hop_id_cnt, src_mac, dst_mac,
-                                  physical_port, vlan_id);
-
-  if (rv < 0) {
-    LOG(ERROR) << __FUNCTION__ << ": tunnel_next_hop_create returned rv=" << rv
-               << " for the following parameter: next_hop_id="
-               << next_hop_id_cnt << ", src_mac=" << src_mac
-               << ", dst_mac=" << dst_mac << ", physical_port=" << physical_port
-               << ", vlan_id=" << vlan_id;
-    return rv;
-  }
+  setup->next_hop.next_hop_id = next_hop_id_cnt;
+  setup->next_hop.src_mac = src_mac;
+  setup->next_hop.dst_mac = dst_mac;
+  setup->next_hop.physical_port = physical_port;
+  setup->next_hop.vlan_id = vlan_id;
 
   tunnel_next_hop_id.emplace(tnh, next_hop_id_cnt);
   tunnel_next_hop2tnh.emplace(next_hop_id_cnt, tnh);
   *next_hop_id = next_hop_id_cnt++;
 
-  return rv;
+  return 0;
 }
 
 int nl_vxlan::delete_next_hop(rtnl_neigh *neigh) {
@@ -1191,6 +1257,8 @@ int nl_vxlan::delete_next_hop(const struct tunnel_nh &tnh) {
 
 int nl_vxlan::add_l2_neigh(rtnl_neigh *neigh, rtnl_link *link,
                            rtnl_link *br_link) {
+  trace_scope trace("nl_vxlan::add_l2_neigh");
+
   assert(link);
   assert(neigh);
   assert(rtnl_link_get_family(link) == AF_UNSPEC); // the actual interface
@@ -1373,6 +1441,8 @@ int nl_vxlan::add_l2_neigh(rtnl_neigh *neigh, uint32_t lport,
 
 int nl_vxlan::delete_l2_neigh(rtnl_neigh *neigh, rtnl_link *link,
                               rtnl_link *br_link) {
+  trace_scope trace("nl_vxlan::delete_l2_neigh");
+
   assert(link);
   assert(neigh);
   assert(rtnl_link_get_family(link) == AF_UNSPEC); // the vxlan interface
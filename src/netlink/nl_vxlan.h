@@ -8,6 +8,7 @@
 #include <memory>
 
 #include "nl_l3_interfaces.h"
+#include "sai.h"
 
 extern "C" {
 struct nl_addr;
@@ -20,7 +21,6 @@ namespace basebox {
 class cnetlink;
 class nl_l3;
 class nl_bridge;
-class switch_interface;
 struct tunnel_nh;
 
 class nl_vxlan : public net_reachable, nh_reachable {
@@ -57,15 +57,22 @@ public:
   int delete_endpoint(rtnl_link *vxlan_link);
 
 private:
+  int enable_tenant(uint32_t vni);
+
+  // The objects missing on the switch are added to setup to be created in a
+  // single tunnel_endpoint_setup call, and are registered right away.
   int create_endpoint(rtnl_link *vxlan_link, rtnl_link *br_link,
                       nl_addr *group);
   int create_endpoint(rtnl_link *vxlan_link, nl_addr *local_, nl_addr *group_,
-                      uint32_t _next_hop_id, uint32_t *_port_id);
+                      uint32_t _next_hop_id, uint32_t *_port_id,
+                      switch_interface::tunnel_endpoint_ops *setup);
   int delete_endpoint(rtnl_link *vxlan_link, nl_addr *local_, nl_addr *group_);
 
   int create_next_hop(rtnl_link *vxlan_link, nl_addr *remote,
-                      uint32_t *next_hop_id);
-  int create_next_hop(rtnl_neigh *neigh, uint32_t *_next_hop_id);
+                      uint32_t *next_hop_id,
+                      switch_interface::tunnel_endpoint_ops *setup);
+  int create_next_hop(rtnl_neigh *neigh, uint32_t *_next_hop_id,
+                      switch_interface::tunnel_endpoint_ops *setup);
   int delete_next_hop(rtnl_neigh *neigh);
   int delete_next_hop(uint32_t nh_id);
   int delete_next_hop(const struct tunnel_nh &);
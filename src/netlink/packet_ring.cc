@@ -0,0 +1,225 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include <glog/logging.h>
+
+#include "packet_ring.h"
+
+namespace basebox {
+
+// rx blocks are retired after 10ms at the latest, even if not full
+static constexpr unsigned rx_block_size = 1 << 20;
+static constexpr unsigned rx_block_nr = 8;
+static constexpr unsigned rx_frame_size = 2048;
+static constexpr unsigned rx_block_tov = 10;
+
+// tx slots are large enough for jumbo frames
+static constexpr unsigned tx_block_size = 1 << 18;
+static constexpr unsigned tx_block_nr = 8;
+static constexpr unsigned tx_frame_size = 16384;
+
+// offset of the frame data in a tx slot
+static constexpr size_t tx_data_off =
+    TPACKET3_HDRLEN - sizeof(struct sockaddr_ll);
+
+packet_ring::packet_ring(int ifindex)
+    : fd(-1), ifindex(ifindex), map(nullptr), map_len(0), rx_block(0),
+      tx_frame(0), tx_pending(false) {
+  memset(&rx_req, 0, sizeof(rx_req));
+  rx_req.tp_block_size = rx_block_size;
+  rx_req.tp_block_nr = rx_block_nr;
+  rx_req.tp_frame_size = rx_frame_size;
+  rx_req.tp_frame_nr = rx_block_size / rx_frame_size * rx_block_nr;
+  rx_req.tp_retire_blk_tov = rx_block_tov;
+
+  memset(&tx_req, 0, sizeof(tx_req));
+  tx_req.tp_block_size = tx_block_size;
+  tx_req.tp_block_nr = tx_block_nr;
+  tx_req.tp_frame_size = tx_frame_size;
+  tx_req.tp_frame_nr = tx_block_size / tx_frame_size * tx_block_nr;
+}
+
+packet_ring::~packet_ring() { close(); }
+
+int packet_ring::open() {
+  int version = TPACKET_V3;
+  int one = 1;
+  int rv;
+
+  if (fd >= 0) {
+    VLOG(1) << __FUNCTION__ << ": ring is already open using fd=" << fd;
+    return 0;
+  }
+
+  // protocol is set on bind to not receive frames of other interfaces
+  fd = socket(AF_PACKET, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    rv = -errno;
+    LOG(ERROR) << __FUNCTION__ << ": failed to open AF_PACKET socket errno="
+               << errno;
+    return rv;
+  }
+
+  if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) <
+          0 ||
+      setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &rx_req, sizeof(rx_req)) <
+          0 ||
+      setsockopt(fd, SOL_PACKET, PACKET_TX_RING, &tx_req, sizeof(tx_req)) <
+          0) {
+    rv = -errno;
+    LOG(ERROR) << __FUNCTION__ << ": failed to set up TPACKET_V3 rings errno="
+               << errno;
+    close();
+    return rv;
+  }
+
+  // frames sent using the tx ring must not show up in the rx ring, not
+  // available on older kernels, those are filtered in rx
+  setsockopt(fd, SOL_PACKET, PACKET_IGNORE_OUTGOING, &one, sizeof(one));
+  setsockopt(fd, SOL_PACKET, PACKET_QDISC_BYPASS, &one, sizeof(one));
+
+  map_len = rx_req.tp_block_size * rx_req.tp_block_nr +
+            tx_req.tp_block_size * tx_req.tp_block_nr;
+  void *m = mmap(nullptr, map_len, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, fd, 0);
+  if (m == MAP_FAILED) {
+    rv = -errno;
+    LOG(ERROR) << __FUNCTION__ << ": failed to map rings errno=" << errno;
+    map_len = 0;
+    close();
+    return rv;
+  }
+  map = static_cast<uint8_t *>(m);
+
+  struct sockaddr_ll sll;
+  memset(&sll, 0, sizeof(sll));
+  sll.sll_family = AF_PACKET;
+  sll.sll_protocol = htons(ETH_P_ALL);
+  sll.sll_ifindex = ifindex;
+
+  if (bind(fd, reinterpret_cast<struct sockaddr *>(&sll), sizeof(sll)) < 0) {
+    rv = -errno;
+    LOG(ERROR) << __FUNCTION__ << ": failed to bind to ifindex=" << ifindex
+               << " errno=" << errno;
+    close();
+    return rv;
+  }
+
+  VLOG(1) << __FUNCTION__ << ": opened ring on ifindex=" << ifindex
+          << " fd=" << fd << " size=" << map_len;
+
+  return 0;
+}
+
+void packet_ring::close() {
+  if (map) {
+    munmap(map, map_len);
+    map = nullptr;
+    map_len = 0;
+  }
+
+  if (fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  }
+
+  rx_block = 0;
+  tx_frame = 0;
+  tx_pending = false;
+}
+
+unsigned packet_ring::rx(
+    const std::function<void(const char *data, size_t len)> &cb) {
+  unsigned cnt = 0;
+
+  if (map == nullptr)
+    return 0;
+
+  for (;;) {
+    auto *bd = reinterpret_cast<struct tpacket_block_desc *>(
+        map + rx_block * rx_req.tp_block_size);
+
+    if (!(__atomic_load_n(&bd->hdr.bh1.block_status, __ATOMIC_ACQUIRE) &
+          TP_STATUS_USER))
+      break;
+
+    auto *hdr = reinterpret_cast<struct tpacket3_hdr *>(
+        reinterpret_cast<uint8_t *>(bd) + bd->hdr.bh1.offset_to_first_pkt);
+
+    for (unsigned i = 0; i < bd->hdr.bh1.num_pkts; i++) {
+      auto *sll = reinterpret_cast<struct sockaddr_ll *>(
+          reinterpret_cast<uint8_t *>(hdr) +
+          TPACKET_ALIGN(sizeof(struct tpacket3_hdr)));
+
+      if (sll->sll_pkttype != PACKET_OUTGOING) {
+        cb(reinterpret_cast<const char *>(hdr) + hdr->tp_mac, hdr->tp_snaplen);
+        cnt++;
+      }
+
+      hdr = reinterpret_cast<struct tpacket3_hdr *>(
+          reinterpret_cast<uint8_t *>(hdr) + hdr->tp_next_offset);
+    }
+
+    // hand the block back to the kernel
+    __atomic_store_n(&bd->hdr.bh1.block_status, TP_STATUS_KERNEL,
+                     __ATOMIC_RELEASE);
+    rx_block = (rx_block + 1) % rx_req.tp_block_nr;
+  }
+
+  return cnt;
+}
+
+int packet_ring::tx(const char *data, size_t len) {
+  if (map == nullptr)
+    return -ENOTCONN;
+
+  if (len > tx_req.tp_frame_size - tx_data_off)
+    return -EMSGSIZE;
+
+  uint8_t *tx_ring = map + rx_req.tp_block_size * rx_req.tp_block_nr;
+  auto *hdr = reinterpret_cast<struct tpacket3_hdr *>(
+      tx_ring + tx_frame * tx_req.tp_frame_size);
+
+  if (__atomic_load_n(&hdr->tp_status, __ATOMIC_ACQUIRE) !=
+      TP_STATUS_AVAILABLE)
+    return -ENOBUFS;
+
+  memcpy(reinterpret_cast<uint8_t *>(hdr) + tx_data_off, data, len);
+  hdr->tp_len = len;
+  hdr->tp_snaplen = len;
+  hdr->tp_next_offset = 0;
+  __atomic_store_n(&hdr->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+
+  tx_frame = (tx_frame + 1) % tx_req.tp_frame_nr;
+  tx_pending = true;
+
+  return 0;
+}
+
+int packet_ring::flush() {
+  if (!tx_pending)
+    return 0;
+
+  tx_pending = false;
+
+  if (sendto(fd, nullptr, 0, MSG_DONTWAIT, nullptr, 0) < 0 &&
+      errno != EAGAIN) {
+    int rv = -errno;
+    VLOG(1) << __FUNCTION__ << ": failed to send on fd=" << fd
+            << " errno=" << errno;
+    return rv;
+  }
+
+  return 0;
+}
+
+} // namespace basebox
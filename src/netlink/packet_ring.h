@@ -0,0 +1,77 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include <linux/if_packet.h>
+
+namespace basebox {
+
+/**
+ * AF_PACKET socket with TPACKET_V3 rx and tx rings mapped into userspace
+ *
+ * Received frames are handed out block by block straight from the ring,
+ * frames to send are copied into free tx slots and sent with a single
+ * syscall per flush.
+ */
+class packet_ring {
+public:
+  packet_ring(int ifindex);
+  ~packet_ring();
+
+  /**
+   * @brief open the socket, set up the rings and bind it to the interface
+   *
+   * @return 0 on success, negative errno otherwise
+   */
+  int open();
+  void close();
+
+  int get_fd() const { return fd; }
+  int get_ifindex() const { return ifindex; }
+
+  /**
+   * @brief process all blocks released by the kernel
+   *
+   * @param cb called for every received frame, data is valid during the call
+   * @return number of frames processed
+   */
+  unsigned rx(const std::function<void(const char *data, size_t len)> &cb);
+
+  /**
+   * @brief copy a frame into the next free tx slot
+   *
+   * @return 0 on success, -ENOBUFS if the ring is full, -EMSGSIZE if the frame
+   * does not fit into a slot
+   */
+  int tx(const char *data, size_t len);
+
+  /**
+   * @brief let the kernel send all frames queued using tx
+   *
+   * @return 0 on success, negative errno otherwise
+   */
+  int flush();
+
+private:
+  packet_ring(const packet_ring &other) = delete; // non construction-copyable
+  packet_ring &operator=(const packet_ring &) = delete; // non copyable
+
+  int fd;
+  int ifindex;
+
+  struct tpacket_req3 rx_req;
+  struct tpacket_req3 tx_req;
+  uint8_t *map;
+  size_t map_len;
+
+  unsigned rx_block; // next block to check
+  unsigned tx_frame; // next tx slot to use
+  bool tx_pending;
+};
+
+} // namespace basebox
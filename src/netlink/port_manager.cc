@@ -0,0 +1,73 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+#include "port_manager.h"
+
+namespace basebox {
+
+void port_manager::publish_port_map() {
+  auto pm = std::make_shared<port_map>();
+  uint32_t max_port_id = 0;
+  int max_ifindex = 0;
+
+  for (const auto &p : id_to_hwaddr) {
+    if (p.first <= port_map::max_dense_port_id)
+      max_port_id = std::max(max_port_id, p.first);
+  }
+  for (const auto &p : id_to_ifindex) {
+    if (p.first <= port_map::max_dense_port_id)
+      max_port_id = std::max(max_port_id, p.first);
+  }
+  for (const auto &p : ifindex_to_id) {
+    if (p.first < port_map::max_dense_ifindex)
+      max_ifindex = std::max(max_ifindex, p.first);
+  }
+
+  if (!id_to_hwaddr.empty() || !id_to_ifindex.empty())
+    pm->ports.resize(max_port_id + 1);
+  if (!ifindex_to_id.empty())
+    pm->ifindexes.resize(max_ifindex + 1, 0);
+
+  auto entry = [&pm](uint32_t port_id) -> port_map::port_entry & {
+    if (port_id <= port_map::max_dense_port_id)
+      return pm->ports[port_id];
+    return pm->sparse_ports[port_id];
+  };
+
+  for (const auto &p : id_to_hwaddr) {
+    auto &e = entry(p.first);
+    e.valid = true;
+    e.hwaddr = p.second;
+  }
+  for (const auto &p : id_to_ifindex) {
+    auto &e = entry(p.first);
+    e.valid = true;
+    e.ifindex = p.second;
+  }
+  for (const auto &p : ifindex_to_id) {
+    if (p.first >= 0 && p.first < port_map::max_dense_ifindex)
+      pm->ifindexes[p.first] = p.second;
+    else
+      pm->sparse_ifindexes.emplace(p.first, p.second);
+  }
+  pm->names = port_names2id;
+
+  VLOG(3) << __FUNCTION__ << ": ports=" << pm->ports.size()
+          << " ifindexes=" << pm->ifindexes.size()
+          << " names=" << pm->names.size();
+
+  // snapshots replaced while a lookup was running are freed by a later
+  // publish, port changes are too rare for them to pile up
+  retired.push_back(std::move(current));
+  current = std::move(pm);
+  port_snapshot.store(current.get());
+
+  if (readers.load() == 0)
+    retired.clear();
+}
+
+} // namespace basebox
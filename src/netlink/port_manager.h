@@ -3,11 +3,13 @@
 
 #pragma once
 
+#include <atomic>
 #include <deque>
 #include <string>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <vector>
 
 #include "sai.h"
 #include <linux/ethtool.h>
@@ -21,6 +23,72 @@ namespace basebox {
 class cnetlink;
 class port_manager;
 
+/**
+ * immutable snapshot of the port mappings
+ *
+ * Port ids of physical ports and ifindexes are small, hence both are used as
+ * index into dense arrays up to a small bound, larger ones are looked up in
+ * maps. A new snapshot is built and published for every change, readers use
+ * whatever snapshot they loaded without locking.
+ */
+struct port_map {
+  struct port_entry {
+    bool valid = false;
+    int ifindex = 0;
+    rofl::caddress_ll hwaddr;
+  };
+
+  // bounds of the dense arrays, larger values are kept in the sparse maps.
+  // ifindexes grow with every interface created, so the array covers the
+  // ones allocated at boot only.
+  static constexpr uint32_t max_dense_port_id = 1023;
+  static constexpr int max_dense_ifindex = 4096;
+
+  std::vector<port_entry> ports; // indexed by port_id
+  std::vector<uint32_t> ifindexes; // port_id indexed by ifindex
+  std::map<uint32_t, port_entry> sparse_ports;
+  std::map<int, uint32_t> sparse_ifindexes;
+  std::map<std::string, uint32_t> names;
+
+  const port_entry *get_port(uint32_t port_id) const noexcept {
+    if (port_id < ports.size())
+      return ports[port_id].valid ? &ports[port_id] : nullptr;
+
+    auto it = sparse_ports.find(port_id);
+    return it != sparse_ports.end() ? &it->second : nullptr;
+  }
+
+  uint32_t get_port_id(int ifindex) const noexcept {
+    if (ifindex >= 0 && static_cast<size_t>(ifindex) < ifindexes.size())
+      return ifindexes[ifindex];
+
+    auto it = sparse_ifindexes.find(ifindex);
+    return it != sparse_ifindexes.end() ? it->second : 0;
+  }
+
+  int get_ifindex(uint32_t port_id) const noexcept {
+    const port_entry *p = get_port(port_id);
+    return p ? p->ifindex : 0;
+  }
+
+  const rofl::caddress_ll get_hwaddr(uint32_t port_id) const noexcept {
+    const port_entry *p = get_port(port_id);
+    return p ? p->hwaddr : rofl::caddress_ll();
+  }
+};
+
+struct port_queue_stats {
+  std::string name;
+  uint32_t queue;
+  uint32_t worker;
+  uint64_t rx_packets;
+  uint64_t rx_bytes;
+  uint64_t rx_dropped;
+  uint64_t tx_packets;
+  uint64_t tx_bytes;
+  uint64_t tx_dropped;
+};
+
 class switch_callback {
 public:
   virtual ~switch_callback() = default;
@@ -30,7 +98,9 @@ public:
 class port_manager {
 
 public:
-  port_manager(){};
+  port_manager()
+      : readers(0), current(std::make_shared<const port_map>()),
+        port_snapshot(current.get()){};
   virtual ~port_manager(){};
 
   virtual int create_portdev(uint32_t port_id, const std::string &port_name,
@@ -43,43 +113,32 @@ public:
   virtual int enqueue(uint32_t port_id, basebox::packet *pkt) = 0;
 
   std::map<std::string, uint32_t> get_registered_ports() const {
+    return get_port_map()->names;
+  }
+
+  // current snapshot of the port mappings, can be kept as long as needed
+  std::shared_ptr<const port_map> get_port_map() const {
     std::lock_guard<std::mutex> lock(tn_mutex);
-    return port_names2id;
+    return current;
   }
+
   void register_switch(switch_interface *swi) noexcept { this->swi = swi; }
 
   void unregister_switch(switch_interface *swi) noexcept {
     this->swi = nullptr;
   }
 
+  // lookups are lock free and can be done from any thread
   uint32_t get_port_id(int ifindex) const noexcept {
-    // XXX TODO add assert wrt threading
-    auto it = ifindex_to_id.find(ifindex);
-    if (it == ifindex_to_id.end()) {
-      return 0;
-    } else {
-      return it->second;
-    }
+    return snapshot_ref(*this)->get_port_id(ifindex);
   }
 
   int get_ifindex(uint32_t port_id) const noexcept {
-    // XXX TODO add assert wrt threading
-    auto it = id_to_ifindex.find(port_id);
-    if (it == id_to_ifindex.end()) {
-      return 0;
-    } else {
-      return it->second;
-    }
+    return snapshot_ref(*this)->get_ifindex(port_id);
   }
 
   const rofl::caddress_ll get_hwaddr(uint32_t port_id) const noexcept {
-    // XXX TODO add assert wrt threading
-    auto it = id_to_hwaddr.find(port_id);
-    if (it == id_to_hwaddr.end()) {
-      return nulladdr;
-    } else {
-      return it->second;
-    }
+    return snapshot_ref(*this)->get_hwaddr(port_id);
   }
 
   void clear() noexcept {
@@ -87,6 +146,7 @@ public:
     ifindex_to_id.clear();
     id_to_ifindex.clear();
     id_to_hwaddr.clear();
+    publish_port_map();
   }
 
   virtual int change_port_status(const std::string name, bool status) = 0;
@@ -99,6 +159,11 @@ public:
   virtual bool portdev_ready(rtnl_link *link) = 0;
   virtual int update_mtu(rtnl_link *link) = 0;
 
+  // access from gRPC, empty if the port devices have no software queues
+  virtual std::deque<port_queue_stats> get_queue_statistics() const {
+    return {};
+  }
+
 protected:
   port_manager(const port_manager &other) = delete; // non construction-copyable
   port_manager &operator=(const port_manager &) = delete; // non copyable
@@ -107,14 +172,50 @@ protected:
   mutable std::mutex tn_mutex; // tap names mutex
   std::map<std::string, uint32_t> port_names2id;
 
-  // only accessible from cnetlink
+  // written from cnetlink, locked by tn_mutex
   std::map<int, uint32_t> ifindex_to_id;
   std::map<uint32_t, int> id_to_ifindex;
   std::map<uint32_t, rofl::caddress_ll> id_to_hwaddr;
 
-  const rofl::caddress_ll nulladdr;
+  /**
+   * @brief publish the maps above as a new snapshot used by the lookups
+   *
+   * Has to be called with tn_mutex held after the maps were changed.
+   */
+  void publish_port_map();
 
   switch_interface *swi;
+
+private:
+  /**
+   * the current snapshot pinned for a lookup
+   *
+   * A reader announces itself in readers before loading port_snapshot, so
+   * the snapshots replaced before publish_port_map() sees no reader are
+   * unused and can be freed.
+   */
+  class snapshot_ref {
+  public:
+    explicit snapshot_ref(const port_manager &pm) noexcept : pm(pm) {
+      pm.readers.fetch_add(1);
+      map = pm.port_snapshot.load();
+    }
+    ~snapshot_ref() { pm.readers.fetch_sub(1); }
+
+    const port_map *operator->() const noexcept { return map; }
+
+  private:
+    const port_manager &pm;
+    const port_map *map;
+  };
+
+  mutable std::atomic<unsigned> readers;
+
+  // locked by tn_mutex, owning the published and the retired snapshots
+  std::shared_ptr<const port_map> current;
+  std::vector<std::shared_ptr<const port_map>> retired;
+
+  std::atomic<const port_map *> port_snapshot;
 };
 
 } // namespace basebox
@@ -0,0 +1,301 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <linux/if_ether.h>
+#include <netinet/in.h>
+
+#include "punt_queue.h"
+#include "utils/packet_pool.h"
+
+DECLARE_int32(punt_rate_control);
+DECLARE_int32(punt_rate_routing);
+DECLARE_int32(punt_rate_arp_nd);
+DECLARE_int32(punt_rate_other);
+
+namespace basebox {
+
+#ifndef ETH_P_LLDP
+#define ETH_P_LLDP 0x88CC
+#endif
+
+#define VLAN_HLEN 4
+
+static inline uint16_t get_be16(const uint8_t *p) {
+  return (uint16_t(p[0]) << 8) | p[1];
+}
+
+static bool is_routing_l4(uint8_t proto, const uint8_t *l4, std::size_t len) {
+  if (len < 4)
+    return false;
+
+  uint16_t sport = get_be16(l4);
+  uint16_t dport = get_be16(l4 + 2);
+
+  switch (proto) {
+  case IPPROTO_TCP:
+    // BGP
+    return sport == 179 || dport == 179;
+  case IPPROTO_UDP:
+    // BFD single hop, echo and multihop, RIP and RIPng
+    for (uint16_t port : {3784, 3785, 4784, 520, 521}) {
+      if (dport == port)
+        return true;
+    }
+    return false;
+  default:
+    return false;
+  }
+}
+
+static enum punt_class classify_ipv4(const uint8_t *ip, std::size_t len) {
+  if (len < 20)
+    return PUNT_CLASS_OTHER;
+
+  std::size_t hlen = (ip[0] & 0x0f) * 4;
+  uint16_t frag = get_be16(ip + 6) & 0x1fff;
+  uint8_t proto = ip[9];
+
+  switch (proto) {
+  case IPPROTO_IGMP:
+  case IPPROTO_PIM:
+  case 89:  // OSPF
+  case 112: // VRRP
+    return PUNT_CLASS_ROUTING;
+  case IPPROTO_TCP:
+  case IPPROTO_UDP:
+    if (frag == 0 && hlen >= 20 && len > hlen &&
+        is_routing_l4(proto, ip + hlen, len - hlen))
+      return PUNT_CLASS_ROUTING;
+    return PUNT_CLASS_OTHER;
+  default:
+    return PUNT_CLASS_OTHER;
+  }
+}
+
+static enum punt_class classify_ipv6(const uint8_t *ip, std::size_t len) {
+  if (len < 40)
+    return PUNT_CLASS_OTHER;
+
+  uint8_t nh = ip[6];
+  std::size_t off = 40;
+
+  // MLD is sent with a router alert in a hop-by-hop header
+  if (nh == IPPROTO_HOPOPTS) {
+    if (len < off + 8)
+      return PUNT_CLASS_OTHER;
+    nh = ip[off];
+    off += (ip[off + 1] + 1) * 8;
+  }
+
+  if (len <= off)
+    return PUNT_CLASS_OTHER;
+
+  switch (nh) {
+  case IPPROTO_ICMPV6:
+    switch (ip[off]) {
+    case 130: // MLD query
+    case 131: // MLDv1 report
+    case 132: // MLDv1 done
+    case 143: // MLDv2 report
+      return PUNT_CLASS_ROUTING;
+    case 133: // router solicitation
+    case 134: // router advertisement
+    case 135: // neighbor solicitation
+    case 136: // neighbor advertisement
+    case 137: // redirect
+      return PUNT_CLASS_ARP_ND;
+    default:
+      return PUNT_CLASS_OTHER;
+    }
+  case IPPROTO_PIM:
+  case 89:  // OSPFv3
+  case 112: // VRRP
+    return PUNT_CLASS_ROUTING;
+  case IPPROTO_TCP:
+  case IPPROTO_UDP:
+    if (is_routing_l4(nh, ip + off, len - off))
+      return PUNT_CLASS_ROUTING;
+    return PUNT_CLASS_OTHER;
+  default:
+    return PUNT_CLASS_OTHER;
+  }
+}
+
+enum punt_class punt_queue::classify(const packet *pkt) noexcept {
+  static const uint8_t ieee_reserved[] = {0x01, 0x80, 0xc2, 0x00, 0x00};
+  const uint8_t *data = reinterpret_cast<const uint8_t *>(pkt->data);
+  std::size_t len = pkt->len;
+
+  if (len < ETH_HLEN)
+    return PUNT_CLASS_OTHER;
+
+  // STP, slow protocols (LACP), 802.1X and LLDP use 01:80:c2:00:00:0x
+  if (memcmp(data, ieee_reserved, sizeof(ieee_reserved)) == 0 &&
+      data[5] <= 0x0f)
+    return PUNT_CLASS_CONTROL;
+
+  std::size_t off = 2 * ETH_ALEN;
+  uint16_t proto = get_be16(data + off);
+
+  while ((proto == ETH_P_8021Q || proto == ETH_P_8021AD) &&
+         len >= off + VLAN_HLEN + 2) {
+    off += VLAN_HLEN;
+    proto = get_be16(data + off);
+  }
+  off += 2;
+
+  switch (proto) {
+  case ETH_P_SLOW:
+  case ETH_P_LLDP:
+    return PUNT_CLASS_CONTROL;
+  case ETH_P_ARP:
+    return PUNT_CLASS_ARP_ND;
+  case ETH_P_IP:
+    return classify_ipv4(data + off, len - off);
+  case ETH_P_IPV6:
+    return classify_ipv6(data + off, len - off);
+  default:
+    return PUNT_CLASS_OTHER;
+  }
+}
+
+const char *punt_queue::class_name(enum punt_class cls) noexcept {
+  switch (cls) {
+  case PUNT_CLASS_CONTROL:
+    return "control";
+  case PUNT_CLASS_ROUTING:
+    return "routing";
+  case PUNT_CLASS_ARP_ND:
+    return "arp_nd";
+  case PUNT_CLASS_OTHER:
+    return "other";
+  default:
+    return "invalid";
+  }
+}
+
+bool punt_queue::token_bucket::take(
+    std::chrono::steady_clock::time_point now) {
+  if (rate == 0)
+    return true;
+
+  std::chrono::duration<double> elapsed = now - last;
+  last = now;
+  tokens = std::min<double>(burst, tokens + elapsed.count() * rate);
+
+  if (tokens < 1)
+    return false;
+
+  tokens -= 1;
+  return true;
+}
+
+punt_queue::punt_queue() : queued(0) {
+  set_rate(PUNT_CLASS_CONTROL, FLAGS_punt_rate_control, 0);
+  set_rate(PUNT_CLASS_ROUTING, FLAGS_punt_rate_routing, 0);
+  set_rate(PUNT_CLASS_ARP_ND, FLAGS_punt_rate_arp_nd, 0);
+  set_rate(PUNT_CLASS_OTHER, FLAGS_punt_rate_other, 0);
+}
+
+punt_queue::~punt_queue() { clear(); }
+
+void punt_queue::set_rate(enum punt_class cls, uint32_t rate, uint32_t burst) {
+  assert(cls < PUNT_CLASS_MAX);
+
+  // allow bursts of 100ms by default
+  if (burst == 0)
+    burst = std::max<uint32_t>(rate / 10, 32);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  token_bucket &tb = classes[cls].tb;
+  tb.rate = rate;
+  tb.burst = burst;
+  tb.tokens = burst;
+  tb.last = std::chrono::steady_clock::now();
+
+  VLOG(1) << __FUNCTION__ << ": class=" << class_name(cls) << " rate=" << rate
+          << " burst=" << burst;
+}
+
+int punt_queue::push(uint32_t port_id, packet *pkt) {
+  enum punt_class cls = classify(pkt);
+  auto now = std::chrono::steady_clock::now();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    punt_class_queue &c = classes[cls];
+
+    if (not c.tb.take(now)) {
+      c.policed++;
+    } else if (c.q.size() >= max_queue_len) {
+      c.overflow++;
+    } else {
+      c.packets++;
+      c.bytes += pkt->len;
+      c.q.emplace_back(port_id, pkt);
+      queued++;
+      return 0;
+    }
+  }
+
+  VLOG(3) << __FUNCTION__ << ": dropped " << class_name(cls)
+          << " frame from port_id=" << port_id;
+  packet_put(pkt);
+  return -ENOBUFS;
+}
+
+std::size_t punt_queue::pop(std::deque<entry> &out, std::size_t max) {
+  std::size_t cnt = 0;
+  std::lock_guard<std::mutex> lock(mutex);
+
+  for (auto &c : classes) {
+    while (cnt < max && not c.q.empty()) {
+      out.push_back(c.q.front());
+      c.q.pop_front();
+      cnt++;
+    }
+  }
+  queued -= cnt;
+
+  return cnt;
+}
+
+std::size_t punt_queue::size() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return queued;
+}
+
+void punt_queue::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  for (auto &c : classes) {
+    for (auto &e : c.q)
+      packet_put(e.pkt);
+    c.q.clear();
+  }
+  queued = 0;
+}
+
+std::deque<punt_class_stats> punt_queue::get_statistics() const {
+  std::deque<punt_class_stats> stats;
+  std::lock_guard<std::mutex> lock(mutex);
+
+  for (int i = 0; i < PUNT_CLASS_MAX; i++) {
+    const punt_class_queue &c = classes[i];
+
+    stats.push_back({class_name(static_cast<enum punt_class>(i)), c.tb.rate,
+                     c.q.size(), c.packets, c.bytes, c.policed, c.overflow});
+  }
+
+  return stats;
+}
+
+} // namespace basebox
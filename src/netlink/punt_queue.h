@@ -0,0 +1,103 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+
+#include "sai.h"
+
+namespace basebox {
+
+// priority classes of punted frames, lower value is served first
+enum punt_class {
+  PUNT_CLASS_CONTROL, // LACP, LLDP, STP
+  PUNT_CLASS_ROUTING, // BGP, BFD, OSPF, VRRP, PIM, IGMP/MLD
+  PUNT_CLASS_ARP_ND,  // ARP and IPv6 neighbor discovery
+  PUNT_CLASS_OTHER,
+  PUNT_CLASS_MAX,
+};
+
+struct punt_class_stats {
+  std::string name;
+  uint32_t rate;
+  uint64_t queued;
+  uint64_t packets;
+  uint64_t bytes;
+  uint64_t policed;
+  uint64_t overflow;
+};
+
+/**
+ * Queue of frames punted to the CPU
+ *
+ * Frames are sorted into priority classes on arrival. Each class is policed
+ * by a token bucket and has its own bounded FIFO, frames are dequeued in
+ * strict priority order. Thus a storm in a lower class cannot delay protocol
+ * frames of a higher class.
+ */
+class punt_queue final {
+public:
+  struct entry {
+    entry(uint32_t port_id, packet *pkt) : port_id(port_id), pkt(pkt) {}
+    uint32_t port_id;
+    packet *pkt;
+  };
+
+  punt_queue();
+  ~punt_queue();
+
+  static enum punt_class classify(const packet *pkt) noexcept;
+  static const char *class_name(enum punt_class cls) noexcept;
+
+  /**
+   * @brief queue a frame, ownership of pkt is always taken
+   *
+   * @return 0 on success, -ENOBUFS if the frame was dropped
+   */
+  int push(uint32_t port_id, packet *pkt);
+
+  // dequeue up to max frames, highest priority first
+  std::size_t pop(std::deque<entry> &out, std::size_t max);
+
+  std::size_t size() const;
+  void clear();
+
+  // rate in packets per second, 0 = unlimited
+  void set_rate(enum punt_class cls, uint32_t rate, uint32_t burst);
+
+  std::deque<punt_class_stats> get_statistics() const;
+
+private:
+  punt_queue(const punt_queue &other) = delete; // non construction-copyable
+  punt_queue &operator=(const punt_queue &) = delete; // non copyable
+
+  struct token_bucket {
+    uint32_t rate = 0;
+    uint32_t burst = 0;
+    double tokens = 0;
+    std::chrono::steady_clock::time_point last;
+
+    bool take(std::chrono::steady_clock::time_point now);
+  };
+
+  struct punt_class_queue {
+    std::deque<entry> q;
+    token_bucket tb;
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    uint64_t policed = 0;
+    uint64_t overflow = 0;
+  };
+
+  static constexpr std::size_t max_queue_len = 4096;
+
+  mutable std::mutex mutex;
+  punt_class_queue classes[PUNT_CLASS_MAX];
+  std::size_t queued;
+};
+
+} // namespace basebox
@@ -1,38 +1,63 @@
 // SPDX-FileCopyrightText: © 2018 BISDN GmbH
 // SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
 
+#include <algorithm>
 #include <cerrno>
 #include <glog/logging.h>
-#include <sys/resource.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/uio.h>
 
 #include "tap_io.h"
+#include "utils/packet_pool.h"
+#include "utils/punt_stats.h"
+#include "utils/trace_ring.h"
+#include "vnet_hdr.h"
 
 namespace basebox {
 
-static inline void release_packets(std::deque<std::pair<int, packet *>> &q) {
-  for (auto i : q) {
-    std::free(i.second);
-  }
-}
+tap_io::tap_io(unsigned id, int cpu)
+    : tap_io_engine(id, cpu), thread(1),
+      tap_fds(std::make_shared<const std::vector<int>>()) {
+  thread.start("tap_io/" + std::to_string(id));
 
-tap_io::tap_io() : thread(1) {
-  struct rlimit limit;
-  int rv = getrlimit(RLIMIT_NOFILE, &limit);
+  // pinning has to be done from within the thread
+  if (!pinned)
+    thread.wakeup(this);
+};
 
-  if (rv == -1) {
-    LOG(FATAL) << __FUNCTION__
-               << ": could not retrive RLIMIT_NOFILE errno=" << errno;
-  }
+tap_io::~tap_io() { thread.stop(); }
 
-  VLOG(2) << __FUNCTION__ << ": RLIMIT_NOFILE soft=" << limit.rlim_cur
-          << " hard=" << limit.rlim_max;
+void tap_io_engine::pin_thread() {
+  cpu_set_t cpuset;
 
-  sw_cbs.resize(limit.rlim_max);
+  pinned = true;
 
-  thread.start("tap_io");
-};
+  CPU_ZERO(&cpuset);
+  CPU_SET(cpu, &cpuset);
 
-tap_io::~tap_io() { thread.stop(); }
+  int rv = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+  if (rv != 0) {
+    LOG(ERROR) << __FUNCTION__ << ": failed to pin worker " << id
+               << " to cpu=" << cpu << " rv=" << rv;
+    return;
+  }
+
+  VLOG(1) << __FUNCTION__ << ": pinned worker " << id << " to cpu=" << cpu;
+}
+
+void tap_io::release_packets(std::deque<std::pair<int, packet *>> &q,
+                             int err) {
+  for (auto i : q) {
+    auto it = sw_cbs.find(i.first);
+    if (it != sw_cbs.end()) {
+      if (it->second.stats)
+        it->second.stats->tx_dropped++;
+      punt_drop(it->second.port_id, PUNT_HOP_TAP_TX, err);
+    }
+    packet_put(i.second);
+  }
+}
 
 void tap_io::register_tap(tap_io_details td) {
   {
@@ -56,79 +81,158 @@ void tap_io::unregister_tap(int fd) {
 
 void tap_io::enqueue(int fd, packet *pkt) {
   if (fd < 0) {
-    std::free(pkt);
+    packet_put(pkt);
     return;
   }
 
-  if (static_cast<size_t>(fd) < sw_cbs.capacity() && sw_cbs[fd].fd == fd) {
+  auto fds = std::atomic_load(&tap_fds);
+  if (not std::binary_search(fds->begin(), fds->end(), fd)) {
+    packet_put(pkt);
+    return;
+  }
+
+  {
     // store pkt in outgoing queue
     std::lock_guard<std::mutex> guard(pout_queue_mutex);
     pout_queue.emplace_back(std::make_pair(fd, pkt));
-  } else {
-    std::free(pkt);
-    return;
   }
 
   thread.wakeup(this);
 }
 
 void tap_io::update_mtu(int fd, unsigned mtu) {
-  if (fd < 0 || static_cast<size_t>(fd) > sw_cbs.size()) {
+  if (fd < 0) {
     LOG(ERROR) << __FUNCTION__ << ": invalid fd=" << fd;
     return;
   }
 
   VLOG(4) << __FUNCTION__ << ": of fd=" << fd << ", mtu=" << mtu;
 
-  sw_cbs[fd].mtu = mtu;
+  {
+    std::lock_guard<std::mutex> guard(events_mutex);
+    tap_io_details td;
+    td.fd = fd;
+    td.mtu = mtu;
+    events.emplace_back(std::make_pair(TAP_IO_MTU, td));
+  }
+
+  thread.wakeup(this);
 }
 
 void tap_io::handle_read_event(rofl::cthread &thread, int fd) {
   VLOG(3) << __FUNCTION__ << ": thread=" << thread << ", fd=" << fd;
+  trace_scope trace("tap_io::rx", fd);
 
-  tap_io_details *td;
-
-  try {
-    td = &sw_cbs.at(fd);
-  } catch (std::exception &e) {
+  auto it = sw_cbs.find(fd);
+  if (it == sw_cbs.end()) {
     LOG(ERROR) << __FUNCTION__ << ": failed to read from fd=" << fd;
     return;
   }
 
-  size_t len = sizeof(std::size_t) + 22 + td->mtu;
+  tap_io_details *td = &it->second;
+
+  if (td->vnet_hdr) {
+    read_vnet_hdr(fd, td);
+    return;
+  }
+
+  size_t len = 22 + td->mtu;
 
   VLOG(4) << __FUNCTION__ << ": read on fd=" << fd << ", max_len=" << len;
 
-  auto *pkt = (packet *)std::malloc(len);
+  packet *pkt = packet_alloc(len);
 
   if (pkt == nullptr) {
     LOG(ERROR) << __FUNCTION__ << ": no mem left";
     return;
   }
 
-  pkt->len = read(fd, pkt->data, len - sizeof(pkt->len));
+  pkt->len = read(fd, pkt->data, len);
 
   if (pkt->len > 0) {
     VLOG(3) << __FUNCTION__ << ": read " << pkt->len << " bytes from fd=" << fd
             << " into pkt=" << pkt << " tid=" << pthread_self();
+    if (td->stats) {
+      td->stats->rx_packets++;
+      td->stats->rx_bytes += pkt->len;
+    }
+    punt_count(td->port_id, PUNT_HOP_TAP_RX, pkt);
     assert(td->cb);
     td->cb->enqueue_to_switch(td->port_id, pkt);
   } else {
+    if (td->stats)
+      td->stats->rx_dropped++;
+    punt_drop(td->port_id, PUNT_HOP_TAP_RX, errno);
     // error occured (or non-blocking)
     switch (errno) {
     case EAGAIN:
       LOG(ERROR) << __FUNCTION__
                  << ": EAGAIN XXX not implemented packet is dropped";
-      std::free(pkt);
+      packet_put(pkt);
       break;
     default:
       LOG(ERROR) << __FUNCTION__ << ": unknown error occured";
-      std::free(pkt);
+      packet_put(pkt);
       break;
     }
   }
 }
 
+void tap_io::read_vnet_hdr(int fd, tap_io_details *td) {
+  if (rx_buf.empty())
+    rx_buf.resize(vnet_hdr_max_frame);
+
+  ssize_t len = read(fd, rx_buf.data(), rx_buf.size());
+
+  if (len <= 0) {
+    if (td->stats)
+      td->stats->rx_dropped++;
+    punt_drop(td->port_id, PUNT_HOP_TAP_RX, errno);
+    LOG(ERROR) << __FUNCTION__ << ": failed to read from fd=" << fd
+               << " errno=" << errno;
+    return;
+  }
+
+  std::deque<packet *> pkts;
+  int rv = vnet_hdr_to_packets(rx_buf.data(), len, pkts);
+
+  if (rv < 0) {
+    if (td->stats)
+      td->stats->rx_dropped++;
+    punt_drop(td->port_id, PUNT_HOP_TAP_RX, rv);
+    LOG(ERROR) << __FUNCTION__ << ": dropping frame of " << len
+               << " bytes from fd=" << fd << " rv=" << rv;
+    return;
+  }
+
+  VLOG(3) << __FUNCTION__ << ": read " << len << " bytes from fd=" << fd
+          << " as " << rv << " packets";
+
+  assert(td->cb);
+  for (auto pkt : pkts) {
+    if (td->stats) {
+      td->stats->rx_packets++;
+      td->stats->rx_bytes += pkt->len;
+    }
+    punt_count(td->port_id, PUNT_HOP_TAP_RX, pkt);
+    td->cb->enqueue_to_switch(td->port_id, pkt);
+  }
+}
+
+ssize_t tap_io::write_pkt(const tap_io_details &td, const packet *pkt) {
+  if (!td.vnet_hdr)
+    return write(td.fd, pkt->data, pkt->len);
+
+  // frames from the switch are complete, no offloads requested
+  static const struct vnet_hdr vh = {};
+  struct iovec iov[2] = {
+      {const_cast<vnet_hdr *>(&vh), vnet_hdr_len},
+      {const_cast<char *>(pkt->data), pkt->len},
+  };
+
+  return writev(td.fd, iov, 2);
+}
+
 void tap_io::handle_write_event(rofl::cthread &thread, int fd) {
   thread.drop_write_fd(fd);
   tx();
@@ -143,11 +247,23 @@ void tap_io::tx() {
     std::swap(out_queue, pout_queue);
   }
 
+  trace_scope trace("tap_io::tx", out_queue.size());
+
   while (not out_queue.empty()) {
 
     pkt = out_queue.front();
+
+    auto it = sw_cbs.find(pkt.first);
+    if (it == sw_cbs.end()) {
+      // tap was removed meanwhile
+      packet_put(pkt.second);
+      out_queue.pop_front();
+      continue;
+    }
+
+    tap_io_details &td = it->second;
     int rc = 0;
-    if ((rc = write(pkt.first, pkt.second->data, pkt.second->len)) < 0) {
+    if ((rc = write_pkt(td, pkt.second)) < 0) {
       switch (errno) {
       case EAGAIN:
         VLOG(1) << __FUNCTION__ << ": EAGAIN";
@@ -161,23 +277,30 @@ void tap_io::tx() {
       case EIO:
         // tap not enabled drop packet
         VLOG(1) << __FUNCTION__ << ": EIO";
-        release_packets(out_queue);
+        release_packets(out_queue, EIO);
         return;
       default:
         // will drop packets
-        release_packets(out_queue);
+        release_packets(out_queue, errno);
         LOG(ERROR) << __FUNCTION__ << ": unknown error occurred rc=" << rc
                    << " errno=" << errno << " '" << strerror(errno);
         return;
       }
     }
-    std::free(pkt.second);
+    if (td.stats) {
+      td.stats->tx_packets++;
+      td.stats->tx_bytes += pkt.second->len;
+    }
+    punt_count(td.port_id, PUNT_HOP_TAP_TX, pkt.second);
+    punt_latency(PUNT_LAT_PACKET_IN_TAP, pkt.second);
+    packet_put(pkt.second);
     out_queue.pop_front();
   }
 }
 
 void tap_io::handle_events() {
   std::lock_guard<std::mutex> guard(events_mutex);
+  bool changed = false;
 
   // register fds
   for (auto ev : events) {
@@ -186,19 +309,37 @@ void tap_io::handle_events() {
 
     case TAP_IO_ADD:
       sw_cbs[fd] = ev.second;
+      changed = true;
       VLOG(3) << __FUNCTION__ << ": register fd=" << fd
               << ", mtu=" << ev.second.mtu << ", port_id=" << ev.second.port_id;
       thread.add_read_fd(this, fd, true, false);
       break;
     case TAP_IO_REM:
       thread.drop_fd(fd, false);
-      sw_cbs[fd] = tap_io_details();
+      changed |= sw_cbs.erase(fd) > 0;
       break;
+    case TAP_IO_MTU: {
+      auto it = sw_cbs.find(fd);
+      if (it != sw_cbs.end())
+        it->second.mtu = ev.second.mtu;
+    } break;
     default:
       break;
     }
   }
   events.clear();
+
+  if (!changed)
+    return;
+
+  // publish the new set of fds, readers keep the old one as long as needed
+  auto fds = std::make_shared<std::vector<int>>();
+  fds->reserve(sw_cbs.size());
+  for (const auto &cb : sw_cbs)
+    fds->push_back(cb.first);
+  std::sort(fds->begin(), fds->end());
+
+  std::atomic_store(&tap_fds, std::shared_ptr<const std::vector<int>>(fds));
 }
 
 } // namespace basebox
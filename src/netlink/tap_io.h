@@ -1,56 +1,117 @@
 // SPDX-FileCopyrightText: © 2018 BISDN GmbH
 // SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
 
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
 #include <rofl/common/cthread.hpp>
 
 #include "tap_manager.h"
 
 namespace basebox {
 
-class tap_io : public rofl::cthread_env {
+// per queue counters, written by the owning tap_io thread only
+struct tap_queue_stats {
+  std::atomic<uint64_t> rx_packets{0};
+  std::atomic<uint64_t> rx_bytes{0};
+  std::atomic<uint64_t> rx_dropped{0};
+  std::atomic<uint64_t> tx_packets{0};
+  std::atomic<uint64_t> tx_bytes{0};
+  std::atomic<uint64_t> tx_dropped{0};
+};
+
+// interface of the tap packet I/O engines, a tap_manager owns a pool of them
+class tap_io_engine {
 public:
   struct tap_io_details {
-    tap_io_details() : fd(-1), port_id(0), cb(nullptr), mtu(1500) {}
-    tap_io_details(int fd, uint32_t port_id, switch_callback *cb, unsigned mtu)
-        : fd(fd), port_id(port_id), cb(cb), mtu(mtu) {}
+    tap_io_details()
+        : fd(-1), port_id(0), cb(nullptr), mtu(1500), vnet_hdr(false) {}
+    tap_io_details(int fd, uint32_t port_id, switch_callback *cb, unsigned mtu,
+                   std::shared_ptr<tap_queue_stats> stats = nullptr,
+                   bool vnet_hdr = false)
+        : fd(fd), port_id(port_id), cb(cb), mtu(mtu), stats(std::move(stats)),
+          vnet_hdr(vnet_hdr) {}
     int fd;
     uint32_t port_id;
     switch_callback *cb;
     unsigned mtu;
+    std::shared_ptr<tap_queue_stats> stats;
+    bool vnet_hdr; // frames are prefixed with a virtio_net_hdr
   };
 
-  tap_io();
-  virtual ~tap_io();
+  /**
+   * @param id worker id, used for naming the thread
+   * @param cpu cpu to pin the worker thread to, -1 to not pin it
+   */
+  tap_io_engine(unsigned id, int cpu) : id(id), cpu(cpu), pinned(cpu < 0) {}
+  virtual ~tap_io_engine() = default;
 
   // port_id should be removed at some point and be rather data
-  void register_tap(tap_io_details td);
-  void unregister_tap(int fd);
-  void enqueue(int fd, packet *pkt);
-  void update_mtu(int fd, unsigned mtu);
+  virtual void register_tap(tap_io_details td) = 0;
+  virtual void unregister_tap(int fd) = 0;
+  virtual void enqueue(int fd, packet *pkt) = 0;
+  virtual void update_mtu(int fd, unsigned mtu) = 0;
+
+protected:
+  unsigned id;
+  int cpu;
+  bool pinned;
+
+  // has to be called from within the worker thread
+  void pin_thread();
+};
+
+class tap_io : public tap_io_engine, public rofl::cthread_env {
+public:
+  tap_io(unsigned id = 0, int cpu = -1);
+  virtual ~tap_io();
+
+  void register_tap(tap_io_details td) override;
+  void unregister_tap(int fd) override;
+  void enqueue(int fd, packet *pkt) override;
+  void update_mtu(int fd, unsigned mtu) override;
 
 private:
   enum tap_io_event {
     TAP_IO_ADD,
     TAP_IO_REM,
+    TAP_IO_MTU,
   };
 
   rofl::cthread thread;
+
   std::deque<std::pair<int, packet *>> pout_queue;
   std::mutex pout_queue_mutex;
 
   std::deque<std::pair<enum tap_io_event, tap_io_details>> events;
   std::mutex events_mutex;
 
-  std::deque<std::pair<int, packet *>> pin_queue;
-  std::vector<tap_io_details> sw_cbs;
+  // only accessible from the worker thread
+  std::unordered_map<int, tap_io_details> sw_cbs;
+
+  // sorted fds of sw_cbs, republished by the worker on every change and
+  // read lock free by enqueue using std::atomic_load
+  std::shared_ptr<const std::vector<int>> tap_fds;
+
+  // receive buffer for super-frames of taps using IFF_VNET_HDR
+  std::vector<char> rx_buf;
 
   void tx();
+  void read_vnet_hdr(int fd, tap_io_details *td);
+  ssize_t write_pkt(const tap_io_details &td, const packet *pkt);
   void handle_events();
+  void release_packets(std::deque<std::pair<int, packet *>> &q, int err);
 
 protected:
   void handle_read_event(rofl::cthread &thread, int fd);
   void handle_write_event(rofl::cthread &thread, int fd);
   void handle_wakeup(__attribute__((unused)) rofl::cthread &thread) {
+    if (!pinned)
+      pin_thread();
     handle_events();
     tx();
   }
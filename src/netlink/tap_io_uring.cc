@@ -0,0 +1,437 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include <cerrno>
+#include <glog/logging.h>
+#include <sys/eventfd.h>
+
+#include "tap_io_uring.h"
+#include "utils/packet_pool.h"
+#include "utils/punt_stats.h"
+#include "utils/trace_ring.h"
+#include "vnet_hdr.h"
+
+namespace basebox {
+
+// user_data of the submissions, writes carry their tx_req pointer, reads and
+// cancels the registration of the tap
+enum uring_op {
+  URING_OP_TX = 0,
+  URING_OP_READ = 1,
+  URING_OP_CANCEL = 2,
+};
+
+static inline uint64_t uring_tag(enum uring_op op, uint64_t reg) {
+  return (reg << 2) | op;
+}
+
+tap_io_uring::tap_io_uring(unsigned id, int cpu, size_t buf_len)
+    : tap_io_engine(id, cpu), thread(1), buf_ring(nullptr), buf_len(buf_len),
+      buf_entries(buf_len > default_buf_len ? 128 : 512), bufs_returned(0),
+      event_fd(-1), multishot(true), next_reg(1) {
+  int rv = io_uring_queue_init(ring_entries, &ring, 0);
+
+  if (rv < 0) {
+    LOG(FATAL) << __FUNCTION__ << ": failed to setup io_uring rv=" << rv;
+  }
+
+  buf_ring = io_uring_setup_buf_ring(&ring, buf_entries, buf_group, 0, &rv);
+
+  if (buf_ring == nullptr) {
+    LOG(FATAL) << __FUNCTION__
+               << ": failed to setup provided buffer ring rv=" << rv;
+  }
+
+  bufs.resize(buf_len * buf_entries);
+  for (unsigned i = 0; i < buf_entries; i++)
+    return_buf(i);
+  io_uring_buf_ring_advance(buf_ring, bufs_returned);
+  bufs_returned = 0;
+
+  event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (event_fd < 0 || io_uring_register_eventfd(&ring, event_fd) < 0) {
+    LOG(FATAL) << __FUNCTION__
+               << ": failed to register eventfd errno=" << errno;
+  }
+
+  VLOG(1) << __FUNCTION__ << ": worker " << id << " using " << buf_entries
+          << " buffers of " << buf_len << " bytes";
+
+  thread.start("tap_uring/" + std::to_string(id));
+  thread.add_read_fd(this, event_fd, true, false);
+
+  // pinning has to be done from within the thread
+  if (!pinned)
+    thread.wakeup(this);
+}
+
+tap_io_uring::~tap_io_uring() {
+  thread.stop();
+
+  for (auto &p : pout_queue)
+    packet_put(p.second);
+
+  io_uring_free_buf_ring(&ring, buf_ring, buf_entries, buf_group);
+  io_uring_queue_exit(&ring);
+  close(event_fd);
+}
+
+void tap_io_uring::register_tap(tap_io_details td) {
+  {
+    std::lock_guard<std::mutex> guard(events_mutex);
+    events.emplace_back(std::make_pair(TAP_IO_ADD, td));
+  }
+
+  thread.wakeup(this);
+}
+
+void tap_io_uring::unregister_tap(int fd) {
+  {
+    std::lock_guard<std::mutex> guard(events_mutex);
+    tap_io_details td;
+    td.fd = fd;
+    events.emplace_back(std::make_pair(TAP_IO_REM, td));
+  }
+
+  thread.wakeup(this);
+}
+
+void tap_io_uring::enqueue(int fd, packet *pkt) {
+  if (fd < 0) {
+    packet_put(pkt);
+    return;
+  }
+
+  // unknown fds are dropped from within the worker thread
+  {
+    std::lock_guard<std::mutex> guard(pout_queue_mutex);
+    pout_queue.emplace_back(std::make_pair(fd, pkt));
+  }
+
+  thread.wakeup(this);
+}
+
+void tap_io_uring::update_mtu(int fd, unsigned mtu) {
+  if (fd < 0) {
+    LOG(ERROR) << __FUNCTION__ << ": invalid fd=" << fd;
+    return;
+  }
+
+  VLOG(4) << __FUNCTION__ << ": of fd=" << fd << ", mtu=" << mtu;
+
+  if (mtu + 22 > buf_len) {
+    LOG(WARNING) << __FUNCTION__ << ": mtu=" << mtu << " of fd=" << fd
+                 << " exceeds buffer size " << buf_len
+                 << ", frames will be truncated";
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(events_mutex);
+    tap_io_details td;
+    td.fd = fd;
+    td.mtu = mtu;
+    events.emplace_back(std::make_pair(TAP_IO_MTU, td));
+  }
+
+  thread.wakeup(this);
+}
+
+struct io_uring_sqe *tap_io_uring::get_sqe() {
+  struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+
+  if (sqe == nullptr) {
+    // submission queue is full, flush it
+    io_uring_submit(&ring);
+    sqe = io_uring_get_sqe(&ring);
+  }
+
+  if (sqe == nullptr)
+    LOG(ERROR) << __FUNCTION__ << ": submission queue full";
+
+  return sqe;
+}
+
+void tap_io_uring::arm_read(uint64_t reg, int fd) {
+  struct io_uring_sqe *sqe = get_sqe();
+
+  if (sqe == nullptr)
+    return;
+
+  if (multishot) {
+    io_uring_prep_read_multishot(sqe, fd, 0, 0, buf_group);
+  } else {
+    io_uring_prep_read(sqe, fd, nullptr, buf_len, 0);
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = buf_group;
+  }
+
+  io_uring_sqe_set_data64(sqe, uring_tag(URING_OP_READ, reg));
+}
+
+void tap_io_uring::return_buf(unsigned bid) {
+  io_uring_buf_ring_add(buf_ring, bufs.data() + bid * buf_len, buf_len, bid,
+                        io_uring_buf_ring_mask(buf_entries), bufs_returned++);
+}
+
+void tap_io_uring::handle_events() {
+  std::lock_guard<std::mutex> guard(events_mutex);
+
+  for (auto ev : events) {
+    int fd = ev.second.fd;
+    switch (ev.first) {
+
+    case TAP_IO_ADD: {
+      uint64_t reg = next_reg++;
+
+      taps[fd] = ev.second;
+      tap_regs[fd] = reg;
+      armed_regs[reg] = fd;
+      VLOG(3) << __FUNCTION__ << ": register fd=" << fd
+              << ", mtu=" << ev.second.mtu << ", port_id=" << ev.second.port_id;
+      arm_read(reg, fd);
+    } break;
+    case TAP_IO_REM: {
+      auto it = tap_regs.find(fd);
+      if (it == tap_regs.end())
+        break;
+
+      // completions still in flight for this registration are dropped, even
+      // if a new tap got the same fd meanwhile
+      uint64_t reg = it->second;
+      taps.erase(fd);
+      tap_regs.erase(it);
+      armed_regs.erase(reg);
+
+      // the fd might be closed already, hence cancel by user_data
+      struct io_uring_sqe *sqe = get_sqe();
+      if (sqe) {
+        io_uring_prep_cancel64(sqe, uring_tag(URING_OP_READ, reg), 0);
+        io_uring_sqe_set_data64(sqe, uring_tag(URING_OP_CANCEL, reg));
+      }
+    } break;
+    case TAP_IO_MTU: {
+      auto it = taps.find(fd);
+      if (it != taps.end())
+        it->second.mtu = ev.second.mtu;
+    } break;
+    default:
+      break;
+    }
+  }
+  events.clear();
+
+  io_uring_submit(&ring);
+}
+
+void tap_io_uring::handle_read_event(rofl::cthread &thread, int fd) {
+  VLOG(3) << __FUNCTION__ << ": thread=" << thread << ", fd=" << fd;
+
+  uint64_t cnt;
+  if (read(event_fd, &cnt, sizeof(cnt)) < 0 && errno != EAGAIN) {
+    LOG(ERROR) << __FUNCTION__ << ": failed to read eventfd errno=" << errno;
+  }
+
+  handle_completions();
+}
+
+void tap_io_uring::handle_completions() {
+  struct io_uring_cqe *cqes[64];
+  unsigned n;
+
+  while ((n = io_uring_peek_batch_cqe(&ring, cqes, 64)) > 0) {
+    std::deque<uint64_t> rearm;
+
+    for (unsigned i = 0; i < n; i++) {
+      struct io_uring_cqe *cqe = cqes[i];
+      uint64_t data = io_uring_cqe_get_data64(cqe);
+      uint64_t reg = data >> 2;
+
+      switch (data & 0x3) {
+      case URING_OP_TX:
+        handle_tx(cqe);
+        break;
+      case URING_OP_READ:
+        handle_read(cqe, reg);
+        if (!(cqe->flags & IORING_CQE_F_MORE) && cqe->res != -ECANCELED &&
+            armed_regs.find(reg) != armed_regs.end())
+          rearm.push_back(reg);
+        break;
+      case URING_OP_CANCEL:
+        VLOG(3) << __FUNCTION__ << ": cancelled read of registration " << reg
+                << " rv=" << cqe->res;
+        break;
+      default:
+        break;
+      }
+    }
+
+    io_uring_cq_advance(&ring, n);
+
+    // buffers have to be back in the ring before reads are rearmed
+    if (bufs_returned) {
+      io_uring_buf_ring_advance(buf_ring, bufs_returned);
+      bufs_returned = 0;
+    }
+
+    for (uint64_t reg : rearm) {
+      auto it = armed_regs.find(reg);
+      if (it != armed_regs.end())
+        arm_read(reg, it->second);
+    }
+  }
+
+  io_uring_submit(&ring);
+}
+
+void tap_io_uring::handle_read(struct io_uring_cqe *cqe, uint64_t reg) {
+  auto reg_it = armed_regs.find(reg);
+  int fd = reg_it != armed_regs.end() ? reg_it->second : -1;
+
+  trace_scope trace("tap_io_uring::rx", fd);
+
+  auto it = taps.find(fd);
+  tap_io_details *td = (it != taps.end()) ? &it->second : nullptr;
+
+  if (cqe->res < 0) {
+    switch (-cqe->res) {
+    case ECANCELED:
+      break;
+    case EINVAL:
+      if (multishot) {
+        LOG(WARNING) << __FUNCTION__
+                     << ": multishot reads not supported, falling back";
+        multishot = false;
+        break;
+      }
+      // fall through
+    default:
+      if (td && td->stats)
+        td->stats->rx_dropped++;
+      if (td)
+        punt_drop(td->port_id, PUNT_HOP_TAP_RX, cqe->res);
+      VLOG(1) << __FUNCTION__ << ": read on fd=" << fd
+              << " failed rv=" << cqe->res;
+      break;
+    }
+    return;
+  }
+
+  if (!(cqe->flags & IORING_CQE_F_BUFFER)) {
+    LOG(ERROR) << __FUNCTION__ << ": completion without buffer on fd=" << fd;
+    return;
+  }
+
+  unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+  const char *buf = bufs.data() + bid * buf_len;
+  size_t len = cqe->res;
+  std::deque<packet *> pkts;
+
+  if (td == nullptr) {
+    // tap was removed meanwhile
+    return_buf(bid);
+    return;
+  }
+
+  if (td->vnet_hdr) {
+    int rv = vnet_hdr_to_packets(buf, len, pkts);
+    if (rv < 0) {
+      LOG(ERROR) << __FUNCTION__ << ": dropping frame of " << len
+                 << " bytes from fd=" << fd << " rv=" << rv;
+    }
+  } else if (len > 0) {
+    packet *pkt = packet_copy(buf, len);
+    if (pkt) {
+      pkts.push_back(pkt);
+    } else {
+      LOG(ERROR) << __FUNCTION__ << ": no mem left";
+    }
+  }
+
+  return_buf(bid);
+
+  if (pkts.empty()) {
+    if (td->stats)
+      td->stats->rx_dropped++;
+    punt_drop(td->port_id, PUNT_HOP_TAP_RX, -ENOMEM);
+  }
+
+  assert(td->cb);
+  for (auto pkt : pkts) {
+    if (td->stats) {
+      td->stats->rx_packets++;
+      td->stats->rx_bytes += pkt->len;
+    }
+    punt_count(td->port_id, PUNT_HOP_TAP_RX, pkt);
+    td->cb->enqueue_to_switch(td->port_id, pkt);
+  }
+}
+
+void tap_io_uring::handle_tx(struct io_uring_cqe *cqe) {
+  auto *req = reinterpret_cast<tx_req *>(io_uring_cqe_get_data(cqe));
+  auto it = taps.find(req->fd);
+
+  if (it != taps.end()) {
+    auto &stats = it->second.stats;
+    uint32_t port_id = it->second.port_id;
+
+    if (cqe->res < 0) {
+      if (stats)
+        stats->tx_dropped++;
+      punt_drop(port_id, PUNT_HOP_TAP_TX, cqe->res);
+    } else {
+      if (stats) {
+        stats->tx_packets++;
+        stats->tx_bytes += req->pkt->len;
+      }
+      punt_count(port_id, PUNT_HOP_TAP_TX, req->pkt);
+      punt_latency(PUNT_LAT_PACKET_IN_TAP, req->pkt);
+    }
+  }
+
+  if (cqe->res < 0) {
+    VLOG(1) << __FUNCTION__ << ": write to fd=" << req->fd
+            << " failed rv=" << cqe->res;
+  }
+
+  packet_put(req->pkt);
+  delete req;
+}
+
+void tap_io_uring::tx() {
+  std::deque<std::pair<int, packet *>> out_queue;
+
+  {
+    std::lock_guard<std::mutex> guard(pout_queue_mutex);
+    std::swap(out_queue, pout_queue);
+  }
+
+  trace_scope trace("tap_io_uring::tx", out_queue.size());
+
+  // frames from the switch are complete, no offloads requested
+  static const struct vnet_hdr vh = {};
+
+  for (auto &p : out_queue) {
+    auto it = taps.find(p.first);
+    struct io_uring_sqe *sqe;
+
+    if (it == taps.end() || (sqe = get_sqe()) == nullptr) {
+      packet_put(p.second);
+      continue;
+    }
+
+    auto *req = new tx_req{p.first, p.second, {}};
+    unsigned iovcnt = 0;
+
+    if (it->second.vnet_hdr)
+      req->iov[iovcnt++] = {const_cast<vnet_hdr *>(&vh), vnet_hdr_len};
+    req->iov[iovcnt++] = {p.second->data, p.second->len};
+
+    io_uring_prep_writev(sqe, p.first, req->iov, iovcnt, 0);
+    io_uring_sqe_set_data(sqe, req);
+  }
+
+  if (!out_queue.empty())
+    io_uring_submit(&ring);
+}
+
+} // namespace basebox
@@ -0,0 +1,113 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#pragma once
+
+#include <map>
+
+#include <liburing.h>
+#include <sys/uio.h>
+
+#include "tap_io.h"
+
+namespace basebox {
+
+/**
+ * tap I/O engine using io_uring
+ *
+ * Every tap queue has a multishot read armed, picking its buffers from a
+ * ring of provided buffers shared by all taps of the worker. Packets to the
+ * taps are submitted as one batch per wakeup. Completions are signalled on an
+ * eventfd polled by the worker thread and reaped in batches.
+ *
+ * Reads are tagged with the registration of the tap instead of its fd, so
+ * completions of a removed tap are never taken for those of a new tap reusing
+ * the fd number.
+ *
+ * Writes use plain iovecs pointing into the packets, only the receive
+ * buffers are registered. Registering the transmit side would need a copy
+ * into fixed buffers, and there is no fixed variant of the writev needed to
+ * prepend the virtio_net_hdr.
+ */
+class tap_io_uring : public tap_io_engine, public rofl::cthread_env {
+public:
+  // large enough for jumbo frames
+  static constexpr size_t default_buf_len = 16384;
+
+  /**
+   * @param id worker id, used for naming the thread
+   * @param cpu cpu to pin the worker thread to, -1 to not pin it
+   * @param buf_len size of each receive buffer, must fit the largest frame
+   */
+  tap_io_uring(unsigned id = 0, int cpu = -1,
+               size_t buf_len = default_buf_len);
+  virtual ~tap_io_uring();
+
+  void register_tap(tap_io_details td) override;
+  void unregister_tap(int fd) override;
+  void enqueue(int fd, packet *pkt) override;
+  void update_mtu(int fd, unsigned mtu) override;
+
+private:
+  enum tap_io_event {
+    TAP_IO_ADD,
+    TAP_IO_REM,
+    TAP_IO_MTU,
+  };
+
+  // in flight write, freed on completion
+  struct tx_req {
+    int fd;
+    packet *pkt;
+    struct iovec iov[2];
+  };
+
+  static constexpr unsigned ring_entries = 1024;
+  static constexpr unsigned buf_group = 0;
+
+  rofl::cthread thread;
+
+  struct io_uring ring;
+  struct io_uring_buf_ring *buf_ring;
+  std::vector<char> bufs;
+  size_t buf_len;
+  unsigned buf_entries; // power of 2
+  unsigned bufs_returned;
+  int event_fd;
+  bool multishot;
+
+  std::deque<std::pair<int, packet *>> pout_queue;
+  std::mutex pout_queue_mutex;
+
+  std::deque<std::pair<enum tap_io_event, tap_io_details>> events;
+  std::mutex events_mutex;
+
+  std::map<int, tap_io_details> taps;
+  std::map<int, uint64_t> tap_regs;   // registration of the tap of an fd
+  std::map<uint64_t, int> armed_regs; // fd of a registration
+  uint64_t next_reg;
+
+  struct io_uring_sqe *get_sqe();
+  void arm_read(uint64_t reg, int fd);
+  void return_buf(unsigned bid);
+  void handle_events();
+  void handle_completions();
+  void handle_read(struct io_uring_cqe *cqe, uint64_t reg);
+  void handle_tx(struct io_uring_cqe *cqe);
+  void tx();
+
+protected:
+  void handle_read_event(rofl::cthread &thread, int fd);
+  void handle_write_event(__attribute__((unused)) rofl::cthread &thread,
+                          __attribute__((unused)) int fd) {}
+  void handle_wakeup(__attribute__((unused)) rofl::cthread &thread) {
+    if (!pinned)
+      pin_thread();
+    handle_events();
+    tx();
+  }
+  void handle_timeout(__attribute__((unused)) rofl::cthread &thread,
+                      __attribute__((unused)) uint32_t timer_id) {}
+};
+
+} // namespace basebox
@@ -1,11 +1,13 @@
 // SPDX-FileCopyrightText: © 2016 BISDN GmbH
 // SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <linux/if_tun.h>
 #include <net/if.h>
 #include <netlink/route/link.h>
 #include <sys/ioctl.h>
+#include <sstream>
 #include <utility>
 #include <linux/ethtool.h>
 #include <linux/sockios.h>
@@ -14,13 +16,65 @@
 #include "ctapdev.h"
 #include "tap_io.h"
 #include "tap_manager.h"
+#include "utils/packet_pool.h"
+#include "vnet_hdr.h"
+
+#ifdef HAVE_LIBURING
+#include "tap_io_uring.h"
+#endif
 
 #define ETHTOOL_LINK_MODE_MASK_MAX_KERNEL_NU32 (SCHAR_MAX)
 #define ETHTOOL_SPEED(speed) speed / 1000 // conversion to Mbit
 
+DECLARE_int32(tap_queues);
+DECLARE_int32(tap_io_threads);
+DECLARE_string(tap_io_cpus);
+DECLARE_bool(tap_vnet_hdr);
+DECLARE_string(tap_io_engine);
+
 namespace basebox {
 
-tap_manager::tap_manager() : io(new tap_io()) {}
+static std::vector<int> parse_cpu_list(const std::string &list) {
+  std::vector<int> cpus;
+  std::stringstream ss(list);
+  std::string cpu;
+
+  while (std::getline(ss, cpu, ',')) {
+    if (cpu.empty())
+      continue;
+
+    try {
+      cpus.push_back(std::stoi(cpu));
+    } catch (std::exception &e) {
+      LOG(ERROR) << __FUNCTION__ << ": ignoring invalid cpu '" << cpu << "'";
+    }
+  }
+
+  return cpus;
+}
+
+tap_manager::tap_manager()
+    : queues(FLAGS_tap_queues), vnet_hdr(FLAGS_tap_vnet_hdr), next_worker(0),
+      callback(nullptr) {
+  std::vector<int> cpus = parse_cpu_list(FLAGS_tap_io_cpus);
+
+  for (int i = 0; i < FLAGS_tap_io_threads; i++) {
+    int cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+#ifdef HAVE_LIBURING
+    if (FLAGS_tap_io_engine == "io_uring") {
+      size_t buf_len =
+          vnet_hdr ? vnet_hdr_max_frame : tap_io_uring::default_buf_len;
+      io.emplace_back(new tap_io_uring(i, cpu, buf_len));
+      continue;
+    }
+#endif
+    io.emplace_back(new tap_io(i, cpu));
+  }
+
+  LOG(INFO) << __FUNCTION__ << ": using " << io.size() << " "
+            << FLAGS_tap_io_engine << " tap_io workers with " << queues
+            << " queues per tap, vnet_hdr=" << vnet_hdr;
+}
 
 tap_manager::~tap_manager() {
   std::map<uint32_t, ctapdev *> ddevs;
@@ -54,9 +108,7 @@ int tap_manager::create_portdev(uint32_t port_id, const std::string &port_name,
     ctapdev *dev;
 
     try {
-      int fd = -1;
-
-      dev = new ctapdev(port_name, hwaddr);
+      dev = new ctapdev(port_name, hwaddr, queues, vnet_hdr);
       tap_devs.insert(std::make_pair(port_id, dev));
       {
         std::lock_guard<std::mutex> lock{tn_mutex};
@@ -71,20 +123,18 @@ int tap_manager::create_portdev(uint32_t port_id, const std::string &port_name,
         if (!rv2.second) {
           LOG(FATAL) << __FUNCTION__ << ": failed to insert hwaddr";
         }
+        publish_port_map();
 
         dev->tap_open();
-        fd = dev->get_fd();
-        tap_names2fds.emplace(std::make_pair(port_name, fd));
+        callback = &cb;
+        start_queues(port_id, port_name, dev);
       }
 
       LOG(INFO) << __FUNCTION__
                 << ": created device having the following details: port_id="
-                << port_id << " portname=" << port_name << " fd=" << fd
-                << " ptr=" << dev;
-
-      // start reading from port
-      tap_io::tap_io_details td(fd, port_id, &cb, 1500);
-      io->register_tap(td);
+                << port_id << " portname=" << port_name
+                << " fd=" << dev->get_fd()
+                << " queues=" << dev->get_fds().size() << " ptr=" << dev;
     } catch (std::exception &e) {
       LOG(ERROR) << __FUNCTION__ << ": failed to create tapdev " << port_name;
       r = -EINVAL;
@@ -122,51 +172,89 @@ int tap_manager::destroy_portdev(uint32_t port_id,
     port_names2id.erase(tap_names_it);
   }
 
-  auto tap_names2fd_it = tap_names2fds.find(port_name);
-
-  if (tap_names2fd_it != tap_names2fds.end()) {
-    tap_names2fds.erase(tap_names2fd_it);
-  }
+  stop_queues(port_id, port_name);
+  publish_port_map();
 
   // drop port from port mapping
   auto dev = it->second;
-  int fd = dev->get_fd();
   tap_devs.erase(it);
   delete dev;
 
-  io->unregister_tap(fd);
-
   return 0;
 }
 
+void tap_manager::start_queues(uint32_t port_id, const std::string &port_name,
+                               const ctapdev *dev) {
+  std::vector<tap_queue> tqs;
+
+  // consecutive queues go to different workers, also those of a port
+  for (int fd : dev->get_fds()) {
+    tqs.push_back(tap_queue{fd, next_worker++ % unsigned(io.size()),
+                            std::make_shared<tap_queue_stats>()});
+  }
+
+  for (const auto &q : tqs) {
+    tap_io::tap_io_details td(q.fd, port_id, callback, 1500, q.stats,
+                              vnet_hdr);
+    io[q.worker]->register_tap(td);
+  }
+
+  tap_names2queues[port_name] = tqs;
+  tap_queues[port_id] = std::move(tqs);
+}
+
+void tap_manager::stop_queues(uint32_t port_id, const std::string &port_name) {
+  auto it = tap_queues.find(port_id);
+
+  if (it != tap_queues.end()) {
+    for (const auto &q : it->second)
+      io[q.worker]->unregister_tap(q.fd);
+    tap_queues.erase(it);
+  }
+
+  tap_names2queues.erase(port_name);
+}
+
 int tap_manager::enqueue(uint32_t port_id, basebox::packet *pkt) {
-  int fd = get_fd(port_id);
-  if (fd < 0) {
-    std::free(pkt);
+  // dropped unless handed to a worker
+  packet_handle ref(pkt);
+
+  const tap_queue *q = get_queue(port_id, pkt);
+  if (q == nullptr)
     return 0;
-  }
 
-  VLOG(3) << __FUNCTION__ << ": send pkt " << pkt << " to tap on fd=" << fd;
+  VLOG(3) << __FUNCTION__ << ": send pkt " << pkt << " to tap on fd=" << q->fd;
 
   try {
-    io->enqueue(fd, pkt);
+    io[q->worker]->enqueue(q->fd, pkt);
+    ref.release();
   } catch (std::exception &e) {
     LOG(ERROR) << __FUNCTION__ << ": failed to enqueue packet " << pkt
-               << " to fd=" << fd;
-    std::free(pkt);
+               << " to fd=" << q->fd;
   }
   return 0;
 }
 
-int tap_manager::get_fd(uint32_t port_id) const noexcept {
+const tap_manager::tap_queue *
+tap_manager::get_queue(uint32_t port_id,
+                       const basebox::packet *pkt) const noexcept {
   // XXX TODO add assert wrt threading
-  auto it = tap_devs.find(port_id);
+  auto it = tap_queues.find(port_id);
 
-  if (it == tap_devs.end()) {
-    return -EINVAL;
+  if (it == tap_queues.end() || it->second.empty()) {
+    return nullptr;
   }
 
-  return it->second->get_fd();
+  const std::vector<tap_queue> &tqs = it->second;
+  if (tqs.size() <= 1 || pkt->len < 2 * ETH_ALEN)
+    return &tqs.front();
+
+  // keep frames between the same hosts on the same queue to retain ordering
+  uint32_t hash = 0;
+  for (int i = 0; i < 2 * ETH_ALEN; i++)
+    hash = hash * 31 + static_cast<uint8_t>(pkt->data[i]);
+
+  return &tqs[hash % tqs.size()];
 }
 
 bool tap_manager::portdev_ready(rtnl_link *link) {
@@ -226,6 +314,8 @@ bool tap_manager::portdev_ready(rtnl_link *link) {
                    << " id(new)=" << tn_it->second;
       rv1.first->second = tn_it->second;
     }
+
+    publish_port_map();
   }
 
   update_mtu(link);
@@ -237,17 +327,18 @@ int tap_manager::update_mtu(rtnl_link *link) {
   assert(link);
 
   std::lock_guard<std::mutex> lock{tn_mutex};
-  auto fd_it = tap_names2fds.find(std::string(rtnl_link_get_name(link)));
-  if (fd_it == tap_names2fds.end()) {
+  auto q_it = tap_names2queues.find(std::string(rtnl_link_get_name(link)));
+  if (q_it == tap_names2queues.end()) {
     LOG(ERROR) << __FUNCTION__ << ": tap_dev not found";
     return -EINVAL;
   }
 
-  if (fd_it->second == -1) {
+  if (q_it->second.empty()) {
     LOG(FATAL) << __FUNCTION__ << ": need to update fd";
   }
 
-  io->update_mtu(fd_it->second, rtnl_link_get_mtu(link));
+  for (const auto &q : q_it->second)
+    io[q.worker]->update_mtu(q.fd, rtnl_link_get_mtu(link));
   return 0;
 }
 
@@ -302,6 +393,7 @@ bool tap_manager::portdev_removed(rtnl_link *link) {
     id_to_ifindex.erase(id2ifi_it);
   if (pd_it != port_deleted.end())
     port_deleted.erase(pd_it);
+  publish_port_map();
 
   return true;
 }
@@ -315,21 +407,27 @@ int tap_manager::recreate_tapdev(int ifindex, const std::string &portname,
   ctapdev *dev;
 
   try {
-    dev = new ctapdev(portname, hwaddr);
+    dev = new ctapdev(portname, hwaddr, queues, vnet_hdr);
     auto id = ifindex_to_id.find(ifindex);
 
-    tap_devs.erase(id->second);
+    // the queues of the removed device are not read anymore
+    stop_queues(id->second, portname);
+    auto old = tap_devs.find(id->second);
+    if (old != tap_devs.end()) {
+      delete old->second;
+      tap_devs.erase(old);
+    }
 
     // create the port
     dev->tap_open();
     tap_devs.emplace(std::make_pair(id->second, dev));
+    start_queues(id->second, portname, dev);
 
     int fd = dev->get_fd();
 
     LOG(INFO) << __FUNCTION__ << ": port_id=" << ifindex
               << " portname=" << portname << " fd=" << fd << " ptr=" << dev;
 
-    tap_names2fds.emplace(std::make_pair(portname, fd));
     port_names2id.emplace(std::make_pair(portname, id->second));
 
   } catch (std::exception &e) {
@@ -352,22 +450,22 @@ int tap_manager::recreate_tapdev(int ifindex, const std::string &portname,
  */
 int tap_manager::change_port_status(const std::string name, bool status) {
   std::lock_guard<std::mutex> lock{tn_mutex};
-  auto fd_it = tap_names2fds.find(name);
+  auto q_it = tap_names2queues.find(name);
   int error;
   int carrier = status;
 
-  if (fd_it == tap_names2fds.end()) {
+  if (q_it == tap_names2queues.end()) {
     LOG(ERROR) << __FUNCTION__ << ": tap_dev not found";
     return -EINVAL;
   }
 
-  if (fd_it->second == -1) {
+  if (q_it->second.empty()) {
     LOG(FATAL) << __FUNCTION__ << ": need to update fd";
     return -EINVAL;
   }
 
-  // Set flags
-  error = ioctl(fd_it->second, TUNSETCARRIER, &carrier);
+  // Set flags, the carrier is shared by all queues
+  error = ioctl(q_it->second.front().fd, TUNSETCARRIER, &carrier);
   if (error) {
     LOG(ERROR) << __FUNCTION__ << ": ioctl failed with error code " << error;
   }
@@ -441,4 +539,26 @@ int tap_manager::set_port_speed(const std::string name, uint32_t speed,
 
 int tap_manager::set_offloaded(rtnl_link *link, bool offloaded) { return 0; }
 
+std::deque<port_queue_stats> tap_manager::get_queue_statistics() const {
+  std::deque<port_queue_stats> rv;
+  std::lock_guard<std::mutex> lock{tn_mutex};
+
+  for (const auto &port : tap_names2queues) {
+    for (size_t i = 0; i < port.second.size(); i++) {
+      const tap_queue_stats &qs = *port.second[i].stats;
+
+      rv.emplace_back(port_queue_stats{
+          port.first, static_cast<uint32_t>(i), port.second[i].worker,
+          qs.rx_packets.load(std::memory_order_relaxed),
+          qs.rx_bytes.load(std::memory_order_relaxed),
+          qs.rx_dropped.load(std::memory_order_relaxed),
+          qs.tx_packets.load(std::memory_order_relaxed),
+          qs.tx_bytes.load(std::memory_order_relaxed),
+          qs.tx_dropped.load(std::memory_order_relaxed)});
+    }
+  }
+
+  return rv;
+}
+
 } // namespace basebox
@@ -6,6 +6,7 @@
 #include <deque>
 #include <string>
 #include <map>
+#include <vector>
 #include <memory>
 #include <mutex>
 
@@ -20,8 +21,9 @@ struct rtnl_link;
 namespace basebox {
 
 class ctapdev;
-class tap_io;
+class tap_io_engine;
 class tap_manager;
+struct tap_queue_stats;
 
 class tap_manager final : public port_manager {
 
@@ -46,22 +48,43 @@ public:
   bool portdev_ready(rtnl_link *link);
   int update_mtu(rtnl_link *link);
 
+  std::deque<port_queue_stats> get_queue_statistics() const override;
+
 private:
   tap_manager(const tap_manager &other) = delete; // non construction-copyable
   tap_manager &operator=(const tap_manager &) = delete; // non copyable
 
-  std::map<std::string, int> tap_names2fds;
+  // a queue of a tap device and the tap_io worker serving it
+  struct tap_queue {
+    int fd;
+    unsigned worker;
+    std::shared_ptr<tap_queue_stats> stats;
+  };
+
+  std::map<std::string, std::vector<tap_queue>> tap_names2queues;
 
   // only accessible from southbound
   std::map<uint32_t, ctapdev *> tap_devs; // port id:tap_device
+  std::map<uint32_t, std::vector<tap_queue>> tap_queues; // by port id
   std::deque<uint32_t> port_deleted;
 
-  std::unique_ptr<tap_io> io;
+  unsigned queues; // queues per tap device
+  bool vnet_hdr;   // taps use IFF_VNET_HDR with offloads
+  std::vector<std::unique_ptr<tap_io_engine>> io;
+  unsigned next_worker;      // queues are assigned to the workers round robin
+  switch_callback *callback; // of the created ports
 
   int recreate_tapdev(int ifindex, const std::string &portname,
                       const rofl::caddress_ll &hwaddr);
 
-  int get_fd(uint32_t port_id) const noexcept;
+  // register the queues of a created device with the workers, called with
+  // tn_mutex held
+  void start_queues(uint32_t port_id, const std::string &port_name,
+                    const ctapdev *dev);
+  void stop_queues(uint32_t port_id, const std::string &port_name);
+
+  const tap_queue *get_queue(uint32_t port_id,
+                             const basebox::packet *pkt) const noexcept;
 };
 
 } // namespace basebox
@@ -0,0 +1,472 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include <glog/logging.h>
+#include <net/if.h>
+#include <netlink/route/link.h>
+#include <netlink/route/link/veth.h>
+
+#include <cassert>
+
+#include "packet_ring.h"
+#include "tap_io.h"
+#include "utils/packet_pool.h"
+#include "utils/punt_stats.h"
+#include "veth_manager.h"
+
+namespace basebox {
+
+veth_manager::veth_manager() : thread(1) {
+  int err;
+
+  sock = nl_socket_alloc();
+  if ((err = nl_connect(sock, NETLINK_ROUTE)) < 0)
+    LOG(FATAL) << __FUNCTION__
+               << ": Unable to connect netlink socket: " << nl_geterror(err);
+
+  thread.start("veth_io");
+}
+
+veth_manager::~veth_manager() {
+  thread.stop();
+
+  std::map<uint32_t, std::shared_ptr<veth_port>> dports;
+  dports.swap(ports);
+  for (auto &port : dports) {
+    delete_veth(port.second->name);
+  }
+
+  for (auto &p : pout_queue)
+    packet_put(p.second);
+
+  nl_socket_free(sock);
+}
+
+std::string veth_manager::peer_name(uint32_t port_id) {
+  return "bbpkt" + std::to_string(port_id);
+}
+
+int veth_manager::create_veth(const std::string &name, const std::string &peer,
+                              const rofl::caddress_ll &hwaddr) {
+  std::unique_ptr<rtnl_link, decltype(&rtnl_link_put)> link(
+      rtnl_link_veth_alloc(), rtnl_link_put);
+  std::unique_ptr<nl_addr, decltype(&nl_addr_put)> addr(
+      nl_addr_build(AF_LLC, hwaddr.somem(), hwaddr.memlen()), nl_addr_put);
+
+  if (!link || !addr)
+    return -ENOMEM;
+
+  rtnl_link_set_name(link.get(), name.c_str());
+  rtnl_link_set_addr(link.get(), addr.get());
+
+  // the peer is owned by the veth link
+  rtnl_link *peer_link = rtnl_link_veth_get_peer(link.get());
+  rtnl_link_set_name(peer_link, peer.c_str());
+  rtnl_link_put(peer_link);
+
+  std::lock_guard<std::mutex> lock{sock_mutex};
+  int err = rtnl_link_add(sock, link.get(), NLM_F_CREATE | NLM_F_EXCL);
+  if (err < 0) {
+    LOG(ERROR) << __FUNCTION__ << ": failed to create veth pair " << name
+               << "/" << peer << ": " << nl_geterror(err);
+    return -EINVAL;
+  }
+
+  rtnl_link *l = nullptr;
+  err = rtnl_link_get_kernel(sock, 0, peer.c_str(), &l);
+  if (err < 0) {
+    LOG(ERROR) << __FUNCTION__ << ": failed to get peer " << peer << ": "
+               << nl_geterror(err);
+    return -ENODEV;
+  }
+
+  int ifindex = rtnl_link_get_ifindex(l);
+  rtnl_link_put(l);
+
+  return ifindex;
+}
+
+int veth_manager::delete_veth(const std::string &name) {
+  std::unique_ptr<rtnl_link, decltype(&rtnl_link_put)> link(rtnl_link_alloc(),
+                                                            rtnl_link_put);
+
+  if (!link)
+    return -ENOMEM;
+
+  // removes the peer as well
+  rtnl_link_set_name(link.get(), name.c_str());
+
+  std::lock_guard<std::mutex> lock{sock_mutex};
+  int err = rtnl_link_delete(sock, link.get());
+  if (err < 0) {
+    LOG(ERROR) << __FUNCTION__ << ": failed to delete veth pair " << name
+               << ": " << nl_geterror(err);
+    return -EINVAL;
+  }
+
+  return 0;
+}
+
+int veth_manager::change_link(const std::string &name, rtnl_link *change) {
+  std::lock_guard<std::mutex> lock{sock_mutex};
+  rtnl_link *link = nullptr;
+
+  int err = rtnl_link_get_kernel(sock, 0, name.c_str(), &link);
+  if (err < 0) {
+    LOG(ERROR) << __FUNCTION__ << ": failed to get link " << name << ": "
+               << nl_geterror(err);
+    return -ENODEV;
+  }
+
+  err = rtnl_link_change(sock, link, change, 0);
+  rtnl_link_put(link);
+
+  if (err < 0) {
+    LOG(ERROR) << __FUNCTION__ << ": failed to change link " << name << ": "
+               << nl_geterror(err);
+    return -EINVAL;
+  }
+
+  return 0;
+}
+
+int veth_manager::create_portdev(uint32_t port_id, const std::string &port_name,
+                                 const rofl::caddress_ll &hwaddr,
+                                 switch_callback &cb) {
+  {
+    std::lock_guard<std::mutex> lock{tn_mutex};
+
+    if (ports.find(port_id) != ports.end() ||
+        port_names2id.find(port_name) != port_names2id.end()) {
+      VLOG(1) << __FUNCTION__ << ": " << port_name
+              << " with port_id=" << port_id << " already existing";
+      return 0;
+    }
+  }
+
+  auto port = std::make_shared<veth_port>();
+  port->port_id = port_id;
+  port->name = port_name;
+  port->peer_name = peer_name(port_id);
+  port->cb = &cb;
+  port->stats = std::make_shared<tap_queue_stats>();
+
+  int ifindex = create_veth(port->name, port->peer_name, hwaddr);
+  if (ifindex < 0)
+    return ifindex;
+
+  port->ring.reset(new packet_ring(ifindex));
+  int rv = port->ring->open();
+  if (rv < 0) {
+    LOG(ERROR) << __FUNCTION__ << ": failed to open packet ring on "
+               << port->peer_name;
+    delete_veth(port->name);
+    return rv;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock{tn_mutex};
+    port_names2id.emplace(std::make_pair(port_name, port_id));
+    id_to_hwaddr.emplace(std::make_pair(port_id, hwaddr));
+    peer_names.insert(port->peer_name);
+    ports.emplace(std::make_pair(port_id, port));
+    publish_port_map();
+  }
+
+  LOG(INFO) << __FUNCTION__
+            << ": created device having the following details: port_id="
+            << port_id << " portname=" << port_name
+            << " peer=" << port->peer_name << " fd=" << port->ring->get_fd();
+
+  {
+    std::lock_guard<std::mutex> guard(events_mutex);
+    events.emplace_back(std::make_pair(VETH_ADD, port));
+  }
+  thread.wakeup(this);
+
+  return 0;
+}
+
+int veth_manager::destroy_portdev(uint32_t port_id,
+                                  const std::string &port_name) {
+  std::shared_ptr<veth_port> port;
+
+  {
+    std::lock_guard<std::mutex> lock{tn_mutex};
+    auto it = ports.find(port_id);
+    if (it == ports.end()) {
+      LOG(WARNING) << __FUNCTION__ << ": called for invalid port_id="
+                   << port_id << " port_name=" << port_name;
+      return 0;
+    }
+
+    port = it->second;
+    ports.erase(it);
+    port_deleted.push_back(port_id);
+    id_to_hwaddr.erase(port_id);
+    port_names2id.erase(port_name);
+    publish_port_map();
+  }
+
+  // the ring is closed once the worker dropped it
+  {
+    std::lock_guard<std::mutex> guard(events_mutex);
+    events.emplace_back(std::make_pair(VETH_REM, port));
+  }
+  thread.wakeup(this);
+
+  delete_veth(port_name);
+
+  return 0;
+}
+
+int veth_manager::enqueue(uint32_t port_id, basebox::packet *pkt) {
+  {
+    std::lock_guard<std::mutex> guard(pout_queue_mutex);
+    pout_queue.emplace_back(std::make_pair(port_id, pkt));
+  }
+
+  thread.wakeup(this);
+  return 0;
+}
+
+bool veth_manager::portdev_ready(rtnl_link *link) {
+  assert(link);
+
+  // already registered?
+  int ifindex = rtnl_link_get_ifindex(link);
+  auto it = ifindex_to_id.find(ifindex);
+  if (it != ifindex_to_id.end()) {
+    LOG(ERROR) << __FUNCTION__ << ": already registered port "
+               << rtnl_link_get_name(link);
+    return false;
+  }
+
+  {
+    std::string name(rtnl_link_get_name(link));
+    std::lock_guard<std::mutex> lock{tn_mutex};
+    auto tn_it = port_names2id.find(name);
+    if (tn_it == port_names2id.end()) {
+      VLOG(2) << __FUNCTION__ << ": ignoring unexpected device " << name;
+      return false;
+    }
+
+    id_to_ifindex[tn_it->second] = ifindex;
+    ifindex_to_id[ifindex] = tn_it->second;
+    publish_port_map();
+  }
+
+  update_mtu(link);
+
+  return true;
+}
+
+int veth_manager::update_mtu(rtnl_link *link) {
+  assert(link);
+
+  std::string peer;
+  {
+    std::lock_guard<std::mutex> lock{tn_mutex};
+    auto tn_it = port_names2id.find(rtnl_link_get_name(link));
+    if (tn_it == port_names2id.end())
+      return -EINVAL;
+    peer = peer_name(tn_it->second);
+  }
+
+  // frames from the host have to fit through the peer
+  std::unique_ptr<rtnl_link, decltype(&rtnl_link_put)> change(
+      rtnl_link_alloc(), rtnl_link_put);
+  rtnl_link_set_mtu(change.get(), rtnl_link_get_mtu(link));
+
+  return change_link(peer, change.get());
+}
+
+bool veth_manager::portdev_removed(rtnl_link *link) {
+  assert(link);
+
+  int ifindex(rtnl_link_get_ifindex(link));
+  std::string portname(rtnl_link_get_name(link));
+  std::lock_guard<std::mutex> lock{tn_mutex};
+
+  // peers are not announced as ports
+  if (peer_names.erase(portname))
+    return true;
+
+  auto ifi2id_it = ifindex_to_id.find(ifindex);
+  if (ifi2id_it == ifindex_to_id.end()) {
+    VLOG(2) << __FUNCTION__
+            << ": ignore removal of device with ifindex=" << ifindex;
+    return false;
+  }
+
+  auto pd_it =
+      std::find(port_deleted.begin(), port_deleted.end(), ifi2id_it->second);
+  if (pd_it == port_deleted.end()) {
+    LOG(ERROR) << __FUNCTION__ << ": unexpected port removal of " << portname;
+  } else {
+    port_deleted.erase(pd_it);
+  }
+
+  id_to_ifindex.erase(ifi2id_it->second);
+  ifindex_to_id.erase(ifi2id_it);
+  publish_port_map();
+
+  return true;
+}
+
+/*
+ * set carrier of the port according to the open flow link state
+ *
+ * The carrier of a veth follows the admin state of its peer.
+ *
+ * @param name port name to be changed
+ * @param status interface status: true=up / false=down
+ * @return 0 on success
+ */
+int veth_manager::change_port_status(const std::string name, bool status) {
+  std::string peer;
+  {
+    std::lock_guard<std::mutex> lock{tn_mutex};
+    auto tn_it = port_names2id.find(name);
+    if (tn_it == port_names2id.end()) {
+      VLOG(1) << __FUNCTION__ << ": unknown port " << name;
+      return -EINVAL;
+    }
+    peer = peer_name(tn_it->second);
+  }
+
+  std::unique_ptr<rtnl_link, decltype(&rtnl_link_put)> change(
+      rtnl_link_alloc(), rtnl_link_put);
+  if (status)
+    rtnl_link_set_flags(change.get(), IFF_UP);
+  else
+    rtnl_link_unset_flags(change.get(), IFF_UP);
+
+  return change_link(peer, change.get());
+}
+
+int veth_manager::set_port_speed(const std::string name, uint32_t speed,
+                                 uint8_t duplex) {
+  // veth has no settable link speed
+  VLOG(2) << __FUNCTION__ << ": ignoring speed=" << speed
+          << " duplex=" << unsigned(duplex) << " of port " << name;
+  return -EOPNOTSUPP;
+}
+
+int veth_manager::set_offloaded(rtnl_link *link, bool offloaded) { return 0; }
+
+std::deque<port_queue_stats> veth_manager::get_queue_statistics() const {
+  std::deque<port_queue_stats> rv;
+  std::lock_guard<std::mutex> lock{tn_mutex};
+
+  for (const auto &port : ports) {
+    const tap_queue_stats &qs = *port.second->stats;
+
+    rv.emplace_back(port_queue_stats{
+        port.second->name, 0, 0, qs.rx_packets.load(std::memory_order_relaxed),
+        qs.rx_bytes.load(std::memory_order_relaxed),
+        qs.rx_dropped.load(std::memory_order_relaxed),
+        qs.tx_packets.load(std::memory_order_relaxed),
+        qs.tx_bytes.load(std::memory_order_relaxed),
+        qs.tx_dropped.load(std::memory_order_relaxed)});
+  }
+
+  return rv;
+}
+
+void veth_manager::handle_events() {
+  std::lock_guard<std::mutex> guard(events_mutex);
+
+  for (auto &ev : events) {
+    auto &port = ev.second;
+    int fd = port->ring->get_fd();
+
+    switch (ev.first) {
+    case VETH_ADD:
+      fd_ports[fd] = port;
+      id_ports[port->port_id] = port;
+      thread.add_read_fd(this, fd, true, false);
+      VLOG(3) << __FUNCTION__ << ": register fd=" << fd
+              << ", port_id=" << port->port_id;
+      break;
+    case VETH_REM:
+      thread.drop_fd(fd, false);
+      fd_ports.erase(fd);
+      id_ports.erase(port->port_id);
+      break;
+    default:
+      break;
+    }
+  }
+  events.clear();
+}
+
+void veth_manager::handle_read_event(rofl::cthread &thread, int fd) {
+  VLOG(3) << __FUNCTION__ << ": thread=" << thread << ", fd=" << fd;
+
+  auto it = fd_ports.find(fd);
+  if (it == fd_ports.end()) {
+    LOG(ERROR) << __FUNCTION__ << ": failed to read from fd=" << fd;
+    return;
+  }
+
+  auto &port = it->second;
+  port->ring->rx([&port](const char *data, size_t len) {
+    packet *pkt = packet_copy(data, len);
+
+    if (pkt == nullptr) {
+      port->stats->rx_dropped++;
+      punt_drop(port->port_id, PUNT_HOP_TAP_RX, -ENOMEM);
+      return;
+    }
+
+    port->stats->rx_packets++;
+    port->stats->rx_bytes += len;
+    punt_count(port->port_id, PUNT_HOP_TAP_RX, pkt);
+    port->cb->enqueue_to_switch(port->port_id, pkt);
+  });
+}
+
+void veth_manager::tx() {
+  std::deque<std::pair<uint32_t, packet *>> out_queue;
+  std::set<veth_port *> pending;
+
+  {
+    std::lock_guard<std::mutex> guard(pout_queue_mutex);
+    std::swap(out_queue, pout_queue);
+  }
+
+  for (auto &p : out_queue) {
+    auto it = id_ports.find(p.first);
+
+    if (it != id_ports.end()) {
+      auto &port = it->second;
+      int rv = port->ring->tx(p.second->data, p.second->len);
+
+      if (rv == -ENOBUFS) {
+        // ring is full, let the kernel catch up once
+        port->ring->flush();
+        rv = port->ring->tx(p.second->data, p.second->len);
+      }
+
+      if (rv == 0) {
+        port->stats->tx_packets++;
+        port->stats->tx_bytes += p.second->len;
+        punt_count(p.first, PUNT_HOP_TAP_TX, p.second);
+        punt_latency(PUNT_LAT_PACKET_IN_TAP, p.second);
+        pending.insert(port.get());
+      } else {
+        port->stats->tx_dropped++;
+        punt_drop(p.first, PUNT_HOP_TAP_TX, rv);
+      }
+    }
+
+    packet_put(p.second);
+  }
+
+  // one syscall per port for the whole batch
+  for (auto port : pending)
+    port->ring->flush();
+}
+
+} // namespace basebox
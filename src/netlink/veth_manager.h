@@ -0,0 +1,121 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#pragma once
+
+#include <deque>
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+
+#include <rofl/common/cthread.hpp>
+
+#include "port_manager.h"
+#include "sai.h"
+
+extern "C" {
+struct nl_sock;
+struct rtnl_link;
+}
+
+namespace basebox {
+
+class packet_ring;
+struct tap_queue_stats;
+
+/**
+ * port_manager using veth pairs
+ *
+ * The port side of each pair carries the port name and is used by the host,
+ * its peer is attached to an AF_PACKET socket with TPACKET_V3 rings serving
+ * the punt path. Carrier of the port follows the admin state of the peer.
+ */
+class veth_manager final : public port_manager, public rofl::cthread_env {
+
+public:
+  veth_manager();
+  ~veth_manager();
+
+  int create_portdev(uint32_t port_id, const std::string &port_name,
+                     const rofl::caddress_ll &hwaddr,
+                     switch_callback &callback);
+
+  int destroy_portdev(uint32_t port_id, const std::string &port_name);
+
+  int enqueue(uint32_t port_id, basebox::packet *pkt);
+
+  int change_port_status(const std::string name, bool status);
+  int set_port_speed(const std::string name, uint32_t speed, uint8_t duplex);
+  int set_offloaded(rtnl_link *link, bool offloaded);
+
+  // access from northbound (cnetlink)
+  bool portdev_removed(rtnl_link *link);
+  bool portdev_ready(rtnl_link *link);
+  int update_mtu(rtnl_link *link);
+
+  std::deque<port_queue_stats> get_queue_statistics() const override;
+
+private:
+  veth_manager(const veth_manager &other) = delete; // non construction-copyable
+  veth_manager &operator=(const veth_manager &) = delete; // non copyable
+
+  struct veth_port {
+    uint32_t port_id;
+    std::string name;
+    std::string peer_name;
+    switch_callback *cb;
+    std::unique_ptr<packet_ring> ring;
+    std::shared_ptr<tap_queue_stats> stats;
+  };
+
+  enum veth_event {
+    VETH_ADD,
+    VETH_REM,
+  };
+
+  rofl::cthread thread;
+
+  // netlink socket used to manage the veth pairs
+  struct nl_sock *sock;
+  std::mutex sock_mutex;
+
+  // locked using tn_mutex
+  std::map<uint32_t, std::shared_ptr<veth_port>> ports; // port id:port
+  std::set<std::string> peer_names;
+  std::deque<uint32_t> port_deleted;
+
+  std::deque<std::pair<uint32_t, packet *>> pout_queue;
+  std::mutex pout_queue_mutex;
+
+  std::deque<std::pair<enum veth_event, std::shared_ptr<veth_port>>> events;
+  std::mutex events_mutex;
+
+  // only accessible from the worker thread
+  std::map<int, std::shared_ptr<veth_port>> fd_ports;
+  std::map<uint32_t, std::shared_ptr<veth_port>> id_ports;
+
+  static std::string peer_name(uint32_t port_id);
+
+  int create_veth(const std::string &name, const std::string &peer,
+                  const rofl::caddress_ll &hwaddr);
+  int delete_veth(const std::string &name);
+  int change_link(const std::string &name, rtnl_link *change);
+
+  void handle_events();
+  void tx();
+
+protected:
+  void handle_read_event(rofl::cthread &thread, int fd);
+  void handle_write_event(__attribute__((unused)) rofl::cthread &thread,
+                          __attribute__((unused)) int fd) {}
+  void handle_wakeup(__attribute__((unused)) rofl::cthread &thread) {
+    handle_events();
+    tx();
+  }
+  void handle_timeout(__attribute__((unused)) rofl::cthread &thread,
+                      __attribute__((unused)) uint32_t timer_id) {}
+};
+
+} // namespace basebox
@@ -0,0 +1,209 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <netinet/ip.h>
+#include <netinet/ip6.h>
+#include <netinet/tcp.h>
+
+#ifndef TH_CWR
+#define TH_CWR 0x80
+#endif
+
+#include <glog/logging.h>
+
+#include "vnet_hdr.h"
+#include "utils/packet_pool.h"
+
+namespace basebox {
+
+// sum up data as a sequence of 16 bit words in network byte order
+static uint32_t csum_add(uint32_t sum, const void *data, std::size_t len) {
+  auto *p = static_cast<const uint8_t *>(data);
+
+  while (len > 1) {
+    sum += (p[0] << 8) | p[1];
+    p += 2;
+    len -= 2;
+  }
+
+  if (len)
+    sum += p[0] << 8;
+
+  return sum;
+}
+
+static uint16_t csum_fold(uint32_t sum) {
+  while (sum >> 16)
+    sum = (sum & 0xffff) + (sum >> 16);
+  return htons(~sum & 0xffff);
+}
+
+static packet *alloc_packet(std::size_t len) {
+  packet *pkt = packet_alloc(len);
+
+  if (pkt == nullptr)
+    LOG(ERROR) << __FUNCTION__ << ": no mem left";
+
+  return pkt;
+}
+
+// offset of the L3 header and its ethertype, skipping up to two vlan tags
+static int l3_offset(const char *frame, std::size_t len, uint16_t *proto) {
+  std::size_t off = 2 * ETH_ALEN;
+
+  for (int tags = 0; tags <= 2; tags++) {
+    if (off + 2 > len)
+      return -EINVAL;
+
+    uint16_t type;
+    memcpy(&type, frame + off, sizeof(type));
+    type = ntohs(type);
+    off += 2;
+
+    if (type != ETH_P_8021Q && type != ETH_P_8021AD) {
+      *proto = type;
+      return off;
+    }
+
+    off += 2; // tci
+  }
+
+  return -EINVAL;
+}
+
+static int segment_tcp(const char *frame, std::size_t len,
+                       const struct vnet_hdr &vh,
+                       std::deque<packet *> &pkts) {
+  uint16_t proto;
+  int l3off = l3_offset(frame, len, &proto);
+  std::size_t l4off = vh.csum_start;
+  std::size_t mss = vh.gso_size;
+
+  if (l3off < 0 || mss == 0 || l4off < static_cast<size_t>(l3off) ||
+      l4off + sizeof(struct tcphdr) > len)
+    return -EINVAL;
+
+  auto *th = reinterpret_cast<const struct tcphdr *>(frame + l4off);
+  std::size_t hdr_len = l4off + th->doff * 4;
+
+  if (th->doff < 5 || hdr_len > len)
+    return -EINVAL;
+
+  bool v4;
+  switch (vh.gso_type & ~VNET_HDR_GSO_ECN) {
+  case VNET_HDR_GSO_TCPV4:
+    if (proto != ETH_P_IP || l3off + sizeof(struct iphdr) > l4off)
+      return -EINVAL;
+    v4 = true;
+    break;
+  case VNET_HDR_GSO_TCPV6:
+    if (proto != ETH_P_IPV6 || l3off + sizeof(struct ip6_hdr) > l4off)
+      return -EINVAL;
+    v4 = false;
+    break;
+  default:
+    return -EOPNOTSUPP;
+  }
+
+  std::deque<packet *> segs;
+  std::size_t payload = len - hdr_len;
+  uint32_t seq = ntohl(th->seq);
+
+  for (std::size_t off = 0; off < payload || segs.empty(); off += mss) {
+    std::size_t seg_len = std::min(mss, payload - off);
+    bool last = off + seg_len >= payload;
+    packet *pkt = alloc_packet(hdr_len + seg_len);
+
+    if (pkt == nullptr) {
+      for (auto p : segs)
+        packet_put(p);
+      return -ENOMEM;
+    }
+
+    memcpy(pkt->data, frame, hdr_len);
+    memcpy(pkt->data + hdr_len, frame + hdr_len + off, seg_len);
+
+    char *l3 = pkt->data + l3off;
+    auto *tcp = reinterpret_cast<struct tcphdr *>(pkt->data + l4off);
+    std::size_t l4_len = hdr_len - l4off + seg_len;
+    uint32_t sum;
+
+    if (v4) {
+      auto *ip = reinterpret_cast<struct iphdr *>(l3);
+      ip->tot_len = htons(l4off - l3off + l4_len);
+      ip->id = htons(ntohs(ip->id) + segs.size());
+      ip->check = 0;
+      ip->check = csum_fold(csum_add(0, ip, ip->ihl * 4));
+      sum = csum_add(0, &ip->saddr, 2 * sizeof(ip->saddr));
+    } else {
+      auto *ip6 = reinterpret_cast<struct ip6_hdr *>(l3);
+      ip6->ip6_plen = htons(l4off - l3off - sizeof(*ip6) + l4_len);
+      sum = csum_add(0, &ip6->ip6_src, 2 * sizeof(ip6->ip6_src));
+    }
+
+    tcp->seq = htonl(seq + off);
+    if (!segs.empty())
+      tcp->th_flags &= ~TH_CWR;
+    if (!last)
+      tcp->th_flags &= ~(TH_FIN | TH_PUSH);
+
+    tcp->check = 0;
+    sum += IPPROTO_TCP + l4_len;
+    tcp->check = csum_fold(csum_add(sum, tcp, l4_len));
+
+    segs.push_back(pkt);
+  }
+
+  int rv = segs.size();
+  std::move(segs.begin(), segs.end(), std::back_inserter(pkts));
+  return rv;
+}
+
+int vnet_hdr_to_packets(const char *buf, std::size_t len,
+                        std::deque<packet *> &pkts) {
+  struct vnet_hdr vh;
+
+  if (len < vnet_hdr_len + ETH_HLEN)
+    return -EINVAL;
+
+  memcpy(&vh, buf, sizeof(vh));
+  buf += vnet_hdr_len;
+  len -= vnet_hdr_len;
+
+  if (vh.gso_type != VNET_HDR_GSO_NONE) {
+    if (!(vh.flags & VNET_HDR_F_NEEDS_CSUM))
+      return -EINVAL;
+    return segment_tcp(buf, len, vh, pkts);
+  }
+
+  packet *pkt = alloc_packet(len);
+  if (pkt == nullptr)
+    return -ENOMEM;
+
+  memcpy(pkt->data, buf, len);
+
+  if (vh.flags & VNET_HDR_F_NEEDS_CSUM) {
+    // the checksum field already holds the pseudo header sum
+    std::size_t start = vh.csum_start;
+    std::size_t field = start + vh.csum_offset;
+
+    if (field + sizeof(uint16_t) > len) {
+      packet_put(pkt);
+      return -EINVAL;
+    }
+
+    uint16_t csum = csum_fold(csum_add(0, pkt->data + start, len - start));
+    memcpy(pkt->data + field, &csum, sizeof(csum));
+  }
+
+  pkts.push_back(pkt);
+  return 1;
+}
+
+} // namespace basebox
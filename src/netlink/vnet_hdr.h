@@ -0,0 +1,58 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+#include "utils/utils.h"
+
+namespace basebox {
+
+// header prepended to every frame on tap interfaces with IFF_VNET_HDR, same
+// layout as struct virtio_net_hdr (linux/virtio_net.h is not valid C++)
+struct vnet_hdr {
+  uint8_t flags;
+  uint8_t gso_type;
+  uint16_t hdr_len;
+  uint16_t gso_size;
+  uint16_t csum_start;
+  uint16_t csum_offset;
+} __attribute__((packed));
+
+enum vnet_hdr_flags {
+  VNET_HDR_F_NEEDS_CSUM = 1,
+};
+
+enum vnet_hdr_gso_type {
+  VNET_HDR_GSO_NONE = 0,
+  VNET_HDR_GSO_TCPV4 = 1,
+  VNET_HDR_GSO_TCPV6 = 4,
+  VNET_HDR_GSO_ECN = 0x80,
+};
+
+constexpr std::size_t vnet_hdr_len = sizeof(struct vnet_hdr);
+
+// largest frame a tap with TSO enabled hands out: vlan tagged ethernet header
+// plus a full 64k IP packet
+constexpr std::size_t vnet_hdr_max_frame = vnet_hdr_len + 22 + 65535;
+
+/**
+ * @brief convert a frame read from a tap with IFF_VNET_HDR to wire frames
+ *
+ * Partial checksums are completed and TCP super-frames (TSO/GSO) are split
+ * into segments of at most gso_size bytes payload.
+ *
+ * @param buf frame including the leading virtio_net_hdr
+ * @param len length of buf
+ * @param pkts resulting packets are appended, the caller owns them
+ *
+ * @return number of packets appended or negative errno, nothing is appended
+ * on error
+ */
+int vnet_hdr_to_packets(const char *buf, std::size_t len,
+                        std::deque<packet *> &pkts);
+
+} // namespace basebox
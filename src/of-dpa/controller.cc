@@ -17,8 +17,12 @@
 #include "controller.h"
 #include "ofdpa_client.h"
 #include "ofdpa_datatypes.h"
+#include "utils/convergence_stats.h"
+#include "utils/packet_pool.h"
+#include "utils/punt_stats.h"
 #include "utils/utils.h"
 #include "utils/rofl-utils.h"
+#include "utils/trace_ring.h"
 
 DECLARE_bool(clear_switch_configuration);
 DECLARE_bool(use_knet);
@@ -95,10 +99,10 @@ void controller::handle_dpt_open(rofl::crofdpt &dpt) {
   if (FLAGS_clear_switch_configuration) {
     // first delete all flows, as they may reference groups
     dpt.flow_mod_reset();
-    dpt.send_barrier_request(rofl::cauxid(0));
+    send_barrier(dpt);
     // now we can delete all groups, which may reference logical ports
     dpt.group_mod_reset();
-    dpt.send_barrier_request(rofl::cauxid(0));
+    send_barrier(dpt);
 
     // now we can delete all tunnel ports, tenents and nexthops
     // LAG ports will be handled separately
@@ -120,7 +124,11 @@ void controller::handle_dpt_open(rofl::crofdpt &dpt) {
       rate = 1024;
   }
 
-  ofdpa->ofdpaRxRateSet(rate);
+  ofdpa->ofdpaRxRateSet(rate, [rate](ofdpa::OfdpaStatus::OfdpaStatusCode rv) {
+    if (rv != ofdpa::OfdpaStatus::OFDPA_E_NONE)
+      LOG(ERROR) << "failed to set rx rate limit of " << rate
+                 << " pps: rv=" << rv;
+  });
 
   dpt.send_features_request(rofl::cauxid(0), 1);
   dpt.send_desc_stats_request(rofl::cauxid(0), 0, 1);
@@ -138,6 +146,10 @@ void controller::handle_dpt_close(const rofl::cdptid &dptid) {
             << std::hex << dptid;
 
   connected = false;
+  {
+    std::lock_guard<std::mutex> lock(barrier_mutex);
+    barrier_marks.clear();
+  }
   std::deque<nbi::port_notification_data> ntfys;
   try {
     {
@@ -222,12 +234,37 @@ void controller::handle_barrier_reply(
     rofl::openflow::cofmsg_barrier_reply &msg) {
   VLOG(1) << __FUNCTION__ << ": dpt=" << dpt << ", auxid=" << auxid
           << ", xid=" << std::showbase << std::hex << (unsigned)msg.get_xid();
+
+  // barriers are answered in order
+  std::lock_guard<std::mutex> lock(barrier_mutex);
+  if (!barrier_marks.empty()) {
+    conv_barrier_done(barrier_marks.front());
+    barrier_marks.pop_front();
+  }
 }
 
 void controller::handle_barrier_reply_timeout(rofl::crofdpt &dpt,
                                               uint32_t xid) {
   VLOG(1) << __FUNCTION__ << ": dpt=" << dpt << ", xid=" << std::showbase
           << std::hex << (unsigned)xid;
+
+  std::lock_guard<std::mutex> lock(barrier_mutex);
+  if (!barrier_marks.empty())
+    barrier_marks.pop_front();
+}
+
+void controller::send_barrier(rofl::crofdpt &dpt, uint32_t *xid) {
+  trace_scope trace("controller::send_barrier");
+
+  conv_mark mark = conv_barrier_sent();
+
+  // keep the marks in the order the barriers were sent
+  std::lock_guard<std::mutex> lock(barrier_mutex);
+  if (xid)
+    dpt.send_barrier_request(rofl::cauxid(0), 1, xid);
+  else
+    dpt.send_barrier_request(rofl::cauxid(0));
+  barrier_marks.push_back(mark);
 }
 
 void controller::handle_desc_stats_reply(
@@ -317,13 +354,15 @@ void controller::handle_port_desc_stats_reply(
   using rofl::openflow::cofport;
 
   std::deque<struct nbi::port_notification_data> notifications;
+  ofdpa_client::batch lag_deletes(*ofdpa);
 
   for (auto i : msg.get_ports().keys()) {
     const cofport &port = msg.get_ports().get_port(i);
     uint32_t port_no = port.get_port_no();
 
     if (nbi::get_port_type(port_no) == nbi::port_type_lag) {
-      ofdpa->OfdpaTrunkDelete(port_no);
+      // independent of each other, so all stale LAGs are deleted at once
+      lag_deletes.add(&ofdpa_client::OfdpaTrunkDelete, port_no);
       continue;
     }
 
@@ -342,6 +381,9 @@ void controller::handle_port_desc_stats_reply(
         port.get_name(), status, speed, duplex});
   }
 
+  // LAG ids may be reused once the ports are announced
+  lag_deletes.commit();
+
   /* init 1:1 port mapping */
   try {
     nb->port_notification(notifications);
@@ -413,6 +455,79 @@ void controller::handle_port_stats_reply(
   stats_array = msg.get_port_stats_array();
 }
 
+void controller::request_bridging_stats() {
+  rofl::crofdpt &dpt = set_dpt(dptid, true);
+  const uint16_t stats_flags = 0;
+  const int timeout_in_secs = hit_poll_interval;
+  uint32_t xid = 0;
+  rofl::openflow::cofflow_stats_request request(
+      dpt.get_version(), rofl::openflow::cofmatch(dpt.get_version()),
+      OFDPA_FLOW_TABLE_ID_BRIDGING);
+
+  dpt.send_flow_stats_request(rofl::cauxid(0), stats_flags, request,
+                              timeout_in_secs, &xid);
+  VLOG(3) << __FUNCTION__ << " sent, xid=" << xid;
+}
+
+void controller::handle_flow_stats_reply(
+    rofl::crofdpt &dpt, const rofl::cauxid &auxid,
+    rofl::openflow::cofmsg_flow_stats_reply &msg) {
+  trace_scope trace("controller::handle_flow_stats_reply");
+
+  VLOG(2) << __FUNCTION__ << ": dpt=" << dpt << " on auxid=" << auxid;
+
+  std::deque<l2_addr> hits;
+  const auto &stats = msg.get_flow_stats_array();
+
+  for (auto id : stats.keys()) {
+    const auto &fs = stats.get_flow_stats(id);
+    rofl::caddress_ll mac;
+    uint16_t vid;
+    uint8_t addr[ETH_ALEN];
+
+    if (fs.get_table_id() != OFDPA_FLOW_TABLE_ID_BRIDGING)
+      continue;
+
+    try {
+      mac = fs.get_match().get_eth_dst();
+      vid = fs.get_match().get_vlan_vid() & 0xfff;
+    } catch (rofl::openflow::eOxmNotFound &e) {
+      continue;
+    }
+
+    // an entry is used if its counter moved since the last poll
+    mac.pack(addr, sizeof(addr));
+    uint64_t key = 0;
+    for (auto b : addr)
+      key = key << 8 | b;
+    key = key << 16 | vid;
+
+    uint64_t n = fs.get_packet_count();
+    auto it = bridging_packets.find(key);
+    if (n > 0 && (it == bridging_packets.end() || it->second != n))
+      hits.push_back(
+          l2_addr{static_cast<uint32_t>(fs.get_cookie() & 0xffffffff), vid,
+                  mac});
+
+    bridging_packets_next.emplace(key, n);
+  }
+
+  if (!hits.empty())
+    nb->fdb_hits(hits);
+
+  // a large table is replied in several segments, each compared to the
+  // previous poll
+  if (msg.get_stats_flags() & rofl::openflow13::OFPMPF_REPLY_MORE)
+    return;
+
+  // entries gone since the last poll are dropped
+  bridging_packets.swap(bridging_packets_next);
+  bridging_packets_next.clear();
+
+  VLOG(2) << __FUNCTION__ << ": " << bridging_packets.size()
+          << " bridging entries polled";
+}
+
 void controller::handle_timeout(rofl::cthread &thread, uint32_t timer_id) {
   try {
     switch (timer_id) {
@@ -423,6 +538,16 @@ void controller::handle_timeout(rofl::cthread &thread, uint32_t timer_id) {
       if (connected)
         request_port_stats();
       break;
+    case TIMER_bridging_stats_request: {
+      // stopped by setting the interval to 0
+      uint16_t interval = hit_poll_interval;
+      if (interval == 0)
+        break;
+      thread.add_timer(this, TIMER_bridging_stats_request,
+                       rofl::ctimespec().expire_in(interval));
+      if (connected)
+        request_bridging_stats();
+    } break;
     default:
       rofl::crofbase::handle_timeout(thread, timer_id);
       break;
@@ -449,17 +574,18 @@ void controller::send_packet_in_to_cpu(rofl::crofdpt &dpt,
     return;
   }
 
+  // the frame is owned by msg which is gone once we return, whereas the
+  // packet is processed asynchronously, hence copy it into a pooled buffer
   const rofl::cpacket &pkt_in = msg.get_packet();
-  pkt = (packet *)std::malloc(sizeof(std::size_t) + pkt_in.length());
+  pkt = packet_copy(pkt_in.soframe(), pkt_in.length());
 
   if (pkt == nullptr) {
     LOG(ERROR) << __FUNCTION__ << ": no mem left";
+    punt_drop(port_id, PUNT_HOP_PACKET_IN, -ENOMEM);
     return;
   }
 
-  pkt->len = pkt_in.length();
-  std::memcpy(pkt->data, pkt_in.soframe(), pkt_in.length());
-
+  punt_count(port_id, PUNT_HOP_PACKET_IN, pkt);
   nb->enqueue(port_id, pkt);
 }
 
@@ -487,11 +613,15 @@ void controller::handle_bridging_table_rm(
 }
 
 int controller::enqueue(uint32_t port_id, packet *pkt) noexcept {
+  trace_scope trace("controller::enqueue", port_id);
+
   using rofl::openflow::cofport;
   using std::map;
   int rv = 0;
 
   assert(pkt && "invalid enque");
+  // the packet is released on every exit, sent or not
+  packet_handle ref(pkt);
   auto *eth = (struct ethhdr *)pkt->data;
 
   try {
@@ -532,9 +662,13 @@ int controller::enqueue(uint32_t port_id, packet *pkt) noexcept {
           rofl::openflow::base::get_ofp_no_buffer(dpt.get_version()),
           rofl::openflow::base::get_ofpp_controller_port(dpt.get_version()),
           actions, (uint8_t *)pkt->data, pkt->len);
+
+      punt_count(port_id, PUNT_HOP_PACKET_OUT, pkt);
+      punt_latency(PUNT_LAT_TAP_PACKET_OUT, pkt);
     } else {
       LOG(ERROR) << __FUNCTION__ << ": packet sent to invalid port_id "
                  << std::showbase << std::hex << port_id;
+      rv = -EINVAL;
     }
   } catch (rofl::eRofDptNotFound &e) {
     LOG(ERROR) << __FUNCTION__
@@ -550,7 +684,8 @@ int controller::enqueue(uint32_t port_id, packet *pkt) noexcept {
 
 errout:
 
-  std::free(pkt);
+  if (rv < 0)
+    punt_drop(port_id, PUNT_HOP_PACKET_OUT, rv);
   return rv;
 }
 int controller::sai_learn_mode_to_flags(sai_bridge_port_fdb_learning_t mode,
@@ -606,6 +741,7 @@ int controller::port_set_learn(
   if (rv)
     return rv;
 
+  // synchronous, a later mode of the same port must not overtake this one
   return ofdpa->ofdpaPortSourceMacLearningSet(port_id, flags);
 }
 
@@ -621,6 +757,7 @@ int controller::port_set_move_learn(
   if (rv)
     return rv;
 
+  // synchronous, a later mode of the same port must not overtake this one
   return ofdpa->ofdpaPortSourceMacMoveLearningSet(port_id, flags);
 }
 
@@ -649,6 +786,7 @@ int controller::lag_create(uint32_t *lag_id, std::string name,
   *lag_id = nbi::combine_port_type(_lag_id, nbi::port_type_lag);
   _lag_id++;
 
+  // synchronous, the members added next need the trunk
   rv = ofdpa->OfdpaTrunkCreate(*lag_id, name, mode);
   return rv;
 }
@@ -664,10 +802,19 @@ int controller::lag_remove(uint32_t lag_id) noexcept {
                  << " entries in lag map were removed";
   }
 
-  return ofdpa->OfdpaTrunkDelete(lag_id);
+  // lag ids are never reused, so nothing depends on the completion
+  ofdpa->OfdpaTrunkDelete(
+      lag_id, [lag_id](ofdpa::OfdpaStatus::OfdpaStatusCode rv) {
+        if (rv != ofdpa::OfdpaStatus::OFDPA_E_NONE)
+          LOG(ERROR) << "lag_remove: failed to delete lag_id=" << std::showbase
+                     << std::hex << lag_id << std::dec << " rv=" << rv;
+      });
+
+  return 0;
 }
 
-int controller::lag_add_member(uint32_t lag_id, uint32_t port_id) noexcept {
+int controller::lag_add_member(uint32_t lag_id, uint32_t port_id,
+                               uint8_t active) noexcept {
   if (!connected) {
     VLOG(1) << __FUNCTION__ << ": not connected";
     return -EAGAIN;
@@ -689,7 +836,27 @@ int controller::lag_add_member(uint32_t lag_id, uint32_t port_id) noexcept {
 
   it->second.emplace(port_id);
 
-  rv = ofdpa->OfdpaPortTrunkGroupSet(port_id, lag_id);
+  // the port has to be in the trunk before its state can be set
+  ofdpa_client::batch b(*ofdpa);
+  b.add(&ofdpa_client::OfdpaPortTrunkGroupSet, port_id, lag_id);
+  b.barrier();
+  b.add(&ofdpa_client::OfdpaTrunkPortMemberActiveSet, port_id, lag_id,
+        active);
+
+  auto results = b.commit();
+  if (results[0] < 0) {
+    LOG(ERROR) << __FUNCTION__ << ": failed to add port_id=" << port_id
+               << " to lag_id=" << std::showbase << std::hex << lag_id
+               << std::dec << " err=" << results[0];
+    rv = results[0];
+  } else if (results[1] < 0) {
+    LOG(ERROR) << __FUNCTION__ << ": failed to set port_id=" << port_id
+               << " active=" << (unsigned)active << " in lag_id="
+               << std::showbase << std::hex << lag_id << std::dec
+               << " err=" << results[1];
+    rv = results[1];
+  }
+
   return rv;
 }
 
@@ -721,6 +888,7 @@ int controller::lag_remove_member(uint32_t lag_id, uint32_t port_id) noexcept {
     return -EINVAL;
   }
 
+  // synchronous, updates of the same port have to stay in order
   rv = ofdpa->OfdpaPortTrunkGroupSet(port_id, 0);
   return rv;
 }
@@ -743,6 +911,7 @@ int controller::lag_set_member_active(uint32_t lag_id, uint32_t port_id,
     return -EINVAL;
   }
 
+  // synchronous, updates of the same port have to stay in order
   rv = ofdpa->OfdpaTrunkPortMemberActiveSet(port_id, lag_id, active);
   return rv;
 }
@@ -754,6 +923,7 @@ int controller::lag_set_mode(uint32_t lag_id, uint8_t mode) noexcept {
   }
   int rv = 0;
 
+  // synchronous, updates of the same lag have to stay in order
   rv = ofdpa->ofdpaTrunkPortPSCSet(lag_id, mode);
   return rv;
 }
@@ -802,6 +972,26 @@ int controller::l2_set_idle_timeout(uint16_t idle_timeout) noexcept {
   return 0;
 };
 
+int controller::l2_hit_poll_interval(uint16_t interval) noexcept {
+  VLOG(1) << __FUNCTION__ << ": interval=" << interval;
+
+  bool start = hit_poll_interval.exchange(interval) == 0 && interval > 0;
+
+  // a timer still pending from before polling was stopped is rearmed with
+  // the new interval when it expires
+  if (start && !bb_thread.has_timer(this, TIMER_bridging_stats_request)) {
+    try {
+      bb_thread.add_timer(this, TIMER_bridging_stats_request,
+                          rofl::ctimespec().expire_in(interval));
+    } catch (std::exception &e) {
+      LOG(ERROR) << __FUNCTION__ << ": failed to start polling: " << e.what();
+      return -EINVAL;
+    }
+  }
+
+  return 0;
+}
+
 int controller::l2_addr_remove_all_in_vlan(uint32_t port,
                                            uint16_t vid) noexcept {
   int rv = 0;
@@ -827,6 +1017,8 @@ int controller::l2_addr_remove_all_in_vlan(uint32_t port,
 int controller::l2_addr_add(uint32_t port, uint16_t vid,
                             const rofl::caddress_ll &mac, bool filtered,
                             bool permanent, bool update) noexcept {
+  trace_scope trace("controller::l2_addr_add");
+
   int rv = 0;
   try {
     rofl::crofdpt &dpt = set_dpt(dptid, true);
@@ -839,7 +1031,7 @@ int controller::l2_addr_add(uint32_t port, uint16_t vid,
       dpt.send_flow_mod_message(rofl::cauxid(0),
                                 fm_driver.remove_bridging_unicast_vlan(
                                     dpt.get_version(), 0, vid, mac));
-      dpt.send_barrier_request(rofl::cauxid(0));
+      send_barrier(dpt);
     }
 
     // XXX have the knowlege here about filtered/unfiltered?
@@ -867,6 +1059,8 @@ int controller::l2_addr_add(uint32_t port, uint16_t vid,
 
 int controller::l2_addr_remove(uint32_t port, uint16_t vid,
                                const rofl::caddress_ll &mac) noexcept {
+  trace_scope trace("controller::l2_addr_remove");
+
   int rv = 0;
   try {
     rofl::crofdpt &dpt = set_dpt(dptid, true);
@@ -886,6 +1080,39 @@ int controller::l2_addr_remove(uint32_t port, uint16_t vid,
   return rv;
 }
 
+int controller::l2_addr_remove_bulk(
+    const std::deque<l2_addr> &addrs) noexcept {
+  trace_scope trace("controller::l2_addr_remove_bulk", addrs.size());
+
+  int rv = 0;
+
+  if (addrs.empty())
+    return 0;
+
+  try {
+    rofl::crofdpt &dpt = set_dpt(dptid, true);
+
+    for (const auto &a : addrs)
+      dpt.send_flow_mod_message(rofl::cauxid(0),
+                                fm_driver.remove_bridging_unicast_vlan(
+                                    dpt.get_version(), a.port, a.vid, a.mac));
+
+    // a single barrier for the whole batch
+    send_barrier(dpt);
+    VLOG(2) << __FUNCTION__ << ": removed " << addrs.size() << " entries";
+  } catch (rofl::eRofBaseNotFound &e) {
+    LOG(ERROR) << ": caught rofl::eRofBaseNotFound";
+    rv = -EINVAL;
+  } catch (rofl::eRofConnNotConnected &e) {
+    LOG(ERROR) << ": not connected msg=" << e.what();
+    rv = -ENOTCONN;
+  } catch (std::exception &e) {
+    LOG(ERROR) << ": caught unknown exception: " << e.what();
+    rv = -EINVAL;
+  }
+  return rv;
+}
+
 int controller::l2_overlay_addr_add(uint32_t lport, uint32_t tunnel_id,
                                     const rofl::cmacaddr &mac,
                                     bool permanent) noexcept {
@@ -923,7 +1150,7 @@ int controller::l2_overlay_addr_remove(uint32_t tunnel_id, uint32_t lport_id,
       dpt.send_flow_mod_message(
           rofl::cauxid(0), fm_driver.remove_bridging_unicast_overlay_all_lport(
                                dpt.get_version(), lport_id));
-      dpt.send_barrier_request(rofl::cauxid(0));
+      send_barrier(dpt);
     } else {
       dpt.send_flow_mod_message(rofl::cauxid(0),
                                 fm_driver.remove_bridging_unicast_overlay(
@@ -1051,13 +1278,13 @@ int controller::l2_multicast_group_leave(uint32_t port, uint16_t vid,
           fm_driver.enable_group_l2_multicast(dpt.get_version(), it->index, vid,
                                               it->l2_interface, true));
 
-      dpt.send_barrier_request(rofl::cauxid(0));
+      send_barrier(dpt);
     } else {
       dpt.send_flow_mod_message(rofl::cauxid(0),
                                 fm_driver.remove_bridging_multicast_vlan(
                                     dpt.get_version(), port, vid, mc_group));
 
-      dpt.send_barrier_request(rofl::cauxid(0));
+      send_barrier(dpt);
 
       dpt.send_group_mod_message(rofl::cauxid(0),
                                  fm_driver.disable_group_l2_multicast(
@@ -1119,6 +1346,8 @@ int controller::l2_multicast_group_leave_all_in_vlan(uint32_t port,
 
 int controller::l3_termination_add(uint32_t sport, uint16_t vid,
                                    const rofl::caddress_ll &dmac) noexcept {
+  trace_scope trace("controller::l3_termination_add");
+
   int rv = 0;
   try {
     rofl::crofdpt &dpt = set_dpt(dptid, true);
@@ -1132,7 +1361,7 @@ int controller::l3_termination_add(uint32_t sport, uint16_t vid,
                                          dpt.get_version(), sport, vid, dmac));
     }
 
-    dpt.send_barrier_request(rofl::cauxid(0));
+    send_barrier(dpt);
   } catch (rofl::eRofBaseNotFound &e) {
     LOG(ERROR) << ": caught rofl::eRofBaseNotFound";
     rv = -EINVAL;
@@ -1162,7 +1391,7 @@ int controller::l3_termination_add_v6(uint32_t sport, uint16_t vid,
                                          dpt.get_version(), sport, vid, dmac));
     }
 
-    dpt.send_barrier_request(rofl::cauxid(0));
+    send_barrier(dpt);
   } catch (rofl::eRofBaseNotFound &e) {
     LOG(ERROR) << ": caught rofl::eRofBaseNotFound";
     rv = -EINVAL;
@@ -1179,6 +1408,8 @@ int controller::l3_termination_add_v6(uint32_t sport, uint16_t vid,
 
 int controller::l3_termination_remove(uint32_t sport, uint16_t vid,
                                       const rofl::caddress_ll &dmac) noexcept {
+  trace_scope trace("controller::l3_termination_remove");
+
   int rv = 0;
   try {
     rofl::crofdpt &dpt = set_dpt(dptid, true);
@@ -1186,7 +1417,7 @@ int controller::l3_termination_remove(uint32_t sport, uint16_t vid,
                               fm_driver.disable_tmac_ipv4_unicast_mac(
                                   dpt.get_version(), sport, vid, dmac));
 
-    dpt.send_barrier_request(rofl::cauxid(0));
+    send_barrier(dpt);
   } catch (rofl::eRofBaseNotFound &e) {
     LOG(ERROR) << ": caught rofl::eRofBaseNotFound";
     rv = -EINVAL;
@@ -1210,7 +1441,7 @@ int controller::l3_termination_remove_v6(
                               fm_driver.disable_tmac_ipv6_unicast_mac(
                                   dpt.get_version(), sport, vid, dmac));
 
-    dpt.send_barrier_request(rofl::cauxid(0));
+    send_barrier(dpt);
   } catch (rofl::eRofBaseNotFound &e) {
     LOG(ERROR) << ": caught rofl::eRofBaseNotFound";
     rv = -EINVAL;
@@ -1229,6 +1460,8 @@ int controller::l3_egress_create(uint32_t port, uint16_t vid,
                                  const rofl::caddress_ll &src_mac,
                                  const rofl::caddress_ll &dst_mac,
                                  uint32_t *l3_interface_id) noexcept {
+  trace_scope trace("controller::l3_egress_create");
+
   int rv = 0;
   uint32_t _egress_interface_id;
   bool increment = false;
@@ -1276,6 +1509,8 @@ int controller::l3_egress_update(uint32_t port, uint16_t vid,
                                  const rofl::caddress_ll &src_mac,
                                  const rofl::caddress_ll &dst_mac,
                                  uint32_t *l3_interface_id) noexcept {
+  trace_scope trace("controller::l3_egress_update");
+
   int rv = 0;
 
   try {
@@ -1305,10 +1540,12 @@ int controller::l3_egress_update(uint32_t port, uint16_t vid,
 }
 
 int controller::l3_egress_remove(uint32_t l3_interface_id) noexcept {
+  trace_scope trace("controller::l3_egress_remove");
+
   int rv = 0;
   try {
     rofl::crofdpt &dpt = set_dpt(dptid, true);
-    dpt.send_barrier_request(rofl::cauxid(0));
+    send_barrier(dpt);
     dpt.send_group_mod_message(
         rofl::cauxid(0),
         fm_driver.disable_group_l3_unicast(dpt.get_version(), l3_interface_id));
@@ -1332,6 +1569,8 @@ int controller::l3_unicast_host_add(const rofl::caddress_in4 &ipv4_dst,
                                     uint32_t l3_interface_id, bool is_ecmp,
                                     bool update_route,
                                     uint16_t vrf_id) noexcept {
+  trace_scope trace("controller::l3_unicast_host_add");
+
   int rv = 0;
 
   if (l3_interface_id > 0x0fffffff)
@@ -1372,6 +1611,8 @@ int controller::l3_unicast_host_add(const rofl::caddress_in6 &ipv6_dst,
                                     uint32_t l3_interface_id, bool is_ecmp,
                                     bool update_route,
                                     uint16_t vrf_id) noexcept {
+  trace_scope trace("controller::l3_unicast_host_add_v6");
+
   int rv = 0;
 
   if (l3_interface_id > 0x0fffffff)
@@ -1410,6 +1651,8 @@ int controller::l3_unicast_host_add(const rofl::caddress_in6 &ipv6_dst,
 
 int controller::l3_unicast_host_remove(const rofl::caddress_in4 &ipv4_dst,
                                        uint16_t vrf_id) noexcept {
+  trace_scope trace("controller::l3_unicast_host_remove");
+
   int rv = 0;
 
   try {
@@ -1418,7 +1661,7 @@ int controller::l3_unicast_host_remove(const rofl::caddress_in4 &ipv4_dst,
     dpt.send_flow_mod_message(
         rofl::cauxid(0), fm_driver.disable_ipv4_unicast_host(dpt.get_version(),
                                                              ipv4_dst, vrf_id));
-    dpt.send_barrier_request(rofl::cauxid(0));
+    send_barrier(dpt);
   } catch (rofl::eRofBaseNotFound &e) {
     LOG(ERROR) << ": caught rofl::eRofBaseNotFound";
     rv = -EINVAL;
@@ -1435,6 +1678,8 @@ int controller::l3_unicast_host_remove(const rofl::caddress_in4 &ipv4_dst,
 
 int controller::l3_unicast_host_remove(const rofl::caddress_in6 &ipv6_dst,
                                        uint16_t vrf_id) noexcept {
+  trace_scope trace("controller::l3_unicast_host_remove_v6");
+
   int rv = 0;
 
   try {
@@ -1443,7 +1688,7 @@ int controller::l3_unicast_host_remove(const rofl::caddress_in6 &ipv6_dst,
     dpt.send_flow_mod_message(
         rofl::cauxid(0),
         fm_driver.disable_ipv6_unicast_host(dpt.get_version(), ipv6_dst));
-    dpt.send_barrier_request(rofl::cauxid(0));
+    send_barrier(dpt);
   } catch (rofl::eRofBaseNotFound &e) {
     LOG(ERROR) << ": caught rofl::eRofBaseNotFound";
     rv = -EINVAL;
@@ -1463,6 +1708,8 @@ int controller::l3_unicast_route_add(const rofl::caddress_in4 &ipv4_dst,
                                      uint32_t l3_interface_id, bool is_ecmp,
                                      bool update_route,
                                      uint16_t vrf_id) noexcept {
+  trace_scope trace("controller::l3_unicast_route_add");
+
   int rv = 0;
 
   if (l3_interface_id > 0x0fffffff)
@@ -1483,7 +1730,7 @@ int controller::l3_unicast_route_add(const rofl::caddress_in4 &ipv4_dst,
                                   dpt.get_version(), ipv4_dst, mask,
                                   l3_interface_id, update_route, vrf_id));
 
-    dpt.send_barrier_request(rofl::cauxid(0));
+    send_barrier(dpt);
   } catch (rofl::eRofBaseNotFound &e) {
     LOG(ERROR) << ": caught rofl::eRofBaseNotFound";
     rv = -EINVAL;
@@ -1503,6 +1750,8 @@ int controller::l3_unicast_route_add(const rofl::caddress_in6 &ipv6_dst,
                                      uint32_t l3_interface_id, bool is_ecmp,
                                      bool update_route,
                                      uint16_t vrf_id) noexcept {
+  trace_scope trace("controller::l3_unicast_route_add_v6");
+
   int rv = 0;
 
   if (l3_interface_id > 0x0fffffff)
@@ -1523,7 +1772,7 @@ int controller::l3_unicast_route_add(const rofl::caddress_in6 &ipv6_dst,
                                   dpt.get_version(), ipv6_dst, mask,
                                   l3_interface_id, update_route, vrf_id));
 
-    dpt.send_barrier_request(rofl::cauxid(0));
+    send_barrier(dpt);
   } catch (rofl::eRofBaseNotFound &e) {
     LOG(ERROR) << ": caught rofl::eRofBaseNotFound";
     rv = -EINVAL;
@@ -1540,6 +1789,8 @@ int controller::l3_unicast_route_add(const rofl::caddress_in6 &ipv6_dst,
 
 int controller::l3_ecmp_add(uint32_t *l3_ecmp_id,
                             const std::set<uint32_t> &l3_interfaces) noexcept {
+  trace_scope trace("controller::l3_ecmp_add");
+
   int rv = 0;
   uint32_t _ecmp_interface_id;
   bool increment = false;
@@ -1588,6 +1839,8 @@ int controller::l3_ecmp_add(uint32_t *l3_ecmp_id,
 
 int controller::l3_ecmp_update(
     uint32_t l3_ecmp_id, const std::set<uint32_t> &l3_interfaces) noexcept {
+  trace_scope trace("controller::l3_ecmp_update");
+
   int rv = 0;
 
   try {
@@ -1619,6 +1872,8 @@ int controller::l3_ecmp_update(
 }
 
 int controller::l3_ecmp_remove(uint32_t l3_ecmp_id) noexcept {
+  trace_scope trace("controller::l3_ecmp_remove");
+
   int rv = 0;
 
   if (l3_ecmp_id > 0x0fffffff)
@@ -1650,6 +1905,8 @@ int controller::l3_ecmp_remove(uint32_t l3_ecmp_id) noexcept {
 int controller::l3_unicast_route_remove(const rofl::caddress_in4 &ipv4_dst,
                                         const rofl::caddress_in4 &mask,
                                         uint16_t vrf_id) noexcept {
+  trace_scope trace("controller::l3_unicast_route_remove");
+
   int rv = 0;
 
   try {
@@ -1658,7 +1915,7 @@ int controller::l3_unicast_route_remove(const rofl::caddress_in4 &ipv4_dst,
     dpt.send_flow_mod_message(rofl::cauxid(0),
                               fm_driver.disable_ipv4_unicast_lpm(
                                   dpt.get_version(), ipv4_dst, mask, vrf_id));
-    dpt.send_barrier_request(rofl::cauxid(0));
+    send_barrier(dpt);
   } catch (rofl::eRofBaseNotFound &e) {
     LOG(ERROR) << ": caught rofl::eRofBaseNotFound";
     rv = -EINVAL;
@@ -1676,6 +1933,8 @@ int controller::l3_unicast_route_remove(const rofl::caddress_in4 &ipv4_dst,
 int controller::l3_unicast_route_remove(const rofl::caddress_in6 &ipv6_dst,
                                         const rofl::caddress_in6 &mask,
                                         uint16_t vrf_id) noexcept {
+  trace_scope trace("controller::l3_unicast_route_remove_v6");
+
   int rv = 0;
 
   try {
@@ -1684,7 +1943,7 @@ int controller::l3_unicast_route_remove(const rofl::caddress_in6 &ipv6_dst,
     dpt.send_flow_mod_message(rofl::cauxid(0),
                               fm_driver.disable_ipv6_unicast_lpm(
                                   dpt.get_version(), ipv6_dst, mask, vrf_id));
-    dpt.send_barrier_request(rofl::cauxid(0));
+    send_barrier(dpt);
   } catch (rofl::eRofBaseNotFound &e) {
     LOG(ERROR) << ": caught rofl::eRofBaseNotFound";
     rv = -EINVAL;
@@ -1741,6 +2000,8 @@ int controller::ingress_port_vlan_drop_accept_all(uint32_t port) noexcept {
 
 int controller::ingress_port_vlan_add(uint32_t port, uint16_t vid, bool pvid,
                                       uint16_t vrf_id) noexcept {
+  trace_scope trace("controller::ingress_port_vlan_add");
+
   int rv = 0;
   try {
     rofl::crofdpt &dpt = set_dpt(dptid, true);
@@ -1779,7 +2040,7 @@ int controller::ingress_port_pvid_add(uint32_t port, uint16_t pvid) noexcept {
         fm_driver.enable_port_pvid_ingress(dpt.get_version(), port, pvid));
 
     uint32_t xid = 0;
-    dpt.send_barrier_request(rofl::cauxid(0), 1, &xid);
+    send_barrier(dpt, &xid);
     VLOG(2) << __FUNCTION__ << ": sent barrier with xid=" << (unsigned)xid;
   } catch (rofl::eRofBaseNotFound &e) {
     LOG(ERROR) << ": caught rofl::eRofBaseNotFound";
@@ -1805,7 +2066,7 @@ int controller::ingress_port_pvid_remove(uint32_t port,
         fm_driver.disable_port_pvid_ingress(dpt.get_version(), port, pvid));
 
     uint32_t xid = 0;
-    dpt.send_barrier_request(rofl::cauxid(0), 1, &xid);
+    send_barrier(dpt, &xid);
     VLOG(2) << __FUNCTION__ << ": sent barrier with xid=" << (unsigned)xid;
   } catch (rofl::eRofBaseNotFound &e) {
     LOG(ERROR) << ": caught rofl::eRofBaseNotFound";
@@ -1822,6 +2083,8 @@ int controller::ingress_port_pvid_remove(uint32_t port,
 
 int controller::ingress_port_vlan_remove(uint32_t port, uint16_t vid, bool pvid,
                                          uint16_t vrf_id) noexcept {
+  trace_scope trace("controller::ingress_port_vlan_remove");
+
   int rv = 0;
   try {
     rofl::crofdpt &dpt = set_dpt(dptid, true);
@@ -1838,7 +2101,7 @@ int controller::ingress_port_vlan_remove(uint32_t port, uint16_t vid, bool pvid,
                                     dpt.get_version(), port, vid, vrf_id));
     }
     uint32_t xid = 0;
-    dpt.send_barrier_request(rofl::cauxid(0), 1, &xid);
+    send_barrier(dpt, &xid);
     VLOG(2) << __FUNCTION__ << ": sent barrier with xid=" << (unsigned)xid;
   } catch (rofl::eRofBaseNotFound &e) {
     LOG(ERROR) << ": caught rofl::eRofBaseNotFound";
@@ -1895,6 +2158,8 @@ int controller::egress_port_vlan_drop_accept_all(uint32_t port) noexcept {
 
 int controller::egress_port_vlan_add(uint32_t port, uint16_t vid, bool untagged,
                                      bool update) noexcept {
+  trace_scope trace("controller::egress_port_vlan_add");
+
   int rv = 0;
   try {
     // create filtered egress interface
@@ -1923,6 +2188,8 @@ int controller::egress_port_vlan_add(uint32_t port, uint16_t vid, bool untagged,
 }
 
 int controller::egress_port_vlan_remove(uint32_t port, uint16_t vid) noexcept {
+  trace_scope trace("controller::egress_port_vlan_remove");
+
   int rv = 0;
   try {
     // remove filtered egress interface
@@ -1937,7 +2204,7 @@ int controller::egress_port_vlan_remove(uint32_t port, uint16_t vid) noexcept {
     }
     dpt.send_group_mod_message(rofl::cauxid(0), gm);
     uint32_t xid = 0;
-    dpt.send_barrier_request(rofl::cauxid(0), 1, &xid);
+    send_barrier(dpt, &xid);
     VLOG(2) << __FUNCTION__ << ": sent barrier with xid=" << (unsigned)xid;
   } catch (rofl::eRofBaseNotFound &e) {
     LOG(ERROR) << ": caught rofl::eRofBaseNotFound";
@@ -1981,7 +2248,7 @@ int controller::add_l2_overlay_flood(uint32_t tunnel_id,
                                    tunnel_dlf_it->second,
                                    (tunnel_dlf_it->second.size() > 1)));
 
-    dpt.send_barrier_request(rofl::cauxid(0));
+    send_barrier(dpt);
 
     //   if (tunnel_dlf_it->second.size() == 1) {
     dpt.send_flow_mod_message(
@@ -2036,7 +2303,7 @@ int controller::del_l2_overlay_flood(uint32_t tunnel_id,
       dpt.send_flow_mod_message(
           rofl::cauxid(0),
           fm_driver.remove_bridging_dlf_overlay(dpt.get_version(), tunnel_id));
-      dpt.send_barrier_request(rofl::cauxid(0));
+      send_barrier(dpt);
       dpt.send_group_mod_message(rofl::cauxid(0),
                                  fm_driver.disable_group_l2_overlay_flood(
                                      dpt.get_version(), tunnel_id, tunnel_id));
@@ -2069,7 +2336,7 @@ int controller::egress_bridge_port_vlan_add(uint32_t port, uint16_t vid,
 
     if (rv < 0)
       return rv;
-    dpt.send_barrier_request(rofl::cauxid(0));
+    send_barrier(dpt);
 
     {
       std::lock_guard<std::mutex> lock(l2_domain_mutex);
@@ -2092,7 +2359,7 @@ int controller::egress_bridge_port_vlan_add(uint32_t port, uint16_t vid,
                                         (l2_dom_set.size() != 1)));
 
     if (l2_dom_set.size() == 1) { // send barrier + DLF on creation
-      dpt.send_barrier_request(rofl::cauxid(0));
+      send_barrier(dpt);
       dpt.send_flow_mod_message(
           rofl::cauxid(0),
           fm_driver.add_bridging_dlf_vlan(
@@ -2142,14 +2409,14 @@ int controller::egress_bridge_port_vlan_remove(uint32_t port,
       dpt.send_flow_mod_message(
           rofl::cauxid(0),
           fm_driver.remove_bridging_dlf_vlan(dpt.get_version(), vid));
-      dpt.send_barrier_request(rofl::cauxid(0));
+      send_barrier(dpt);
       dpt.send_group_mod_message(
           rofl::cauxid(0),
           fm_driver.disable_group_l2_flood(dpt.get_version(), vid, vid));
     }
 
     uint32_t xid = 0;
-    dpt.send_barrier_request(rofl::cauxid(0), 1, &xid);
+    send_barrier(dpt, &xid);
     VLOG(2) << __FUNCTION__ << ": sent barrier with xid=" << (unsigned)xid;
 
     // remove filtered egress interface
@@ -2494,13 +2761,26 @@ int controller::get_statistics(uint64_t port_no, uint32_t number_of_counters,
   return rv;
 }
 
+// The tunnel calls are synchronous unless noted otherwise: nl_vxlan keeps its
+// bookkeeping in line with the results and ports have to be deleted before
+// their next hops.
+
 int controller::tunnel_tenant_create(uint32_t tunnel_id,
                                      uint32_t vni) noexcept {
   return ofdpa->ofdpaTunnelTenantCreate(tunnel_id, vni);
 }
 
 int controller::tunnel_tenant_delete(uint32_t tunnel_id) noexcept {
-  return ofdpa->ofdpaTunnelTenantDelete(tunnel_id);
+  // the tenant is deleted last and its id is derived from the unique vni, so
+  // nothing depends on the completion
+  ofdpa->ofdpaTunnelTenantDelete(
+      tunnel_id, [tunnel_id](ofdpa::OfdpaStatus::OfdpaStatusCode rv) {
+        if (rv != ofdpa::OfdpaStatus::OFDPA_E_NONE)
+          LOG(ERROR) << "tunnel_tenant_delete: failed to delete tunnel_id="
+                     << tunnel_id << " rv=" << rv;
+      });
+
+  return 0;
 }
 
 int controller::tunnel_next_hop_create(uint32_t next_hop_id, uint64_t src_mac,
@@ -2558,6 +2838,70 @@ int controller::tunnel_port_tenant_add(uint32_t lport_id,
   return rv;
 }
 
+int controller::tunnel_endpoint_setup(tunnel_endpoint_ops *s) noexcept {
+  ofdpa_client::batch b(*ofdpa);
+  std::vector<std::pair<int *, int>> rvs; // result, stage of each call
+
+  // the tenant and the next hop are independent of each other
+  if (s->tenant.tunnel_id) {
+    b.add(&ofdpa_client::ofdpaTunnelTenantCreate, s->tenant.tunnel_id,
+          s->tenant.vni);
+    rvs.emplace_back(&s->tenant.rv, 0);
+  }
+
+  if (s->next_hop.next_hop_id) {
+    b.add(&ofdpa_client::ofdpaTunnelNextHopCreate, s->next_hop.next_hop_id,
+          s->next_hop.src_mac, s->next_hop.dst_mac, s->next_hop.physical_port,
+          s->next_hop.vlan_id);
+    rvs.emplace_back(&s->next_hop.rv, 0);
+  }
+
+  b.barrier();
+  if (s->endpoint.port_id) {
+    b.add(&ofdpa_client::ofdpaTunnelEndpointPortCreate, s->endpoint.port_id,
+          s->endpoint.port_name, s->endpoint.remote_ipv4,
+          s->endpoint.local_ipv4, s->endpoint.ttl, s->endpoint.next_hop_id,
+          s->endpoint.terminator_udp_dst_port,
+          s->endpoint.initiator_udp_dst_port,
+          s->endpoint.udp_src_port_if_no_entropy, s->endpoint.use_entropy);
+    rvs.emplace_back(&s->endpoint.rv, 1);
+  }
+
+  b.barrier();
+  b.add(&ofdpa_client::ofdpaTunnelPortTenantAdd, s->port_tenant.port_id,
+        s->port_tenant.tunnel_id);
+  rvs.emplace_back(&s->port_tenant.rv, 2);
+
+  s->tenant.rv = s->next_hop.rv = s->endpoint.rv = s->port_tenant.rv = 0;
+
+  // the stages after a failed one are not sent
+  auto results = b.commit();
+  int rv = 0;
+  int failed_stage = 3;
+  for (std::size_t i = 0; i < results.size(); i++) {
+    if (rvs[i].second > failed_stage) {
+      *rvs[i].first = -ECANCELED;
+      continue;
+    }
+
+    *rvs[i].first = results[i];
+    if (results[i] < 0 && rv == 0) {
+      rv = results[i];
+      failed_stage = rvs[i].second;
+    }
+  }
+
+  if (rv < 0)
+    LOG(ERROR) << __FUNCTION__ << ": failed to set up port_id="
+               << s->port_tenant.port_id
+               << " in tunnel_id=" << s->port_tenant.tunnel_id
+               << ": tenant=" << s->tenant.rv << ", next_hop=" << s->next_hop.rv
+               << ", endpoint=" << s->endpoint.rv
+               << ", port_tenant=" << s->port_tenant.rv;
+
+  return rv;
+}
+
 int controller::tunnel_port_tenant_remove(uint32_t lport_id,
                                           uint32_t tunnel_id) noexcept {
   int rv;
@@ -2592,18 +2936,19 @@ int controller::lookup_stpid(uint32_t vlan_id) noexcept {
 }
 
 int controller::find_free_stgid() noexcept {
-  // 512 groups, 2 reserved (0 and 1)
-  if (vlan_to_stg.size() == (512 - 2))
-    return -ENOSPC;
+  // 512 groups, 2 reserved (0 and 1). Groups still being destroyed are in
+  // use, so the search is bound instead of relying on vlan_to_stg.
+  for (int i = 2; i < 512; i++) {
+    if (!stg_in_use[current_stg])
+      return current_stg;
 
-  while (stg_in_use[current_stg]) {
     current_stg++;
 
     if (current_stg == 512)
       current_stg = 2;
   }
 
-  return current_stg;
+  return -ENOSPC;
 }
 
 int controller::ofdpa_stg_destroy(uint16_t vlan_id) noexcept {
@@ -2613,22 +2958,43 @@ int controller::ofdpa_stg_destroy(uint16_t vlan_id) noexcept {
   if (stg_id == 0)
     return 0;
 
-  rv = ofdpa->ofdpaStgDestroy(stg_id);
-  if (rv < 0) {
-    LOG(ERROR) << __FUNCTION__ << ": failed to destroy the STP group";
-    return rv;
-  }
-
+  // The group id stays reserved until the destroy completed, the completion
+  // is run on the netlink thread owning the STG state. A new group of the
+  // same VLAN may have been created meanwhile, the destroy moves the VLAN
+  // back to the default group, so it is added again.
   vlan_to_stg.erase(vlan_id);
-  stg_in_use[stg_id] = false;
+  rv = ofdpa->ofdpaStgDestroy(
+      stg_id, [this, stg_id, vlan_id](ofdpa::OfdpaStatus::OfdpaStatusCode rv) {
+        nb->post([this, stg_id, vlan_id, rv]() {
+          if (rv != ofdpa::OfdpaStatus::OFDPA_E_NONE) {
+            LOG(ERROR) << "ofdpa_stg_destroy: failed to destroy the STP group "
+                       << stg_id << " rv=" << rv;
+            return;
+          }
+
+          stg_in_use[stg_id] = false;
+
+          int new_stg_id = lookup_stpid(vlan_id);
+          if (new_stg_id != 0 &&
+              ofdpa->ofdpaStgVlanAdd(vlan_id, new_stg_id) < 0)
+            LOG(ERROR) << "ofdpa_stg_destroy: failed to add VLAN=" << vlan_id
+                       << " to the STP group=" << new_stg_id;
+        });
+      });
 
   return rv;
 }
 
 int controller::ofdpa_stg_state_port_set(uint32_t port_id, uint16_t vlan_id,
                                          uint8_t state) noexcept {
+  return ofdpa_stg_state_ports_set(std::set<uint32_t>{port_id}, vlan_id, state);
+}
+
+int controller::ofdpa_stg_state_ports_set(const std::set<uint32_t> &port_ids,
+                                          uint16_t vlan_id,
+                                          uint8_t state) noexcept {
   std::string bcm_state;
-  int rv;
+  int rv = 0;
   int stg_id = lookup_stpid(vlan_id);
   if (stg_id == 0)
     stg_id = 1;
@@ -2653,9 +3019,20 @@ int controller::ofdpa_stg_state_port_set(uint32_t port_id, uint16_t vlan_id,
     return -EINVAL;
   }
 
-  rv = ofdpa->ofdpaStgStatePortSet(port_id, bcm_state, stg_id);
-  if (rv < 0) {
-    LOG(ERROR) << __FUNCTION__ << ": failed to set the STP state";
+  // synchronous, states of the same port have to stay in order
+  ofdpa_client::batch b(*ofdpa);
+  for (auto port_id : port_ids)
+    b.add(&ofdpa_client::ofdpaStgStatePortSet, port_id, bcm_state, stg_id);
+
+  auto results = b.commit();
+  auto it = port_ids.begin();
+  for (auto err : results) {
+    if (err < 0) {
+      LOG(ERROR) << __FUNCTION__ << ": failed to set the STP state of port_id="
+                 << *it << " err=" << err;
+      rv = err;
+    }
+    ++it;
   }
 
   return rv;
@@ -2674,6 +3051,8 @@ int controller::ofdpa_stg_create(uint16_t vlan_id) noexcept {
     return stg_id;
   }
 
+  // synchronous, the group has to exist before the VLAN is added and the
+  // port states are set
   rv = ofdpa->ofdpaStgCreate(stg_id);
   if (rv < 0) {
     LOG(ERROR) << __FUNCTION__ << ": failed to create the STP group";
@@ -2693,6 +3072,9 @@ int controller::ofdpa_stg_create(uint16_t vlan_id) noexcept {
   return rv;
 }
 
+// The KNET calls are issued from the knet_ctl worker thread and stay
+// synchronous, the link operations following them need the netif.
+
 int controller::port_knet_create(uint32_t port_id) noexcept {
   return ofdpa->ofdpaPortKnetCreate(port_id);
 }
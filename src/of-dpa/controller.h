@@ -6,12 +6,15 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 
+#include <atomic>
+#include <deque>
 #include <exception>
 #include <iostream>
 #include <memory>
 #include <mutex>
 #include <set>
 #include <string>
+#include <unordered_map>
 
 #include <glog/logging.h>
 
@@ -20,6 +23,7 @@
 #include <rofl/ofdpa/rofl_ofdpa_fm_driver.hpp>
 
 #include "sai.h"
+#include "utils/convergence_stats.h"
 
 #define CHECK_BIT(var, pos) (((var) >> (pos)) & 1)
 namespace basebox {
@@ -58,7 +62,8 @@ public:
                  rofl::openflow::cofhello_elem_versionbitmap(),
              uint16_t ofdpa_grpc_port = 50051)
       : nb(std::move(nb)), bb_thread(1), egress_interface_id(1),
-        ecmp_interface_id(1), default_idle_timeout(300), connected(false),
+        ecmp_interface_id(1), default_idle_timeout(300), hit_poll_interval(0),
+        connected(false),
         ofdpa(nullptr), ofdpa_grpc_port(ofdpa_grpc_port) {
     this->nb->register_switch(this);
     rofl::crofbase::set_versionbitmap(versionbitmap);
@@ -136,6 +141,12 @@ protected:
       rofl::crofdpt &dpt, const rofl::cauxid &auxid,
       rofl::openflow::cofmsg_port_stats_reply &msg) override;
 
+  void request_bridging_stats();
+
+  void handle_flow_stats_reply(
+      rofl::crofdpt &dpt, const rofl::cauxid &auxid,
+      rofl::openflow::cofmsg_flow_stats_reply &msg) override;
+
   void handle_timeout(rofl::cthread &thread, uint32_t timer_id) override;
 
 public:
@@ -150,7 +161,8 @@ public:
   int lag_create(uint32_t *lag_id, std::string name,
                  uint8_t mode) noexcept override;
   int lag_remove(uint32_t lag_id) noexcept override;
-  int lag_add_member(uint32_t lag_id, uint32_t port_id) noexcept override;
+  int lag_add_member(uint32_t lag_id, uint32_t port_id,
+                     uint8_t active) noexcept override;
   int lag_remove_member(uint32_t lag_id, uint32_t port_id) noexcept override;
   int lag_set_member_active(uint32_t lag_id, uint32_t port_id,
                             uint8_t active) noexcept override;
@@ -166,6 +178,8 @@ public:
                   bool update = false) noexcept override;
   int l2_addr_remove(uint32_t port, uint16_t vid,
                      const rofl::caddress_ll &mac) noexcept override;
+  int l2_addr_remove_bulk(const std::deque<l2_addr> &addrs) noexcept override;
+  int l2_hit_poll_interval(uint16_t interval) noexcept override;
 
   int l2_overlay_addr_add(uint32_t lport, uint32_t tunnel_id,
                           const rofl::cmacaddr &mac,
@@ -332,6 +346,8 @@ public:
   int tunnel_port_tenant_remove(uint32_t lport_id,
                                 uint32_t tunnel_id) noexcept override;
 
+  int tunnel_endpoint_setup(tunnel_endpoint_ops *setup) noexcept override;
+
   /* STP */
   // This set of functions is currently defined in our datamodel
   // but no implementation. It is intented that these functions
@@ -345,6 +361,9 @@ public:
 
   int ofdpa_stg_state_port_set(uint32_t port_id, uint16_t vlan_id,
                                uint8_t state) noexcept override;
+  int ofdpa_stg_state_ports_set(const std::set<uint32_t> &port_ids,
+                                uint16_t vlan_id,
+                                uint8_t state) noexcept override;
 
   /* print this */
   friend std::ostream &operator<<(std::ostream &os, const controller &box) {
@@ -359,6 +378,13 @@ private:
   std::mutex multicast_groups_mutex;
   std::mutex stats_mutex;
   std::mutex conn_mutex;
+  std::mutex barrier_mutex;
+
+  // events the outstanding barriers were sent for, in order of sending
+  std::deque<conv_mark> barrier_marks;
+
+  // send a barrier and account its reply to the event being handled
+  void send_barrier(rofl::crofdpt &dpt, uint32_t *xid = nullptr);
 
   std::map<uint16_t, std::set<uint32_t>> l2_domain;
   std::map<uint16_t, std::set<uint32_t>> lag;
@@ -389,6 +415,12 @@ private:
   uint32_t ecmp_interface_id;
   std::set<uint32_t> freed_ecmp_interfaces_ids;
   uint16_t default_idle_timeout;
+  // seconds, 0 = disabled, set by the netlink thread
+  std::atomic<uint16_t> hit_poll_interval;
+  // packets of the bridging entries at the last poll, by (mac, vid)
+  std::unordered_map<uint64_t, uint64_t> bridging_packets;
+  // collected from the segments of the reply to the current poll
+  std::unordered_map<uint64_t, uint64_t> bridging_packets_next;
   bool connected;
   std::shared_ptr<ofdpa_client> ofdpa;
   uint16_t ofdpa_grpc_port;
@@ -406,7 +438,8 @@ private:
   enum timer_t {
     /* handle_timeout will be called as well from crofbase, hence we need some
        id head room */
-    TIMER_port_stats_request = 10 // timer_id for querying port statistics
+    TIMER_port_stats_request = 10, // timer_id for querying port statistics
+    TIMER_bridging_stats_request,  // timer_id for polling the bridging hits
   };
   const int port_stats_request_interval = 2; // time in seconds
 
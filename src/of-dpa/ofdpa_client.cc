@@ -1,132 +1,330 @@
 // SPDX-FileCopyrightText: © 2018 BISDN GmbH
 // SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <map>
+#include <pthread.h>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
 #include <grpc++/grpc++.h>
 
 #include "ofdpa_client.h"
+#include "ofdpa_rpc_stats.h"
+#include "utils/trace_ring.h"
+
+DECLARE_int32(ofdpa_rpc_timeout);
 
 using namespace ofdpa;
 using namespace grpc;
 
 namespace basebox {
 
-ofdpa_client::ofdpa_client(std::shared_ptr<Channel> channel)
-    : stub_(ofdpa::OfdpaRpc::NewStub(channel)) {}
+namespace {
+
+struct rpc_counters {
+  std::atomic<uint64_t> calls;
+  std::atomic<uint64_t> inflight;
+  std::atomic<uint64_t> ofdpa_errors;
+  std::atomic<uint64_t> deadline_exceeded;
+  std::atomic<uint64_t> unavailable;
+  std::atomic<uint64_t> cancelled;
+  std::atomic<uint64_t> rpc_errors;
+  latency_histogram latency;
+};
+
+// per method, kept across client instances
+std::map<std::string, std::unique_ptr<rpc_counters>> counters;
+std::mutex counters_mutex;
+
+rpc_counters *get_counters(const char *name) {
+  std::lock_guard<std::mutex> guard(counters_mutex);
+  auto &c = counters[name];
+
+  if (!c)
+    c.reset(new rpc_counters()); // value initialized
+  return c.get();
+}
 
-OfdpaStatus::OfdpaStatusCode ofdpa_client::ofdpaTunnelReset() {
-  ::Empty request;
-  ::OfdpaStatus response;
-  ::ClientContext context;
+} // namespace
 
-  context.set_wait_for_ready(true);
+struct ofdpa_client::rpc_call {
+  const char *name;
+  rpc_counters *counters;
+  ::ClientContext context;
+  ::OfdpaStatus response;
+  ::Status status;
+  reader_ptr reader;
+  completion_cb cb;
+  std::chrono::steady_clock::time_point start;
+};
 
-  ::Status rv = stub_->ofdpaTunnelReset(&context, request, &response);
+ofdpa_client::ofdpa_client(std::shared_ptr<Channel> channel)
+    : stub_(ofdpa::OfdpaRpc::NewStub(channel)) {
+  cq_thread = std::thread(&ofdpa_client::run, this);
+  pthread_setname_np(cq_thread.native_handle(), "ofdpa_client");
+}
 
-  if (not rv.ok()) {
-    // LOG status
-    return ofdpa::OfdpaStatus::OFDPA_E_RPC;
+ofdpa_client::~ofdpa_client() {
+  {
+    std::lock_guard<std::mutex> guard(calls_mutex);
+    for (auto c : calls)
+      c->context.TryCancel();
   }
 
-  return response.status();
+  // pending calls still complete before run() returns
+  cq.Shutdown();
+  cq_thread.join();
 }
 
+template <typename Request>
 OfdpaStatus::OfdpaStatusCode
-ofdpa_client::ofdpaTunnelTenantCreate(uint32_t tunnel_id, uint32_t vni) {
-  // TODO maybe use ofdpa_datatypes as parameters
+ofdpa_client::call(const char *name, prepare_fn<Request> prepare,
+                   const Request &request, completion_cb cb) {
+  std::promise<OfdpaStatus::OfdpaStatusCode> done;
+  std::future<OfdpaStatus::OfdpaStatusCode> result;
+
+  if (!cb) {
+    if (std::this_thread::get_id() == cq_thread.get_id()) {
+      LOG(ERROR) << __FUNCTION__ << ": blocking call of " << name
+                 << " from a completion callback";
+      return OfdpaStatus::OFDPA_E_RPC;
+    }
+
+    result = done.get_future();
+    cb = [&done](OfdpaStatus::OfdpaStatusCode rv) { done.set_value(rv); };
+  }
 
-  ::TunnelTenantCreate request;
-  request.set_tunnel_id(tunnel_id);
+  auto c = new rpc_call();
+  c->name = name;
+  c->counters = get_counters(name);
+  c->cb = std::move(cb);
+  c->context.set_wait_for_ready(true);
+  if (FLAGS_ofdpa_rpc_timeout > 0)
+    c->context.set_deadline(
+        std::chrono::system_clock::now() +
+        std::chrono::milliseconds(FLAGS_ofdpa_rpc_timeout));
+
+  c->counters->calls.fetch_add(1, std::memory_order_relaxed);
+  c->counters->inflight.fetch_add(1, std::memory_order_relaxed);
+
+  {
+    std::lock_guard<std::mutex> guard(calls_mutex);
+    calls.insert(c);
+  }
 
-  ::OfdpaTunnelTenantConfig *config = request.mutable_config();
-  config->set_proto(::OFDPA_TUNNEL_PROTO_VXLAN);
-  config->set_virtual_network_id(vni);
+  c->start = std::chrono::steady_clock::now();
+  c->reader = (stub_.get()->*prepare)(&c->context, request, &cq);
+  c->reader->StartCall();
+  c->reader->Finish(&c->response, &c->status, c);
 
-  ::OfdpaStatus response;
-  ::ClientContext context;
+  if (result.valid())
+    return result.get();
 
-  context.set_wait_for_ready(true);
+  return OfdpaStatus::OFDPA_E_NONE;
+}
 
-  ::Status rv = stub_->ofdpaTunnelTenantCreate(&context, request, &response);
+void ofdpa_client::complete(rpc_call *c, bool ok) {
+  rpc_counters *cnt = c->counters;
+  OfdpaStatus::OfdpaStatusCode rv = OfdpaStatus::OFDPA_E_RPC;
+  auto d = std::chrono::steady_clock::now() - c->start;
+
+  cnt->latency.record(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+  cnt->inflight.fetch_sub(1, std::memory_order_relaxed);
+  trace_span(c->name, c->start, c->status.error_code());
+
+  if (ok && c->status.ok()) {
+    rv = c->response.status();
+    if (rv != OfdpaStatus::OFDPA_E_NONE)
+      cnt->ofdpa_errors.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    switch (c->status.error_code()) {
+    case StatusCode::DEADLINE_EXCEEDED:
+      cnt->deadline_exceeded.fetch_add(1, std::memory_order_relaxed);
+      break;
+    case StatusCode::UNAVAILABLE:
+      cnt->unavailable.fetch_add(1, std::memory_order_relaxed);
+      break;
+    case StatusCode::CANCELLED:
+      cnt->cancelled.fetch_add(1, std::memory_order_relaxed);
+      break;
+    default:
+      cnt->rpc_errors.fetch_add(1, std::memory_order_relaxed);
+      break;
+    }
+
+    LOG(WARNING) << __FUNCTION__ << ": " << c->name
+                 << " failed: code=" << c->status.error_code() << " "
+                 << c->status.error_message();
+  }
 
-  if (not rv.ok()) {
-    // LOG status
-    return ofdpa::OfdpaStatus::OFDPA_E_RPC;
+  {
+    std::lock_guard<std::mutex> guard(calls_mutex);
+    calls.erase(c);
   }
 
-  return response.status();
+  c->cb(rv);
+  delete c;
 }
 
-OfdpaStatus::OfdpaStatusCode
-ofdpa_client::ofdpaTunnelTenantDelete(uint32_t tunnel_id) {
+void ofdpa_client::run() {
+  void *tag;
+  bool ok;
 
-  ::ofdpa::TunnelId request;
+  while (cq.Next(&tag, &ok))
+    complete(static_cast<rpc_call *>(tag), ok);
+}
 
-  request.set_tunnel_id(tunnel_id);
-  ::OfdpaStatus response;
-  ::ClientContext context;
+std::vector<OfdpaStatus::OfdpaStatusCode> ofdpa_client::batch::commit() {
+  std::vector<OfdpaStatus::OfdpaStatusCode> results;
+  std::deque<std::vector<op>> todo(1);
 
-  context.set_wait_for_ready(true);
+  todo.swap(stages);
 
-  ::Status rv = stub_->ofdpaTunnelTenantDelete(&context, request, &response);
+  std::size_t total = 0;
+  for (const auto &stage : todo)
+    total += stage.size();
 
-  if (not rv.ok()) {
-    // LOG status
-    return ofdpa::OfdpaStatus::OFDPA_E_RPC;
+  if (std::this_thread::get_id() == client.cq_thread.get_id()) {
+    LOG(ERROR) << __FUNCTION__
+               << ": blocking commit from a completion callback";
+    results.resize(total, OfdpaStatus::OFDPA_E_RPC);
+    return results;
   }
 
-  return response.status();
+  for (auto &stage : todo) {
+    std::mutex m;
+    std::condition_variable cv;
+    std::size_t base = results.size();
+    std::size_t pending = stage.size();
+
+    results.resize(base + stage.size(), OfdpaStatus::OFDPA_E_RPC);
+
+    for (std::size_t i = 0; i < stage.size(); i++) {
+      stage[i]([&, i](OfdpaStatus::OfdpaStatusCode rv) {
+        std::lock_guard<std::mutex> guard(m);
+        results[base + i] = rv;
+        if (--pending == 0)
+          cv.notify_one();
+      });
+    }
+
+    std::unique_lock<std::mutex> lock(m);
+    cv.wait(lock, [&pending] { return pending == 0; });
+
+    // the following stages depend on this one
+    bool failed = false;
+    for (std::size_t i = base; i < results.size(); i++)
+      failed |= results[i] != OfdpaStatus::OFDPA_E_NONE;
+
+    if (failed)
+      break;
+  }
+
+  VLOG(2) << __FUNCTION__ << ": completed " << results.size() << " of "
+          << total << " calls in " << todo.size() << " stages";
+
+  // calls of the stages not sent
+  results.resize(total, OfdpaStatus::OFDPA_E_RPC);
+
+  return results;
+}
+
+std::deque<ofdpa_rpc_stats> ofdpa_rpc_statistics() {
+  std::deque<ofdpa_rpc_stats> stats;
+  std::lock_guard<std::mutex> guard(counters_mutex);
+
+  for (const auto &c : counters) {
+    const rpc_counters *cnt = c.second.get();
+    ofdpa_rpc_stats s = {};
+
+    s.name = c.first;
+    s.calls = cnt->calls.load(std::memory_order_relaxed);
+    s.inflight = cnt->inflight.load(std::memory_order_relaxed);
+    s.ofdpa_errors = cnt->ofdpa_errors.load(std::memory_order_relaxed);
+    s.deadline_exceeded =
+        cnt->deadline_exceeded.load(std::memory_order_relaxed);
+    s.unavailable = cnt->unavailable.load(std::memory_order_relaxed);
+    s.cancelled = cnt->cancelled.load(std::memory_order_relaxed);
+    s.rpc_errors = cnt->rpc_errors.load(std::memory_order_relaxed);
+    cnt->latency.snapshot(s.latency);
+    stats.push_back(std::move(s));
+  }
+
+  return stats;
+}
+
+OfdpaStatus::OfdpaStatusCode ofdpa_client::ofdpaTunnelReset(completion_cb cb) {
+  ::Empty request;
+
+  return call("ofdpaTunnelReset", &OfdpaRpc::Stub::PrepareAsyncofdpaTunnelReset,
+              request, std::move(cb));
 }
 
 OfdpaStatus::OfdpaStatusCode
-ofdpa_client::ofdpaPortSourceMacLearningSet(uint32_t port_num,
-                                            uint32_t l2_learn) {
-  ::ofdpa::PortSrcMacLearning request;
-  ::ClientContext context;
-  ::OfdpaStatus response;
+ofdpa_client::ofdpaTunnelTenantCreate(uint32_t tunnel_id, uint32_t vni,
+                                      completion_cb cb) {
+  // TODO maybe use ofdpa_datatypes as parameters
 
-  context.set_wait_for_ready(true);
+  ::TunnelTenantCreate request;
+  request.set_tunnel_id(tunnel_id);
 
-  request.set_port_num(port_num);
-  request.set_l2_learn(l2_learn);
+  ::OfdpaTunnelTenantConfig *config = request.mutable_config();
+  config->set_proto(::OFDPA_TUNNEL_PROTO_VXLAN);
+  config->set_virtual_network_id(vni);
 
-  ::Status rv =
-      stub_->ofdpaPortSourceMacLearningSet(&context, request, &response);
+  return call("ofdpaTunnelTenantCreate",
+              &OfdpaRpc::Stub::PrepareAsyncofdpaTunnelTenantCreate, request,
+              std::move(cb));
+}
 
-  if (not rv.ok()) {
-    // LOG status
-    return ofdpa::OfdpaStatus::OFDPA_E_RPC;
-  }
+OfdpaStatus::OfdpaStatusCode
+ofdpa_client::ofdpaTunnelTenantDelete(uint32_t tunnel_id, completion_cb cb) {
+  ::ofdpa::TunnelId request;
 
-  return response.status();
+  request.set_tunnel_id(tunnel_id);
+
+  return call("ofdpaTunnelTenantDelete",
+              &OfdpaRpc::Stub::PrepareAsyncofdpaTunnelTenantDelete, request,
+              std::move(cb));
 }
 
 OfdpaStatus::OfdpaStatusCode
-ofdpa_client::ofdpaPortSourceMacMoveLearningSet(uint32_t port_num,
-                                                uint32_t l2_learn) {
+ofdpa_client::ofdpaPortSourceMacLearningSet(uint32_t port_num,
+                                            uint32_t l2_learn,
+                                            completion_cb cb) {
   ::ofdpa::PortSrcMacLearning request;
-  ::ClientContext context;
-  ::OfdpaStatus response;
-
-  context.set_wait_for_ready(true);
 
   request.set_port_num(port_num);
   request.set_l2_learn(l2_learn);
 
-  ::Status rv =
-      stub_->ofdpaPortSourceMacMoveLearningSet(&context, request, &response);
+  return call("ofdpaPortSourceMacLearningSet",
+              &OfdpaRpc::Stub::PrepareAsyncofdpaPortSourceMacLearningSet,
+              request, std::move(cb));
+}
 
-  if (not rv.ok()) {
-    // LOG status
-    return ofdpa::OfdpaStatus::OFDPA_E_RPC;
-  }
+OfdpaStatus::OfdpaStatusCode
+ofdpa_client::ofdpaPortSourceMacMoveLearningSet(uint32_t port_num,
+                                                uint32_t l2_learn,
+                                                completion_cb cb) {
+  ::ofdpa::PortSrcMacLearning request;
 
-  return response.status();
+  request.set_port_num(port_num);
+  request.set_l2_learn(l2_learn);
+
+  return call("ofdpaPortSourceMacMoveLearningSet",
+              &OfdpaRpc::Stub::PrepareAsyncofdpaPortSourceMacMoveLearningSet,
+              request, std::move(cb));
 }
 
 OfdpaStatus::OfdpaStatusCode
 ofdpa_client::ofdpaTunnelNextHopCreate(uint32_t next_hop_id, uint64_t src_mac,
                                        uint64_t dst_mac, uint32_t physical_port,
-                                       uint16_t vlan_id) {
+                                       uint16_t vlan_id, completion_cb cb) {
   ::TunnelNextHopCreate request;
   request.set_next_hop_id(next_hop_id);
   ::OfdpaTunnelNextHopConfig *config = request.mutable_config();
@@ -136,45 +334,26 @@ ofdpa_client::ofdpaTunnelNextHopCreate(uint32_t next_hop_id, uint64_t src_mac,
   config->set_physical_port_num(physical_port);
   config->set_vlan_id(vlan_id); // XXX validate?
 
-  ::OfdpaStatus response;
-  ::ClientContext context;
-
-  context.set_wait_for_ready(true);
-
-  ::Status rv = stub_->ofdpaTunnelNextHopCreate(&context, request, &response);
-
-  if (not rv.ok()) {
-    // LOG status
-    return ofdpa::OfdpaStatus::OFDPA_E_RPC;
-  }
-
-  return response.status();
+  return call("ofdpaTunnelNextHopCreate",
+              &OfdpaRpc::Stub::PrepareAsyncofdpaTunnelNextHopCreate, request,
+              std::move(cb));
 }
 
 OfdpaStatus::OfdpaStatusCode
-ofdpa_client::ofdpaTunnelNextHopDelete(uint32_t next_hop_id) {
+ofdpa_client::ofdpaTunnelNextHopDelete(uint32_t next_hop_id,
+                                       completion_cb cb) {
   ::NextHopId request;
   request.set_next_hop_id(next_hop_id);
 
-  ::OfdpaStatus response;
-  ::ClientContext context;
-
-  context.set_wait_for_ready(true);
-
-  ::Status rv = stub_->ofdpaTunnelNextHopDelete(&context, request, &response);
-
-  if (not rv.ok()) {
-    // LOG status
-    return ofdpa::OfdpaStatus::OFDPA_E_RPC;
-  }
-
-  return response.status();
+  return call("ofdpaTunnelNextHopDelete",
+              &OfdpaRpc::Stub::PrepareAsyncofdpaTunnelNextHopDelete, request,
+              std::move(cb));
 }
 
 ofdpa::OfdpaStatus::OfdpaStatusCode
 ofdpa_client::ofdpaTunnelNextHopModify(uint32_t next_hop_id, uint64_t src_mac,
                                        uint64_t dst_mac, uint32_t physical_port,
-                                       uint16_t vlan_id) {
+                                       uint16_t vlan_id, completion_cb cb) {
   ::TunnelNextHopCreate request;
   request.set_next_hop_id(next_hop_id);
   ::OfdpaTunnelNextHopConfig *config = request.mutable_config();
@@ -184,19 +363,9 @@ ofdpa_client::ofdpaTunnelNextHopModify(uint32_t next_hop_id, uint64_t src_mac,
   config->set_physical_port_num(physical_port);
   config->set_vlan_id(vlan_id); // XXX validate?
 
-  ::OfdpaStatus response;
-  ::ClientContext context;
-
-  context.set_wait_for_ready(true);
-
-  ::Status rv = stub_->ofdpaTunnelNextHopModify(&context, request, &response);
-
-  if (not rv.ok()) {
-    // LOG status
-    return ofdpa::OfdpaStatus::OFDPA_E_RPC;
-  }
-
-  return response.status();
+  return call("ofdpaTunnelNextHopModify",
+              &OfdpaRpc::Stub::PrepareAsyncofdpaTunnelNextHopModify, request,
+              std::move(cb));
 }
 
 TunnelPortCreate make_tunnel_port(uint32_t port_id,
@@ -247,7 +416,7 @@ OfdpaEndpointConfig make_endpoint_config(uint32_t remote, uint32_t local,
 
 OfdpaStatus::OfdpaStatusCode ofdpa_client::ofdpaTunnelAccessPortCreate(
     uint32_t port_id, const std::string &port_name, uint32_t physical_port,
-    uint16_t vlan_id, bool untagged) {
+    uint16_t vlan_id, bool untagged, completion_cb cb) {
   // XXX TODO check parameters
   TunnelPortCreate request =
       make_tunnel_port(port_id, port_name, OFDPA_TUNNEL_PORT_TYPE_ACCESS);
@@ -257,14 +426,14 @@ OfdpaStatus::OfdpaStatusCode ofdpa_client::ofdpaTunnelAccessPortCreate(
       ->mutable_access_port_config()
       ->CopyFrom(make_access_port_config(physical_port, vlan_id, untagged));
 
-  return ofdpaTunnelPortCreate(request);
+  return ofdpaTunnelPortCreate(request, std::move(cb));
 }
 
 OfdpaStatus::OfdpaStatusCode ofdpa_client::ofdpaTunnelEndpointPortCreate(
     uint32_t port_id, const std::string &port_name, uint32_t remote_ipv4,
     uint32_t local_ipv4, uint32_t ttl, uint32_t next_hop_id,
     uint32_t terminator_udp_dst_port, uint32_t initiator_udp_dst_port,
-    uint32_t udp_src_port_if_no_entropy, bool use_entropy) {
+    uint32_t udp_src_port_if_no_entropy, bool use_entropy, completion_cb cb) {
   // XXX TODO check parameters
   TunnelPortCreate request =
       make_tunnel_port(port_id, port_name, OFDPA_TUNNEL_PORT_TYPE_ENDPOINT);
@@ -275,340 +444,212 @@ OfdpaStatus::OfdpaStatusCode ofdpa_client::ofdpaTunnelEndpointPortCreate(
           remote_ipv4, local_ipv4, ttl, next_hop_id, terminator_udp_dst_port,
           initiator_udp_dst_port, udp_src_port_if_no_entropy, use_entropy));
 
-  return ofdpaTunnelPortCreate(request);
+  return ofdpaTunnelPortCreate(request, std::move(cb));
 }
 
 OfdpaStatus::OfdpaStatusCode
-ofdpa_client::ofdpaTunnelPortCreate(const ::ofdpa::TunnelPortCreate &request) {
-  ::OfdpaStatus response;
-  ::ClientContext context;
-
-  context.set_wait_for_ready(true);
-
-  ::Status rv = stub_->ofdpaTunnelPortCreate(&context, request, &response);
-
-  if (not rv.ok()) {
-    // LOG status
-    return ofdpa::OfdpaStatus::OFDPA_E_RPC;
-  }
-
-  return response.status();
+ofdpa_client::ofdpaTunnelPortCreate(const ::ofdpa::TunnelPortCreate &request,
+                                    completion_cb cb) {
+  return call("ofdpaTunnelPortCreate",
+              &OfdpaRpc::Stub::PrepareAsyncofdpaTunnelPortCreate, request,
+              std::move(cb));
 }
 
 ofdpa::OfdpaStatus::OfdpaStatusCode
-ofdpa_client::ofdpaTunnelPortDelete(uint32_t lport_id) {
+ofdpa_client::ofdpaTunnelPortDelete(uint32_t lport_id, completion_cb cb) {
   ::PortNum request;
   request.set_port_num(lport_id);
-  ::OfdpaStatus response;
-  ::ClientContext context;
-
-  context.set_wait_for_ready(true);
-
-  ::Status rv = stub_->ofdpaTunnelPortDelete(&context, request, &response);
 
-  if (not rv.ok()) {
-    // LOG status
-    return ofdpa::OfdpaStatus::OFDPA_E_RPC;
-  }
-
-  return response.status();
+  return call("ofdpaTunnelPortDelete",
+              &OfdpaRpc::Stub::PrepareAsyncofdpaTunnelPortDelete, request,
+              std::move(cb));
 }
 
 OfdpaStatus::OfdpaStatusCode
-ofdpa_client::ofdpaTunnelPortTenantAdd(uint32_t port_id, uint32_t tunnel_id) {
+ofdpa_client::ofdpaTunnelPortTenantAdd(uint32_t port_id, uint32_t tunnel_id,
+                                       completion_cb cb) {
   ::TunnelPortTenantAdd request;
 
   request.set_port_num(port_id);
   request.set_tunnel_id(tunnel_id);
 
-  ::OfdpaStatus response;
-  ::ClientContext context;
-
-  context.set_wait_for_ready(true);
-
-  ::Status rv = stub_->ofdpaTunnelPortTenantAdd(&context, request, &response);
-
-  if (not rv.ok()) {
-    // LOG status
-    return ofdpa::OfdpaStatus::OFDPA_E_RPC;
-  }
-
-  return response.status();
+  return call("ofdpaTunnelPortTenantAdd",
+              &OfdpaRpc::Stub::PrepareAsyncofdpaTunnelPortTenantAdd, request,
+              std::move(cb));
 }
 
 ofdpa::OfdpaStatus::OfdpaStatusCode
 ofdpa_client::ofdpaTunnelPortTenantDelete(uint32_t port_id,
-                                          uint32_t tunnel_id) {
+                                          uint32_t tunnel_id,
+                                          completion_cb cb) {
   ::TunnelPortTenantAdd request;
 
   request.set_port_num(port_id);
   request.set_tunnel_id(tunnel_id);
 
-  ::OfdpaStatus response;
-  ::ClientContext context;
-
-  context.set_wait_for_ready(true);
-
-  ::Status rv =
-      stub_->ofdpaTunnelPortTenantDelete(&context, request, &response);
-
-  if (not rv.ok()) {
-    return ofdpa::OfdpaStatus::OFDPA_E_RPC;
-  }
-
-  return response.status();
+  return call("ofdpaTunnelPortTenantDelete",
+              &OfdpaRpc::Stub::PrepareAsyncofdpaTunnelPortTenantDelete, request,
+              std::move(cb));
 }
 
-OfdpaStatus::OfdpaStatusCode ofdpa_client::ofdpaStgReset() {
+OfdpaStatus::OfdpaStatusCode ofdpa_client::ofdpaStgReset(completion_cb cb) {
   ::Empty request;
-  ::OfdpaStatus response;
-  ::ClientContext context;
-
-  context.set_wait_for_ready(true);
-
-  ::Status rv = stub_->ofdpaStgReset(&context, request, &response);
 
-  if (not rv.ok()) {
-    // LOG status
-    return ofdpa::OfdpaStatus::OFDPA_E_RPC;
-  }
-
-  return response.status();
+  return call("ofdpaStgReset", &OfdpaRpc::Stub::PrepareAsyncofdpaStgReset,
+              request, std::move(cb));
 }
 
 ofdpa::OfdpaStatus::OfdpaStatusCode
 ofdpa_client::ofdpaStgStatePortSet(uint32_t port_id, std::string state,
-                                   uint32_t stg_id) {
-  ::OfdpaStatus response;
-  ::ClientContext context;
+                                   uint32_t stg_id, completion_cb cb) {
   ::StpInterfaceState request;
 
-  context.set_wait_for_ready(true);
-
   request.set_port_num(port_id);
   request.set_port_state(state);
   request.mutable_stg_id()->set_id(stg_id);
 
-  ::Status rv = stub_->ofdpaStgStatePortSet(&context, request, &response);
-  if (not rv.ok()) {
-    return ofdpa::OfdpaStatus::OFDPA_E_RPC;
-  }
-
-  return response.status();
+  return call("ofdpaStgStatePortSet",
+              &OfdpaRpc::Stub::PrepareAsyncofdpaStgStatePortSet, request,
+              std::move(cb));
 }
 
 ofdpa::OfdpaStatus::OfdpaStatusCode
-ofdpa_client::ofdpaStgCreate(uint16_t stg_id) {
-  ::OfdpaStatus response;
-  ::ClientContext context;
+ofdpa_client::ofdpaStgCreate(uint16_t stg_id, completion_cb cb) {
   ::StgId request;
 
-  context.set_wait_for_ready(true);
   request.set_id(stg_id);
 
-  ::Status rv = stub_->ofdpaStgCreate(&context, request, &response);
-  if (not rv.ok()) {
-    return ofdpa::OfdpaStatus::OFDPA_E_RPC;
-  }
-
-  return response.status();
+  return call("ofdpaStgCreate", &OfdpaRpc::Stub::PrepareAsyncofdpaStgCreate,
+              request, std::move(cb));
 }
 
 ofdpa::OfdpaStatus::OfdpaStatusCode
-ofdpa_client::ofdpaStgDestroy(uint16_t stg_id) {
-  ::OfdpaStatus response;
-  ::ClientContext context;
+ofdpa_client::ofdpaStgDestroy(uint16_t stg_id, completion_cb cb) {
   ::StgId request;
 
-  context.set_wait_for_ready(true);
   request.set_id(stg_id);
 
-  ::Status rv = stub_->ofdpaStgDestroy(&context, request, &response);
-  if (not rv.ok()) {
-    return ofdpa::OfdpaStatus::OFDPA_E_RPC;
-  }
-
-  return response.status();
+  return call("ofdpaStgDestroy", &OfdpaRpc::Stub::PrepareAsyncofdpaStgDestroy,
+              request, std::move(cb));
 }
 
 ofdpa::OfdpaStatus::OfdpaStatusCode
-ofdpa_client::ofdpaStgVlanAdd(uint16_t vlanid, uint32_t stgid) {
-  ::OfdpaStatus response;
-  ::ClientContext context;
+ofdpa_client::ofdpaStgVlanAdd(uint16_t vlanid, uint32_t stgid,
+                              completion_cb cb) {
   ::StgVlan request;
 
-  context.set_wait_for_ready(true);
   request.mutable_stg_id()->set_id(stgid);
   request.mutable_vlan_id()->set_id(vlanid);
 
-  ::Status rv = stub_->ofdpaStgVlanAdd(&context, request, &response);
-  if (not rv.ok()) {
-    return ofdpa::OfdpaStatus::OFDPA_E_RPC;
-  }
-
-  return response.status();
+  return call("ofdpaStgVlanAdd", &OfdpaRpc::Stub::PrepareAsyncofdpaStgVlanAdd,
+              request, std::move(cb));
 }
 
 ofdpa::OfdpaStatus::OfdpaStatusCode
-ofdpa_client::ofdpaStgVlanRemove(uint16_t vlan_id, uint32_t stg_id) {
+ofdpa_client::ofdpaStgVlanRemove(uint16_t vlan_id, uint32_t stg_id,
+                                 completion_cb cb) {
   ::OfdpaStatus response;
-  ::ClientContext context;
 
-  context.set_wait_for_ready(true);
+  if (cb)
+    cb(response.status());
 
   return response.status();
 }
 
 ofdpa::OfdpaStatus::OfdpaStatusCode
 ofdpa_client::OfdpaTrunkCreate(uint32_t lag_id, std::string name,
-                               uint8_t mode) {
-  ::OfdpaStatus response;
-  ::ClientContext context;
+                               uint8_t mode, completion_cb cb) {
   ::TrunkCreate request;
 
-  context.set_wait_for_ready(true);
-
   request.set_name(name);
   request.set_lag_id(lag_id);
   request.set_lag_type((::LagType)mode);
 
-  ::Status rv = stub_->ofdpaTrunkCreate(&context, request, &response);
-  if (not rv.ok()) {
-    return ofdpa::OfdpaStatus::OFDPA_E_RPC;
-  }
-
-  return response.status();
+  return call("ofdpaTrunkCreate", &OfdpaRpc::Stub::PrepareAsyncofdpaTrunkCreate,
+              request, std::move(cb));
 }
 
 ofdpa::OfdpaStatus::OfdpaStatusCode
-ofdpa_client::OfdpaTrunkDelete(uint32_t lag_id) {
-  ::OfdpaStatus response;
-  ::ClientContext context;
+ofdpa_client::OfdpaTrunkDelete(uint32_t lag_id, completion_cb cb) {
   ::PortNum request;
 
-  context.set_wait_for_ready(true);
-
   request.set_port_num(lag_id);
 
-  ::Status rv = stub_->ofdpaTrunkDelete(&context, request, &response);
-  if (not rv.ok()) {
-    return ofdpa::OfdpaStatus::OFDPA_E_RPC;
-  }
-
-  return response.status();
+  return call("ofdpaTrunkDelete", &OfdpaRpc::Stub::PrepareAsyncofdpaTrunkDelete,
+              request, std::move(cb));
 }
 
 ofdpa::OfdpaStatus::OfdpaStatusCode
-ofdpa_client::OfdpaPortTrunkGroupSet(uint32_t port_id, uint32_t trunk_id) {
-  ::OfdpaStatus response;
-  ::ClientContext context;
+ofdpa_client::OfdpaPortTrunkGroupSet(uint32_t port_id, uint32_t trunk_id,
+                                     completion_cb cb) {
   ::TrunkGroupSet request;
 
-  context.set_wait_for_ready(true);
-
   request.set_lag_id(trunk_id);
   request.set_member(port_id);
 
-  ::Status rv = stub_->ofdpaPortTrunkGroupSet(&context, request, &response);
-  if (not rv.ok()) {
-    return ofdpa::OfdpaStatus::OFDPA_E_RPC;
-  }
-
-  return response.status();
+  return call("ofdpaPortTrunkGroupSet",
+              &OfdpaRpc::Stub::PrepareAsyncofdpaPortTrunkGroupSet, request,
+              std::move(cb));
 }
 
 ofdpa::OfdpaStatus::OfdpaStatusCode
 ofdpa_client::OfdpaTrunkPortMemberActiveSet(uint32_t port_id, uint32_t trunk_id,
-                                            uint32_t active) {
-  ::OfdpaStatus response;
-  ::ClientContext context;
+                                            uint32_t active,
+                                            completion_cb cb) {
   ::PortMemberActiveSet request;
 
-  context.set_wait_for_ready(true);
-
   request.set_lag_id(trunk_id);
   request.set_member(port_id);
   request.set_active(active);
 
-  ::Status rv =
-      stub_->ofdpaTrunkPortMemberActiveSet(&context, request, &response);
-  if (not rv.ok()) {
-    return ofdpa::OfdpaStatus::OFDPA_E_RPC;
-  }
-
-  return response.status();
+  return call("ofdpaTrunkPortMemberActiveSet",
+              &OfdpaRpc::Stub::PrepareAsyncofdpaTrunkPortMemberActiveSet,
+              request, std::move(cb));
 }
 
 ofdpa::OfdpaStatus::OfdpaStatusCode
-ofdpa_client::ofdpaTrunkPortPSCSet(uint32_t lag_id, uint8_t mode) {
-  ::OfdpaStatus response;
-  ::ClientContext context;
+ofdpa_client::ofdpaTrunkPortPSCSet(uint32_t lag_id, uint8_t mode,
+                                   completion_cb cb) {
   ::PSC request;
 
-  context.set_wait_for_ready(true);
-
   request.set_lag_id(lag_id);
   request.set_lag_type((::LagType)mode);
 
-  ::Status rv = stub_->ofdpaTrunkPortPSCSet(&context, request, &response);
-  if (not rv.ok()) {
-    return ofdpa::OfdpaStatus::OFDPA_E_RPC;
-  }
-
-  return response.status();
+  return call("ofdpaTrunkPortPSCSet",
+              &OfdpaRpc::Stub::PrepareAsyncofdpaTrunkPortPSCSet, request,
+              std::move(cb));
 }
 
-ofdpa::OfdpaStatus::OfdpaStatusCode ofdpa_client::ofdpaRxRateSet(int32_t pps) {
-  ::OfdpaStatus response;
-  ::ClientContext context;
+ofdpa::OfdpaStatus::OfdpaStatusCode
+ofdpa_client::ofdpaRxRateSet(int32_t pps, completion_cb cb) {
   ::Pps request;
 
-  context.set_wait_for_ready(true);
-
   request.set_pps(pps);
 
-  ::Status rv = stub_->ofdpaRxRateSet(&context, request, &response);
-  if (not rv.ok()) {
-    return ofdpa::OfdpaStatus::OFDPA_E_RPC;
-  }
-
-  return response.status();
+  return call("ofdpaRxRateSet", &OfdpaRpc::Stub::PrepareAsyncofdpaRxRateSet,
+              request, std::move(cb));
 }
 
 ofdpa::OfdpaStatus::OfdpaStatusCode
-ofdpa_client::ofdpaPortKnetCreate(uint32_t port_id) {
-  ::OfdpaStatus response;
-  ::ClientContext context;
+ofdpa_client::ofdpaPortKnetCreate(uint32_t port_id, completion_cb cb) {
   ::PortNum request;
 
-  context.set_wait_for_ready(true);
-
   request.set_port_num(port_id);
 
-  ::Status rv = stub_->ofdpaPortKnetCreate(&context, request, &response);
-  if (not rv.ok()) {
-    return ofdpa::OfdpaStatus::OFDPA_E_RPC;
-  }
-
-  return response.status();
+  return call("ofdpaPortKnetCreate",
+              &OfdpaRpc::Stub::PrepareAsyncofdpaPortKnetCreate, request,
+              std::move(cb));
 }
 
 ofdpa::OfdpaStatus::OfdpaStatusCode
-ofdpa_client::ofdpaPortKnetDelete(uint32_t port_id) {
-  ::OfdpaStatus response;
-  ::ClientContext context;
+ofdpa_client::ofdpaPortKnetDelete(uint32_t port_id, completion_cb cb) {
   ::PortNum request;
 
-  context.set_wait_for_ready(true);
-
   request.set_port_num(port_id);
 
-  ::Status rv = stub_->ofdpaPortKnetDelete(&context, request, &response);
-  if (not rv.ok()) {
-    return ofdpa::OfdpaStatus::OFDPA_E_RPC;
-  }
-
-  return response.status();
+  return call("ofdpaPortKnetDelete",
+              &OfdpaRpc::Stub::PrepareAsyncofdpaPortKnetDelete, request,
+              std::move(cb));
 }
 
 } // namespace basebox
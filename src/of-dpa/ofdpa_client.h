@@ -3,7 +3,13 @@
 
 #pragma once
 
+#include <deque>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
 
 #include "api/ofdpa.grpc.pb.h"
 
@@ -11,6 +17,20 @@ using grpc::Channel;
 
 namespace basebox {
 
+/**
+ * client of the OF-DPA agent
+ *
+ * All methods are sent through a completion queue served by a dedicated
+ * thread. Each call is bound by the deadline set in FLAGS_ofdpa_rpc_timeout.
+ *
+ * Without a completion callback a method blocks until the call completed and
+ * returns its result. With a callback it returns OFDPA_E_NONE as soon as the
+ * call has been issued, and the callback is invoked with the result from the
+ * client thread. Such calls are pipelined, so only independent calls may be
+ * issued without waiting for the previous completion. Callbacks must not
+ * block nor issue blocking calls; a completion updating state owned by
+ * another thread is handed over with nbi::post.
+ */
 class ofdpa_client {
 public:
   typedef enum {
@@ -21,87 +41,180 @@ public:
     SRC_MAC_LEARN_PENDING = 8,
   } ofdpa_src_mac_learn_mode_t;
 
+  typedef std::function<void(ofdpa::OfdpaStatus::OfdpaStatusCode)>
+      completion_cb;
+
+  /**
+   * calls issued together
+   *
+   * All calls added to a batch are sent at once on commit, so a batch costs a
+   * single round-trip instead of one per call. Calls added after a barrier
+   * are sent once all calls before the barrier completed successfully, after
+   * a failure they are not sent and return OFDPA_E_RPC. The status of each
+   * call is returned in the order the calls were added.
+   *
+   * Any method of the client may be added along with all its arguments
+   * except the completion callback, e.g.
+   *
+   *   b.add(&ofdpa_client::OfdpaTrunkDelete, lag_id);
+   */
+  class batch {
+  public:
+    explicit batch(ofdpa_client &client) : client(client), stages(1) {}
+
+    template <typename... Params, typename... Args>
+    void add(ofdpa::OfdpaStatus::OfdpaStatusCode (ofdpa_client::*method)(
+                 Params...),
+             Args... args) {
+      stages.back().emplace_back([this, method, args...](completion_cb cb) {
+        return (client.*method)(args..., std::move(cb));
+      });
+    }
+
+    void barrier() {
+      if (!stages.back().empty())
+        stages.emplace_back();
+    }
+
+    bool empty() const { return stages.front().empty(); }
+
+    // send all calls and wait for their completion, the batch is empty
+    // afterwards
+    std::vector<ofdpa::OfdpaStatus::OfdpaStatusCode> commit();
+
+  private:
+    typedef std::function<ofdpa::OfdpaStatus::OfdpaStatusCode(completion_cb)>
+        op;
+
+    ofdpa_client &client;
+    std::deque<std::vector<op>> stages;
+  };
+
   ofdpa_client(std::shared_ptr<grpc::Channel> channel);
+  ~ofdpa_client();
 
-  ofdpa::OfdpaStatus::OfdpaStatusCode ofdpaTunnelReset();
   ofdpa::OfdpaStatus::OfdpaStatusCode
-  ofdpaTunnelTenantCreate(uint32_t tunnel_id, uint32_t vni);
+  ofdpaTunnelReset(completion_cb cb = nullptr);
+  ofdpa::OfdpaStatus::OfdpaStatusCode
+  ofdpaTunnelTenantCreate(uint32_t tunnel_id, uint32_t vni,
+                          completion_cb cb = nullptr);
 
   ofdpa::OfdpaStatus::OfdpaStatusCode
-  ofdpaTunnelTenantDelete(uint32_t tunnel_id);
+  ofdpaTunnelTenantDelete(uint32_t tunnel_id, completion_cb cb = nullptr);
 
   ofdpa::OfdpaStatus::OfdpaStatusCode
-  ofdpaPortSourceMacLearningSet(uint32_t port_num, uint32_t l2_learn);
+  ofdpaPortSourceMacLearningSet(uint32_t port_num, uint32_t l2_learn,
+                                completion_cb cb = nullptr);
   ofdpa::OfdpaStatus::OfdpaStatusCode
-  ofdpaPortSourceMacMoveLearningSet(uint32_t port_num, uint32_t l2_learn);
+  ofdpaPortSourceMacMoveLearningSet(uint32_t port_num, uint32_t l2_learn,
+                                    completion_cb cb = nullptr);
 
   ofdpa::OfdpaStatus::OfdpaStatusCode
   ofdpaTunnelNextHopCreate(uint32_t next_hop_id, uint64_t src_mac,
                            uint64_t dst_mac, uint32_t physical_port,
-                           uint16_t vlan_id);
+                           uint16_t vlan_id, completion_cb cb = nullptr);
 
   ofdpa::OfdpaStatus::OfdpaStatusCode
-  ofdpaTunnelNextHopDelete(uint32_t next_hop_id);
+  ofdpaTunnelNextHopDelete(uint32_t next_hop_id, completion_cb cb = nullptr);
 
   ofdpa::OfdpaStatus::OfdpaStatusCode
   ofdpaTunnelNextHopModify(uint32_t next_hop_id, uint64_t src_mac,
                            uint64_t dst_mac, uint32_t physical_port,
-                           uint16_t vlan_id);
+                           uint16_t vlan_id, completion_cb cb = nullptr);
 
   ofdpa::OfdpaStatus::OfdpaStatusCode
   ofdpaTunnelAccessPortCreate(uint32_t port_id, const std::string &port_name,
                               uint32_t physical_port, uint16_t vlan_id,
-                              bool untagged);
+                              bool untagged, completion_cb cb = nullptr);
 
   ofdpa::OfdpaStatus::OfdpaStatusCode ofdpaTunnelEndpointPortCreate(
       uint32_t port_id, const std::string &port_name, uint32_t remote_ipv4,
       uint32_t local_ipv4, uint32_t ttl, uint32_t next_hop_id,
       uint32_t terminator_udp_dst_port, uint32_t initiator_udp_dst_port,
-      uint32_t udp_src_port_if_no_entropy, bool use_entropy);
+      uint32_t udp_src_port_if_no_entropy, bool use_entropy,
+      completion_cb cb = nullptr);
 
-  ofdpa::OfdpaStatus::OfdpaStatusCode ofdpaTunnelPortDelete(uint32_t lport_id);
+  ofdpa::OfdpaStatus::OfdpaStatusCode
+  ofdpaTunnelPortDelete(uint32_t lport_id, completion_cb cb = nullptr);
 
   ofdpa::OfdpaStatus::OfdpaStatusCode
-  ofdpaTunnelPortTenantAdd(uint32_t port_id, uint32_t tunnel_id);
+  ofdpaTunnelPortTenantAdd(uint32_t port_id, uint32_t tunnel_id,
+                           completion_cb cb = nullptr);
 
   ofdpa::OfdpaStatus::OfdpaStatusCode
-  ofdpaTunnelPortTenantDelete(uint32_t port_id, uint32_t tunnel_id);
+  ofdpaTunnelPortTenantDelete(uint32_t port_id, uint32_t tunnel_id,
+                              completion_cb cb = nullptr);
 
-  ofdpa::OfdpaStatus::OfdpaStatusCode ofdpaStgReset();
-  ofdpa::OfdpaStatus::OfdpaStatusCode ofdpaStgCreate(uint16_t stg_id);
-  ofdpa::OfdpaStatus::OfdpaStatusCode ofdpaStgDestroy(uint16_t stg_id);
+  ofdpa::OfdpaStatus::OfdpaStatusCode ofdpaStgReset(completion_cb cb = nullptr);
+  ofdpa::OfdpaStatus::OfdpaStatusCode
+  ofdpaStgCreate(uint16_t stg_id, completion_cb cb = nullptr);
+  ofdpa::OfdpaStatus::OfdpaStatusCode
+  ofdpaStgDestroy(uint16_t stg_id, completion_cb cb = nullptr);
 
-  ofdpa::OfdpaStatus::OfdpaStatusCode ofdpaStgVlanAdd(uint16_t vlanid,
-                                                      uint32_t stgid);
-  ofdpa::OfdpaStatus::OfdpaStatusCode ofdpaStgVlanRemove(uint16_t vlan_id,
-                                                         uint32_t stg_id);
+  ofdpa::OfdpaStatus::OfdpaStatusCode
+  ofdpaStgVlanAdd(uint16_t vlanid, uint32_t stgid, completion_cb cb = nullptr);
+  ofdpa::OfdpaStatus::OfdpaStatusCode
+  ofdpaStgVlanRemove(uint16_t vlan_id, uint32_t stg_id,
+                     completion_cb cb = nullptr);
 
-  ofdpa::OfdpaStatus::OfdpaStatusCode ofdpaStgStatePortSet(uint32_t port_id,
-                                                           std::string state,
-                                                           uint32_t stg_id = 0);
+  ofdpa::OfdpaStatus::OfdpaStatusCode
+  ofdpaStgStatePortSet(uint32_t port_id, std::string state,
+                       uint32_t stg_id = 0, completion_cb cb = nullptr);
 
   ofdpa::OfdpaStatus::OfdpaStatusCode
-  OfdpaTrunkCreate(uint32_t lag_id, std::string name, uint8_t mode);
-  ofdpa::OfdpaStatus::OfdpaStatusCode OfdpaTrunkDelete(uint32_t lag_id);
+  OfdpaTrunkCreate(uint32_t lag_id, std::string name, uint8_t mode,
+                   completion_cb cb = nullptr);
+  ofdpa::OfdpaStatus::OfdpaStatusCode
+  OfdpaTrunkDelete(uint32_t lag_id, completion_cb cb = nullptr);
 
-  ofdpa::OfdpaStatus::OfdpaStatusCode OfdpaPortTrunkGroupSet(uint32_t port_id,
-                                                             uint32_t trunk_id);
+  ofdpa::OfdpaStatus::OfdpaStatusCode
+  OfdpaPortTrunkGroupSet(uint32_t port_id, uint32_t trunk_id,
+                         completion_cb cb = nullptr);
   ofdpa::OfdpaStatus::OfdpaStatusCode
   OfdpaTrunkPortMemberActiveSet(uint32_t port_id, uint32_t trunk_id,
-                                uint32_t active);
+                                uint32_t active, completion_cb cb = nullptr);
 
-  ofdpa::OfdpaStatus::OfdpaStatusCode ofdpaTrunkPortPSCSet(uint32_t lag_id,
-                                                           uint8_t mode);
-  ofdpa::OfdpaStatus::OfdpaStatusCode ofdpaRxRateSet(int32_t pps);
+  ofdpa::OfdpaStatus::OfdpaStatusCode
+  ofdpaTrunkPortPSCSet(uint32_t lag_id, uint8_t mode,
+                       completion_cb cb = nullptr);
+  ofdpa::OfdpaStatus::OfdpaStatusCode
+  ofdpaRxRateSet(int32_t pps, completion_cb cb = nullptr);
 
-  ofdpa::OfdpaStatus::OfdpaStatusCode ofdpaPortKnetCreate(uint32_t port_id);
-  ofdpa::OfdpaStatus::OfdpaStatusCode ofdpaPortKnetDelete(uint32_t port_id);
+  ofdpa::OfdpaStatus::OfdpaStatusCode
+  ofdpaPortKnetCreate(uint32_t port_id, completion_cb cb = nullptr);
+  ofdpa::OfdpaStatus::OfdpaStatusCode
+  ofdpaPortKnetDelete(uint32_t port_id, completion_cb cb = nullptr);
 
 private:
+  typedef std::unique_ptr<grpc::ClientAsyncResponseReader<ofdpa::OfdpaStatus>>
+      reader_ptr;
+
+  template <typename Request>
+  using prepare_fn = reader_ptr (ofdpa::OfdpaRpc::Stub::*)(
+      grpc::ClientContext *, const Request &, grpc::CompletionQueue *);
+
+  struct rpc_call;
+
   ofdpa::OfdpaStatus::OfdpaStatusCode
-  ofdpaTunnelPortCreate(const ::ofdpa::TunnelPortCreate &request);
+  ofdpaTunnelPortCreate(const ::ofdpa::TunnelPortCreate &request,
+                        completion_cb cb);
+
+  template <typename Request>
+  ofdpa::OfdpaStatus::OfdpaStatusCode call(const char *name,
+                                           prepare_fn<Request> prepare,
+                                           const Request &request,
+                                           completion_cb cb);
+  void complete(rpc_call *c, bool ok);
+  void run();
 
   std::unique_ptr<ofdpa::OfdpaRpc::Stub> stub_;
+
+  grpc::CompletionQueue cq;
+  std::thread cq_thread;
+
+  // calls in flight, canceled on destruction
+  std::set<rpc_call *> calls;
+  std::mutex calls_mutex;
 };
 
 } // namespace basebox
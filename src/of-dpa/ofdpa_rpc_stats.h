@@ -0,0 +1,30 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+
+#include "utils/latency_histogram.h"
+
+namespace basebox {
+
+// per method statistics of the RPCs sent to the OF-DPA agent
+struct ofdpa_rpc_stats {
+  std::string name;
+  uint64_t calls;
+  uint64_t inflight;
+  uint64_t ofdpa_errors; // completed, but rejected by OF-DPA
+  uint64_t deadline_exceeded;
+  uint64_t unavailable;
+  uint64_t cancelled;
+  uint64_t rpc_errors; // any other gRPC error
+  latency_stats latency;
+};
+
+// statistics of all methods called since startup
+std::deque<ofdpa_rpc_stats> ofdpa_rpc_statistics();
+
+} // namespace basebox
@@ -0,0 +1,177 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <sched.h>
+
+#include "netlink/cnetlink.h"
+#include "netlink/nbi_impl.h"
+#include "netlink/nl_capture.h"
+#include "replay_port_manager.h"
+#include "utils/record_log.h"
+#include "utils/swi_recorder.h"
+
+DECLARE_string(tryfromenv); // from gflags
+DEFINE_string(capture, "", "Netlink capture to replay");
+DEFINE_string(dump, "", "Print the switch calls recorded in this file");
+DEFINE_bool(dump_timestamps, false, "Print the timestamps of the calls");
+DEFINE_double(speed, 0,
+              "Replay speed relative to the capture (0 = as fast as possible)");
+
+// used by the netlink side, defined in netlink/nl_flags.cc
+DECLARE_int32(port_untagged_vid);
+
+static bool validate_speed(const char *flagname, double value) {
+  VLOG(3) << __FUNCTION__ << ": flagname=" << flagname << ", value=" << value;
+  if (value >= 0) // value is ok
+    return true;
+  return false;
+}
+
+static bool validate_vid(const char *flagname, gflags::int32 value) {
+  VLOG(3) << __FUNCTION__ << ": flagname=" << flagname << ", value=" << value;
+  if (value > 0 && value <= 4095) // value is ok
+    return true;
+  return false;
+}
+
+// waits until cnetlink handled everything injected so far
+static void wait_done(basebox::cnetlink *nl) {
+  while (!nl->injection_done())
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+}
+
+int main(int argc, char **argv) {
+  using basebox::cnetlink;
+  using basebox::nbi;
+  using basebox::nbi_impl;
+  using basebox::record_reader;
+  using basebox::replay_port_manager;
+  using basebox::swi_recorder;
+  using clock = std::chrono::steady_clock;
+
+  if (!gflags::RegisterFlagValidator(&FLAGS_speed, &validate_speed)) {
+    std::cerr << "Failed to register speed validator" << std::endl;
+    exit(1);
+  }
+
+  if (!gflags::RegisterFlagValidator(&FLAGS_port_untagged_vid, &validate_vid)) {
+    std::cerr << "Failed to register vid validator" << std::endl;
+    exit(1);
+  }
+
+  FLAGS_tryfromenv =
+      std::string("multicast,mark_fwd_offload,port_untagged_vid");
+  gflags::SetUsageMessage(
+      "replay a netlink capture of baseboxd without a switch\n"
+      "  nl-replay --capture=FILE [--swi_record=FILE]\n"
+      "  nl-replay --dump=FILE");
+
+  // init
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  if (!FLAGS_dump.empty()) {
+    int rv = basebox::swi_record_dump(FLAGS_dump, std::cout,
+                                      FLAGS_dump_timestamps);
+    if (rv < 0) {
+      LOG(ERROR) << "failed to dump " << FLAGS_dump << ": " << strerror(-rv);
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
+
+  record_reader reader;
+  if (FLAGS_capture.empty() ||
+      reader.open(FLAGS_capture, basebox::nl_capture_kind) < 0) {
+    LOG(ERROR) << "no valid capture given, see --help";
+    return EXIT_FAILURE;
+  }
+
+  // links, routes etc. set up by cnetlink must not reach the host
+  if (unshare(CLONE_NEWNET) < 0) {
+    LOG(ERROR) << "failed to create network namespace: " << strerror(errno);
+    return EXIT_FAILURE;
+  }
+
+  // the switch, every call succeeds
+  swi_recorder sw(nullptr);
+
+  std::shared_ptr<cnetlink> nl(new cnetlink());
+  std::shared_ptr<replay_port_manager> port_man(new replay_port_manager());
+  nbi_impl nb(nl, port_man);
+
+  nb.register_switch(&sw);
+  nb.switch_state_notification(nbi::SWITCH_STATE_UP);
+
+  uint64_t ts_ns, first_ts = 0;
+  uint16_t type;
+  std::string payload;
+  uint64_t n_snapshot = 0, n_events = 0, n_ports = 0;
+  auto start = clock::now();
+  int rv;
+
+  while ((rv = reader.next(&ts_ns, &type, &payload)) > 0) {
+    switch (type) {
+    case basebox::NL_CAPTURE_SNAPSHOT:
+      nl->inject(std::move(payload), false);
+      n_snapshot++;
+      break;
+    case basebox::NL_CAPTURE_EVENT:
+      if (FLAGS_speed > 0) {
+        if (n_events == 0)
+          first_ts = ts_ns;
+        std::this_thread::sleep_until(
+            start + std::chrono::nanoseconds(
+                        (uint64_t)((ts_ns - first_ts) / FLAGS_speed)));
+      }
+      nl->inject(std::move(payload), true);
+      n_events++;
+      break;
+    case basebox::NL_CAPTURE_PORT: {
+      nbi::port_notification_data p;
+      if (basebox::nl_capture_unpack_port(payload, &p) < 0) {
+        LOG(ERROR) << "invalid port record";
+        break;
+      }
+
+      // port notifications are handled right away, keep them in order
+      wait_done(nl.get());
+      std::deque<nbi::port_notification_data> ntfys = {p};
+      nb.port_notification(ntfys);
+      n_ports++;
+    } break;
+    default:
+      LOG(WARNING) << "skipping unknown record type " << type;
+      break;
+    }
+  }
+
+  if (rv < 0)
+    LOG(ERROR) << "capture is truncated, replaying what was read";
+
+  wait_done(nl.get());
+  double elapsed =
+      std::chrono::duration<double>(clock::now() - start).count();
+
+  std::cout << "snapshot messages: " << n_snapshot << std::endl
+            << "events: " << n_events << std::endl
+            << "port notifications: " << n_ports << std::endl
+            << "switch calls: " << sw.calls() << std::endl
+            << "elapsed: " << elapsed << " s" << std::endl
+            << "events/s: " << (elapsed > 0 ? n_events / elapsed : 0)
+            << std::endl
+            << "switch calls/s: " << (elapsed > 0 ? sw.calls() / elapsed : 0)
+            << std::endl;
+
+  return EXIT_SUCCESS;
+}
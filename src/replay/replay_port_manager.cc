@@ -0,0 +1,95 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include <cassert>
+
+#include <glog/logging.h>
+#include <netlink/route/link.h>
+
+#include "replay_port_manager.h"
+#include "utils/packet_pool.h"
+
+namespace basebox {
+
+int replay_port_manager::create_portdev(uint32_t port_id,
+                                        const std::string &port_name,
+                                        const rofl::caddress_ll &hwaddr,
+                                        switch_callback &callback) {
+  std::lock_guard<std::mutex> lock{tn_mutex};
+
+  if (port_names2id.find(port_name) != port_names2id.end()) {
+    VLOG(1) << __FUNCTION__ << ": " << port_name
+            << " with port_id=" << port_id << " already existing";
+    return 0;
+  }
+
+  port_names2id[port_name] = port_id;
+  id_to_hwaddr[port_id] = hwaddr;
+  publish_port_map();
+
+  return 0;
+}
+
+int replay_port_manager::destroy_portdev(uint32_t port_id,
+                                         const std::string &port_name) {
+  std::lock_guard<std::mutex> lock{tn_mutex};
+
+  // the link is removed by the capture
+  port_names2id.erase(port_name);
+  id_to_hwaddr.erase(port_id);
+  publish_port_map();
+
+  return 0;
+}
+
+int replay_port_manager::enqueue(uint32_t port_id, basebox::packet *pkt) {
+  packet_put(pkt);
+  return 0;
+}
+
+bool replay_port_manager::portdev_ready(rtnl_link *link) {
+  assert(link);
+
+  int ifindex = rtnl_link_get_ifindex(link);
+  std::string name(rtnl_link_get_name(link));
+  std::lock_guard<std::mutex> lock{tn_mutex};
+
+  auto tn_it = port_names2id.find(name);
+  if (tn_it == port_names2id.end()) {
+    VLOG(2) << __FUNCTION__ << ": ignoring unexpected device " << name;
+    return false;
+  }
+
+  if (ifindex_to_id.find(ifindex) != ifindex_to_id.end()) {
+    LOG(ERROR) << __FUNCTION__ << ": already registered port " << name;
+    return false;
+  }
+
+  id_to_ifindex[tn_it->second] = ifindex;
+  ifindex_to_id[ifindex] = tn_it->second;
+  publish_port_map();
+
+  return true;
+}
+
+bool replay_port_manager::portdev_removed(rtnl_link *link) {
+  assert(link);
+
+  int ifindex = rtnl_link_get_ifindex(link);
+  std::lock_guard<std::mutex> lock{tn_mutex};
+
+  auto it = ifindex_to_id.find(ifindex);
+  if (it == ifindex_to_id.end()) {
+    VLOG(2) << __FUNCTION__
+            << ": ignore removal of device with ifindex=" << ifindex;
+    return false;
+  }
+
+  id_to_ifindex.erase(it->second);
+  ifindex_to_id.erase(it);
+  publish_port_map();
+
+  return true;
+}
+
+} // namespace basebox
@@ -0,0 +1,46 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#pragma once
+
+#include <string>
+
+#include "netlink/port_manager.h"
+
+namespace basebox {
+
+/**
+ * port_manager without port devices
+ *
+ * Used to replay a netlink capture. The links of the ports are part of the
+ * capture, hence only the mappings are maintained: ports announced by the
+ * switch are registered by name and bound to the ifindex of the link with
+ * that name once it shows up. Packets are dropped.
+ */
+class replay_port_manager final : public port_manager {
+
+public:
+  replay_port_manager() = default;
+  ~replay_port_manager() = default;
+
+  int create_portdev(uint32_t port_id, const std::string &port_name,
+                     const rofl::caddress_ll &hwaddr,
+                     switch_callback &callback);
+
+  int destroy_portdev(uint32_t port_id, const std::string &port_name);
+
+  int enqueue(uint32_t port_id, basebox::packet *pkt);
+
+  int change_port_status(const std::string name, bool status) { return 0; }
+  int set_port_speed(const std::string name, uint32_t speed, uint8_t duplex) {
+    return 0;
+  }
+  int set_offloaded(rtnl_link *link, bool offloaded) { return 0; }
+
+  // access from northbound (cnetlink)
+  bool portdev_removed(rtnl_link *link);
+  bool portdev_ready(rtnl_link *link);
+  int update_mtu(rtnl_link *link) { return 0; }
+};
+
+} // namespace basebox
@@ -5,6 +5,7 @@
 
 #include <cinttypes>
 #include <deque>
+#include <functional>
 #include <set>
 
 #include <rofl/common/caddress.h>
@@ -57,6 +58,12 @@ public:
     SAI_BRIDGE_PORT_FDB_LEARNING_MODE_FDB_LOG_NOTIFICATION,
   } sai_bridge_port_fdb_learning_t;
 
+  struct l2_addr {
+    uint32_t port;
+    uint16_t vid;
+    rofl::caddress_ll mac;
+  };
+
   virtual int
   port_set_learn(uint32_t port_id,
                  sai_bridge_port_fdb_learning_t l2_learn) noexcept = 0;
@@ -68,7 +75,9 @@ public:
   virtual int lag_create(uint32_t *lag_id, std::string name,
                          uint8_t mode) noexcept = 0;
   virtual int lag_remove(uint32_t lag_id) noexcept = 0;
-  virtual int lag_add_member(uint32_t lag_id, uint32_t port_id) noexcept = 0;
+  // adds the port to the lag and sets its state in a single batch
+  virtual int lag_add_member(uint32_t lag_id, uint32_t port_id,
+                             uint8_t active) noexcept = 0;
   virtual int lag_remove_member(uint32_t lag_id, uint32_t port_id) noexcept = 0;
   virtual int lag_set_member_active(uint32_t lag_id, uint32_t port_id,
                                     uint8_t active) noexcept = 0;
@@ -90,6 +99,12 @@ public:
                           bool permanent, bool update = false) noexcept = 0;
   virtual int l2_addr_remove(uint32_t port, uint16_t vid,
                              const rofl::caddress_ll &mac) noexcept = 0;
+  // remove several entries in a single batch, returns the last error
+  virtual int
+  l2_addr_remove_bulk(const std::deque<l2_addr> &addrs) noexcept = 0;
+  // report the entries used since the last poll every interval seconds to
+  // nbi::fdb_hits, 0 disables polling
+  virtual int l2_hit_poll_interval(uint16_t interval) noexcept = 0;
 
   virtual int l2_overlay_addr_add(uint32_t lport, uint32_t tunnel_id,
                                   const rofl::cmacaddr &mac,
@@ -284,6 +299,51 @@ public:
                                      uint32_t tunnel_id) noexcept = 0;
   virtual int tunnel_port_tenant_remove(uint32_t port_id,
                                         uint32_t tunnel_id) noexcept = 0;
+
+  /**
+   * steps of setting up a tunnel endpoint in a tenant
+   *
+   * A step with a zero id is skipped, e.g. because the object exists already.
+   * Each step gets its result in rv, -ECANCELED if it was not issued.
+   */
+  struct tunnel_endpoint_ops {
+    struct {
+      uint32_t tunnel_id;
+      uint32_t vni;
+      int rv;
+    } tenant;
+    struct {
+      uint32_t next_hop_id;
+      uint64_t src_mac;
+      uint64_t dst_mac;
+      uint32_t physical_port;
+      uint16_t vlan_id;
+      int rv;
+    } next_hop;
+    struct {
+      uint32_t port_id;
+      std::string port_name;
+      uint32_t remote_ipv4;
+      uint32_t local_ipv4;
+      uint32_t ttl;
+      uint32_t next_hop_id;
+      uint32_t terminator_udp_dst_port;
+      uint32_t initiator_udp_dst_port;
+      uint32_t udp_src_port_if_no_entropy;
+      bool use_entropy;
+      int rv;
+    } endpoint;
+    struct {
+      uint32_t port_id;
+      uint32_t tunnel_id;
+      int rv;
+    } port_tenant;
+  };
+
+  // issues the tenant and next hop, then the endpoint, then adds the endpoint
+  // to the tenant, each stage only if the previous ones succeeded. Returns
+  // the first error.
+  virtual int tunnel_endpoint_setup(tunnel_endpoint_ops *setup) noexcept = 0;
   /* @} */
 
   /* @ STP  { */
@@ -296,6 +356,11 @@ public:
 
   virtual int ofdpa_stg_state_port_set(uint32_t port_id, uint16_t vlan_id,
                                        uint8_t state) noexcept = 0;
+  // same for several ports (e.g. all members of a LAG) in a single batch,
+  // returns the last error
+  virtual int ofdpa_stg_state_ports_set(const std::set<uint32_t> &port_ids,
+                                        uint16_t vlan_id,
+                                        uint8_t state) noexcept = 0;
   /* @} */
 };
 
@@ -357,6 +422,12 @@ public:
   virtual int enqueue(uint32_t port_id, basebox::packet *pkt) noexcept = 0;
   virtual int fdb_timeout(uint32_t port_id, uint16_t vid,
                           const rofl::caddress_ll &mac) noexcept = 0;
+  virtual int
+  fdb_hits(const std::deque<switch_interface::l2_addr> &hits) noexcept = 0;
+
+  // run fn on the thread calling the switch_interface, e.g. the completion
+  // of an asynchronous switch call updating state owned by that thread
+  virtual void post(std::function<void()> fn) noexcept = 0;
 };
 
 inline switch_interface::swi_flags operator|(switch_interface::swi_flags a,
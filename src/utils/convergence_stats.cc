@@ -0,0 +1,113 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include "convergence_stats.h"
+
+namespace basebox {
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+// zero initialized due to static storage
+latency_histogram latencies[CONV_EV_MAX][CONV_STAGE_MAX];
+
+thread_local conv_trace *current = nullptr;
+
+void record(enum conv_event ev, enum conv_stage stage, clock::duration d) {
+  latencies[ev][stage].record(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+}
+
+} // namespace
+
+conv_trace::conv_trace(enum conv_event ev, clock::time_point arrival)
+    : ev(ev), arrival(arrival), start(clock::now()), written(false),
+      prev(current) {
+  record(ev, CONV_STAGE_QUEUE, start - arrival);
+  current = this;
+}
+
+conv_trace::~conv_trace() {
+  current = prev;
+  record(ev, CONV_STAGE_PROCESS, clock::now() - start);
+  if (written)
+    record(ev, CONV_STAGE_SWITCH, last_write - arrival);
+}
+
+void conv_switch_write() noexcept {
+  if (current == nullptr)
+    return;
+
+  current->last_write = clock::now();
+  current->written = true;
+}
+
+conv_mark conv_barrier_sent() noexcept {
+  if (current == nullptr)
+    return conv_mark{CONV_EV_OTHER, clock::time_point(), false};
+
+  return conv_mark{current->ev, current->arrival, true};
+}
+
+void conv_barrier_done(const conv_mark &mark) noexcept {
+  if (mark.valid)
+    record(mark.ev, CONV_STAGE_BARRIER, clock::now() - mark.arrival);
+}
+
+std::deque<conv_latency_stats> conv_latency_statistics() {
+  std::deque<conv_latency_stats> stats;
+
+  for (int ev = 0; ev < CONV_EV_MAX; ev++) {
+    for (int stage = 0; stage < CONV_STAGE_MAX; stage++) {
+      conv_latency_stats s = {};
+
+      s.event = conv_event_name(static_cast<enum conv_event>(ev));
+      s.stage = conv_stage_name(static_cast<enum conv_stage>(stage));
+      latencies[ev][stage].snapshot(s);
+      stats.push_back(std::move(s));
+    }
+  }
+
+  return stats;
+}
+
+const char *conv_event_name(enum conv_event ev) noexcept {
+  switch (ev) {
+  case CONV_EV_LINK:
+    return "link";
+  case CONV_EV_NEIGH:
+    return "neigh";
+  case CONV_EV_ROUTE:
+    return "route";
+  case CONV_EV_NEXTHOP:
+    return "nexthop";
+  case CONV_EV_ADDR:
+    return "addr";
+  case CONV_EV_MDB:
+    return "mdb";
+  case CONV_EV_BRIDGE_VLAN:
+    return "bridge_vlan";
+  case CONV_EV_OTHER:
+    return "other";
+  default:
+    return "invalid";
+  }
+}
+
+const char *conv_stage_name(enum conv_stage stage) noexcept {
+  switch (stage) {
+  case CONV_STAGE_QUEUE:
+    return "queue";
+  case CONV_STAGE_PROCESS:
+    return "process";
+  case CONV_STAGE_SWITCH:
+    return "switch";
+  case CONV_STAGE_BARRIER:
+    return "barrier";
+  default:
+    return "invalid";
+  }
+}
+
+} // namespace basebox
@@ -0,0 +1,96 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+
+#include "latency_histogram.h"
+
+namespace basebox {
+
+/**
+ * Latency histograms of the convergence from a kernel event to the switch
+ *
+ * A netlink event is traced from its arrival until the switch confirmed the
+ * changes it caused. The event being handled is tracked per thread by
+ * conv_trace, calls of the switch and barriers sent on this thread are
+ * accounted to it. Recording is lock free.
+ */
+
+enum conv_event {
+  CONV_EV_LINK,
+  CONV_EV_NEIGH,
+  CONV_EV_ROUTE,
+  CONV_EV_NEXTHOP,
+  CONV_EV_ADDR,
+  CONV_EV_MDB,
+  CONV_EV_BRIDGE_VLAN,
+  CONV_EV_OTHER,
+  CONV_EV_MAX,
+};
+
+enum conv_stage {
+  CONV_STAGE_QUEUE,   // arrival until the handling started
+  CONV_STAGE_PROCESS, // duration of the handling
+  CONV_STAGE_SWITCH,  // arrival until the last call of the switch returned
+  CONV_STAGE_BARRIER, // arrival until the switch replied to the barrier
+  CONV_STAGE_MAX,
+};
+
+// event a barrier was sent for
+struct conv_mark {
+  enum conv_event ev;
+  std::chrono::steady_clock::time_point arrival;
+  bool valid;
+};
+
+/**
+ * @brief scope of handling an event
+ *
+ * Records the queueing when created and the processing and switch write when
+ * destroyed. Has to be kept on the stack of the handling thread.
+ */
+class conv_trace {
+public:
+  conv_trace(enum conv_event ev, std::chrono::steady_clock::time_point arrival);
+  ~conv_trace();
+
+  conv_trace(const conv_trace &) = delete;
+  conv_trace &operator=(const conv_trace &) = delete;
+
+private:
+  friend void conv_switch_write() noexcept;
+  friend conv_mark conv_barrier_sent() noexcept;
+
+  enum conv_event ev;
+  std::chrono::steady_clock::time_point arrival;
+  std::chrono::steady_clock::time_point start;
+  std::chrono::steady_clock::time_point last_write;
+  bool written;
+  conv_trace *prev;
+};
+
+// account a call of the switch to the event handled by this thread, if any
+void conv_switch_write() noexcept;
+
+// mark a barrier sent on this thread, to be passed to conv_barrier_done
+conv_mark conv_barrier_sent() noexcept;
+
+// the switch replied to the barrier
+void conv_barrier_done(const conv_mark &mark) noexcept;
+
+struct conv_latency_stats : latency_stats {
+  std::string event;
+  std::string stage;
+};
+
+std::deque<conv_latency_stats> conv_latency_statistics();
+
+const char *conv_event_name(enum conv_event ev) noexcept;
+const char *conv_stage_name(enum conv_stage stage) noexcept;
+
+} // namespace basebox
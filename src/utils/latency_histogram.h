@@ -0,0 +1,115 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace basebox {
+
+struct latency_stats {
+  uint64_t count;
+  uint64_t mean_ns;
+  uint64_t p50_ns;
+  uint64_t p90_ns;
+  uint64_t p99_ns;
+  uint64_t p999_ns;
+  uint64_t max_ns;
+  std::vector<std::pair<uint64_t, uint64_t>> buckets; // upper bound:count
+};
+
+/**
+ * log-linear histogram of nanosecond values in the style of HdrHistogram,
+ * each power of two is split into 8 buckets giving a precision of 12.5%
+ *
+ * Recording is lock free. The counters are not initialized, instances have to
+ * be either of static storage or value initialized.
+ */
+class latency_histogram {
+public:
+  static constexpr unsigned sub_bits = 3;
+  static constexpr unsigned sub_count = 1 << sub_bits;
+  static constexpr unsigned max_bits = 40; // ~18 minutes
+  static constexpr unsigned num_buckets =
+      (max_bits - sub_bits + 1) * sub_count + sub_count;
+
+  void record(uint64_t ns) {
+    counts[index(ns)].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(ns, std::memory_order_relaxed);
+
+    uint64_t m = max.load(std::memory_order_relaxed);
+    while (ns > m &&
+           !max.compare_exchange_weak(m, ns, std::memory_order_relaxed))
+      ;
+  }
+
+  void snapshot(latency_stats &s) const {
+    uint64_t c[num_buckets];
+    uint64_t cnt = 0;
+
+    for (unsigned i = 0; i < num_buckets; i++) {
+      c[i] = counts[i].load(std::memory_order_relaxed);
+      cnt += c[i];
+      if (c[i])
+        s.buckets.emplace_back(upper(i), c[i]);
+    }
+
+    s.count = cnt;
+    s.max_ns = max.load(std::memory_order_relaxed);
+    s.mean_ns = cnt ? sum.load(std::memory_order_relaxed) / cnt : 0;
+    s.p50_ns = percentile(c, cnt, 0.5, s.max_ns);
+    s.p90_ns = percentile(c, cnt, 0.9, s.max_ns);
+    s.p99_ns = percentile(c, cnt, 0.99, s.max_ns);
+    s.p999_ns = percentile(c, cnt, 0.999, s.max_ns);
+  }
+
+private:
+  std::atomic<uint64_t> counts[num_buckets];
+  std::atomic<uint64_t> sum;
+  std::atomic<uint64_t> max;
+
+  static unsigned index(uint64_t v) {
+    if (v < sub_count)
+      return v;
+
+    unsigned msb = 63 - __builtin_clzll(v);
+    if (msb > max_bits)
+      return num_buckets - 1;
+
+    unsigned shift = msb - sub_bits;
+    return (shift + 1) * sub_count + ((v >> shift) - sub_count);
+  }
+
+  // largest value accounted to bucket i
+  static uint64_t upper(unsigned i) {
+    if (i < sub_count)
+      return i;
+
+    unsigned shift = i / sub_count - 1;
+    uint64_t sub = i % sub_count;
+    return ((sub_count + sub + 1) << shift) - 1;
+  }
+
+  static uint64_t percentile(const uint64_t *c, uint64_t cnt, double q,
+                             uint64_t max) {
+    if (cnt == 0)
+      return 0;
+
+    uint64_t target = std::ceil(cnt * q);
+    uint64_t seen = 0;
+
+    for (unsigned i = 0; i < num_buckets; i++) {
+      seen += c[i];
+      if (seen >= target)
+        return std::min(upper(i), max);
+    }
+    return max;
+  }
+};
+
+} // namespace basebox
@@ -0,0 +1,180 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <pthread.h>
+
+#include "log_limit.h"
+
+namespace basebox {
+
+namespace {
+
+constexpr int64_t window_ns = 1000000000;
+
+struct log_entry {
+  const char *file;
+  int line;
+  google::LogSeverity severity;
+  std::string msg;
+};
+
+std::atomic<uint32_t> limit(10);
+
+// sites that suppressed messages, never removed as sites are static
+std::mutex sites_mutex;
+log_site *sites = nullptr;
+
+std::atomic<bool> async(false);
+std::mutex queue_mutex;
+std::condition_variable queue_cv;
+std::deque<log_entry> queue;
+std::size_t queue_max = 0;
+uint64_t dropped = 0;
+bool running = false;
+std::thread sink;
+
+int64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void write_log(const char *file, int line, google::LogSeverity severity,
+               const std::string &msg) {
+  google::LogMessage(file, line, severity).stream() << msg;
+}
+
+// log the suppressed messages of the sites whose window is over
+void flush_sites(int64_t now) {
+  std::lock_guard<std::mutex> lock(sites_mutex);
+
+  for (log_site *s = sites; s != nullptr; s = s->next) {
+    if (now - s->window_start.load(std::memory_order_relaxed) < window_ns)
+      continue;
+
+    uint64_t n = s->suppressed.exchange(0, std::memory_order_relaxed);
+    if (n)
+      write_log(s->file, s->line, google::GLOG_INFO,
+                "suppressed " + std::to_string(n) + " messages");
+  }
+}
+
+void run() {
+  std::unique_lock<std::mutex> lock(queue_mutex);
+
+  for (;;) {
+    queue_cv.wait_for(lock, std::chrono::seconds(1),
+                      [] { return !running || !queue.empty(); });
+
+    std::deque<log_entry> batch;
+    std::swap(batch, queue);
+    uint64_t d = dropped;
+    dropped = 0;
+    bool stop = !running;
+    lock.unlock();
+
+    for (const auto &e : batch)
+      write_log(e.file, e.line, e.severity, e.msg);
+    if (d)
+      LOG(WARNING) << __FUNCTION__ << ": dropped " << d << " log messages";
+    flush_sites(now_ns());
+
+    if (stop)
+      return;
+    lock.lock();
+  }
+}
+
+} // namespace
+
+bool log_site::allow() noexcept {
+  uint32_t max = limit.load(std::memory_order_relaxed);
+
+  if (max == 0)
+    return true;
+
+  int64_t now = now_ns();
+  int64_t start = window_start.load(std::memory_order_relaxed);
+
+  if (now - start >= window_ns &&
+      window_start.compare_exchange_strong(start, now,
+                                           std::memory_order_relaxed))
+    count.store(0, std::memory_order_relaxed);
+
+  if (count.fetch_add(1, std::memory_order_relaxed) < max)
+    return true;
+
+  suppressed.fetch_add(1, std::memory_order_relaxed);
+  if (!registered.exchange(true)) {
+    std::lock_guard<std::mutex> lock(sites_mutex);
+    next = sites;
+    sites = this;
+  }
+
+  return false;
+}
+
+log_message::log_message(log_site &site, google::LogSeverity severity)
+    : site(site), severity(severity) {}
+
+log_message::~log_message() {
+  uint64_t n = site.suppressed.exchange(0, std::memory_order_relaxed);
+
+  if (n)
+    os << " (suppressed " << n << " similar messages)";
+
+  if (!async.load(std::memory_order_relaxed)) {
+    write_log(site.file, site.line, severity, os.str());
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    if (queue.size() >= queue_max) {
+      dropped++;
+      return;
+    }
+    queue.emplace_back(log_entry{site.file, site.line, severity, os.str()});
+  }
+  queue_cv.notify_one();
+}
+
+void log_limit_init(uint32_t per_second) {
+  limit.store(per_second, std::memory_order_relaxed);
+}
+
+void log_async_start(std::size_t queue_len) {
+  std::lock_guard<std::mutex> lock(queue_mutex);
+
+  if (running)
+    return;
+
+  queue_max = queue_len;
+  running = true;
+  sink = std::thread(run);
+  pthread_setname_np(sink.native_handle(), "log_sink");
+  async.store(true, std::memory_order_relaxed);
+}
+
+void log_async_stop() {
+  async.store(false, std::memory_order_relaxed);
+
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    if (!running)
+      return;
+    running = false;
+  }
+
+  queue_cv.notify_one();
+  sink.join();
+}
+
+} // namespace basebox
@@ -0,0 +1,83 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <sstream>
+
+#include <glog/logging.h>
+
+namespace basebox {
+
+/**
+ * Rate limited logging for per event paths
+ *
+ * LOG_LIMITED(severity) is used like LOG(severity). Every statement is a site
+ * of its own, which logs at most log_limit_init() messages per second. The
+ * number of suppressed messages is appended to the next message of the site,
+ * or logged by the sink thread once the second is over.
+ *
+ * Messages are formatted on the calling thread. With log_async_start() they
+ * are written to glog by a sink thread, otherwise right away. A full queue
+ * drops messages, which is logged as well.
+ */
+
+// state of a LOG_LIMITED statement
+struct log_site {
+  log_site(const char *file, int line)
+      : file(file), line(line), window_start(0), count(0), suppressed(0),
+        registered(false), next(nullptr) {}
+
+  log_site(const log_site &) = delete;
+  log_site &operator=(const log_site &) = delete;
+
+  // whether a message may be logged now
+  bool allow() noexcept;
+
+  const char *file;
+  int line;
+  std::atomic<int64_t> window_start; // ns
+  std::atomic<uint32_t> count;       // messages in the window
+  std::atomic<uint64_t> suppressed;
+  std::atomic<bool> registered;
+  log_site *next; // list of sites that suppressed messages
+};
+
+class log_message {
+public:
+  log_message(log_site &site, google::LogSeverity severity);
+  ~log_message();
+
+  log_message(const log_message &) = delete;
+  log_message &operator=(const log_message &) = delete;
+
+  std::ostream &stream() { return os; }
+
+private:
+  log_site &site;
+  google::LogSeverity severity;
+  std::ostringstream os;
+};
+
+// messages per second and site, 0 = unlimited
+void log_limit_init(uint32_t per_second);
+
+// write the messages from a sink thread, queueing at most queue_len
+void log_async_start(std::size_t queue_len);
+
+// write the queued messages and stop the sink thread
+void log_async_stop();
+
+} // namespace basebox
+
+#define LOG_LIMITED(severity)                                                  \
+  if (basebox::log_site &log_site_ = [](const char *file,                      \
+                                        int line) -> basebox::log_site & {     \
+        static basebox::log_site site(file, line);                             \
+        return site;                                                           \
+      }(__FILE__, __LINE__);                                                   \
+      !log_site_.allow()) {                                                    \
+  } else                                                                       \
+    basebox::log_message(log_site_, google::GLOG_##severity).stream()
@@ -0,0 +1,153 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "packet_pool.h"
+
+namespace basebox {
+
+// kept in front of every packet
+struct packet_ctrl {
+  std::atomic<uint32_t> refcnt;
+  uint32_t pool;
+  std::size_t capacity;
+  std::chrono::steady_clock::time_point ts;
+  void (*release)(packet_ctrl *ctrl);
+};
+
+struct packet_pool {
+  const std::size_t size;
+  const std::size_t max_free;
+  std::mutex mutex;
+  std::vector<packet_ctrl *> free;
+};
+
+// frames up to the default MTU, jumbo frames and tap super-frames
+static packet_pool pools[] = {
+    {2048, 1024, {}, {}},
+    {10240, 256, {}, {}},
+    {65600, 32, {}, {}},
+};
+
+static constexpr uint32_t no_pool = UINT32_MAX;
+
+static inline packet_ctrl *to_ctrl(const packet *pkt) {
+  return reinterpret_cast<packet_ctrl *>(
+      reinterpret_cast<char *>(const_cast<packet *>(pkt)) -
+      sizeof(packet_ctrl));
+}
+
+static inline packet *to_packet(packet_ctrl *ctrl) {
+  return reinterpret_cast<packet *>(reinterpret_cast<char *>(ctrl) +
+                                    sizeof(packet_ctrl));
+}
+
+static void heap_release(packet_ctrl *ctrl) {
+  ctrl->~packet_ctrl();
+  std::free(ctrl);
+}
+
+static void pool_release(packet_ctrl *ctrl) {
+  packet_pool &pool = pools[ctrl->pool];
+
+  {
+    std::lock_guard<std::mutex> guard(pool.mutex);
+    if (pool.free.size() < pool.max_free) {
+      pool.free.push_back(ctrl);
+      return;
+    }
+  }
+
+  heap_release(ctrl);
+}
+
+static packet_ctrl *alloc_ctrl(std::size_t capacity) {
+  void *mem = std::malloc(sizeof(packet_ctrl) + sizeof(packet) + capacity);
+
+  if (mem == nullptr)
+    return nullptr;
+
+  return new (mem) packet_ctrl{{0}, no_pool, capacity, {}, heap_release};
+}
+
+packet *packet_alloc(std::size_t len) {
+  packet_ctrl *ctrl = nullptr;
+
+  for (uint32_t i = 0; i < sizeof(pools) / sizeof(pools[0]); i++) {
+    packet_pool &pool = pools[i];
+
+    if (len > pool.size)
+      continue;
+
+    {
+      std::lock_guard<std::mutex> guard(pool.mutex);
+      if (!pool.free.empty()) {
+        ctrl = pool.free.back();
+        pool.free.pop_back();
+      }
+    }
+
+    if (ctrl == nullptr) {
+      ctrl = alloc_ctrl(pool.size);
+      if (ctrl == nullptr)
+        return nullptr;
+      ctrl->pool = i;
+      ctrl->release = pool_release;
+    }
+    break;
+  }
+
+  if (ctrl == nullptr) {
+    ctrl = alloc_ctrl(len);
+    if (ctrl == nullptr)
+      return nullptr;
+  }
+
+  ctrl->refcnt.store(1, std::memory_order_relaxed);
+  ctrl->ts = std::chrono::steady_clock::now();
+
+  packet *pkt = to_packet(ctrl);
+  pkt->len = len;
+  return pkt;
+}
+
+packet *packet_copy(const void *data, std::size_t len) {
+  packet *pkt = packet_alloc(len);
+
+  if (pkt)
+    memcpy(pkt->data, data, len);
+
+  return pkt;
+}
+
+packet *packet_get(packet *pkt) {
+  assert(pkt);
+  to_ctrl(pkt)->refcnt.fetch_add(1, std::memory_order_relaxed);
+  return pkt;
+}
+
+void packet_put(packet *pkt) {
+  if (pkt == nullptr)
+    return;
+
+  packet_ctrl *ctrl = to_ctrl(pkt);
+  if (ctrl->refcnt.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    ctrl->release(ctrl);
+}
+
+std::size_t packet_capacity(const packet *pkt) {
+  return to_ctrl(pkt)->capacity;
+}
+
+std::chrono::steady_clock::time_point packet_timestamp(const packet *pkt) {
+  return to_ctrl(pkt)->ts;
+}
+
+} // namespace basebox
@@ -0,0 +1,83 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <utility>
+
+#include "utils.h"
+
+namespace basebox {
+
+/**
+ * Packets are reference counted buffers handed out by packet_alloc. The
+ * packet pointer itself is the handle passed between the threads, the
+ * reference count and the deleter are kept in front of it. Every reference
+ * has to be dropped using packet_put, never by std::free.
+ */
+
+/**
+ * @brief allocate a packet with room for len bytes of data
+ *
+ * Buffers up to 64k are taken from a pool of recycled buffers, larger ones
+ * are allocated from the heap. pkt->len is set to len.
+ *
+ * @return packet with a reference count of 1, or nullptr if out of memory
+ */
+packet *packet_alloc(std::size_t len);
+
+/**
+ * @brief allocate a packet and copy the frame into it
+ */
+packet *packet_copy(const void *data, std::size_t len);
+
+// take an additional reference
+packet *packet_get(packet *pkt);
+
+// drop a reference, the packet is released once the last one is gone
+void packet_put(packet *pkt);
+
+// allocated size of the data buffer
+std::size_t packet_capacity(const packet *pkt);
+
+// time the packet was allocated, i.e. entered baseboxd
+std::chrono::steady_clock::time_point packet_timestamp(const packet *pkt);
+
+/**
+ * owning handle of a packet reference, for code paths that have to release
+ * the packet on every exit
+ */
+class packet_handle {
+public:
+  packet_handle() noexcept : pkt(nullptr) {}
+  explicit packet_handle(packet *pkt) noexcept : pkt(pkt) {}
+  packet_handle(const packet_handle &other)
+      : pkt(other.pkt ? packet_get(other.pkt) : nullptr) {}
+  packet_handle(packet_handle &&other) noexcept : pkt(other.release()) {}
+  ~packet_handle() { reset(); }
+
+  packet_handle &operator=(packet_handle other) noexcept {
+    std::swap(pkt, other.pkt);
+    return *this;
+  }
+
+  packet *get() const noexcept { return pkt; }
+  packet *operator->() const noexcept { return pkt; }
+  explicit operator bool() const noexcept { return pkt != nullptr; }
+
+  // give up ownership, e.g. when passing the packet on
+  packet *release() noexcept { return std::exchange(pkt, nullptr); }
+
+  void reset(packet *p = nullptr) {
+    if (pkt)
+      packet_put(pkt);
+    pkt = p;
+  }
+
+private:
+  packet *pkt;
+};
+
+} // namespace basebox
@@ -0,0 +1,239 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+
+#include <linux/if_ether.h>
+
+#include "latency_histogram.h"
+#include "packet_pool.h"
+#include "punt_stats.h"
+
+namespace basebox {
+
+#ifndef ETH_P_LLDP
+#define ETH_P_LLDP 0x88CC
+#endif
+
+namespace {
+
+struct hop_counters {
+  std::atomic<uint64_t> packets;
+  std::atomic<uint64_t> bytes;
+  std::atomic<uint64_t> drops[PUNT_DROP_MAX];
+  std::atomic<uint64_t> ethertypes[PUNT_ETH_MAX];
+};
+
+struct port_counters {
+  std::atomic<uint32_t> port_id; // 0 = unused
+  hop_counters hops[PUNT_HOP_MAX];
+};
+
+constexpr std::size_t max_ports = 512;
+
+// zero initialized due to static storage
+port_counters ports[max_ports];
+port_counters unknown_port;
+latency_histogram latencies[PUNT_LAT_MAX];
+
+port_counters &get_port(uint32_t port_id) {
+  if (port_id == 0)
+    return unknown_port;
+
+  std::size_t h = (port_id * 0x9e3779b1u) % max_ports;
+
+  for (std::size_t i = 0; i < max_ports; i++) {
+    port_counters &p = ports[(h + i) % max_ports];
+    uint32_t id = p.port_id.load(std::memory_order_acquire);
+
+    if (id == port_id)
+      return p;
+
+    if (id == 0) {
+      if (p.port_id.compare_exchange_strong(id, port_id,
+                                            std::memory_order_acq_rel) ||
+          id == port_id)
+        return p;
+    }
+  }
+
+  return unknown_port;
+}
+
+enum punt_ethertype get_ethertype(const packet *pkt) {
+  if (pkt->len < ETH_HLEN)
+    return PUNT_ETH_OTHER;
+
+  const uint8_t *data = reinterpret_cast<const uint8_t *>(pkt->data);
+  std::size_t off = 2 * ETH_ALEN;
+  uint16_t proto = (data[off] << 8) | data[off + 1];
+
+  while ((proto == ETH_P_8021Q || proto == ETH_P_8021AD) &&
+         pkt->len >= off + 6) {
+    off += 4;
+    proto = (data[off] << 8) | data[off + 1];
+  }
+
+  switch (proto) {
+  case ETH_P_IP:
+    return PUNT_ETH_IPV4;
+  case ETH_P_IPV6:
+    return PUNT_ETH_IPV6;
+  case ETH_P_ARP:
+    return PUNT_ETH_ARP;
+  case ETH_P_LLDP:
+    return PUNT_ETH_LLDP;
+  case ETH_P_SLOW:
+    return PUNT_ETH_SLOW;
+  default:
+    return PUNT_ETH_OTHER;
+  }
+}
+
+enum punt_drop get_drop_reason(int err) {
+  switch (std::abs(err)) {
+  case EAGAIN:
+    return PUNT_DROP_EAGAIN;
+  case EIO:
+    return PUNT_DROP_EIO;
+  case ENOTCONN:
+    return PUNT_DROP_ENOTCONN;
+  case ENOBUFS:
+    return PUNT_DROP_ENOBUFS;
+  default:
+    return PUNT_DROP_OTHER;
+  }
+}
+
+} // namespace
+
+void punt_count(uint32_t port_id, enum punt_hop hop, const packet *pkt) {
+  hop_counters &c = get_port(port_id).hops[hop];
+
+  c.packets.fetch_add(1, std::memory_order_relaxed);
+  c.bytes.fetch_add(pkt->len, std::memory_order_relaxed);
+  c.ethertypes[get_ethertype(pkt)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void punt_drop(uint32_t port_id, enum punt_hop hop, int err) {
+  get_port(port_id).hops[hop].drops[get_drop_reason(err)].fetch_add(
+      1, std::memory_order_relaxed);
+}
+
+void punt_latency(enum punt_latency lat, const packet *pkt) {
+  auto d = std::chrono::steady_clock::now() - packet_timestamp(pkt);
+  latencies[lat].record(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+}
+
+std::deque<punt_port_stats> punt_port_statistics() {
+  std::deque<punt_port_stats> stats;
+
+  auto add = [&stats](const port_counters &p, uint32_t port_id) {
+    punt_port_stats s = {};
+    bool used = false;
+
+    s.port_id = port_id;
+    for (int h = 0; h < PUNT_HOP_MAX; h++) {
+      const hop_counters &c = p.hops[h];
+      punt_hop_stats &hs = s.hops[h];
+
+      hs.packets = c.packets.load(std::memory_order_relaxed);
+      hs.bytes = c.bytes.load(std::memory_order_relaxed);
+      used |= hs.packets != 0;
+      for (int i = 0; i < PUNT_DROP_MAX; i++) {
+        hs.drops[i] = c.drops[i].load(std::memory_order_relaxed);
+        used |= hs.drops[i] != 0;
+      }
+      for (int i = 0; i < PUNT_ETH_MAX; i++)
+        hs.ethertypes[i] = c.ethertypes[i].load(std::memory_order_relaxed);
+    }
+
+    if (used)
+      stats.push_back(s);
+  };
+
+  for (const auto &p : ports) {
+    uint32_t port_id = p.port_id.load(std::memory_order_acquire);
+    if (port_id)
+      add(p, port_id);
+  }
+  add(unknown_port, 0);
+
+  return stats;
+}
+
+std::deque<punt_latency_stats> punt_latency_statistics() {
+  static const char *names[PUNT_LAT_MAX] = {
+      "packet_in_dispatch",
+      "packet_in_tap",
+      "tap_packet_out",
+  };
+  std::deque<punt_latency_stats> stats;
+
+  for (int i = 0; i < PUNT_LAT_MAX; i++) {
+    punt_latency_stats s = {};
+
+    s.name = names[i];
+    latencies[i].snapshot(s);
+    stats.push_back(std::move(s));
+  }
+
+  return stats;
+}
+
+const char *punt_hop_name(enum punt_hop hop) noexcept {
+  switch (hop) {
+  case PUNT_HOP_PACKET_IN:
+    return "packet_in";
+  case PUNT_HOP_TAP_TX:
+    return "tap_tx";
+  case PUNT_HOP_TAP_RX:
+    return "tap_rx";
+  case PUNT_HOP_PACKET_OUT:
+    return "packet_out";
+  default:
+    return "invalid";
+  }
+}
+
+const char *punt_drop_name(enum punt_drop drop) noexcept {
+  switch (drop) {
+  case PUNT_DROP_EAGAIN:
+    return "eagain";
+  case PUNT_DROP_EIO:
+    return "eio";
+  case PUNT_DROP_ENOTCONN:
+    return "enotconn";
+  case PUNT_DROP_ENOBUFS:
+    return "enobufs";
+  case PUNT_DROP_OTHER:
+    return "other";
+  default:
+    return "invalid";
+  }
+}
+
+const char *punt_ethertype_name(enum punt_ethertype eth) noexcept {
+  switch (eth) {
+  case PUNT_ETH_IPV4:
+    return "ipv4";
+  case PUNT_ETH_IPV6:
+    return "ipv6";
+  case PUNT_ETH_ARP:
+    return "arp";
+  case PUNT_ETH_LLDP:
+    return "lldp";
+  case PUNT_ETH_SLOW:
+    return "slow";
+  case PUNT_ETH_OTHER:
+    return "other";
+  default:
+    return "invalid";
+  }
+}
+
+} // namespace basebox
@@ -0,0 +1,90 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+
+#include "latency_histogram.h"
+#include "utils.h"
+
+namespace basebox {
+
+/**
+ * Counters and latency histograms of the punt path
+ *
+ * All counters are updated lock free and may be written from any thread.
+ * Per port counters are kept in a fixed size table, ports beyond its size
+ * are accounted to port 0.
+ */
+
+// points a frame passes on its way between switch and host
+enum punt_hop {
+  PUNT_HOP_PACKET_IN,  // received from the switch
+  PUNT_HOP_TAP_TX,     // written to the host interface
+  PUNT_HOP_TAP_RX,     // read from the host interface
+  PUNT_HOP_PACKET_OUT, // sent to the switch
+  PUNT_HOP_MAX,
+};
+
+enum punt_drop {
+  PUNT_DROP_EAGAIN,
+  PUNT_DROP_EIO,
+  PUNT_DROP_ENOTCONN,
+  PUNT_DROP_ENOBUFS,
+  PUNT_DROP_OTHER,
+  PUNT_DROP_MAX,
+};
+
+enum punt_ethertype {
+  PUNT_ETH_IPV4,
+  PUNT_ETH_IPV6,
+  PUNT_ETH_ARP,
+  PUNT_ETH_LLDP,
+  PUNT_ETH_SLOW,
+  PUNT_ETH_OTHER,
+  PUNT_ETH_MAX,
+};
+
+enum punt_latency {
+  PUNT_LAT_PACKET_IN_DISPATCH, // packet-in until handed to the port backend
+  PUNT_LAT_PACKET_IN_TAP,      // packet-in until written to the host
+  PUNT_LAT_TAP_PACKET_OUT,     // read from the host until sent to the switch
+  PUNT_LAT_MAX,
+};
+
+// count a frame passing hop, dropped frames are counted using punt_drop
+void punt_count(uint32_t port_id, enum punt_hop hop, const packet *pkt);
+
+// count a frame dropped at hop, err is a (negative) errno
+void punt_drop(uint32_t port_id, enum punt_hop hop, int err);
+
+// record the time since pkt entered baseboxd
+void punt_latency(enum punt_latency lat, const packet *pkt);
+
+struct punt_hop_stats {
+  uint64_t packets;
+  uint64_t bytes;
+  uint64_t drops[PUNT_DROP_MAX];
+  uint64_t ethertypes[PUNT_ETH_MAX];
+};
+
+struct punt_port_stats {
+  uint32_t port_id;
+  punt_hop_stats hops[PUNT_HOP_MAX];
+};
+
+struct punt_latency_stats : latency_stats {
+  std::string name;
+};
+
+std::deque<punt_port_stats> punt_port_statistics();
+std::deque<punt_latency_stats> punt_latency_statistics();
+
+const char *punt_hop_name(enum punt_hop hop) noexcept;
+const char *punt_drop_name(enum punt_drop drop) noexcept;
+const char *punt_ethertype_name(enum punt_ethertype eth) noexcept;
+
+} // namespace basebox
@@ -0,0 +1,140 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include <cerrno>
+#include <cstring>
+
+#include <glog/logging.h>
+
+#include "record_log.h"
+
+namespace basebox {
+
+static const char record_magic[8] = {'B', 'B', 'R', 'E', 'C', 'L', 'O', 'G'};
+static const uint32_t record_version = 1;
+
+struct record_file_hdr {
+  char magic[8];
+  uint32_t version;
+  uint32_t kind;
+} __attribute__((packed));
+
+record_writer::record_writer() : f(nullptr) {}
+
+record_writer::~record_writer() { close(); }
+
+int record_writer::open(const std::string &path, uint32_t kind) {
+  std::lock_guard<std::mutex> lock(mutex);
+  record_file_hdr hdr;
+
+  if (f)
+    return -EBUSY;
+
+  f = fopen(path.c_str(), "we");
+  if (f == nullptr) {
+    int rv = -errno;
+    LOG(ERROR) << __FUNCTION__ << ": failed to create " << path << ": "
+               << strerror(errno);
+    return rv;
+  }
+
+  memcpy(hdr.magic, record_magic, sizeof(hdr.magic));
+  hdr.version = record_version;
+  hdr.kind = kind;
+  if (fwrite(&hdr, sizeof(hdr), 1, f) != 1) {
+    LOG(ERROR) << __FUNCTION__ << ": failed to write " << path;
+    fclose(f);
+    f = nullptr;
+    return -EIO;
+  }
+
+  start = std::chrono::steady_clock::now();
+  return 0;
+}
+
+void record_writer::close() {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  if (f == nullptr)
+    return;
+
+  fclose(f);
+  f = nullptr;
+}
+
+void record_writer::write(uint16_t type, const void *data, std::size_t len) {
+  write_at(now_ns(), type, data, len);
+}
+
+void record_writer::write_at(uint64_t ts_ns, uint16_t type, const void *data,
+                             std::size_t len) {
+  record_hdr hdr = {ts_ns, type, 0, static_cast<uint32_t>(len)};
+  std::lock_guard<std::mutex> lock(mutex);
+
+  if (f == nullptr)
+    return;
+
+  // stdio buffers the records, the log is flushed on close
+  if (fwrite(&hdr, sizeof(hdr), 1, f) != 1 ||
+      (len && fwrite(data, len, 1, f) != 1)) {
+    LOG(ERROR) << __FUNCTION__ << ": write failed, closing log";
+    fclose(f);
+    f = nullptr;
+  }
+}
+
+record_reader::record_reader() : f(nullptr) {}
+
+record_reader::~record_reader() {
+  if (f)
+    fclose(f);
+}
+
+int record_reader::open(const std::string &path, uint32_t kind) {
+  record_file_hdr hdr;
+
+  if (f)
+    return -EBUSY;
+
+  f = fopen(path.c_str(), "re");
+  if (f == nullptr) {
+    int rv = -errno;
+    LOG(ERROR) << __FUNCTION__ << ": failed to open " << path << ": "
+               << strerror(errno);
+    return rv;
+  }
+
+  if (fread(&hdr, sizeof(hdr), 1, f) != 1 ||
+      memcmp(hdr.magic, record_magic, sizeof(hdr.magic)) != 0 ||
+      hdr.version != record_version || hdr.kind != kind) {
+    LOG(ERROR) << __FUNCTION__ << ": " << path << " is not a valid log";
+    fclose(f);
+    f = nullptr;
+    return -EINVAL;
+  }
+
+  return 0;
+}
+
+int record_reader::next(uint64_t *ts_ns, uint16_t *type,
+                        std::string *payload) {
+  record_hdr hdr;
+
+  if (f == nullptr)
+    return 0;
+
+  if (fread(&hdr, sizeof(hdr), 1, f) != 1)
+    return feof(f) ? 0 : -EBADMSG;
+
+  payload->resize(hdr.len);
+  if (hdr.len && fread(&(*payload)[0], hdr.len, 1, f) != 1) {
+    LOG(ERROR) << __FUNCTION__ << ": truncated record";
+    return -EBADMSG;
+  }
+
+  *ts_ns = hdr.ts_ns;
+  *type = hdr.type;
+  return 1;
+}
+
+} // namespace basebox
@@ -0,0 +1,98 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+namespace basebox {
+
+/**
+ * Compact binary log of timestamped records
+ *
+ * A log starts with a header carrying a magic and the kind of the log, which
+ * is followed by the records. Each record is a fixed header (timestamp in ns
+ * since the log was opened, record type, payload length) and its payload. All
+ * values are in host byte order, logs are meant to be read on the same
+ * architecture they were written on.
+ */
+
+struct record_hdr {
+  uint64_t ts_ns;
+  uint16_t type;
+  uint16_t reserved;
+  uint32_t len;
+} __attribute__((packed));
+
+class record_writer {
+public:
+  record_writer();
+  ~record_writer();
+
+  /**
+   * @brief create the log at path, an existing file is truncated
+   *
+   * @return 0 on success, negative errno otherwise
+   */
+  int open(const std::string &path, uint32_t kind);
+  void close();
+
+  bool is_open() const { return f != nullptr; }
+
+  // append a record, may be called from any thread
+  void write(uint16_t type, const void *data, std::size_t len);
+  void write(uint16_t type, const std::string &payload) {
+    write(type, payload.data(), payload.size());
+  }
+
+  // same with an explicit timestamp in ns since the log was opened
+  void write_at(uint64_t ts_ns, uint16_t type, const void *data,
+                std::size_t len);
+
+  uint64_t now_ns() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  }
+
+private:
+  record_writer(const record_writer &) = delete;
+  record_writer &operator=(const record_writer &) = delete;
+
+  std::mutex mutex;
+  FILE *f;
+  std::chrono::steady_clock::time_point start;
+};
+
+class record_reader {
+public:
+  record_reader();
+  ~record_reader();
+
+  /**
+   * @brief open the log at path, which has to be of the given kind
+   *
+   * @return 0 on success, negative errno otherwise
+   */
+  int open(const std::string &path, uint32_t kind);
+
+  /**
+   * @brief read the next record
+   *
+   * @return 1 if a record was read, 0 at the end of the log, -EBADMSG if the
+   * log is truncated
+   */
+  int next(uint64_t *ts_ns, uint16_t *type, std::string *payload);
+
+private:
+  record_reader(const record_reader &) = delete;
+  record_reader &operator=(const record_reader &) = delete;
+
+  FILE *f;
+};
+
+} // namespace basebox
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <arpa/inet.h>
+#include <functional>
 #include <rofl/common/caddress.h>
 
 namespace rofl {
@@ -30,3 +31,15 @@ inline caddress_in6 build_mask_in6(unsigned prefix_len) {
   return rofl::caddress_in6(&sa, sizeof(sa));
 }
 } // namespace rofl
+
+namespace std {
+
+template <> struct hash<rofl::caddress_ll> {
+  using argument_type = rofl::caddress_ll;
+  using result_type = std::size_t;
+  result_type operator()(argument_type const &lla) const noexcept {
+    return std::hash<uint64_t>{}(lla.get_mac());
+  }
+};
+
+} // namespace std
@@ -0,0 +1,1172 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+#include <arpa/inet.h>
+#include <glog/logging.h>
+
+#include "packet_pool.h"
+#include "swi_recorder.h"
+
+namespace basebox {
+
+static const char *const swi_method_names[] = {
+    "unknown",
+    "port_set_learn",
+    "port_set_move_learn",
+    "lag_create",
+    "lag_remove",
+    "lag_add_member",
+    "lag_remove_member",
+    "lag_set_member_active",
+    "lag_set_mode",
+    "overlay_tunnel_add",
+    "overlay_tunnel_remove",
+    "l2_set_idle_timeout",
+    "l2_addr_remove_all_in_vlan",
+    "l2_addr_add",
+    "l2_addr_remove",
+    "l2_overlay_addr_add",
+    "l2_overlay_addr_remove",
+    "l2_multicast_group_join",
+    "l2_multicast_group_leave",
+    "l2_multicast_group_rejoin_all_in_vlan",
+    "l2_multicast_group_leave_all_in_vlan",
+    "l3_termination_add",
+    "l3_termination_add_v6",
+    "l3_termination_remove",
+    "l3_termination_remove_v6",
+    "l3_egress_create",
+    "l3_egress_update",
+    "l3_egress_remove",
+    "l3_unicast_host_add",
+    "l3_unicast_host_remove",
+    "l3_unicast_host_add",
+    "l3_unicast_host_remove",
+    "l3_unicast_route_add",
+    "l3_unicast_route_remove",
+    "l3_unicast_route_add",
+    "l3_unicast_route_remove",
+    "l3_ecmp_add",
+    "l3_ecmp_update",
+    "l3_ecmp_remove",
+    "ingress_port_vlan_accept_all",
+    "ingress_port_vlan_drop_accept_all",
+    "ingress_port_vlan_add",
+    "ingress_port_vlan_remove",
+    "ingress_port_pvid_add",
+    "ingress_port_pvid_remove",
+    "egress_port_vlan_accept_all",
+    "egress_port_vlan_drop_accept_all",
+    "egress_port_vlan_add",
+    "egress_port_vlan_remove",
+    "egress_bridge_port_vlan_add",
+    "egress_bridge_port_vlan_remove",
+    "add_l2_overlay_flood",
+    "del_l2_overlay_flood",
+    "ingress_port_stacked_vlan_enable",
+    "ingress_port_stacked_vlan_disable",
+    "ingress_port_pop_vlan_add",
+    "ingress_port_pop_vlan_remove",
+    "egress_port_push_vlan_add",
+    "egress_port_push_vlan_remove",
+    "set_egress_tpid",
+    "delete_egress_tpid",
+    "port_set_config",
+    "port_knet_create",
+    "port_knet_delete",
+    "enqueue",
+    "subscribe_to",
+    "tunnel_tenant_create",
+    "tunnel_tenant_delete",
+    "tunnel_next_hop_create",
+    "tunnel_next_hop_modify",
+    "tunnel_next_hop_delete",
+    "tunnel_access_port_create",
+    "tunnel_enpoint_create",
+    "tunnel_port_delete",
+    "tunnel_port_tenant_add",
+    "tunnel_port_tenant_remove",
+    "ofdpa_stg_create",
+    "ofdpa_stg_destroy",
+    "ofdpa_stg_state_port_set",
+    "ofdpa_stg_state_ports_set",
+    "l2_addr_remove_bulk",
+    "l2_hit_poll_interval",
+    "tunnel_endpoint_setup",
+};
+
+static_assert(sizeof(swi_method_names) / sizeof(swi_method_names[0]) ==
+                  SWI_METHOD_MAX,
+              "swi_method_names does not match enum swi_method");
+
+const char *swi_method_name(uint16_t method) {
+  if (method >= SWI_METHOD_MAX)
+    return swi_method_names[0];
+  return swi_method_names[method];
+}
+
+enum swi_arg_tag {
+  SWI_ARG_U8 = 1,
+  SWI_ARG_U16,
+  SWI_ARG_U32,
+  SWI_ARG_U64,
+  SWI_ARG_BOOL,
+  SWI_ARG_MAC,
+  SWI_ARG_IN4,
+  SWI_ARG_IN6,
+  SWI_ARG_STR,
+  SWI_ARG_SET,
+};
+
+template <typename T>
+static void append(std::string &buf, enum swi_arg_tag tag, const T &v) {
+  buf.push_back(tag);
+  buf.append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+swi_args &swi_args::u8(uint8_t v) {
+  if (!enabled)
+    return *this;
+
+  append(buf, SWI_ARG_U8, v);
+  return *this;
+}
+
+swi_args &swi_args::u16(uint16_t v) {
+  if (!enabled)
+    return *this;
+
+  append(buf, SWI_ARG_U16, v);
+  return *this;
+}
+
+swi_args &swi_args::u32(uint32_t v) {
+  if (!enabled)
+    return *this;
+
+  append(buf, SWI_ARG_U32, v);
+  return *this;
+}
+
+swi_args &swi_args::u64(uint64_t v) {
+  if (!enabled)
+    return *this;
+
+  append(buf, SWI_ARG_U64, v);
+  return *this;
+}
+
+swi_args &swi_args::flag(bool v) {
+  if (!enabled)
+    return *this;
+
+  append(buf, SWI_ARG_BOOL, static_cast<uint8_t>(v));
+  return *this;
+}
+
+swi_args &swi_args::mac(const rofl::caddress_ll &v) {
+  if (!enabled)
+    return *this;
+
+  uint8_t addr[6];
+
+  v.pack(addr, sizeof(addr));
+  append(buf, SWI_ARG_MAC, addr);
+  return *this;
+}
+
+swi_args &swi_args::in4(const rofl::caddress_in4 &v) {
+  if (!enabled)
+    return *this;
+
+  append(buf, SWI_ARG_IN4, v.get_addr_hbo());
+  return *this;
+}
+
+swi_args &swi_args::in6(const rofl::caddress_in6 &v) {
+  if (!enabled)
+    return *this;
+
+  uint8_t addr[16];
+
+  v.pack(addr, sizeof(addr));
+  append(buf, SWI_ARG_IN6, addr);
+  return *this;
+}
+
+swi_args &swi_args::str(const std::string &v) {
+  if (!enabled)
+    return *this;
+
+  append(buf, SWI_ARG_STR, static_cast<uint16_t>(v.size()));
+  buf.append(v);
+  return *this;
+}
+
+swi_args &swi_args::set(const std::set<uint32_t> &v) {
+  if (!enabled)
+    return *this;
+
+  append(buf, SWI_ARG_SET, static_cast<uint16_t>(v.size()));
+  for (auto i : v)
+    buf.append(reinterpret_cast<const char *>(&i), sizeof(i));
+  return *this;
+}
+
+// reads a value of type T at pos, false if the payload is too short
+template <typename T>
+static bool take(const std::string &buf, size_t *pos, T *v) {
+  if (buf.size() - *pos < sizeof(T))
+    return false;
+  memcpy(v, buf.data() + *pos, sizeof(T));
+  *pos += sizeof(T);
+  return true;
+}
+
+// formats the return value and arguments of a record
+static bool format_call(const std::string &payload, std::ostream &os,
+                        uint16_t method) {
+  size_t pos = 0;
+  int32_t rv;
+
+  if (!take(payload, &pos, &rv))
+    return false;
+
+  os << swi_method_name(method) << "(";
+  for (bool first = true; pos < payload.size(); first = false) {
+    uint8_t tag = payload[pos++];
+
+    if (!first)
+      os << ", ";
+
+    switch (tag) {
+    case SWI_ARG_U8: {
+      uint8_t v;
+      if (!take(payload, &pos, &v))
+        return false;
+      os << (unsigned)v;
+    } break;
+    case SWI_ARG_U16: {
+      uint16_t v;
+      if (!take(payload, &pos, &v))
+        return false;
+      os << v;
+    } break;
+    case SWI_ARG_U32: {
+      uint32_t v;
+      if (!take(payload, &pos, &v))
+        return false;
+      os << std::showbase << std::hex << v << std::dec;
+    } break;
+    case SWI_ARG_U64: {
+      uint64_t v;
+      if (!take(payload, &pos, &v))
+        return false;
+      os << std::showbase << std::hex << v << std::dec;
+    } break;
+    case SWI_ARG_BOOL: {
+      uint8_t v;
+      if (!take(payload, &pos, &v))
+        return false;
+      os << (v ? "true" : "false");
+    } break;
+    case SWI_ARG_MAC: {
+      uint8_t v[6];
+      if (!take(payload, &pos, &v))
+        return false;
+      char str[18];
+      snprintf(str, sizeof(str), "%02x:%02x:%02x:%02x:%02x:%02x", v[0], v[1],
+               v[2], v[3], v[4], v[5]);
+      os << str;
+    } break;
+    case SWI_ARG_IN4: {
+      uint32_t v;
+      char str[INET_ADDRSTRLEN];
+      if (!take(payload, &pos, &v))
+        return false;
+      v = htonl(v);
+      os << inet_ntop(AF_INET, &v, str, sizeof(str));
+    } break;
+    case SWI_ARG_IN6: {
+      uint8_t v[16];
+      char str[INET6_ADDRSTRLEN];
+      if (!take(payload, &pos, &v))
+        return false;
+      os << inet_ntop(AF_INET6, v, str, sizeof(str));
+    } break;
+    case SWI_ARG_STR: {
+      uint16_t len;
+      if (!take(payload, &pos, &len) || payload.size() - pos < len)
+        return false;
+      os << '"' << payload.substr(pos, len) << '"';
+      pos += len;
+    } break;
+    case SWI_ARG_SET: {
+      uint16_t n;
+      if (!take(payload, &pos, &n))
+        return false;
+      os << "{";
+      for (uint16_t i = 0; i < n; i++) {
+        uint32_t v;
+        if (!take(payload, &pos, &v))
+          return false;
+        os << (i ? ", " : "") << std::showbase << std::hex << v << std::dec;
+      }
+      os << "}";
+    } break;
+    default:
+      return false;
+    }
+  }
+  os << ") = " << rv;
+
+  return true;
+}
+
+int swi_record_dump(const std::string &path, std::ostream &os,
+                    bool timestamps) {
+  record_reader reader;
+  uint64_t ts_ns;
+  uint16_t method;
+  std::string payload;
+  int count = 0;
+  int rv;
+
+  rv = reader.open(path, swi_record_kind);
+  if (rv < 0)
+    return rv;
+
+  while ((rv = reader.next(&ts_ns, &method, &payload)) > 0) {
+    std::ostringstream line;
+
+    if (!format_call(payload, line, method)) {
+      LOG(ERROR) << __FUNCTION__ << ": invalid record " << count;
+      return -EBADMSG;
+    }
+
+    if (timestamps)
+      os << std::setw(12) << ts_ns / 1000 << " ";
+    os << line.str() << std::endl;
+    count++;
+  }
+
+  return rv < 0 ? rv : count;
+}
+
+swi_recorder::swi_recorder(switch_interface *inner)
+    : inner(inner), next_id(1), num_calls(0) {}
+
+void swi_recorder::record(enum swi_method method, int rv,
+                          const swi_args &args) {
+  num_calls++;
+
+  if (observer)
+    observer(method, rv);
+
+  if (!args.is_enabled() || !log.is_open())
+    return;
+
+  int32_t v = rv;
+  std::string payload(reinterpret_cast<const char *>(&v), sizeof(v));
+  payload.append(args.data());
+  log.write(method, payload);
+}
+
+int swi_recorder::port_set_learn(
+    uint32_t port_id, sai_bridge_port_fdb_learning_t l2_learn) noexcept {
+  int rv = inner ? inner->port_set_learn(port_id, l2_learn) : 0;
+  record(SWI_PORT_SET_LEARN, rv, args().u32(port_id).u8(l2_learn));
+  return rv;
+}
+
+int swi_recorder::port_set_move_learn(
+    uint32_t port_id, sai_bridge_port_fdb_learning_t l2_learn) noexcept {
+  int rv = inner ? inner->port_set_move_learn(port_id, l2_learn) : 0;
+  record(SWI_PORT_SET_MOVE_LEARN, rv, args().u32(port_id).u8(l2_learn));
+  return rv;
+}
+
+int swi_recorder::lag_create(uint32_t *lag_id, std::string name,
+                             uint8_t mode) noexcept {
+  int rv = 0;
+
+  if (inner)
+    rv = inner->lag_create(lag_id, name, mode);
+  else
+    *lag_id = nbi::combine_port_type(next_id++, nbi::port_type_lag);
+  record(SWI_LAG_CREATE, rv, args().u32(*lag_id).str(name).u8(mode));
+  return rv;
+}
+
+int swi_recorder::lag_remove(uint32_t lag_id) noexcept {
+  int rv = inner ? inner->lag_remove(lag_id) : 0;
+  record(SWI_LAG_REMOVE, rv, args().u32(lag_id));
+  return rv;
+}
+
+int swi_recorder::lag_add_member(uint32_t lag_id, uint32_t port_id,
+                                 uint8_t active) noexcept {
+  int rv = inner ? inner->lag_add_member(lag_id, port_id, active) : 0;
+  record(SWI_LAG_ADD_MEMBER, rv, args().u32(lag_id).u32(port_id).u8(active));
+  return rv;
+}
+
+int swi_recorder::lag_remove_member(uint32_t lag_id,
+                                    uint32_t port_id) noexcept {
+  int rv = inner ? inner->lag_remove_member(lag_id, port_id) : 0;
+  record(SWI_LAG_REMOVE_MEMBER, rv, args().u32(lag_id).u32(port_id));
+  return rv;
+}
+
+int swi_recorder::lag_set_member_active(uint32_t lag_id, uint32_t port_id,
+                                        uint8_t active) noexcept {
+  int rv = inner ? inner->lag_set_member_active(lag_id, port_id, active) : 0;
+  record(SWI_LAG_SET_MEMBER_ACTIVE, rv,
+         args().u32(lag_id).u32(port_id).u8(active));
+  return rv;
+}
+
+int swi_recorder::lag_set_mode(uint32_t lag_id, uint8_t mode) noexcept {
+  int rv = inner ? inner->lag_set_mode(lag_id, mode) : 0;
+  record(SWI_LAG_SET_MODE, rv, args().u32(lag_id).u8(mode));
+  return rv;
+}
+
+int swi_recorder::overlay_tunnel_add(uint32_t tunnel_id) noexcept {
+  int rv = inner ? inner->overlay_tunnel_add(tunnel_id) : 0;
+  record(SWI_OVERLAY_TUNNEL_ADD, rv, args().u32(tunnel_id));
+  return rv;
+}
+
+int swi_recorder::overlay_tunnel_remove(uint32_t tunnel_id) noexcept {
+  int rv = inner ? inner->overlay_tunnel_remove(tunnel_id) : 0;
+  record(SWI_OVERLAY_TUNNEL_REMOVE, rv, args().u32(tunnel_id));
+  return rv;
+}
+
+int swi_recorder::l2_set_idle_timeout(uint16_t idle_timeout) noexcept {
+  int rv = inner ? inner->l2_set_idle_timeout(idle_timeout) : 0;
+  record(SWI_L2_SET_IDLE_TIMEOUT, rv, args().u16(idle_timeout));
+  return rv;
+}
+
+int swi_recorder::l2_addr_remove_all_in_vlan(uint32_t port,
+                                             uint16_t vid) noexcept {
+  int rv = inner ? inner->l2_addr_remove_all_in_vlan(port, vid) : 0;
+  record(SWI_L2_ADDR_REMOVE_ALL_IN_VLAN, rv, args().u32(port).u16(vid));
+  return rv;
+}
+
+int swi_recorder::l2_addr_add(uint32_t port, uint16_t vid,
+                              const rofl::caddress_ll &mac, bool filtered,
+                              bool permanent, bool update) noexcept {
+  int rv = inner
+               ? inner->l2_addr_add(port, vid, mac, filtered, permanent, update)
+               : 0;
+  record(SWI_L2_ADDR_ADD, rv,
+         args()
+             .u32(port)
+             .u16(vid)
+             .mac(mac)
+             .flag(filtered)
+             .flag(permanent)
+             .flag(update));
+  return rv;
+}
+
+int swi_recorder::l2_addr_remove(uint32_t port, uint16_t vid,
+                                 const rofl::caddress_ll &mac) noexcept {
+  int rv = inner ? inner->l2_addr_remove(port, vid, mac) : 0;
+  record(SWI_L2_ADDR_REMOVE, rv, args().u32(port).u16(vid).mac(mac));
+  return rv;
+}
+
+int swi_recorder::l2_addr_remove_bulk(
+    const std::deque<l2_addr> &addrs) noexcept {
+  int rv = inner ? inner->l2_addr_remove_bulk(addrs) : 0;
+  swi_args bulk = args();
+
+  // only encode the addresses if they are written
+  bulk.u32(addrs.size());
+  if (bulk.is_enabled())
+    for (const auto &a : addrs)
+      bulk.u32(a.port).u16(a.vid).mac(a.mac);
+  record(SWI_L2_ADDR_REMOVE_BULK, rv, bulk);
+  return rv;
+}
+
+int swi_recorder::l2_hit_poll_interval(uint16_t interval) noexcept {
+  int rv = inner ? inner->l2_hit_poll_interval(interval) : 0;
+  record(SWI_L2_HIT_POLL_INTERVAL, rv, args().u16(interval));
+  return rv;
+}
+
+int swi_recorder::l2_overlay_addr_add(uint32_t lport, uint32_t tunnel_id,
+                                      const rofl::cmacaddr &mac,
+                                      bool permanent) noexcept {
+  int rv =
+      inner ? inner->l2_overlay_addr_add(lport, tunnel_id, mac, permanent) : 0;
+  record(SWI_L2_OVERLAY_ADDR_ADD, rv,
+         args().u32(lport).u32(tunnel_id).mac(mac).flag(permanent));
+  return rv;
+}
+
+int swi_recorder::l2_overlay_addr_remove(uint32_t tunnel_id,
+                                         uint32_t lport_id,
+                                         const rofl::cmacaddr &mac) noexcept {
+  int rv = inner ? inner->l2_overlay_addr_remove(tunnel_id, lport_id, mac) : 0;
+  record(SWI_L2_OVERLAY_ADDR_REMOVE, rv,
+         args().u32(tunnel_id).u32(lport_id).mac(mac));
+  return rv;
+}
+
+int swi_recorder::l2_multicast_group_join(
+    uint32_t port, uint16_t vid, const rofl::caddress_ll &mc_group) noexcept {
+  int rv = inner ? inner->l2_multicast_group_join(port, vid, mc_group) : 0;
+  record(SWI_L2_MULTICAST_GROUP_JOIN, rv,
+         args().u32(port).u16(vid).mac(mc_group));
+  return rv;
+}
+
+int swi_recorder::l2_multicast_group_leave(uint32_t port, uint16_t vid,
+                                           const rofl::caddress_ll &mc_group,
+                                           bool disable_only) noexcept {
+  int rv = inner ? inner->l2_multicast_group_leave(port, vid, mc_group,
+                                                   disable_only)
+                 : 0;
+  record(SWI_L2_MULTICAST_GROUP_LEAVE, rv,
+         args().u32(port).u16(vid).mac(mc_group).flag(disable_only));
+  return rv;
+}
+
+int swi_recorder::l2_multicast_group_rejoin_all_in_vlan(uint32_t port,
+                                                        uint16_t vid) noexcept {
+  int rv = inner ? inner->l2_multicast_group_rejoin_all_in_vlan(port, vid) : 0;
+  record(SWI_L2_MULTICAST_GROUP_REJOIN_ALL_IN_VLAN, rv,
+         args().u32(port).u16(vid));
+  return rv;
+}
+
+int swi_recorder::l2_multicast_group_leave_all_in_vlan(uint32_t port,
+                                                       uint16_t vid) noexcept {
+  int rv = inner ? inner->l2_multicast_group_leave_all_in_vlan(port, vid) : 0;
+  record(SWI_L2_MULTICAST_GROUP_LEAVE_ALL_IN_VLAN, rv,
+         args().u32(port).u16(vid));
+  return rv;
+}
+
+int swi_recorder::l3_termination_add(uint32_t sport, uint16_t vid,
+                                     const rofl::caddress_ll &dmac) noexcept {
+  int rv = inner ? inner->l3_termination_add(sport, vid, dmac) : 0;
+  record(SWI_L3_TERMINATION_ADD, rv, args().u32(sport).u16(vid).mac(dmac));
+  return rv;
+}
+
+int swi_recorder::l3_termination_add_v6(
+    uint32_t sport, uint16_t vid, const rofl::caddress_ll &dmac) noexcept {
+  int rv = inner ? inner->l3_termination_add_v6(sport, vid, dmac) : 0;
+  record(SWI_L3_TERMINATION_ADD_V6, rv, args().u32(sport).u16(vid).mac(dmac));
+  return rv;
+}
+
+int swi_recorder::l3_termination_remove(
+    uint32_t sport, uint16_t vid, const rofl::caddress_ll &dmac) noexcept {
+  int rv = inner ? inner->l3_termination_remove(sport, vid, dmac) : 0;
+  record(SWI_L3_TERMINATION_REMOVE, rv, args().u32(sport).u16(vid).mac(dmac));
+  return rv;
+}
+
+int swi_recorder::l3_termination_remove_v6(
+    uint32_t sport, uint16_t vid, const rofl::caddress_ll &dmac) noexcept {
+  int rv = inner ? inner->l3_termination_remove_v6(sport, vid, dmac) : 0;
+  record(SWI_L3_TERMINATION_REMOVE_V6, rv,
+         args().u32(sport).u16(vid).mac(dmac));
+  return rv;
+}
+
+int swi_recorder::l3_egress_create(uint32_t port, uint16_t vid,
+                                   const rofl::caddress_ll &src_mac,
+                                   const rofl::caddress_ll &dst_mac,
+                                   uint32_t *l3_interface) noexcept {
+  int rv = 0;
+
+  if (inner)
+    rv = inner->l3_egress_create(port, vid, src_mac, dst_mac, l3_interface);
+  else
+    *l3_interface = next_id++;
+  record(SWI_L3_EGRESS_CREATE, rv,
+         args()
+             .u32(port)
+             .u16(vid)
+             .mac(src_mac)
+             .mac(dst_mac)
+             .u32(*l3_interface));
+  return rv;
+}
+
+int swi_recorder::l3_egress_update(uint32_t port, uint16_t vid,
+                                   const rofl::caddress_ll &src_mac,
+                                   const rofl::caddress_ll &dst_mac,
+                                   uint32_t *l3_interface_id) noexcept {
+  int rv = inner ? inner->l3_egress_update(port, vid, src_mac, dst_mac,
+                                           l3_interface_id)
+                 : 0;
+  record(SWI_L3_EGRESS_UPDATE, rv,
+         args()
+             .u32(port)
+             .u16(vid)
+             .mac(src_mac)
+             .mac(dst_mac)
+             .u32(*l3_interface_id));
+  return rv;
+}
+
+int swi_recorder::l3_egress_remove(uint32_t l3_interface) noexcept {
+  int rv = inner ? inner->l3_egress_remove(l3_interface) : 0;
+  record(SWI_L3_EGRESS_REMOVE, rv, args().u32(l3_interface));
+  return rv;
+}
+
+int swi_recorder::l3_unicast_host_add(const rofl::caddress_in4 &ipv4_dst,
+                                      uint32_t l3_interface, bool is_ecmp,
+                                      bool update_route,
+                                      uint16_t vrf_id) noexcept {
+  int rv = inner ? inner->l3_unicast_host_add(ipv4_dst, l3_interface, is_ecmp,
+                                              update_route, vrf_id)
+                 : 0;
+  record(SWI_L3_UNICAST_HOST_ADD, rv,
+         args()
+             .in4(ipv4_dst)
+             .u32(l3_interface)
+             .flag(is_ecmp)
+             .flag(update_route)
+             .u16(vrf_id));
+  return rv;
+}
+
+int swi_recorder::l3_unicast_host_remove(const rofl::caddress_in4 &ipv4_dst,
+                                         uint16_t vrf_id) noexcept {
+  int rv = inner ? inner->l3_unicast_host_remove(ipv4_dst, vrf_id) : 0;
+  record(SWI_L3_UNICAST_HOST_REMOVE, rv, args().in4(ipv4_dst).u16(vrf_id));
+  return rv;
+}
+
+int swi_recorder::l3_unicast_host_add(const rofl::caddress_in6 &ipv6_dst,
+                                      uint32_t l3_interface, bool is_ecmp,
+                                      bool update_route,
+                                      uint16_t vrf_id) noexcept {
+  int rv = inner ? inner->l3_unicast_host_add(ipv6_dst, l3_interface, is_ecmp,
+                                              update_route, vrf_id)
+                 : 0;
+  record(SWI_L3_UNICAST_HOST_ADD_V6, rv,
+         args()
+             .in6(ipv6_dst)
+             .u32(l3_interface)
+             .flag(is_ecmp)
+             .flag(update_route)
+             .u16(vrf_id));
+  return rv;
+}
+
+int swi_recorder::l3_unicast_host_remove(const rofl::caddress_in6 &ipv6_dst,
+                                         uint16_t vrf_id) noexcept {
+  int rv = inner ? inner->l3_unicast_host_remove(ipv6_dst, vrf_id) : 0;
+  record(SWI_L3_UNICAST_HOST_REMOVE_V6, rv, args().in6(ipv6_dst).u16(vrf_id));
+  return rv;
+}
+
+int swi_recorder::l3_unicast_route_add(const rofl::caddress_in4 &ipv4_dst,
+                                       const rofl::caddress_in4 &mask,
+                                       uint32_t l3_interface, bool is_ecmp,
+                                       bool update_route,
+                                       uint16_t vrf_id) noexcept {
+  int rv = inner ? inner->l3_unicast_route_add(ipv4_dst, mask, l3_interface,
+                                               is_ecmp, update_route, vrf_id)
+                 : 0;
+  record(SWI_L3_UNICAST_ROUTE_ADD, rv,
+         args()
+             .in4(ipv4_dst)
+             .in4(mask)
+             .u32(l3_interface)
+             .flag(is_ecmp)
+             .flag(update_route)
+             .u16(vrf_id));
+  return rv;
+}
+
+int swi_recorder::l3_unicast_route_remove(const rofl::caddress_in4 &ipv4_dst,
+                                          const rofl::caddress_in4 &mask,
+                                          uint16_t vrf_id) noexcept {
+  int rv = inner ? inner->l3_unicast_route_remove(ipv4_dst, mask, vrf_id) : 0;
+  record(SWI_L3_UNICAST_ROUTE_REMOVE, rv,
+         args().in4(ipv4_dst).in4(mask).u16(vrf_id));
+  return rv;
+}
+
+int swi_recorder::l3_unicast_route_add(const rofl::caddress_in6 &ipv6_dst,
+                                       const rofl::caddress_in6 &mask,
+                                       uint32_t l3_interface, bool is_ecmp,
+                                       bool update_route,
+                                       uint16_t vrf_id) noexcept {
+  int rv = inner ? inner->l3_unicast_route_add(ipv6_dst, mask, l3_interface,
+                                               is_ecmp, update_route, vrf_id)
+                 : 0;
+  record(SWI_L3_UNICAST_ROUTE_ADD_V6, rv,
+         args()
+             .in6(ipv6_dst)
+             .in6(mask)
+             .u32(l3_interface)
+             .flag(is_ecmp)
+             .flag(update_route)
+             .u16(vrf_id));
+  return rv;
+}
+
+int swi_recorder::l3_unicast_route_remove(const rofl::caddress_in6 &ipv6_dst,
+                                          const rofl::caddress_in6 &mask,
+                                          uint16_t vrf_id) noexcept {
+  int rv = inner ? inner->l3_unicast_route_remove(ipv6_dst, mask, vrf_id) : 0;
+  record(SWI_L3_UNICAST_ROUTE_REMOVE_V6, rv,
+         args().in6(ipv6_dst).in6(mask).u16(vrf_id));
+  return rv;
+}
+
+int swi_recorder::l3_ecmp_add(
+    uint32_t *l3_ecmp_id, const std::set<uint32_t> &l3_interfaces) noexcept {
+  int rv = 0;
+
+  if (inner)
+    rv = inner->l3_ecmp_add(l3_ecmp_id, l3_interfaces);
+  else
+    *l3_ecmp_id = next_id++;
+  record(SWI_L3_ECMP_ADD, rv, args().u32(*l3_ecmp_id).set(l3_interfaces));
+  return rv;
+}
+
+int swi_recorder::l3_ecmp_update(
+    uint32_t l3_ecmp_id, const std::set<uint32_t> &l3_interfaces) noexcept {
+  int rv = inner ? inner->l3_ecmp_update(l3_ecmp_id, l3_interfaces) : 0;
+  record(SWI_L3_ECMP_UPDATE, rv, args().u32(l3_ecmp_id).set(l3_interfaces));
+  return rv;
+}
+
+int swi_recorder::l3_ecmp_remove(uint32_t l3_ecmp_id) noexcept {
+  int rv = inner ? inner->l3_ecmp_remove(l3_ecmp_id) : 0;
+  record(SWI_L3_ECMP_REMOVE, rv, args().u32(l3_ecmp_id));
+  return rv;
+}
+
+int swi_recorder::ingress_port_vlan_accept_all(uint32_t port) noexcept {
+  int rv = inner ? inner->ingress_port_vlan_accept_all(port) : 0;
+  record(SWI_INGRESS_PORT_VLAN_ACCEPT_ALL, rv, args().u32(port));
+  return rv;
+}
+
+int swi_recorder::ingress_port_vlan_drop_accept_all(uint32_t port) noexcept {
+  int rv = inner ? inner->ingress_port_vlan_drop_accept_all(port) : 0;
+  record(SWI_INGRESS_PORT_VLAN_DROP_ACCEPT_ALL, rv, args().u32(port));
+  return rv;
+}
+
+int swi_recorder::ingress_port_vlan_add(uint32_t port, uint16_t vid,
+                                        bool pvid, uint16_t vrf_id) noexcept {
+  int rv = inner ? inner->ingress_port_vlan_add(port, vid, pvid, vrf_id) : 0;
+  record(SWI_INGRESS_PORT_VLAN_ADD, rv,
+         args().u32(port).u16(vid).flag(pvid).u16(vrf_id));
+  return rv;
+}
+
+int swi_recorder::ingress_port_vlan_remove(uint32_t port, uint16_t vid,
+                                           bool pvid,
+                                           uint16_t vrf_id) noexcept {
+  int rv =
+      inner ? inner->ingress_port_vlan_remove(port, vid, pvid, vrf_id) : 0;
+  record(SWI_INGRESS_PORT_VLAN_REMOVE, rv,
+         args().u32(port).u16(vid).flag(pvid).u16(vrf_id));
+  return rv;
+}
+
+int swi_recorder::ingress_port_pvid_add(uint32_t port,
+                                        uint16_t pvid) noexcept {
+  int rv = inner ? inner->ingress_port_pvid_add(port, pvid) : 0;
+  record(SWI_INGRESS_PORT_PVID_ADD, rv, args().u32(port).u16(pvid));
+  return rv;
+}
+
+int swi_recorder::ingress_port_pvid_remove(uint32_t port,
+                                           uint16_t pvid) noexcept {
+  int rv = inner ? inner->ingress_port_pvid_remove(port, pvid) : 0;
+  record(SWI_INGRESS_PORT_PVID_REMOVE, rv, args().u32(port).u16(pvid));
+  return rv;
+}
+
+int swi_recorder::egress_port_vlan_accept_all(uint32_t port) noexcept {
+  int rv = inner ? inner->egress_port_vlan_accept_all(port) : 0;
+  record(SWI_EGRESS_PORT_VLAN_ACCEPT_ALL, rv, args().u32(port));
+  return rv;
+}
+
+int swi_recorder::egress_port_vlan_drop_accept_all(uint32_t port) noexcept {
+  int rv = inner ? inner->egress_port_vlan_drop_accept_all(port) : 0;
+  record(SWI_EGRESS_PORT_VLAN_DROP_ACCEPT_ALL, rv, args().u32(port));
+  return rv;
+}
+
+int swi_recorder::egress_port_vlan_add(uint32_t port, uint16_t vid,
+                                       bool untagged, bool update) noexcept {
+  int rv = inner ? inner->egress_port_vlan_add(port, vid, untagged, update) : 0;
+  record(SWI_EGRESS_PORT_VLAN_ADD, rv,
+         args().u32(port).u16(vid).flag(untagged).flag(update));
+  return rv;
+}
+
+int swi_recorder::egress_port_vlan_remove(uint32_t port,
+                                          uint16_t vid) noexcept {
+  int rv = inner ? inner->egress_port_vlan_remove(port, vid) : 0;
+  record(SWI_EGRESS_PORT_VLAN_REMOVE, rv, args().u32(port).u16(vid));
+  return rv;
+}
+
+int swi_recorder::egress_bridge_port_vlan_add(uint32_t port, uint16_t vid,
+                                              bool untagged) noexcept {
+  int rv = inner ? inner->egress_bridge_port_vlan_add(port, vid, untagged) : 0;
+  record(SWI_EGRESS_BRIDGE_PORT_VLAN_ADD, rv,
+         args().u32(port).u16(vid).flag(untagged));
+  return rv;
+}
+
+int swi_recorder::egress_bridge_port_vlan_remove(uint32_t port,
+                                                 uint16_t vid) noexcept {
+  int rv = inner ? inner->egress_bridge_port_vlan_remove(port, vid) : 0;
+  record(SWI_EGRESS_BRIDGE_PORT_VLAN_REMOVE, rv, args().u32(port).u16(vid));
+  return rv;
+}
+
+int swi_recorder::add_l2_overlay_flood(uint32_t tunnel_id,
+                                       uint32_t lport_id) noexcept {
+  int rv = inner ? inner->add_l2_overlay_flood(tunnel_id, lport_id) : 0;
+  record(SWI_ADD_L2_OVERLAY_FLOOD, rv, args().u32(tunnel_id).u32(lport_id));
+  return rv;
+}
+
+int swi_recorder::del_l2_overlay_flood(uint32_t tunnel_id,
+                                       uint32_t lport_id) noexcept {
+  int rv = inner ? inner->del_l2_overlay_flood(tunnel_id, lport_id) : 0;
+  record(SWI_DEL_L2_OVERLAY_FLOOD, rv, args().u32(tunnel_id).u32(lport_id));
+  return rv;
+}
+
+int swi_recorder::ingress_port_stacked_vlan_enable(uint32_t port,
+                                                   uint16_t vid) noexcept {
+  int rv = inner ? inner->ingress_port_stacked_vlan_enable(port, vid) : 0;
+  record(SWI_INGRESS_PORT_STACKED_VLAN_ENABLE, rv, args().u32(port).u16(vid));
+  return rv;
+}
+
+int swi_recorder::ingress_port_stacked_vlan_disable(uint32_t port,
+                                                    uint16_t vid) noexcept {
+  int rv = inner ? inner->ingress_port_stacked_vlan_disable(port, vid) : 0;
+  record(SWI_INGRESS_PORT_STACKED_VLAN_DISABLE, rv, args().u32(port).u16(vid));
+  return rv;
+}
+
+int swi_recorder::ingress_port_pop_vlan_add(uint32_t port, uint16_t outer_vid,
+                                            uint16_t inner_vid,
+                                            uint16_t vrf_id) noexcept {
+  int rv = inner ? inner->ingress_port_pop_vlan_add(port, outer_vid, inner_vid,
+                                                    vrf_id)
+                 : 0;
+  record(SWI_INGRESS_PORT_POP_VLAN_ADD, rv,
+         args().u32(port).u16(outer_vid).u16(inner_vid).u16(vrf_id));
+  return rv;
+}
+
+int swi_recorder::ingress_port_pop_vlan_remove(uint32_t port,
+                                               uint16_t outer_vid,
+                                               uint16_t inner_vid,
+                                               uint16_t vrf_id) noexcept {
+  int rv = inner ? inner->ingress_port_pop_vlan_remove(port, outer_vid,
+                                                       inner_vid, vrf_id)
+                 : 0;
+  record(SWI_INGRESS_PORT_POP_VLAN_REMOVE, rv,
+         args().u32(port).u16(outer_vid).u16(inner_vid).u16(vrf_id));
+  return rv;
+}
+
+int swi_recorder::egress_port_push_vlan_add(uint32_t port, uint16_t vid,
+                                            uint16_t push_vid) noexcept {
+  int rv = inner ? inner->egress_port_push_vlan_add(port, vid, push_vid) : 0;
+  record(SWI_EGRESS_PORT_PUSH_VLAN_ADD, rv,
+         args().u32(port).u16(vid).u16(push_vid));
+  return rv;
+}
+
+int swi_recorder::egress_port_push_vlan_remove(uint32_t port, uint16_t vid,
+                                               uint16_t push_vid) noexcept {
+  int rv =
+      inner ? inner->egress_port_push_vlan_remove(port, vid, push_vid) : 0;
+  record(SWI_EGRESS_PORT_PUSH_VLAN_REMOVE, rv,
+         args().u32(port).u16(vid).u16(push_vid));
+  return rv;
+}
+
+int swi_recorder::set_egress_tpid(uint32_t port) noexcept {
+  int rv = inner ? inner->set_egress_tpid(port) : 0;
+  record(SWI_SET_EGRESS_TPID, rv, args().u32(port));
+  return rv;
+}
+
+int swi_recorder::delete_egress_tpid(uint32_t port) noexcept {
+  int rv = inner ? inner->delete_egress_tpid(port) : 0;
+  record(SWI_DELETE_EGRESS_TPID, rv, args().u32(port));
+  return rv;
+}
+
+int swi_recorder::port_set_config(uint32_t port_id,
+                                  const rofl::caddress_ll &mac,
+                                  bool up) noexcept {
+  int rv = inner ? inner->port_set_config(port_id, mac, up) : 0;
+  record(SWI_PORT_SET_CONFIG, rv, args().u32(port_id).mac(mac).flag(up));
+  return rv;
+}
+
+int swi_recorder::port_knet_create(uint32_t port_id) noexcept {
+  int rv = inner ? inner->port_knet_create(port_id) : 0;
+  record(SWI_PORT_KNET_CREATE, rv, args().u32(port_id));
+  return rv;
+}
+
+int swi_recorder::port_knet_delete(uint32_t port_id) noexcept {
+  int rv = inner ? inner->port_knet_delete(port_id) : 0;
+  record(SWI_PORT_KNET_DELETE, rv, args().u32(port_id));
+  return rv;
+}
+
+int swi_recorder::enqueue(uint32_t port_id, basebox::packet *pkt) noexcept {
+  // the per packet path of the tap workers, only accounted if recorded
+  if (!log.is_open()) {
+    if (inner)
+      return inner->enqueue(port_id, pkt);
+    packet_put(pkt);
+    return 0;
+  }
+
+  // the packet is gone once passed on
+  uint32_t len = pkt->len;
+  int rv = 0;
+
+  if (inner)
+    rv = inner->enqueue(port_id, pkt);
+  else
+    packet_put(pkt);
+  record(SWI_ENQUEUE, rv, args().u32(port_id).u32(len));
+  return rv;
+}
+
+int swi_recorder::subscribe_to(enum swi_flags flags) noexcept {
+  int rv = inner ? inner->subscribe_to(flags) : 0;
+  record(SWI_SUBSCRIBE_TO, rv, args().u32(flags));
+  return rv;
+}
+
+bool swi_recorder::is_connected() noexcept {
+  return inner ? inner->is_connected() : true;
+}
+
+int swi_recorder::get_statistics(uint64_t port_no, uint32_t number_of_counters,
+                                 const sai_port_stat_t *counter_ids,
+                                 uint64_t *counters) noexcept {
+  if (inner)
+    return inner->get_statistics(port_no, number_of_counters, counter_ids,
+                                 counters);
+
+  memset(counters, 0, number_of_counters * sizeof(*counters));
+  return 0;
+}
+
+int swi_recorder::tunnel_tenant_create(uint32_t tunnel_id,
+                                       uint32_t vni) noexcept {
+  int rv = inner ? inner->tunnel_tenant_create(tunnel_id, vni) : 0;
+  record(SWI_TUNNEL_TENANT_CREATE, rv, args().u32(tunnel_id).u32(vni));
+  return rv;
+}
+
+int swi_recorder::tunnel_tenant_delete(uint32_t tunnel_id) noexcept {
+  int rv = inner ? inner->tunnel_tenant_delete(tunnel_id) : 0;
+  record(SWI_TUNNEL_TENANT_DELETE, rv, args().u32(tunnel_id));
+  return rv;
+}
+
+int swi_recorder::tunnel_next_hop_create(uint32_t next_hop_id,
+                                         uint64_t src_mac, uint64_t dst_mac,
+                                         uint32_t physical_port,
+                                         uint16_t vlan_id) noexcept {
+  int rv = inner ? inner->tunnel_next_hop_create(next_hop_id, src_mac, dst_mac,
+                                                 physical_port, vlan_id)
+                 : 0;
+  record(SWI_TUNNEL_NEXT_HOP_CREATE, rv,
+         args()
+             .u32(next_hop_id)
+             .u64(src_mac)
+             .u64(dst_mac)
+             .u32(physical_port)
+             .u16(vlan_id));
+  return rv;
+}
+
+int swi_recorder::tunnel_next_hop_modify(uint32_t next_hop_id,
+                                         uint64_t src_mac, uint64_t dst_mac,
+                                         uint32_t physical_port,
+                                         uint16_t vlan_id) noexcept {
+  int rv = inner ? inner->tunnel_next_hop_modify(next_hop_id, src_mac, dst_mac,
+                                                 physical_port, vlan_id)
+                 : 0;
+  record(SWI_TUNNEL_NEXT_HOP_MODIFY, rv,
+         args()
+             .u32(next_hop_id)
+             .u64(src_mac)
+             .u64(dst_mac)
+             .u32(physical_port)
+             .u16(vlan_id));
+  return rv;
+}
+
+int swi_recorder::tunnel_next_hop_delete(uint32_t next_hop_id) noexcept {
+  int rv = inner ? inner->tunnel_next_hop_delete(next_hop_id) : 0;
+  record(SWI_TUNNEL_NEXT_HOP_DELETE, rv, args().u32(next_hop_id));
+  return rv;
+}
+
+int swi_recorder::tunnel_access_port_create(uint32_t port_id,
+                                            const std::string &port_name,
+                                            uint32_t physical_port,
+                                            uint16_t vlan_id,
+                                            bool untagged) noexcept {
+  int rv = inner ? inner->tunnel_access_port_create(
+                       port_id, port_name, physical_port, vlan_id, untagged)
+                 : 0;
+  record(SWI_TUNNEL_ACCESS_PORT_CREATE, rv,
+         args()
+             .u32(port_id)
+             .str(port_name)
+             .u32(physical_port)
+             .u16(vlan_id)
+             .flag(untagged));
+  return rv;
+}
+
+int swi_recorder::tunnel_enpoint_create(
+    uint32_t port_id, const std::string &port_name, uint32_t remote_ipv4,
+    uint32_t local_ipv4, uint32_t ttl, uint32_t next_hop_id,
+    uint32_t terminator_udp_dst_port, uint32_t initiator_udp_dst_port,
+    uint32_t udp_src_port_if_no_entropy, bool use_entropy) noexcept {
+  int rv = inner ? inner->tunnel_enpoint_create(
+                       port_id, port_name, remote_ipv4, local_ipv4, ttl,
+                       next_hop_id, terminator_udp_dst_port,
+                       initiator_udp_dst_port, udp_src_port_if_no_entropy,
+                       use_entropy)
+                 : 0;
+  record(SWI_TUNNEL_ENDPOINT_CREATE, rv,
+         args()
+             .u32(port_id)
+             .str(port_name)
+             .u32(remote_ipv4)
+             .u32(local_ipv4)
+             .u32(ttl)
+             .u32(next_hop_id)
+             .u32(terminator_udp_dst_port)
+             .u32(initiator_udp_dst_port)
+             .u32(udp_src_port_if_no_entropy)
+             .flag(use_entropy));
+  return rv;
+}
+
+int swi_recorder::tunnel_port_delete(uint32_t port_id) noexcept {
+  int rv = inner ? inner->tunnel_port_delete(port_id) : 0;
+  record(SWI_TUNNEL_PORT_DELETE, rv, args().u32(port_id));
+  return rv;
+}
+
+int swi_recorder::tunnel_port_tenant_add(uint32_t port_id,
+                                         uint32_t tunnel_id) noexcept {
+  int rv = inner ? inner->tunnel_port_tenant_add(port_id, tunnel_id) : 0;
+  record(SWI_TUNNEL_PORT_TENANT_ADD, rv, args().u32(port_id).u32(tunnel_id));
+  return rv;
+}
+
+int swi_recorder::tunnel_port_tenant_remove(uint32_t port_id,
+                                            uint32_t tunnel_id) noexcept {
+  int rv = inner ? inner->tunnel_port_tenant_remove(port_id, tunnel_id) : 0;
+  record(SWI_TUNNEL_PORT_TENANT_REMOVE, rv, args().u32(port_id).u32(tunnel_id));
+  return rv;
+}
+
+int swi_recorder::tunnel_endpoint_setup(tunnel_endpoint_ops *s) noexcept {
+  int rv = 0;
+
+  if (inner)
+    rv = inner->tunnel_endpoint_setup(s);
+  else
+    s->tenant.rv = s->next_hop.rv = s->endpoint.rv = s->port_tenant.rv = 0;
+
+  record(SWI_TUNNEL_ENDPOINT_SETUP, rv,
+         args()
+             .u32(s->tenant.tunnel_id)
+             .u32(s->tenant.vni)
+             .u32(s->next_hop.next_hop_id)
+             .u64(s->next_hop.src_mac)
+             .u64(s->next_hop.dst_mac)
+             .u32(s->next_hop.physical_port)
+             .u16(s->next_hop.vlan_id)
+             .u32(s->endpoint.port_id)
+             .str(s->endpoint.port_name)
+             .u32(s->endpoint.remote_ipv4)
+             .u32(s->endpoint.local_ipv4)
+             .u32(s->endpoint.ttl)
+             .u32(s->endpoint.next_hop_id)
+             .u32(s->endpoint.terminator_udp_dst_port)
+             .u32(s->endpoint.initiator_udp_dst_port)
+             .u32(s->endpoint.udp_src_port_if_no_entropy)
+             .flag(s->endpoint.use_entropy)
+             .u32(s->port_tenant.port_id)
+             .u32(s->port_tenant.tunnel_id));
+  return rv;
+}
+
+int swi_recorder::ofdpa_stg_create(uint16_t vlan_id) noexcept {
+  int rv = inner ? inner->ofdpa_stg_create(vlan_id) : 0;
+  record(SWI_OFDPA_STG_CREATE, rv, args().u16(vlan_id));
+  return rv;
+}
+
+int swi_recorder::ofdpa_stg_destroy(uint16_t vlan_id) noexcept {
+  int rv = inner ? inner->ofdpa_stg_destroy(vlan_id) : 0;
+  record(SWI_OFDPA_STG_DESTROY, rv, args().u16(vlan_id));
+  return rv;
+}
+
+int swi_recorder::ofdpa_stg_state_port_set(uint32_t port_id, uint16_t vlan_id,
+                                           uint8_t state) noexcept {
+  int rv = inner ? inner->ofdpa_stg_state_port_set(port_id, vlan_id, state)
+                 : 0;
+  record(SWI_OFDPA_STG_STATE_PORT_SET, rv,
+         args().u32(port_id).u16(vlan_id).u8(state));
+  return rv;
+}
+
+int swi_recorder::ofdpa_stg_state_ports_set(const std::set<uint32_t> &port_ids,
+                                            uint16_t vlan_id,
+                                            uint8_t state) noexcept {
+  int rv = inner ? inner->ofdpa_stg_state_ports_set(port_ids, vlan_id, state)
+                 : 0;
+  record(SWI_OFDPA_STG_STATE_PORTS_SET, rv,
+         args().set(port_ids).u16(vlan_id).u8(state));
+  return rv;
+}
+
+} // namespace basebox
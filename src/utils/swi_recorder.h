@@ -0,0 +1,383 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <ostream>
+#include <string>
+
+#include "record_log.h"
+#include "sai.h"
+
+namespace basebox {
+
+// kind of the record log
+static constexpr uint32_t swi_record_kind = 0x73776963; // "swic"
+
+// record types of the log, one per recorded method
+enum swi_method {
+  SWI_PORT_SET_LEARN = 1,
+  SWI_PORT_SET_MOVE_LEARN,
+  SWI_LAG_CREATE,
+  SWI_LAG_REMOVE,
+  SWI_LAG_ADD_MEMBER,
+  SWI_LAG_REMOVE_MEMBER,
+  SWI_LAG_SET_MEMBER_ACTIVE,
+  SWI_LAG_SET_MODE,
+  SWI_OVERLAY_TUNNEL_ADD,
+  SWI_OVERLAY_TUNNEL_REMOVE,
+  SWI_L2_SET_IDLE_TIMEOUT,
+  SWI_L2_ADDR_REMOVE_ALL_IN_VLAN,
+  SWI_L2_ADDR_ADD,
+  SWI_L2_ADDR_REMOVE,
+  SWI_L2_OVERLAY_ADDR_ADD,
+  SWI_L2_OVERLAY_ADDR_REMOVE,
+  SWI_L2_MULTICAST_GROUP_JOIN,
+  SWI_L2_MULTICAST_GROUP_LEAVE,
+  SWI_L2_MULTICAST_GROUP_REJOIN_ALL_IN_VLAN,
+  SWI_L2_MULTICAST_GROUP_LEAVE_ALL_IN_VLAN,
+  SWI_L3_TERMINATION_ADD,
+  SWI_L3_TERMINATION_ADD_V6,
+  SWI_L3_TERMINATION_REMOVE,
+  SWI_L3_TERMINATION_REMOVE_V6,
+  SWI_L3_EGRESS_CREATE,
+  SWI_L3_EGRESS_UPDATE,
+  SWI_L3_EGRESS_REMOVE,
+  SWI_L3_UNICAST_HOST_ADD,
+  SWI_L3_UNICAST_HOST_REMOVE,
+  SWI_L3_UNICAST_HOST_ADD_V6,
+  SWI_L3_UNICAST_HOST_REMOVE_V6,
+  SWI_L3_UNICAST_ROUTE_ADD,
+  SWI_L3_UNICAST_ROUTE_REMOVE,
+  SWI_L3_UNICAST_ROUTE_ADD_V6,
+  SWI_L3_UNICAST_ROUTE_REMOVE_V6,
+  SWI_L3_ECMP_ADD,
+  SWI_L3_ECMP_UPDATE,
+  SWI_L3_ECMP_REMOVE,
+  SWI_INGRESS_PORT_VLAN_ACCEPT_ALL,
+  SWI_INGRESS_PORT_VLAN_DROP_ACCEPT_ALL,
+  SWI_INGRESS_PORT_VLAN_ADD,
+  SWI_INGRESS_PORT_VLAN_REMOVE,
+  SWI_INGRESS_PORT_PVID_ADD,
+  SWI_INGRESS_PORT_PVID_REMOVE,
+  SWI_EGRESS_PORT_VLAN_ACCEPT_ALL,
+  SWI_EGRESS_PORT_VLAN_DROP_ACCEPT_ALL,
+  SWI_EGRESS_PORT_VLAN_ADD,
+  SWI_EGRESS_PORT_VLAN_REMOVE,
+  SWI_EGRESS_BRIDGE_PORT_VLAN_ADD,
+  SWI_EGRESS_BRIDGE_PORT_VLAN_REMOVE,
+  SWI_ADD_L2_OVERLAY_FLOOD,
+  SWI_DEL_L2_OVERLAY_FLOOD,
+  SWI_INGRESS_PORT_STACKED_VLAN_ENABLE,
+  SWI_INGRESS_PORT_STACKED_VLAN_DISABLE,
+  SWI_INGRESS_PORT_POP_VLAN_ADD,
+  SWI_INGRESS_PORT_POP_VLAN_REMOVE,
+  SWI_EGRESS_PORT_PUSH_VLAN_ADD,
+  SWI_EGRESS_PORT_PUSH_VLAN_REMOVE,
+  SWI_SET_EGRESS_TPID,
+  SWI_DELETE_EGRESS_TPID,
+  SWI_PORT_SET_CONFIG,
+  SWI_PORT_KNET_CREATE,
+  SWI_PORT_KNET_DELETE,
+  SWI_ENQUEUE,
+  SWI_SUBSCRIBE_TO,
+  SWI_TUNNEL_TENANT_CREATE,
+  SWI_TUNNEL_TENANT_DELETE,
+  SWI_TUNNEL_NEXT_HOP_CREATE,
+  SWI_TUNNEL_NEXT_HOP_MODIFY,
+  SWI_TUNNEL_NEXT_HOP_DELETE,
+  SWI_TUNNEL_ACCESS_PORT_CREATE,
+  SWI_TUNNEL_ENDPOINT_CREATE,
+  SWI_TUNNEL_PORT_DELETE,
+  SWI_TUNNEL_PORT_TENANT_ADD,
+  SWI_TUNNEL_PORT_TENANT_REMOVE,
+  SWI_OFDPA_STG_CREATE,
+  SWI_OFDPA_STG_DESTROY,
+  SWI_OFDPA_STG_STATE_PORT_SET,
+  SWI_OFDPA_STG_STATE_PORTS_SET,
+  SWI_L2_ADDR_REMOVE_BULK,
+  SWI_L2_HIT_POLL_INTERVAL,
+  SWI_TUNNEL_ENDPOINT_SETUP,
+  SWI_METHOD_MAX,
+};
+
+const char *swi_method_name(uint16_t method);
+
+/**
+ * arguments of a recorded call
+ *
+ * Every argument is stored with a type tag in front, which makes the records
+ * self describing and allows to dump them without knowing the signatures. A
+ * disabled instance ignores the arguments and does not allocate.
+ */
+class swi_args {
+public:
+  explicit swi_args(bool enabled = true) : enabled(enabled) {}
+
+  swi_args &u8(uint8_t v);
+  swi_args &u16(uint16_t v);
+  swi_args &u32(uint32_t v);
+  swi_args &u64(uint64_t v);
+  swi_args &flag(bool v);
+  swi_args &mac(const rofl::caddress_ll &v);
+  swi_args &in4(const rofl::caddress_in4 &v);
+  swi_args &in6(const rofl::caddress_in6 &v);
+  swi_args &str(const std::string &v);
+  swi_args &set(const std::set<uint32_t> &v);
+
+  const std::string &data() const { return buf; }
+  bool is_enabled() const { return enabled; }
+
+private:
+  std::string buf;
+  bool enabled;
+};
+
+/**
+ * @brief print the records of a log written by swi_recorder
+ *
+ * One line per call: "method(args) = rv", prefixed by the timestamp in us if
+ * requested. Without timestamps the output of two runs can be diffed.
+ *
+ * @return number of records, negative errno on error
+ */
+int swi_record_dump(const std::string &path, std::ostream &os,
+                    bool timestamps);
+
+/**
+ * switch_interface recording every call
+ *
+ * Calls are passed on to the inner switch_interface and recorded with their
+ * arguments and return value once open() was called. Without an inner
+ * switch_interface every call succeeds, ids returned by the switch are
+ * allocated from a counter and enqueued packets are dropped. This allows to
+ * run the netlink side without a switch.
+ *
+ * is_connected() and get_statistics() are passed on but not recorded, they
+ * do not change the state of the switch. enqueue() is on the per packet path
+ * and only counted and observed while recording.
+ */
+class swi_recorder final : public switch_interface {
+public:
+  explicit swi_recorder(switch_interface *inner);
+  ~swi_recorder() override = default;
+
+  // start recording to path, 0 on success or negative errno
+  int open(const std::string &path) { return log.open(path, swi_record_kind); }
+  void close() { log.close(); }
+
+  uint64_t calls() const { return num_calls; }
+
+  // called after every recorded call with its method and return value, e.g.
+  // to measure how long it took until a change reached the switch. Has to be
+  // set before the switch is registered.
+  void set_observer(std::function<void(enum swi_method, int)> cb) {
+    observer = std::move(cb);
+  }
+
+  int port_set_learn(uint32_t port_id,
+                     sai_bridge_port_fdb_learning_t l2_learn) noexcept override;
+  int port_set_move_learn(
+      uint32_t port_id,
+      sai_bridge_port_fdb_learning_t l2_learn) noexcept override;
+
+  int lag_create(uint32_t *lag_id, std::string name,
+                 uint8_t mode) noexcept override;
+  int lag_remove(uint32_t lag_id) noexcept override;
+  int lag_add_member(uint32_t lag_id, uint32_t port_id,
+                     uint8_t active) noexcept override;
+  int lag_remove_member(uint32_t lag_id, uint32_t port_id) noexcept override;
+  int lag_set_member_active(uint32_t lag_id, uint32_t port_id,
+                            uint8_t active) noexcept override;
+  int lag_set_mode(uint32_t lag_id, uint8_t mode) noexcept override;
+
+  int overlay_tunnel_add(uint32_t tunnel_id) noexcept override;
+  int overlay_tunnel_remove(uint32_t tunnel_id) noexcept override;
+
+  int l2_set_idle_timeout(uint16_t idle_timeout) noexcept override;
+  int l2_addr_remove_all_in_vlan(uint32_t port,
+                                 uint16_t vid) noexcept override;
+  int l2_addr_add(uint32_t port, uint16_t vid, const rofl::caddress_ll &mac,
+                  bool filtered, bool permanent,
+                  bool update) noexcept override;
+  int l2_addr_remove(uint32_t port, uint16_t vid,
+                     const rofl::caddress_ll &mac) noexcept override;
+  int l2_addr_remove_bulk(const std::deque<l2_addr> &addrs) noexcept override;
+  int l2_hit_poll_interval(uint16_t interval) noexcept override;
+  int l2_overlay_addr_add(uint32_t lport, uint32_t tunnel_id,
+                          const rofl::cmacaddr &mac,
+                          bool permanent) noexcept override;
+  int l2_overlay_addr_remove(uint32_t tunnel_id, uint32_t lport_id,
+                             const rofl::cmacaddr &mac) noexcept override;
+
+  int l2_multicast_group_join(
+      uint32_t port, uint16_t vid,
+      const rofl::caddress_ll &mc_group) noexcept override;
+  int l2_multicast_group_leave(uint32_t port, uint16_t vid,
+                               const rofl::caddress_ll &mc_group,
+                               bool disable_only) noexcept override;
+  int l2_multicast_group_rejoin_all_in_vlan(uint32_t port,
+                                            uint16_t vid) noexcept override;
+  int l2_multicast_group_leave_all_in_vlan(uint32_t port,
+                                           uint16_t vid) noexcept override;
+
+  int l3_termination_add(uint32_t sport, uint16_t vid,
+                         const rofl::caddress_ll &dmac) noexcept override;
+  int l3_termination_add_v6(uint32_t sport, uint16_t vid,
+                            const rofl::caddress_ll &dmac) noexcept override;
+  int l3_termination_remove(uint32_t sport, uint16_t vid,
+                            const rofl::caddress_ll &dmac) noexcept override;
+  int l3_termination_remove_v6(
+      uint32_t sport, uint16_t vid,
+      const rofl::caddress_ll &dmac) noexcept override;
+
+  int l3_egress_create(uint32_t port, uint16_t vid,
+                       const rofl::caddress_ll &src_mac,
+                       const rofl::caddress_ll &dst_mac,
+                       uint32_t *l3_interface) noexcept override;
+  int l3_egress_update(uint32_t port, uint16_t vid,
+                       const rofl::caddress_ll &src_mac,
+                       const rofl::caddress_ll &dst_mac,
+                       uint32_t *l3_interface_id) noexcept override;
+  int l3_egress_remove(uint32_t l3_interface) noexcept override;
+
+  int l3_unicast_host_add(const rofl::caddress_in4 &ipv4_dst,
+                          uint32_t l3_interface, bool is_ecmp,
+                          bool update_route,
+                          uint16_t vrf_id) noexcept override;
+  int l3_unicast_host_remove(const rofl::caddress_in4 &ipv4_dst,
+                             uint16_t vrf_id) noexcept override;
+  int l3_unicast_host_add(const rofl::caddress_in6 &ipv6_dst,
+                          uint32_t l3_interface, bool is_ecmp,
+                          bool update_route,
+                          uint16_t vrf_id) noexcept override;
+  int l3_unicast_host_remove(const rofl::caddress_in6 &ipv6_dst,
+                             uint16_t vrf_id) noexcept override;
+  int l3_unicast_route_add(const rofl::caddress_in4 &ipv4_dst,
+                           const rofl::caddress_in4 &mask,
+                           uint32_t l3_interface, bool is_ecmp,
+                           bool update_route,
+                           uint16_t vrf_id) noexcept override;
+  int l3_unicast_route_remove(const rofl::caddress_in4 &ipv4_dst,
+                              const rofl::caddress_in4 &mask,
+                              uint16_t vrf_id) noexcept override;
+  int l3_unicast_route_add(const rofl::caddress_in6 &ipv6_dst,
+                           const rofl::caddress_in6 &mask,
+                           uint32_t l3_interface, bool is_ecmp,
+                           bool update_route,
+                           uint16_t vrf_id) noexcept override;
+  int l3_unicast_route_remove(const rofl::caddress_in6 &ipv6_dst,
+                              const rofl::caddress_in6 &mask,
+                              uint16_t vrf_id) noexcept override;
+
+  int l3_ecmp_add(uint32_t *l3_ecmp_id,
+                  const std::set<uint32_t> &l3_interfaces) noexcept override;
+  int l3_ecmp_update(uint32_t l3_ecmp_id,
+                     const std::set<uint32_t> &l3_interfaces) noexcept override;
+  int l3_ecmp_remove(uint32_t l3_ecmp_id) noexcept override;
+
+  int ingress_port_vlan_accept_all(uint32_t port) noexcept override;
+  int ingress_port_vlan_drop_accept_all(uint32_t port) noexcept override;
+  int ingress_port_vlan_add(uint32_t port, uint16_t vid, bool pvid,
+                            uint16_t vrf_id) noexcept override;
+  int ingress_port_vlan_remove(uint32_t port, uint16_t vid, bool pvid,
+                               uint16_t vrf_id) noexcept override;
+  int ingress_port_pvid_add(uint32_t port, uint16_t pvid) noexcept override;
+  int ingress_port_pvid_remove(uint32_t port, uint16_t pvid) noexcept override;
+
+  int egress_port_vlan_accept_all(uint32_t port) noexcept override;
+  int egress_port_vlan_drop_accept_all(uint32_t port) noexcept override;
+  int egress_port_vlan_add(uint32_t port, uint16_t vid, bool untagged,
+                           bool update) noexcept override;
+  int egress_port_vlan_remove(uint32_t port, uint16_t vid) noexcept override;
+  int egress_bridge_port_vlan_add(uint32_t port, uint16_t vid,
+                                  bool untagged) noexcept override;
+  int egress_bridge_port_vlan_remove(uint32_t port,
+                                     uint16_t vid) noexcept override;
+
+  int add_l2_overlay_flood(uint32_t tunnel_id,
+                           uint32_t lport_id) noexcept override;
+  int del_l2_overlay_flood(uint32_t tunnel_id,
+                           uint32_t lport_id) noexcept override;
+
+  int ingress_port_stacked_vlan_enable(uint32_t port,
+                                       uint16_t vid) noexcept override;
+  int ingress_port_stacked_vlan_disable(uint32_t port,
+                                        uint16_t vid) noexcept override;
+  int ingress_port_pop_vlan_add(uint32_t port, uint16_t outer_vid,
+                                uint16_t inner_vid,
+                                uint16_t vrf_id) noexcept override;
+  int ingress_port_pop_vlan_remove(uint32_t port, uint16_t outer_vid,
+                                   uint16_t inner_vid,
+                                   uint16_t vrf_id) noexcept override;
+  int egress_port_push_vlan_add(uint32_t port, uint16_t vid,
+                                uint16_t push_vid) noexcept override;
+  int egress_port_push_vlan_remove(uint32_t port, uint16_t vid,
+                                   uint16_t push_vid) noexcept override;
+  int set_egress_tpid(uint32_t port) noexcept override;
+  int delete_egress_tpid(uint32_t port) noexcept override;
+
+  int port_set_config(uint32_t port_id, const rofl::caddress_ll &mac,
+                      bool up) noexcept override;
+  int port_knet_create(uint32_t port_id) noexcept override;
+  int port_knet_delete(uint32_t port_id) noexcept override;
+
+  int enqueue(uint32_t port_id, basebox::packet *pkt) noexcept override;
+  int subscribe_to(enum swi_flags flags) noexcept override;
+  bool is_connected() noexcept override;
+  int get_statistics(uint64_t port_no, uint32_t number_of_counters,
+                     const sai_port_stat_t *counter_ids,
+                     uint64_t *counters) noexcept override;
+
+  int tunnel_tenant_create(uint32_t tunnel_id, uint32_t vni) noexcept override;
+  int tunnel_tenant_delete(uint32_t tunnel_id) noexcept override;
+  int tunnel_next_hop_create(uint32_t next_hop_id, uint64_t src_mac,
+                             uint64_t dst_mac, uint32_t physical_port,
+                             uint16_t vlan_id) noexcept override;
+  int tunnel_next_hop_modify(uint32_t next_hop_id, uint64_t src_mac,
+                             uint64_t dst_mac, uint32_t physical_port,
+                             uint16_t vlan_id) noexcept override;
+  int tunnel_next_hop_delete(uint32_t next_hop_id) noexcept override;
+  int tunnel_access_port_create(uint32_t port_id, const std::string &port_name,
+                                uint32_t physical_port, uint16_t vlan_id,
+                                bool untagged) noexcept override;
+  int tunnel_enpoint_create(uint32_t port_id, const std::string &port_name,
+                            uint32_t remote_ipv4, uint32_t local_ipv4,
+                            uint32_t ttl, uint32_t next_hop_id,
+                            uint32_t terminator_udp_dst_port,
+                            uint32_t initiator_udp_dst_port,
+                            uint32_t udp_src_port_if_no_entropy,
+                            bool use_entropy) noexcept override;
+  int tunnel_port_delete(uint32_t port_id) noexcept override;
+  int tunnel_port_tenant_add(uint32_t port_id,
+                             uint32_t tunnel_id) noexcept override;
+  int tunnel_port_tenant_remove(uint32_t port_id,
+                                uint32_t tunnel_id) noexcept override;
+  int tunnel_endpoint_setup(tunnel_endpoint_ops *setup) noexcept override;
+
+  int ofdpa_stg_create(uint16_t vlan_id) noexcept override;
+  int ofdpa_stg_destroy(uint16_t vlan_id) noexcept override;
+  int ofdpa_stg_state_port_set(uint32_t port_id, uint16_t vlan_id,
+                               uint8_t state) noexcept override;
+  int ofdpa_stg_state_ports_set(const std::set<uint32_t> &port_ids,
+                                uint16_t vlan_id,
+                                uint8_t state) noexcept override;
+
+private:
+  swi_recorder(const swi_recorder &) = delete;
+  swi_recorder &operator=(const swi_recorder &) = delete;
+
+  // arguments of a call, only encoded while recording
+  swi_args args() const { return swi_args(log.is_open()); }
+  void record(enum swi_method method, int rv, const swi_args &args);
+
+  switch_interface *inner;
+  record_writer log;
+  std::atomic<uint32_t> next_id;
+  std::atomic<uint64_t> num_calls;
+  std::function<void(enum swi_method, int)> observer;
+};
+
+} // namespace basebox
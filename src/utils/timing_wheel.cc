@@ -0,0 +1,68 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include "timing_wheel.h"
+
+namespace basebox {
+
+timing_wheel::timing_wheel(uint32_t now) : current(now), count(0) {}
+
+void timing_wheel::schedule(uint64_t key, uint32_t deadline, uint32_t data) {
+  const uint32_t range = (1U << (bits * levels)) - 1;
+
+  // compare as distances to stay correct when the ticks wrap around
+  if (static_cast<int32_t>(deadline - current) <= 0)
+    deadline = current + 1;
+  else if (deadline - current > range)
+    deadline = current + range;
+
+  place(timer{key, deadline, data});
+  count++;
+}
+
+void timing_wheel::place(const timer &t) {
+  unsigned level = 0;
+
+  while (level < levels - 1 &&
+         (t.deadline >> (bits * (level + 1))) !=
+             (current >> (bits * (level + 1))))
+    level++;
+
+  wheel[level][(t.deadline >> (bits * level)) & (slots - 1)].push_back(t);
+}
+
+void timing_wheel::advance(uint32_t now, std::vector<timer> *expired) {
+  while (current != now) {
+    current++;
+
+    // move the timers of the upper levels down whenever the levels below
+    // wrapped, the highest level first to move its timers all the way down
+    unsigned top = 0;
+    while (top < levels - 1 &&
+           ((current >> (bits * top)) & (slots - 1)) == 0)
+      top++;
+
+    for (unsigned level = top; level > 0; level--) {
+      std::vector<timer> cascade;
+      cascade.swap(wheel[level][(current >> (bits * level)) & (slots - 1)]);
+      for (const auto &t : cascade)
+        place(t);
+    }
+
+    auto &slot = wheel[0][current & (slots - 1)];
+    count -= slot.size();
+    expired->insert(expired->end(), slot.begin(), slot.end());
+    slot.clear();
+  }
+}
+
+void timing_wheel::reset(uint32_t now) {
+  for (auto &level : wheel)
+    for (auto &slot : level)
+      slot.clear();
+
+  current = now;
+  count = 0;
+}
+
+} // namespace basebox
@@ -0,0 +1,60 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace basebox {
+
+/**
+ * @brief hierarchical timing wheel
+ *
+ * Four levels of 64 slots, a timer is kept in the level of the highest 6 bit
+ * digit its deadline differs from the current tick in and moved down once the
+ * level below wraps around. Scheduling is O(1), each timer is moved at most
+ * once per level. Deadlines more than 64^4 ticks ahead are clamped.
+ *
+ * Timers cannot be cancelled, stale timers have to be recognized by the
+ * caller when they expire, e.g. by the data stored along with the key.
+ */
+class timing_wheel {
+public:
+  struct timer {
+    uint64_t key;
+    uint32_t deadline;
+    uint32_t data;
+  };
+
+  explicit timing_wheel(uint32_t now = 0);
+
+  timing_wheel(const timing_wheel &) = delete;
+  timing_wheel &operator=(const timing_wheel &) = delete;
+
+  // a deadline not after the current tick expires with the next one
+  void schedule(uint64_t key, uint32_t deadline, uint32_t data = 0);
+
+  // advance to now, appending the expired timers
+  void advance(uint32_t now, std::vector<timer> *expired);
+
+  // drop all timers and restart at now
+  void reset(uint32_t now);
+
+  uint32_t now() const { return current; }
+  std::size_t size() const { return count; }
+
+private:
+  static constexpr unsigned bits = 6;
+  static constexpr unsigned slots = 1 << bits;
+  static constexpr unsigned levels = 4;
+
+  void place(const timer &t);
+
+  std::vector<timer> wheel[levels][slots];
+  uint32_t current;
+  std::size_t count;
+};
+
+} // namespace basebox
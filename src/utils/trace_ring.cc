@@ -0,0 +1,185 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <glog/logging.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "trace_ring.h"
+
+namespace basebox {
+
+std::atomic<bool> trace_enabled(false);
+
+namespace {
+
+struct record {
+  int64_t start_ns;
+  int64_t dur_ns; // < 0 for instant events
+  const char *name;
+  uint64_t arg;
+};
+
+struct ring {
+  std::unique_ptr<record[]> records;
+  std::size_t mask;
+  std::atomic<uint64_t> head; // written by the owning thread only
+  pid_t tid;
+  char thread_name[16];
+};
+
+std::atomic<std::size_t> ring_size(0);
+
+// rings are kept after their thread exited to still dump them
+std::mutex rings_mutex;
+std::deque<std::unique_ptr<ring>> rings;
+
+thread_local ring *local_ring = nullptr;
+
+ring *get_ring() {
+  if (local_ring)
+    return local_ring;
+
+  std::size_t size = ring_size.load(std::memory_order_relaxed);
+  if (size == 0)
+    return nullptr;
+
+  std::unique_ptr<ring> r(new ring());
+  r->records.reset(new record[size]);
+  r->mask = size - 1;
+  r->head.store(0, std::memory_order_relaxed);
+  r->tid = syscall(SYS_gettid);
+  if (pthread_getname_np(pthread_self(), r->thread_name,
+                         sizeof(r->thread_name)) != 0)
+    r->thread_name[0] = '\0';
+
+  std::lock_guard<std::mutex> lock(rings_mutex);
+  local_ring = r.get();
+  rings.push_back(std::move(r));
+  return local_ring;
+}
+
+} // namespace
+
+void trace_enable(std::size_t records) {
+  std::size_t size = 1;
+
+  // a power of two to wrap around by masking
+  while (size < records)
+    size <<= 1;
+
+  ring_size.store(records ? size : 0, std::memory_order_relaxed);
+  trace_enabled.store(records != 0, std::memory_order_relaxed);
+
+  LOG(INFO) << __FUNCTION__ << ": tracing "
+            << (records ? "enabled" : "disabled") << ", records per thread "
+            << (records ? size : 0);
+}
+
+void trace_record(const char *name, int64_t start_ns, int64_t dur_ns,
+                  uint64_t arg) noexcept {
+  ring *r = get_ring();
+
+  if (r == nullptr)
+    return;
+
+  uint64_t h = r->head.load(std::memory_order_relaxed);
+  r->records[h & r->mask] = record{start_ns, dur_ns, name, arg};
+  r->head.store(h + 1, std::memory_order_release);
+}
+
+std::size_t trace_dump(std::ostream &os) {
+  std::lock_guard<std::mutex> lock(rings_mutex);
+  pid_t pid = getpid();
+  std::size_t n = 0;
+  const char *sep = "\n";
+
+  os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+  for (const auto &r : rings) {
+    os << sep << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+       << ",\"tid\":" << r->tid << ",\"args\":{\"name\":\"" << r->thread_name
+       << "\"}}";
+    sep = ",\n";
+
+    uint64_t head = r->head.load(std::memory_order_acquire);
+    uint64_t size = r->mask + 1;
+
+    for (uint64_t i = head > size ? head - size : 0; i < head; i++) {
+      const record &rec = r->records[i & r->mask];
+
+      // timestamps are in us
+      os << sep << "{\"name\":\"" << rec.name << "\",\"cat\":\"baseboxd\","
+         << "\"ph\":\"" << (rec.dur_ns < 0 ? "i" : "X") << "\",\"ts\":"
+         << rec.start_ns / 1000 << "." << std::setfill('0') << std::setw(3)
+         << rec.start_ns % 1000;
+      if (rec.dur_ns >= 0)
+        os << ",\"dur\":" << rec.dur_ns / 1000 << "." << std::setw(3)
+           << rec.dur_ns % 1000;
+      os << std::setfill(' ') << ",\"pid\":" << pid << ",\"tid\":" << r->tid
+         << ",\"args\":{\"arg\":" << rec.arg << "}}";
+      n++;
+    }
+  }
+
+  os << "\n]}\n";
+  return n;
+}
+
+int trace_dump_file(const std::string &path) {
+  std::ofstream f(path, std::ios::trunc);
+
+  if (!f.is_open())
+    return errno ? -errno : -EIO;
+
+  std::size_t n = trace_dump(f);
+  f.close();
+  if (f.fail())
+    return -EIO;
+
+  return n;
+}
+
+int trace_dump_on_signal(int signo, const std::string &path) {
+  sigset_t set;
+
+  sigemptyset(&set);
+  sigaddset(&set, signo);
+
+  int rv = pthread_sigmask(SIG_BLOCK, &set, nullptr);
+  if (rv != 0) {
+    LOG(ERROR) << __FUNCTION__ << ": failed to block signal " << signo << ": "
+               << strerror(rv);
+    return -rv;
+  }
+
+  std::thread t([set, path]() {
+    int sig;
+
+    while (sigwait(&set, &sig) == 0) {
+      int rv = trace_dump_file(path);
+      if (rv < 0)
+        LOG(ERROR) << "failed to dump trace to " << path << ": "
+                   << strerror(-rv);
+      else
+        LOG(INFO) << "dumped " << rv << " trace records to " << path;
+    }
+  });
+  pthread_setname_np(t.native_handle(), "trace_dump");
+  t.detach();
+
+  return 0;
+}
+
+} // namespace basebox
@@ -0,0 +1,94 @@
+// SPDX-FileCopyrightText: © 2026 BISDN GmbH
+// SPDX-License-Identifier: MPL-2.0-no-copyleft-exception
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace basebox {
+
+/**
+ * Event tracer writing fixed size binary records to a ring per thread
+ *
+ * A record holds the name of the tracepoint, which has to be a string of
+ * static storage, its start, duration and one argument. Every thread writes
+ * to a ring of its own, the oldest records are overwritten. Writing is lock
+ * free, a disabled tracepoint costs a relaxed load and a branch.
+ *
+ * The rings are dumped in the Chrome trace event format, which can be loaded
+ * into Perfetto or chrome://tracing. Records written while dumping may be
+ * torn.
+ */
+
+extern std::atomic<bool> trace_enabled;
+
+// keep records entries per thread, 0 disables tracing. Rings of threads that
+// traced before keep their size.
+void trace_enable(std::size_t records);
+
+void trace_record(const char *name, int64_t start_ns, int64_t dur_ns,
+                  uint64_t arg) noexcept;
+
+inline int64_t trace_ns(std::chrono::steady_clock::time_point t) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             t.time_since_epoch())
+      .count();
+}
+
+// something happened at this point
+inline void trace_instant(const char *name, uint64_t arg = 0) noexcept {
+  if (trace_enabled.load(std::memory_order_relaxed))
+    trace_record(name, trace_ns(std::chrono::steady_clock::now()), -1, arg);
+}
+
+// span started earlier, e.g. on another thread, and ending now
+inline void trace_span(const char *name,
+                       std::chrono::steady_clock::time_point start,
+                       uint64_t arg = 0) noexcept {
+  if (trace_enabled.load(std::memory_order_relaxed)) {
+    int64_t s = trace_ns(start);
+    trace_record(name, s, trace_ns(std::chrono::steady_clock::now()) - s, arg);
+  }
+}
+
+// span of the enclosing scope
+class trace_scope {
+public:
+  explicit trace_scope(const char *name, uint64_t arg = 0) noexcept
+      : name(trace_enabled.load(std::memory_order_relaxed) ? name : nullptr),
+        arg(arg), start(0) {
+    if (this->name)
+      start = trace_ns(std::chrono::steady_clock::now());
+  }
+
+  ~trace_scope() {
+    if (name)
+      trace_record(name, start,
+                   trace_ns(std::chrono::steady_clock::now()) - start, arg);
+  }
+
+  trace_scope(const trace_scope &) = delete;
+  trace_scope &operator=(const trace_scope &) = delete;
+
+private:
+  const char *name;
+  uint64_t arg;
+  int64_t start;
+};
+
+// write all rings to os, returns the number of records
+std::size_t trace_dump(std::ostream &os);
+
+// write all rings to path, returns the number of records or negative errno
+int trace_dump_file(const std::string &path);
+
+// dump to path whenever signo is received. Has to be called before any other
+// thread is started, the signal is blocked and waited for by a thread.
+int trace_dump_on_signal(int signo, const std::string &path);
+
+} // namespace basebox